@@ -1,249 +1,390 @@
-/**
- * \file    logging.c
- * \brief   Source file for logging
-
- * \author  Mathias Buder
- * \date    2024-09-13
-
- *  Copyright (c) 2024 Mathias Buder
- */
-
-#include <ArduinoLog.h>
-#include <EEPROM.h>
-
-#include "logging.h"
-
-
-/*************************************** Defines ****************************************/
-
-#define EEPROM_SETTINGS_ADDRESS     0                                   /*!< The EEPROM address where the settings are stored */
-#define EEPROM_EMPTY_CRC            13768940222999549550ULL             /*!< The initial value of the CRC in the EEPROM */
-
-/******************************** Function prototype ************************************/
-
-
-/**************************** Static Function prototype *********************************/
-static uint64_t appSettings_calculateCrc( settings_t* settings );
-static void     appSettings_writeCrc( settings_t* settings );
-static uint64_t appSettings_readCrc( void );
-static void     appSettings_loadSettings( settings_t* settings );
-
-/******************************** Global variables **************************************/
-
-static settings_t appSettings = {
-    .doorUnlockTimeout = DOOR_UNLOCK_TIMEOUT,
-    .doorOpenTimeout   = DOOR_OPEN_TIMEOUT,
-    .ledBlinkInterval  = LED_BLINK_INTERVAL,
-    .debounceDelay     = {
-                            DEBOUNCE_DELAY_DOOR_BUTTON_1,
-                            DEBOUNCE_DELAY_DOOR_BUTTON_2,
-                            DEBOUNCE_DELAY_DOOR_SWITCH_1,
-                            DEBOUNCE_DELAY_DOOR_SWITCH_2
-                        },
-    .logLevel          = DEFAULT_LOG_LEVEL
-};
-
-
-/******************************** Function definition ************************************/
-
-
-/**
- * @brief Initializes the application settings.
- *
- * This function sets up the application settings by reading the CRC value from the EEPROM.
- * If no settings are found in the EEPROM (indicated by a specific empty CRC value), it uses
- * the default settings. If settings are found, it loads them and verifies their integrity
- * by comparing the CRC value from the EEPROM with a newly calculated CRC value. If the CRC
- * values match, the settings are copied to the global variable. If there is a CRC mismatch,
- * it falls back to using the default settings.
- */
-void appSettings_setup( void )
-{
-    Serial.println( String( __func__ ) + ": Setting up the application settings" );
-
-    /* Read the settings from the EEPROM */
-    settings_t settings;
-    appSettings_loadSettings( &settings );
-
-    /* Calculate the CRC value for the settings */
-    uint64_t crc = appSettings_calculateCrc( &settings );
-
-    /* Check if the CRC value equals the empty CRC value */
-    if ( crc == EEPROM_EMPTY_CRC )
-    {
-        Serial.println( String( __func__ ) + ": No settings found in EEPROM. Using default settings" );
-    }
-    else
-    {
-        /* Read the CRC value from the EEPROM */
-        uint64_t eepromCrc = appSettings_readCrc();
-
-        /* Check if the CRC values match */
-        if ( crc == eepromCrc )
-        {
-            /* Copy the settings to the global variable */
-            memcpy( &appSettings, &settings, sizeof( settings_t ) );
-            Serial.println( String( __func__ ) + ": Settings loaded from EEPROM" );
-        }
-        else
-        {
-            Serial.println( String( __func__ ) + ": CRC mismatch. Using default settings" );
-        }
-    }
-}
-
-
-/**
- * @brief Retrieves the application settings.
- *
- * This function returns a pointer to the application's settings structure.
- *
- * @return A pointer to the settings_t structure containing the application settings.
- */
-settings_t* appSettings_getSettings( void )
-{
-    Log.verboseln( "%s: Settings fetched", __func__ );
-    return &appSettings;
-}
-
-
-/**
- * @brief Loads the application settings from EEPROM into the provided settings structure.
- *
- * This function reads the settings data stored in EEPROM and populates the provided
- * settings structure with this data. It reads byte-by-byte from the EEPROM starting
- * from address 0.
- *
- * @param settings Pointer to the settings structure where the loaded data will be stored.
- *                 If this pointer is NULL, the function logs an error and returns immediately.
- */
-static void appSettings_loadSettings( settings_t* settings )
-{
-    if ( settings == NULL )
-    {
-        Log.error( "%s: settings is NULL", __func__ );
-        return;
-    }
-
-    uint16_t address = EEPROM_SETTINGS_ADDRESS;
-    uint8_t* ptr     = (uint8_t*) settings;
-
-    for ( uint8_t i = 0; i < sizeof( settings_t ); i++ )
-    {
-        *ptr = EEPROM.read( address );
-        ptr++;
-        address++;
-    }
-
-    Log.verboseln( "%s: Settings fetched from EEPROM", __func__ );
-}
-
-
-/**
- * @brief Saves the application settings to EEPROM.
- *
- * This function writes the provided settings structure to the EEPROM
- * starting at a predefined address. It also updates the CRC value in
- * the EEPROM to ensure data integrity.
- *
- * @param settings Pointer to the settings structure to be saved. If the
- *                 pointer is NULL, the function logs an error and returns
- *                 without performing any operation.
- */
-void appSettings_saveSettings( void )
-{
-    uint16_t address = EEPROM_SETTINGS_ADDRESS;
-    uint8_t* ptr     = (uint8_t*) &appSettings;
-
-    for ( uint8_t i = 0; i < sizeof( settings_t ); i++ )
-    {
-        EEPROM.write( address, *ptr );
-        ptr++;
-        address++;
-    }
-
-    /* Update the CRC value in the EEPROM */
-    appSettings_writeCrc( &appSettings );
-
-    Log.noticeln( "%s: Settings saved to EEPROM", __func__ );
-}
-
-/**
- * @brief Calculates the CRC-64 checksum for the given settings.
- *
- * This function computes the CRC-64 checksum using the polynomial 0xC96C5795D7870F42.
- * It iterates over each byte of the settings structure and updates the CRC value accordingly.
- *
- * @param settings Pointer to the settings structure for which the CRC is to be calculated.
- * @return The calculated CRC-64 checksum.
- */
-static uint64_t appSettings_calculateCrc( settings_t* settings )
-{
-    uint64_t crc = 0xFFFFFFFF;
-    uint8_t* ptr = (uint8_t*) settings;
-
-    for ( uint8_t i = 0; i < sizeof( settings_t ); i++ )
-    {
-        crc = crc ^ *ptr;
-        for ( uint8_t j = 0; j < 8; j++ )
-        {
-            if ( crc & 1 )
-            {
-                crc = ( crc >> 1 ) ^ 0xC96C5795D7870F42; /*!< Polynomial used in CRC-64-ISO */
-            }
-            else
-            {
-                crc = crc >> 1;
-            }
-        }
-        ptr++;
-    }
-
-    Log.verboseln( "%s: CRC %l calculated", __func__, crc );
-
-    return crc;
-}
-
-
-/**
- * @brief Writes the CRC value for the given settings to the EEPROM memory.
- *
- * This function calculates the CRC value for the provided settings and writes
- * it to the end of the EEPROM memory. The CRC value is used to ensure data
- * integrity.
- *
- * @param settings Pointer to the settings structure for which the CRC is calculated.
- */
-static void appSettings_writeCrc( settings_t* settings )
-{
-    /* Calculate the CRC value for the settings */
-    uint64_t crc = appSettings_calculateCrc( settings );
-
-    /* Write the CRC value to the end of the EEPROM memory */
-    uint16_t address = EEPROM.length() - sizeof( uint64_t ) - 1;
-    EEPROM.put( address, crc );
-
-    Log.verboseln( "%s: CRC %l written to EEPROM", __func__, crc );
-}
-
-
-/**
- * @brief Reads the CRC value from the end of the EEPROM memory.
- *
- * This function calculates the address of the CRC value stored at the end of the EEPROM memory,
- * reads the CRC value from that address, and returns it.
- *
- * @return The CRC value read from the EEPROM memory.
- */
-static uint64_t appSettings_readCrc( void )
-{
-    uint64_t crc = 0;
-
-    /* Read the CRC value from the end of the EEPROM memory */
-    uint16_t address = EEPROM.length() - sizeof( uint64_t ) - 1;
-    EEPROM.get( address, crc );
-
-    Log.verboseln( "%s: CRC %l read from EEPROM", __func__, crc );
-
-    return crc;
-}
+/**
+ * \file    logging.c
+ * \brief   Source file for logging
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <ArduinoLog.h>
+#include <EEPROM.h>
+
+#include "logging.h"
+
+
+/*************************************** Defines ****************************************/
+
+#define EEPROM_SETTINGS_ADDRESS     0                                   /*!< The EEPROM address where the settings are stored */
+#define EEPROM_ERASED_BYTE          0xFF                                /*!< The value of an erased EEPROM byte */
+#define CRC_INIT                    0xFFFFFFFF                          /*!< The initial value of the CRC */
+#define CRC_POLYNOMIAL              0xC96C5795D7870F42                  /*!< Polynomial used in CRC-64-ISO */
+
+/******************************** Function prototype ************************************/
+
+
+/**************************** Static Function prototype *********************************/
+static constexpr uint64_t appSettings_crcBits( const uint64_t crc, const uint8_t bits );
+static constexpr uint64_t appSettings_crcErased( const uint64_t crc, const uint16_t bytes );
+static void     appSettings_writeCrc( settings_t* settings );
+static uint64_t appSettings_readCrc( void );
+static void     appSettings_loadSettings( settings_t* settings );
+
+/******************************** Global variables **************************************/
+
+/**
+ * @brief Shifts bits of a CRC value through the CRC-64 polynomial.
+ *
+ * Compile time counterpart of the inner loop of appSettings_calculateCrc().
+ *
+ * @param crc The CRC value.
+ * @param bits The number of bits to shift.
+ * @return The CRC value after the bits were shifted.
+ */
+static constexpr uint64_t appSettings_crcBits( const uint64_t crc, const uint8_t bits )
+{
+    return ( bits == 0 ) ? crc : appSettings_crcBits( ( crc & 1 ) ? ( ( crc >> 1 ) ^ CRC_POLYNOMIAL ) : ( crc >> 1 ), bits - 1 );
+}
+
+
+/**
+ * @brief Calculates the CRC-64 checksum of erased EEPROM bytes at compile time.
+ *
+ * The bytes are split in halves, so the recursion depth only grows with the logarithm
+ * of the size of the settings.
+ *
+ * @param crc The CRC value before the bytes.
+ * @param bytes The number of erased bytes.
+ * @return The CRC value after the bytes.
+ */
+static constexpr uint64_t appSettings_crcErased( const uint64_t crc, const uint16_t bytes )
+{
+    return ( bytes == 0 ) ? crc
+         : ( bytes == 1 ) ? appSettings_crcBits( crc ^ EEPROM_ERASED_BYTE, 8 )
+         : appSettings_crcErased( appSettings_crcErased( crc, bytes / 2 ), bytes - bytes / 2 );
+}
+
+/*!< The CRC of settings read from an erased EEPROM, follows the size of settings_t */
+static constexpr uint64_t eepromEmptyCrc = appSettings_crcErased( CRC_INIT, sizeof( settings_t ) );
+
+static settings_t appSettings = {
+    .doorUnlockTimeout = DOOR_UNLOCK_TIMEOUT,
+    .doorOpenTimeout   = DOOR_OPEN_TIMEOUT,
+    .ledBlinkInterval  = LED_BLINK_INTERVAL,
+    .debounceDelay     = {
+                            DEBOUNCE_DELAY_DOOR_BUTTON_1,
+                            DEBOUNCE_DELAY_DOOR_BUTTON_2,
+                            DEBOUNCE_DELAY_DOOR_SWITCH_1,
+                            DEBOUNCE_DELAY_DOOR_SWITCH_2
+                        },
+    .logLevel          = DEFAULT_LOG_LEVEL,
+    .busAddress        = CTRL_BUS_ADDRESS,
+    .busNeighbours     = CTRL_BUS_NEIGHBOURS,
+    .badgeDoors        = BADGE_DOORS,
+    .emergencyInput    = EMERGENCY_INPUT,
+    .dispatchMaxEvents = DISPATCH_MAX_EVENTS,
+    .dispatchMaxTime   = DISPATCH_MAX_TIME,
+    .deferMaxAge       = DEFER_MAX_AGE
+};
+
+static settings_status_t settingsStatus = SETTINGS_STATUS_DEFAULT; /*!< The outcome of loading the settings */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Initializes the application settings.
+ *
+ * This function sets up the application settings by reading the CRC value from the EEPROM.
+ * If no settings are found in the EEPROM (indicated by the CRC of an erased EEPROM), it uses
+ * the default settings. If settings are found, it loads them and verifies their integrity
+ * by comparing the CRC value from the EEPROM with a newly calculated CRC value. If the CRC
+ * values match and the settings are valid, the settings are copied to the global variable.
+ * Otherwise it falls back to using the default settings.
+ *
+ * Runs before the serial interface and the logging are started, because the door control
+ * needs the settings. The outcome is logged later by appSettings_logStatus().
+ */
+void appSettings_setup( void )
+{
+    /* Read the settings from the EEPROM */
+    settings_t settings;
+    appSettings_loadSettings( &settings );
+
+    /* Calculate the CRC value for the settings */
+    uint64_t crc = appSettings_calculateCrc( &settings );
+
+    /* Check if the CRC value equals the empty CRC value */
+    if ( crc == eepromEmptyCrc )
+    {
+        settingsStatus = SETTINGS_STATUS_DEFAULT;
+    }
+    else
+    {
+        /* Read the CRC value from the EEPROM */
+        uint64_t eepromCrc = appSettings_readCrc();
+
+        /* Check if the CRC values match */
+        if ( crc != eepromCrc )
+        {
+            settingsStatus = SETTINGS_STATUS_CRC_MISMATCH;
+        }
+        /* Settings saved by an older firmware may be intact but out of range */
+        else if ( !appSettings_validateSettings( &settings ) )
+        {
+            settingsStatus = SETTINGS_STATUS_INVALID;
+        }
+        else
+        {
+            /* Copy the settings to the global variable */
+            memcpy( &appSettings, &settings, sizeof( settings_t ) );
+            settingsStatus = SETTINGS_STATUS_LOADED;
+        }
+    }
+}
+
+
+/**
+ * @brief Logs the outcome of loading the settings at boot.
+ *
+ * Must be called once the logging is set up.
+ */
+void appSettings_logStatus( void )
+{
+    switch ( settingsStatus )
+    {
+        case SETTINGS_STATUS_LOADED:
+            Log.noticeln( "%s: Settings loaded from EEPROM", __func__ );
+            break;
+
+        case SETTINGS_STATUS_CRC_MISMATCH:
+            Log.warningln( "%s: CRC mismatch. Using default settings", __func__ );
+            break;
+
+        case SETTINGS_STATUS_INVALID:
+            Log.warningln( "%s: Invalid settings in EEPROM. Using default settings", __func__ );
+            break;
+
+        default:
+            Log.noticeln( "%s: No settings found in EEPROM. Using default settings", __func__ );
+            break;
+    }
+}
+
+
+/**
+ * @brief Retrieves the application settings.
+ *
+ * This function returns a pointer to the application's settings structure.
+ *
+ * @return A pointer to the settings_t structure containing the application settings.
+ */
+settings_t* appSettings_getSettings( void )
+{
+    Log.verboseln( "%s: Settings fetched", __func__ );
+    return &appSettings;
+}
+
+
+/**
+ * @brief Loads the application settings from EEPROM into the provided settings structure.
+ *
+ * This function reads the settings data stored in EEPROM and populates the provided
+ * settings structure with this data. It reads byte-by-byte from the EEPROM starting
+ * from address 0.
+ *
+ * @param settings Pointer to the settings structure where the loaded data will be stored.
+ *                 If this pointer is NULL, the function logs an error and returns immediately.
+ */
+static void appSettings_loadSettings( settings_t* settings )
+{
+    if ( settings == NULL )
+    {
+        Log.error( "%s: settings is NULL", __func__ );
+        return;
+    }
+
+    uint16_t address = EEPROM_SETTINGS_ADDRESS;
+    uint8_t* ptr     = (uint8_t*) settings;
+
+    for ( uint16_t i = 0; i < sizeof( settings_t ); i++ )
+    {
+        *ptr = EEPROM.read( address );
+        ptr++;
+        address++;
+    }
+
+    Log.verboseln( "%s: Settings fetched from EEPROM", __func__ );
+}
+
+
+/**
+ * @brief Saves the application settings to EEPROM.
+ *
+ * This function writes the provided settings structure to the EEPROM
+ * starting at a predefined address. Unchanged bytes are not rewritten to
+ * save EEPROM wear. It also updates the CRC value in the EEPROM to ensure
+ * data integrity.
+ *
+ * @param settings Pointer to the settings structure to be saved. If the
+ *                 pointer is NULL, the function logs an error and returns
+ *                 without performing any operation.
+ */
+void appSettings_saveSettings( void )
+{
+    uint16_t address = EEPROM_SETTINGS_ADDRESS;
+    uint8_t* ptr     = (uint8_t*) &appSettings;
+
+    /* Only bytes that differ from the EEPROM content are written */
+    for ( uint16_t i = 0; i < sizeof( settings_t ); i++ )
+    {
+        EEPROM.update( address, *ptr );
+        ptr++;
+        address++;
+    }
+
+    /* Update the CRC value in the EEPROM */
+    appSettings_writeCrc( &appSettings );
+
+    Log.noticeln( "%s: Settings saved to EEPROM", __func__ );
+}
+
+
+/**
+ * @brief Validates a complete set of settings.
+ *
+ * Used before a set of settings is applied, so a configuration batch is either applied
+ * completely or not at all.
+ *
+ * @param settings Pointer to the settings to validate.
+ * @return true if all settings are valid.
+ */
+bool appSettings_validateSettings( const settings_t* const settings )
+{
+    bool valid = true;
+
+    if ( settings->logLevel > LOG_LEVEL_VERBOSE )
+    {
+        Log.errorln( "%s: Invalid log level: %d", __func__, settings->logLevel );
+        valid = false;
+    }
+
+    if ( settings->ledBlinkInterval == 0 )
+    {
+        Log.errorln( "%s: The led blink interval must not be 0", __func__ );
+        valid = false;
+    }
+
+    if ( settings->busAddress > CTRL_BUS_MAX_ADDRESS )
+    {
+        Log.errorln( "%s: Invalid bus address: %d", __func__, settings->busAddress );
+        valid = false;
+    }
+    else if ( ( settings->busAddress != 0 ) && ( settings->busNeighbours & ( 1 << ( settings->busAddress - 1 ) ) ) )
+    {
+        Log.errorln( "%s: A controller can't be its own neighbour", __func__ );
+        valid = false;
+    }
+
+    if ( settings->badgeDoors >= ( 1 << DOOR_TYPE_SIZE ) )
+    {
+        Log.errorln( "%s: Invalid badge doors: 0x%x", __func__, settings->badgeDoors );
+        valid = false;
+    }
+
+    if ( settings->emergencyInput > 1 )
+    {
+        Log.errorln( "%s: Invalid emergency input: %d", __func__, settings->emergencyInput );
+        valid = false;
+    }
+
+    if ( settings->dispatchMaxTime > DISPATCH_MAX_TIME_LIMIT )
+    {
+        Log.errorln( "%s: Invalid dispatch time budget: %d us", __func__, settings->dispatchMaxTime );
+        valid = false;
+    }
+
+    return valid;
+}
+
+/**
+ * @brief Calculates the CRC-64 checksum for the given settings.
+ *
+ * This function computes the CRC-64 checksum using the polynomial 0xC96C5795D7870F42.
+ * It iterates over each byte of the settings structure and updates the CRC value accordingly.
+ *
+ * @param settings Pointer to the settings structure for which the CRC is to be calculated.
+ * @return The calculated CRC-64 checksum.
+ */
+uint64_t appSettings_calculateCrc( const settings_t* const settings )
+{
+    uint64_t       crc = CRC_INIT;
+    const uint8_t* ptr = (const uint8_t*) settings;
+
+    for ( uint16_t i = 0; i < sizeof( settings_t ); i++ )
+    {
+        crc = crc ^ *ptr;
+        for ( uint8_t j = 0; j < 8; j++ )
+        {
+            if ( crc & 1 )
+            {
+                crc = ( crc >> 1 ) ^ CRC_POLYNOMIAL;
+            }
+            else
+            {
+                crc = crc >> 1;
+            }
+        }
+        ptr++;
+    }
+
+    Log.verboseln( "%s: CRC %l calculated", __func__, crc );
+
+    return crc;
+}
+
+
+/**
+ * @brief Writes the CRC value for the given settings to the EEPROM memory.
+ *
+ * This function calculates the CRC value for the provided settings and writes
+ * it to the end of the EEPROM memory. The CRC value is used to ensure data
+ * integrity.
+ *
+ * @param settings Pointer to the settings structure for which the CRC is calculated.
+ */
+static void appSettings_writeCrc( settings_t* settings )
+{
+    /* Calculate the CRC value for the settings */
+    uint64_t crc = appSettings_calculateCrc( settings );
+
+    /* Write the CRC value to the end of the EEPROM memory */
+    uint16_t address = EEPROM.length() - sizeof( uint64_t ) - 1;
+    EEPROM.put( address, crc );
+
+    Log.verboseln( "%s: CRC %l written to EEPROM", __func__, crc );
+}
+
+
+/**
+ * @brief Reads the CRC value from the end of the EEPROM memory.
+ *
+ * This function calculates the address of the CRC value stored at the end of the EEPROM memory,
+ * reads the CRC value from that address, and returns it.
+ *
+ * @return The CRC value read from the EEPROM memory.
+ */
+static uint64_t appSettings_readCrc( void )
+{
+    uint64_t crc = 0;
+
+    /* Read the CRC value from the end of the EEPROM memory */
+    uint16_t address = EEPROM.length() - sizeof( uint64_t ) - 1;
+    EEPROM.get( address, crc );
+
+    Log.verboseln( "%s: CRC %l read from EEPROM", __func__, crc );
+
+    return crc;
+}
@@ -48,7 +48,7 @@
 #define DEBOUNCE_DELAY_DOOR_BUTTON_2    100            /*!< Debounce delay for the door button @unit ms*/
 #define DEBOUNCE_DELAY_DOOR_SWITCH_1    300            /*!< Debounce delay for the door switch @unit ms*/
 #define DEBOUNCE_DELAY_DOOR_SWITCH_2    300            /*!< Debounce delay for the door switch @unit ms*/
-#define DEBOUNCE_STABLE_TIMEOUT         300            /*!< Timeout for the debounce stable state @unit ms */
+#define DEBOUNCE_STABLE_TIMEOUT         300            /*!< Margin on top of the door switch debounce delay for the init state @unit ms */
 
 #define SERIAL_BAUD_RATE                115200         /*!< Baud rate of the serial communication @unit bps */
 #define DEFAULT_LOG_LEVEL               LOG_LEVEL_INFO /*!< Default log level */
@@ -57,10 +57,39 @@
 #define DOOR_UNLOCK_TIMEOUT             5              /*!< Timeout for the door unlock ( 0 = disabled ) @unit s */
 #define DOOR_OPEN_TIMEOUT               600            /*!< Timeout for the door open ( 0 = disabled ) @unit s */
 
+#define CTRL_BUS_MAX_ADDRESS            8              /*!< Highest address on the controller bus */
+#define CTRL_BUS_ADDRESS                0              /*!< Address on the controller bus ( 0 = disabled ) */
+#define CTRL_BUS_NEIGHBOURS             0x00           /*!< Controllers interlocked with this one, bit n-1 = address n */
+
+#define BADGE_DOORS                     0x00           /*!< Doors that only unlock with a badge, bit n = door n */
+
+#define EMERGENCY_INPUT                 0              /*!< The emergency input is wired ( 0 = disabled ) */
+
+#define DISPATCH_MAX_EVENTS             8              /*!< Most events dispatched per main loop iteration ( 0 = unlimited ) */
+#define DISPATCH_MAX_TIME               5000           /*!< Longest event dispatch per main loop iteration ( 0 = unlimited ) @unit us */
+#define DISPATCH_MAX_TIME_LIMIT         40000          /*!< Highest dispatch time budget, below the watchdog deadline of the dispatch @unit us */
+#define DEFER_MAX_AGE                   10             /*!< Age after which a deferred event is dropped ( 0 = never ) @unit s */
+#define DEFER_MAX_AGE_LIMIT             UINT16_MAX     /*!< Highest deferral age, the range of the setting, far below the wraparound of the millisecond clock @unit s */
+
+#define SCHED_DAYS                      7              /*!< Days of the access schedule, Monday first */
+#define SCHED_SLOT_LENGTH               15             /*!< Length of a slot of the access schedule @unit min */
+#define SCHED_SLOTS_PER_DAY             ( 24 * 60 / SCHED_SLOT_LENGTH )      /*!< Slots of the access schedule per day */
+#define SCHED_SLOT_BYTES                ( SCHED_SLOTS_PER_DAY / 8 )          /*!< Bytes of the slot bitmap of a day */
+
 
 
 /************************************ ENUMERATION *************************************/
 
+/**
+ * @brief Enumeration of the outcome of loading the settings at boot
+ */
+typedef enum
+{
+    SETTINGS_STATUS_DEFAULT,      /*!< No settings in the EEPROM, the defaults are used */
+    SETTINGS_STATUS_LOADED,       /*!< The settings were loaded from the EEPROM */
+    SETTINGS_STATUS_CRC_MISMATCH, /*!< The settings in the EEPROM are damaged, the defaults are used */
+    SETTINGS_STATUS_INVALID       /*!< The settings in the EEPROM are out of range, the defaults are used */
+} settings_status_t;
 
 
 /************************************* STRUCTURE **************************************/
@@ -72,13 +101,24 @@ typedef struct
     uint16_t ledBlinkInterval;             /*!< The led blink interval */
     uint16_t debounceDelay[IO_INPUT_SIZE]; /*!< The debounce delay of the inputs */
     uint8_t  logLevel;                     /*!< The log level */
+    uint8_t  busAddress;                   /*!< The address on the controller bus */
+    uint8_t  busNeighbours;                /*!< The interlocked controllers on the bus */
+    uint8_t  badgeDoors;                   /*!< The doors that only unlock with a badge */
+    uint8_t  lockedSlots[DOOR_TYPE_SIZE][SCHED_DAYS][SCHED_SLOT_BYTES]; /*!< Bit n of a day is set if the door stays locked in slot n */
+    uint8_t  emergencyInput;               /*!< The emergency input is wired */
+    uint8_t  dispatchMaxEvents;            /*!< The most events dispatched per main loop iteration */
+    uint16_t dispatchMaxTime;              /*!< The longest event dispatch per main loop iteration */
+    uint16_t deferMaxAge;                  /*!< The age after which a deferred event is dropped */
 } settings_t;
 
 
 /******************************** Function prototype ************************************/
 
 void        appSettings_setup( void );
+void        appSettings_logStatus( void );
 settings_t* appSettings_getSettings( void );
 void        appSettings_saveSettings( void );
+bool        appSettings_validateSettings( const settings_t* const settings );
+uint64_t    appSettings_calculateCrc( const settings_t* const settings );
 
 #endif  // APPSETTINGS_H
\ No newline at end of file
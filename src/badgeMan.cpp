@@ -0,0 +1,448 @@
+/**
+ * \file    badgeMan.cpp
+ * \brief   Source file for the badge readers
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <ArduinoLog.h>
+#include "badgeMan.h"
+#include "credStore.h"
+#include "appSettings.h"
+#include "sysClock.h"
+
+/*
+ * A Wiegand reader sends a frame as pulses on two lines, a pulse on D0 for a 0 bit and
+ * on D1 for a 1 bit. The interrupt handlers only shift the bits into the receive buffer
+ * of the reader. The main loop takes the frame once no bit arrived for BADGE_FRAME_GAP,
+ * checks the parity and looks the credential up in the credential table:
+ *
+ *     26 bits: even parity | facility (8) | card (16) | odd parity
+ *     34 bits: even parity | credential (32)          | odd parity
+ *
+ * The first parity bit covers the first half of the frame, the last one the second half.
+ * The credential of a 26-bit frame is facility << 16 | card.
+ *
+ * On a badge door, the button doesn't unlock any more. An accepted badge requests the
+ * unlock instead, until the door is unlocked or BADGE_REQUEST_TIMEOUT expires.
+ */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The Wiegand receiver of a reader
+ * @details The bits and the bit count are written by the interrupt handlers
+ */
+typedef struct
+{
+    volatile uint8_t  bits[( BADGE_MAX_BITS + 7 ) / 8]; /*!< The received bits, MSB first */
+    volatile uint8_t  bitCount;                         /*!< Number of received bits, BADGE_MAX_BITS + 1 on overflow */
+    uint8_t           seenCount;                        /*!< The bit count at the last check */
+    uint32_t          lastChange;                       /*!< Time the bit count changed last @unit ms */
+} badge_reader_t;
+
+/**
+ * @brief The badge management structure
+ */
+typedef struct
+{
+    door_control_t* pDoorControl;                  /*!< The door control instance of the readers */
+    uint8_t         doors;                         /*!< The badge doors, bit n = door n */
+    bool            requested[DOOR_TYPE_SIZE];     /*!< An accepted badge waits for the door to unlock */
+    uint32_t        requestTime[DOOR_TYPE_SIZE];   /*!< Time the badge was accepted @unit ms */
+    badge_reader_t  readers[DOOR_TYPE_SIZE];       /*!< The reader of every door */
+    badge_stats_t   stats;                         /*!< The badge statistics */
+#if defined( ARDUINO_ARCH_AVR )
+    uint8_t         portLevel;                     /*!< The level of port K at the last pin change */
+#endif
+} badge_man_t;
+
+
+/**************************** Static Function prototype *********************************/
+
+static input_state_t badgeMan_getUnlockRequest( door_control_t* const pDoorControl, door_type_t door, input_state_t button );
+static void          badgeMan_processReader( door_type_t door, uint32_t now );
+static void          badgeMan_processRequest( door_type_t door, uint32_t now );
+static void          badgeMan_handleFrame( door_type_t door, const uint8_t* const pBits, uint8_t bitCount, uint32_t now );
+static bool          badgeMan_getBit( const uint8_t* const pBits, uint8_t index );
+static void          badgeMan_shiftBit( badge_reader_t* const pReader, uint8_t bit );
+
+#if !defined( ARDUINO_ARCH_AVR )
+static void badgeMan_isrDoor1D0( void );
+static void badgeMan_isrDoor1D1( void );
+static void badgeMan_isrDoor2D0( void );
+static void badgeMan_isrDoor2D1( void );
+#endif
+
+
+/******************************** Global variables ************************************/
+
+static badge_man_t badge; /*!< The badge readers */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the badge readers.
+ *
+ * Enables the interrupts of the reader data lines, applies the badge doors of the settings
+ * and filters the unlock requests of the instance.
+ *
+ * @param pDoorControl Pointer to the door control instance of the readers.
+ */
+void badgeMan_setup( door_control_t* const pDoorControl )
+{
+    badge.pDoorControl = pDoorControl;
+
+    pinMode( BADGE_1_D0_PIN, INPUT_PULLUP );
+    pinMode( BADGE_1_D1_PIN, INPUT_PULLUP );
+    pinMode( BADGE_2_D0_PIN, INPUT_PULLUP );
+    pinMode( BADGE_2_D1_PIN, INPUT_PULLUP );
+
+#if defined( ARDUINO_ARCH_AVR )
+    badge.portLevel = PINK;
+    PCMSK2 |= ( 1 << PCINT16 ) | ( 1 << PCINT17 ) | ( 1 << PCINT18 ) | ( 1 << PCINT19 );
+    PCICR  |= ( 1 << PCIE2 );
+#else
+    attachInterrupt( digitalPinToInterrupt( BADGE_1_D0_PIN ), badgeMan_isrDoor1D0, FALLING );
+    attachInterrupt( digitalPinToInterrupt( BADGE_1_D1_PIN ), badgeMan_isrDoor1D1, FALLING );
+    attachInterrupt( digitalPinToInterrupt( BADGE_2_D0_PIN ), badgeMan_isrDoor2D0, FALLING );
+    attachInterrupt( digitalPinToInterrupt( BADGE_2_D1_PIN ), badgeMan_isrDoor2D1, FALLING );
+#endif
+
+    badgeMan_setDoors( appSettings_getSettings()->badgeDoors );
+
+    pDoorControl->unlockRequest = badgeMan_getUnlockRequest;
+}
+
+
+/**
+ * @brief Sets the doors that unlock with a badge only.
+ *
+ * Pending badge requests are dropped.
+ *
+ * @param doors The badge doors, bit n = door n.
+ */
+void badgeMan_setDoors( uint8_t doors )
+{
+    badge.doors = doors & ( ( 1 << DOOR_TYPE_SIZE ) - 1 );
+    memset( badge.requested, 0, sizeof( badge.requested ) );
+
+    Log.noticeln( "%s: Badge doors 0x%x", __func__, badge.doors );
+}
+
+
+/**
+ * @brief Processes the badge readers.
+ *
+ * Must be called once per main loop iteration. Decodes the completed frames and drops
+ * the requests of accepted badges that were used or expired.
+ */
+void badgeMan_process( void )
+{
+    const uint32_t now = sysClock_millis();
+
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        badgeMan_processReader( (door_type_t) door, now );
+        badgeMan_processRequest( (door_type_t) door, now );
+    }
+}
+
+
+/**
+ * @brief Decodes a 26-bit or 34-bit Wiegand frame.
+ *
+ * @param pBits The bits of the frame, MSB first.
+ * @param bitCount The number of bits.
+ * @param pId Pointer to store the credential.
+ * @return true if the length and both parity bits are valid, false otherwise.
+ */
+bool badgeMan_decode( const uint8_t* const pBits, uint8_t bitCount, uint32_t* const pId )
+{
+    if ( ( bitCount != 26 ) && ( bitCount != 34 ) )
+    {
+        return false;
+    }
+
+    const uint8_t half   = bitCount / 2;
+    uint8_t       even   = 0;
+    uint8_t       odd    = 1;
+    uint32_t      id     = 0;
+
+    for ( uint8_t i = 0; i < bitCount; i++ )
+    {
+        const bool bit = badgeMan_getBit( pBits, i );
+
+        if ( i < half )
+        {
+            even ^= bit;
+        }
+        else
+        {
+            odd ^= bit;
+        }
+
+        if ( ( i > 0 ) && ( i < ( bitCount - 1 ) ) )
+        {
+            id = ( id << 1 ) | bit;
+        }
+    }
+
+    *pId = id;
+
+    return ( even == 0 ) && ( odd == 0 );
+}
+
+
+/**
+ * @brief Returns the badge reader statistics.
+ *
+ * @return const badge_stats_t* The statistics.
+ */
+const badge_stats_t* badgeMan_getStats( void )
+{
+    return &badge.stats;
+}
+
+
+/**
+ * @brief Returns the unlock request of a door.
+ *
+ * On a badge door an accepted badge requests the unlock, otherwise the button. A replayed
+ * trace contains no badges, the replayed instance has no filter and its buttons request
+ * the unlock.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param door The door.
+ * @param button The debounced state of the button of the door.
+ * @return input_state_t INPUT_STATE_ACTIVE if the door is requested to unlock.
+ */
+static input_state_t badgeMan_getUnlockRequest( door_control_t* const pDoorControl, door_type_t door, input_state_t button )
+{
+    if ( ( badge.doors & ( 1 << door ) ) == 0 )
+    {
+        return button;
+    }
+
+    return badge.requested[door] ? INPUT_STATE_ACTIVE : INPUT_STATE_INACTIVE;
+}
+
+
+/**
+ * @brief Takes the frame of a reader once no bit arrived for BADGE_FRAME_GAP.
+ *
+ * @param door The door of the reader.
+ * @param now The current time @unit ms
+ */
+static void badgeMan_processReader( door_type_t door, uint32_t now )
+{
+    badge_reader_t* const pReader = &badge.readers[door];
+    uint8_t               bits[sizeof( pReader->bits )];
+    uint8_t               bitCount;
+
+    noInterrupts();
+    bitCount = pReader->bitCount;
+
+    if ( ( bitCount == 0 ) || ( bitCount != pReader->seenCount ) || ( ( now - pReader->lastChange ) < BADGE_FRAME_GAP ) )
+    {
+        interrupts();
+
+        if ( bitCount != pReader->seenCount )
+        {
+            pReader->seenCount  = bitCount;
+            pReader->lastChange = now;
+        }
+        return;
+    }
+
+    for ( uint8_t i = 0; i < sizeof( bits ); i++ )
+    {
+        bits[i]          = pReader->bits[i];
+        pReader->bits[i] = 0;
+    }
+    pReader->bitCount = 0;
+    interrupts();
+
+    pReader->seenCount = 0;
+    badgeMan_handleFrame( door, bits, bitCount, now );
+}
+
+
+/**
+ * @brief Drops the request of an accepted badge once the door is unlocked or the request expired.
+ *
+ * @param door The door.
+ * @param now The current time @unit ms
+ */
+static void badgeMan_processRequest( door_type_t door, uint32_t now )
+{
+    if ( !badge.requested[door] )
+    {
+        return;
+    }
+
+    const door_control_state_t state = stateMan_getState( badge.pDoorControl );
+
+    if (    ( ( door == DOOR_TYPE_DOOR_1 ) && ( ( state == DOOR_CONTROL_STATE_DOOR_1_UNLOCKED ) || ( state == DOOR_CONTROL_STATE_DOOR_1_OPEN ) ) )
+         || ( ( door == DOOR_TYPE_DOOR_2 ) && ( ( state == DOOR_CONTROL_STATE_DOOR_2_UNLOCKED ) || ( state == DOOR_CONTROL_STATE_DOOR_2_OPEN ) ) ) )
+    {
+        badge.requested[door] = false;
+    }
+    else if ( ( now - badge.requestTime[door] ) >= BADGE_REQUEST_TIMEOUT )
+    {
+        badge.requested[door] = false;
+        badge.stats.expired++;
+        Log.warningln( "%s: Door %d wasn't unlocked for the badge", __func__, door + 1 );
+    }
+}
+
+
+/**
+ * @brief Checks a received frame and requests the unlock for an accepted badge.
+ *
+ * @param door The door of the reader.
+ * @param pBits The bits of the frame, MSB first.
+ * @param bitCount The number of bits.
+ * @param now The current time @unit ms
+ */
+static void badgeMan_handleFrame( door_type_t door, const uint8_t* const pBits, uint8_t bitCount, uint32_t now )
+{
+    uint32_t id;
+
+    badge.stats.lastDoor = door;
+
+    if ( !badgeMan_decode( pBits, bitCount, &id ) )
+    {
+        badge.stats.invalid++;
+        badge.stats.lastResult = BADGE_RESULT_INVALID;
+        Log.warningln( "%s: Invalid frame of %d bits at door %d", __func__, bitCount, door + 1 );
+        return;
+    }
+
+    badge.stats.lastId = id;
+
+    if ( credStore_contains( credStore_getTable(), id ) )
+    {
+        badge.stats.granted++;
+        badge.stats.lastResult  = BADGE_RESULT_GRANTED;
+        badge.requested[door]   = ( badge.doors & ( 1 << door ) ) != 0;
+        badge.requestTime[door] = now;
+        Log.noticeln( "%s: Badge %l granted at door %d", __func__, id, door + 1 );
+    }
+    else
+    {
+        badge.stats.denied++;
+        badge.stats.lastResult = BADGE_RESULT_DENIED;
+        Log.warningln( "%s: Badge %l denied at door %d", __func__, id, door + 1 );
+    }
+}
+
+
+/**
+ * @brief Returns a bit of a frame.
+ *
+ * @param pBits The bits of the frame, MSB first.
+ * @param index The index of the bit.
+ * @return true if the bit is 1.
+ */
+static bool badgeMan_getBit( const uint8_t* const pBits, uint8_t index )
+{
+    return ( pBits[index >> 3] & ( 0x80 >> ( index & 7 ) ) ) != 0;
+}
+
+
+/**
+ * @brief Appends a bit to the frame of a reader, called by the interrupt handlers.
+ *
+ * @param pReader Pointer to the reader.
+ * @param bit The bit, 0 or 1.
+ */
+static void badgeMan_shiftBit( badge_reader_t* const pReader, uint8_t bit )
+{
+    const uint8_t count = pReader->bitCount;
+
+    if ( count >= BADGE_MAX_BITS )
+    {
+        /* Too long, the frame is dropped */
+        pReader->bitCount = BADGE_MAX_BITS + 1;
+        return;
+    }
+
+    if ( bit != 0 )
+    {
+        pReader->bits[count >> 3] |= (uint8_t) ( 0x80 >> ( count & 7 ) );
+    }
+    pReader->bitCount = count + 1;
+}
+
+
+#if defined( ARDUINO_ARCH_AVR )
+/**
+ * @brief Pin change interrupt of port K, a falling edge on a data line is a bit.
+ */
+ISR( PCINT2_vect )
+{
+    const uint8_t level   = PINK;
+    const uint8_t falling = badge.portLevel & ~level;
+
+    badge.portLevel = level;
+
+    if ( falling & ( 1 << PK0 ) )
+    {
+        badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_1], 0 );
+    }
+    if ( falling & ( 1 << PK1 ) )
+    {
+        badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_1], 1 );
+    }
+    if ( falling & ( 1 << PK2 ) )
+    {
+        badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_2], 0 );
+    }
+    if ( falling & ( 1 << PK3 ) )
+    {
+        badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_2], 1 );
+    }
+}
+#else
+/**
+ * @brief Interrupt of D0 of the reader of door 1.
+ */
+static void badgeMan_isrDoor1D0( void )
+{
+    badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_1], 0 );
+}
+
+
+/**
+ * @brief Interrupt of D1 of the reader of door 1.
+ */
+static void badgeMan_isrDoor1D1( void )
+{
+    badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_1], 1 );
+}
+
+
+/**
+ * @brief Interrupt of D0 of the reader of door 2.
+ */
+static void badgeMan_isrDoor2D0( void )
+{
+    badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_2], 0 );
+}
+
+
+/**
+ * @brief Interrupt of D1 of the reader of door 2.
+ */
+static void badgeMan_isrDoor2D1( void )
+{
+    badgeMan_shiftBit( &badge.readers[DOOR_TYPE_DOOR_2], 1 );
+}
+#endif
@@ -0,0 +1,79 @@
+/**
+ * \file    badgeMan.h
+ * \brief   Header file for the badge readers
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef BADGE_MANAGEMENT_H
+#define BADGE_MANAGEMENT_H
+
+#include <Arduino.h>
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define BADGE_MAX_BITS              34      /*!< Longest supported Wiegand frame @unit bits */
+#define BADGE_FRAME_GAP             25      /*!< A frame ends if no bit arrives for this time @unit ms */
+#define BADGE_REQUEST_TIMEOUT       2000    /*!< Time an accepted badge waits for the door to unlock @unit ms */
+
+/*
+ * Every door has a Wiegand reader with two data lines, D0 and D1. The lines need an
+ * interrupt: a pin change interrupt of port K on the Mega, as the pins of the external
+ * interrupts are used by the door inputs, the controller bus and I2C, and an external
+ * interrupt on the Uno R4.
+ */
+#if defined( ARDUINO_ARCH_AVR )
+#define BADGE_1_D0_PIN              A8      /*!< D0 of the reader of door 1, PK0 */
+#define BADGE_1_D1_PIN              A9      /*!< D1 of the reader of door 1, PK1 */
+#define BADGE_2_D0_PIN              A10     /*!< D0 of the reader of door 2, PK2 */
+#define BADGE_2_D1_PIN              A11     /*!< D1 of the reader of door 2, PK3 */
+#else
+#define BADGE_1_D0_PIN              A2      /*!< D0 of the reader of door 1 */
+#define BADGE_1_D1_PIN              A3      /*!< D1 of the reader of door 1 */
+#define BADGE_2_D0_PIN              A4      /*!< D0 of the reader of door 2 */
+#define BADGE_2_D1_PIN              A5      /*!< D1 of the reader of door 2 */
+#endif
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the badge read results
+ */
+typedef enum
+{
+    BADGE_RESULT_NONE,     /*!< No badge read yet */
+    BADGE_RESULT_GRANTED,  /*!< The credential is in the credential table */
+    BADGE_RESULT_DENIED,   /*!< The credential isn't in the credential table */
+    BADGE_RESULT_INVALID   /*!< Wrong length or parity, the frame is dropped */
+} badge_result_t;
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The badge reader statistics
+ */
+typedef struct
+{
+    uint16_t       granted;      /*!< Number of accepted badges */
+    uint16_t       denied;       /*!< Number of unknown badges */
+    uint16_t       invalid;      /*!< Number of frames with a wrong length or parity */
+    uint16_t       expired;      /*!< Number of accepted badges the door wasn't unlocked for */
+    uint32_t       lastId;       /*!< The credential of the last valid frame */
+    door_type_t    lastDoor;     /*!< The door of the last frame */
+    badge_result_t lastResult;   /*!< The result of the last frame */
+} badge_stats_t;
+
+
+/******************************** Function prototype ************************************/
+
+void                 badgeMan_setup( door_control_t* const pDoorControl );
+void                 badgeMan_setDoors( uint8_t doors );
+void                 badgeMan_process( void );
+bool                 badgeMan_decode( const uint8_t* const pBits, uint8_t bitCount, uint32_t* const pId );
+const badge_stats_t* badgeMan_getStats( void );
+
+#endif  // BADGE_MANAGEMENT_H
@@ -0,0 +1,889 @@
+/**
+ * \file    bench.cpp
+ * \brief   Source file for the micro benchmarks of the firmware hot paths
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "bench.h"
+#include "hsm.h"
+#include "hsmEngine.h"
+#include "ioMan.h"
+#include "appSettings.h"
+#include "comLineIf.h"
+#include "logging.h"
+#include "wdtMan.h"
+#include "badgeMan.h"
+#include "credStore.h"
+
+#if defined( ARDUINO_ARCH_HOST )
+#include "hostShim.h"
+#endif
+
+#if defined( BENCH_FIRMWARE )
+/* Tables of 100, 1000 and 10000 credentials, generated by tools/credentials.py */
+#include "credBenchTable.h"
+#endif
+
+/*
+ * The benchmarks call the real firmware functions, but never on the door control
+ * instance that drives the hardware:
+ * - The state machine benchmarks use a state machine of their own, the hsm_* ones with
+ *   the engine of hsm.c, the tpl_* ones with the same states on the template engine.
+ * - The debounce benchmark uses an input/output context of its own, which reads its
+ *   inputs from the override instead of the pins.
+ * - The output flush uses the same context. It isn't bound to the pins, so the flush
+ *   compares and commits its output image without writing a pin.
+ * - The pin write benchmark toggles BENCH_WRITE_PIN on the Mega, which must not be
+ *   connected. All pins of the Uno R4 are used, there it writes the red led of door 1
+ *   with the level the pin already has.
+ * - The credential lookups only read the credential tables. The benchmark builds contain
+ *   tables of 100, 1000 and 10000 credentials, see bench_getCredential().
+ * Logging is silenced while a benchmark runs.
+ *
+ * Every operation is timed on its own with the interrupts masked, so neither the led
+ * tick nor the serial interrupts add to the result. The cost of reading the counter
+ * is measured with an empty operation and subtracted. On the Mega, the 16-bit counter
+ * limits a single operation to 65535 cycles (4 ms).
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define BENCH_EVENT             1                                /*!< The event dispatched by the state machine benchmarks */
+#define BENCH_CLI_LINE          "timer -u 10 -o 5 -b 250"        /*!< The command parsed by the command line benchmark */
+#define BENCH_NAME_WIDTH        18                               /*!< Width of the name column of the table */
+#define BENCH_VALUE_WIDTH       10                               /*!< Width of the value columns of the table */
+#define BENCH_BADGE_BITS        26                               /*!< Length of the frame decoded by the badge benchmark */
+
+#if defined( ARDUINO_AVR_MEGA2560 )
+#define BENCH_WRITE_PIN         22          /*!< Unconnected pin toggled by the pin write benchmark */
+#define BENCH_WRITE_TOGGLE      1           /*!< The pin write benchmark toggles the pin */
+#else
+#define BENCH_WRITE_PIN         RBG_LED_1_R /*!< Pin written with its current level by the pin write benchmark */
+#define BENCH_WRITE_TOGGLE      0           /*!< The pin write benchmark keeps the level of the pin */
+#endif
+
+#if defined( ARDUINO_AVR_MEGA2560 )
+typedef uint16_t bench_count_t; /*!< Value of the timer 5 counter */
+#else
+typedef uint32_t bench_count_t; /*!< Value of the cycle counter */
+#endif
+
+
+/**
+ * @brief The null output
+ * @details Discards everything the benchmark logger formats
+ */
+class BenchNullOutput : public Print
+{
+public:
+    size_t write( uint8_t character ) override;
+};
+
+
+class BenchTplMachine;
+
+/**
+ * @brief The first state of the template benchmark state machine
+ * @details Both states match the states of the hsm.c benchmark state machine
+ */
+struct BenchTplState0 : HsmState
+{
+    static state_machine_result_t handler( BenchTplMachine& machine, uint32_t event );
+    static state_machine_result_t entry( BenchTplMachine& machine, uint32_t event );
+    static state_machine_result_t exit( BenchTplMachine& machine, uint32_t event );
+};
+
+/**
+ * @brief The second state of the template benchmark state machine
+ */
+struct BenchTplState1 : HsmState
+{
+    static state_machine_result_t handler( BenchTplMachine& machine, uint32_t event );
+    static state_machine_result_t entry( BenchTplMachine& machine, uint32_t event );
+    static state_machine_result_t exit( BenchTplMachine& machine, uint32_t event );
+};
+
+/**
+ * @brief The template benchmark state machine, logs nothing
+ */
+class BenchTplMachine : public HsmEngine<BenchTplMachine, BenchTplState0, BenchTplState1>
+{
+};
+
+
+/**************************** Static Function prototype *********************************/
+
+static state_machine_result_t bench_stateHandler( state_machine_t* const pState, const uint32_t event );
+static state_machine_result_t bench_stateEntryExitHandler( state_machine_t* const pState, const uint32_t event );
+static void                   bench_eventLogger( state_machine_t* const pStateMachine, uint32_t state, const event_t* const pEvent );
+static void                   bench_resultLogger( state_machine_t* const pStateMachine, uint32_t state, state_machine_result_t result );
+
+static void          bench_startCounter( void );
+static void          bench_stopCounter( void );
+static bench_count_t bench_readCounter( void );
+static uint32_t      bench_timeRepetition( const bench_case_t* const pCase, uint32_t overhead );
+static void          bench_printColumn( uint32_t value );
+
+static void bench_setupStateMachine( void );
+static void bench_setupDebounce( void );
+static void bench_setupPinWrite( void );
+static void bench_runEmpty( uint16_t index );
+static void bench_runPushDispatch( uint16_t index );
+static void bench_runSwitchState( uint16_t index );
+static void bench_setupTplMachine( void );
+static void bench_runTplPushDispatch( uint16_t index );
+static void bench_runTplSwitchState( uint16_t index );
+static void bench_runDebounce( uint16_t index );
+static void bench_runFlushOutputs( uint16_t index );
+static void bench_runPinWrite( uint16_t index );
+static void bench_runCrc( uint16_t index );
+static void bench_runToString( uint16_t index );
+static void bench_runLogFormat( uint16_t index );
+static void bench_runCliParse( uint16_t index );
+static void bench_runBadgeDecode( uint16_t index );
+static void bench_runCredLookup( uint16_t index );
+
+#if defined( BENCH_FIRMWARE )
+static void     bench_runCredLookup100( uint16_t index );
+static void     bench_runCredLookup1k( uint16_t index );
+static void     bench_runCredLookup10k( uint16_t index );
+static uint32_t bench_getCredential( uint16_t index );
+#endif
+
+
+/******************************** Global variables ************************************/
+
+/**
+ * @brief The two states of the benchmark state machine
+ */
+static const state_t benchStates[] = {
+    { .Handler = bench_stateHandler, .Entry = bench_stateEntryExitHandler, .Exit = bench_stateEntryExitHandler, .Id = 0 },
+    { .Handler = bench_stateHandler, .Entry = bench_stateEntryExitHandler, .Exit = bench_stateEntryExitHandler, .Id = 1 }
+};
+
+static state_machine_t  benchMachine;    /*!< The benchmark state machine */
+static BenchTplMachine  benchTplMachine; /*!< The benchmark state machine of the template engine */
+static io_context_t     benchIo;         /*!< The benchmark input/output context */
+static BenchNullOutput  benchNullOutput; /*!< The output of the benchmark logger */
+static Logging          benchLog;        /*!< The benchmark logger, formats into the null output */
+static volatile uint8_t benchSink;       /*!< Keeps the compiler from dropping unused results */
+static uint8_t          benchPinLevel;   /*!< The level of the pin written by the pin write benchmark */
+
+/**
+ * @brief The 26-bit frame of facility 12, card 3456, decoded by the badge benchmark
+ */
+static const uint8_t benchBadgeFrame[] = { 0x06, 0x06, 0xC0, 0x40, 0x00 };
+
+#if defined( ARDUINO_AVR_MEGA2560 )
+static uint8_t savedTccr5a; /*!< Timer 5 configuration before the benchmark */
+static uint8_t savedTccr5b; /*!< Timer 5 configuration before the benchmark */
+#endif
+
+/**
+ * @brief The empty benchmark, times the timing overhead
+ */
+static const bench_case_t benchEmpty = { "empty", NULL, bench_runEmpty, BENCH_CALIBRATION_RUNS };
+
+/**
+ * @brief All benchmarks
+ */
+static const bench_case_t benchCases[] = {
+    { "hsm_push_dispatch", bench_setupStateMachine, bench_runPushDispatch, 100 },
+    { "hsm_switch_state",  bench_setupStateMachine, bench_runSwitchState,  200 },
+    { "tpl_push_dispatch", bench_setupTplMachine,   bench_runTplPushDispatch, 100 },
+    { "tpl_switch_state",  bench_setupTplMachine,   bench_runTplSwitchState,  200 },
+    { "debounce_step",     bench_setupDebounce,     bench_runDebounce,     200 },
+    { "gpio_flush",        bench_setupDebounce,     bench_runFlushOutputs, 200 },
+    { "gpio_write",        bench_setupPinWrite,     bench_runPinWrite,     200 },
+    { "settings_crc",      NULL,                    bench_runCrc,          20  },
+    { "log_to_string",     NULL,                    bench_runToString,     200 },
+    { "log_format",        NULL,                    bench_runLogFormat,    50  },
+    { "cli_parse",         NULL,                    bench_runCliParse,     50  },
+    { "badge_decode",      NULL,                    bench_runBadgeDecode,  50  },
+    { "cred_lookup",       NULL,                    bench_runCredLookup,   200 },
+#if defined( BENCH_FIRMWARE )
+    { "cred_lookup_100",   NULL,                    bench_runCredLookup100, 200 },
+    { "cred_lookup_1k",    NULL,                    bench_runCredLookup1k,  200 },
+    { "cred_lookup_10k",   NULL,                    bench_runCredLookup10k, 200 },
+#endif
+};
+
+#define BENCH_CASE_SIZE         ( sizeof( benchCases ) / sizeof( benchCases[0] ) ) /*!< Number of benchmarks */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Returns the number of benchmarks.
+ *
+ * @return uint8_t The number of benchmarks.
+ */
+uint8_t bench_getCaseCount( void )
+{
+    return BENCH_CASE_SIZE;
+}
+
+
+/**
+ * @brief Returns a benchmark.
+ *
+ * @param index The index of the benchmark.
+ * @return const bench_case_t* The benchmark, NULL if the index is invalid.
+ */
+const bench_case_t* bench_getCase( uint8_t index )
+{
+    return ( index < BENCH_CASE_SIZE ) ? &benchCases[index] : NULL;
+}
+
+
+/**
+ * @brief Measures a benchmark.
+ *
+ * The benchmark runs once to warm up and BENCH_REPETITIONS times timed. The mean time
+ * of a single operation is reported for the fastest and the median repetition.
+ *
+ * @param index The index of the benchmark.
+ * @param pResult Pointer to store the result.
+ */
+void bench_measure( uint8_t index, bench_result_t* const pResult )
+{
+    const bench_case_t* pCase = bench_getCase( index );
+    uint32_t            cycles[BENCH_REPETITIONS];
+
+    if ( pCase == NULL )
+    {
+        Log.errorln( "%s: Invalid benchmark: %d", __func__, index );
+        return;
+    }
+
+    const int logLevel = Log.getLevel();
+    Log.setLevel( LOG_LEVEL_SILENT );
+    benchLog.begin( LOG_LEVEL_VERBOSE, &benchNullOutput );
+    bench_startCounter();
+
+    /* The mean empty operation is the cost of reading the counter */
+    const uint32_t overhead = bench_timeRepetition( &benchEmpty, 0 ) / BENCH_CALIBRATION_RUNS;
+
+    for ( int8_t r = -1; r < BENCH_REPETITIONS; r++ )
+    {
+        const uint32_t duration = bench_timeRepetition( pCase, overhead );
+
+        /* The first run only warms up */
+        if ( r < 0 )
+        {
+            continue;
+        }
+
+        /* Insert sorted */
+        int8_t i = r;
+        for ( ; ( i > 0 ) && ( cycles[i - 1] > duration ); i-- )
+        {
+            cycles[i] = cycles[i - 1];
+        }
+        cycles[i] = duration;
+    }
+
+    bench_stopCounter();
+    Log.setLevel( logLevel );
+
+    pResult->minCycles    = cycles[0] / pCase->iterations;
+    pResult->medianCycles = cycles[BENCH_REPETITIONS / 2] / pCase->iterations;
+}
+
+
+/**
+ * @brief Runs all benchmarks and prints the results as a single JSON line.
+ *
+ * Format: {"bench":1,"version":"...","target":"...","clock_mhz":n,"cases":[{"name":"...","iterations":n,
+ *          "min_cycles":n,"median_cycles":n,"min_ns":n,"median_ns":n},...]}
+ * See tools/bench.py for the comparison of two reports.
+ */
+void bench_printJson( void )
+{
+    Serial.print( F( "{\"bench\":1,\"version\":\"" GIT_VERSION_STRING "\",\"target\":\"" BENCH_TARGET "\",\"clock_mhz\":" ) );
+    Serial.print( BENCH_CLOCK_MHZ );
+    Serial.print( F( ",\"cases\":[" ) );
+
+    for ( uint8_t i = 0; i < BENCH_CASE_SIZE; i++ )
+    {
+        bench_result_t result;
+        bench_measure( i, &result );
+        wdtMan_feedStage( WDT_STAGE_CLI );
+
+        Serial.print( ( i == 0 ) ? F( "{\"name\":\"" ) : F( ",{\"name\":\"" ) );
+        Serial.print( benchCases[i].pName );
+        Serial.print( F( "\",\"iterations\":" ) );
+        Serial.print( benchCases[i].iterations );
+        Serial.print( F( ",\"min_cycles\":" ) );
+        Serial.print( result.minCycles );
+        Serial.print( F( ",\"median_cycles\":" ) );
+        Serial.print( result.medianCycles );
+        Serial.print( F( ",\"min_ns\":" ) );
+        Serial.print( bench_cyclesToNs( result.minCycles ) );
+        Serial.print( F( ",\"median_ns\":" ) );
+        Serial.print( bench_cyclesToNs( result.medianCycles ) );
+        Serial.print( '}' );
+    }
+
+    Serial.println( F( "]}" ) );
+}
+
+
+/**
+ * @brief Runs all benchmarks and prints the results as a table.
+ *
+ * One row per benchmark: the median and the minimum time of a single operation in
+ * cycles, and the median time in ns.
+ */
+void bench_printTable( void )
+{
+    Serial.print( F( "Benchmark " GIT_VERSION_STRING " on " BENCH_TARGET " at " ) );
+    Serial.print( BENCH_CLOCK_MHZ );
+    Serial.println( BENCH_CYCLE_COUNTER ? F( " MHz, cycle counter" ) : F( " MHz, micros()" ) );
+    Serial.println( F( "name                  median       min        ns" ) );
+
+    for ( uint8_t i = 0; i < BENCH_CASE_SIZE; i++ )
+    {
+        bench_result_t result;
+        bench_measure( i, &result );
+        wdtMan_feedStage( WDT_STAGE_CLI );
+
+        Serial.print( benchCases[i].pName );
+        for ( uint8_t pad = strlen( benchCases[i].pName ); pad < BENCH_NAME_WIDTH; pad++ )
+        {
+            Serial.print( ' ' );
+        }
+        bench_printColumn( result.medianCycles );
+        bench_printColumn( result.minCycles );
+        bench_printColumn( bench_cyclesToNs( result.medianCycles ) );
+        Serial.println();
+    }
+}
+
+
+/**
+ * @brief Converts counter cycles to nanoseconds.
+ *
+ * @param cycles The number of cycles.
+ * @return uint32_t The time @unit ns
+ */
+uint32_t bench_cyclesToNs( uint32_t cycles )
+{
+    return ( cycles * 1000UL ) / BENCH_CLOCK_MHZ;
+}
+
+
+/**
+ * @brief Discards a character of the benchmark logger.
+ *
+ * @param character The character.
+ * @return size_t 1
+ */
+size_t BenchNullOutput::write( uint8_t character )
+{
+    benchSink = character;
+    return 1;
+}
+
+
+/**
+ * @brief Starts the cycle counter.
+ */
+static void bench_startCounter( void )
+{
+#if defined( ARDUINO_AVR_MEGA2560 )
+    savedTccr5a = TCCR5A;
+    savedTccr5b = TCCR5B;
+    TCCR5A      = 0;
+    TCCR5B      = ( 1 << CS50 ); /* Normal mode, no prescaler */
+#elif defined( ARDUINO_ARCH_RENESAS )
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+/**
+ * @brief Restores the timer used as cycle counter.
+ */
+static void bench_stopCounter( void )
+{
+#if defined( ARDUINO_AVR_MEGA2560 )
+    TCCR5B = savedTccr5b;
+    TCCR5A = savedTccr5a;
+#endif
+}
+
+
+/**
+ * @brief Reads the cycle counter.
+ *
+ * @return bench_count_t The counter value.
+ */
+static inline bench_count_t bench_readCounter( void )
+{
+#if defined( ARDUINO_AVR_MEGA2560 )
+    return TCNT5;
+#elif defined( ARDUINO_ARCH_RENESAS )
+    return DWT->CYCCNT;
+#elif defined( ARDUINO_ARCH_HOST )
+    return hostShim_readCounter();
+#else
+    return micros();
+#endif
+}
+
+
+/**
+ * @brief Times one repetition of a benchmark, each operation with the interrupts masked.
+ *
+ * @param pCase The benchmark.
+ * @param overhead The cost of reading the counter, subtracted from every operation @unit cycles
+ * @return uint32_t The time of all operations @unit cycles
+ */
+static uint32_t bench_timeRepetition( const bench_case_t* const pCase, uint32_t overhead )
+{
+    uint32_t total = 0;
+
+    if ( pCase->setup != NULL )
+    {
+        pCase->setup();
+    }
+
+    for ( uint16_t i = 0; i < pCase->iterations; i++ )
+    {
+#if BENCH_CYCLE_COUNTER
+        noInterrupts();
+#endif
+        const bench_count_t start = bench_readCounter();
+        pCase->run( i );
+        const bench_count_t duration = bench_readCounter() - start;
+#if BENCH_CYCLE_COUNTER
+        interrupts();
+#endif
+
+        total += ( duration > overhead ) ? duration - overhead : 0;
+    }
+
+    return total;
+}
+
+
+/**
+ * @brief Prints a right aligned value column of the table.
+ *
+ * @param value The value.
+ */
+static void bench_printColumn( uint32_t value )
+{
+    uint8_t digits = 1;
+
+    for ( uint32_t rest = value / 10; rest != 0; rest /= 10 )
+    {
+        digits++;
+    }
+
+    for ( ; digits < BENCH_VALUE_WIDTH; digits++ )
+    {
+        Serial.print( ' ' );
+    }
+
+    Serial.print( value );
+}
+
+
+/**
+ * @brief Handler of both benchmark states, consumes every event.
+ *
+ * @param pState The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+static state_machine_result_t bench_stateHandler( state_machine_t* const pState, const uint32_t event )
+{
+    benchSink = (uint8_t) event;
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Entry and exit handler of both benchmark states.
+ *
+ * @param pState The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+static state_machine_result_t bench_stateEntryExitHandler( state_machine_t* const pState, const uint32_t event )
+{
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Handler of the first template benchmark state, consumes every event.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState0::handler( BenchTplMachine& machine, uint32_t event )
+{
+    benchSink = (uint8_t) event;
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Entry action of the first template benchmark state.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState0::entry( BenchTplMachine& machine, uint32_t event )
+{
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Exit action of the first template benchmark state.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState0::exit( BenchTplMachine& machine, uint32_t event )
+{
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Handler of the second template benchmark state, consumes every event.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState1::handler( BenchTplMachine& machine, uint32_t event )
+{
+    benchSink = (uint8_t) event;
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Entry action of the second template benchmark state.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState1::entry( BenchTplMachine& machine, uint32_t event )
+{
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Exit action of the second template benchmark state.
+ *
+ * @param machine The state machine.
+ * @param event The event.
+ * @return state_machine_result_t EVENT_HANDLED
+ */
+state_machine_result_t BenchTplState1::exit( BenchTplMachine& machine, uint32_t event )
+{
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Event logger of the benchmark state machine, logs nothing.
+ */
+static void bench_eventLogger( state_machine_t* const pStateMachine, uint32_t state, const event_t* const pEvent )
+{
+}
+
+
+/**
+ * @brief Result logger of the benchmark state machine, logs nothing.
+ */
+static void bench_resultLogger( state_machine_t* const pStateMachine, uint32_t state, state_machine_result_t result )
+{
+}
+
+
+/**
+ * @brief Starts the benchmark state machine in its first state with an empty event queue.
+ */
+static void bench_setupStateMachine( void )
+{
+    benchMachine.event = NULL;
+    benchMachine.State = &benchStates[0];
+}
+
+
+/**
+ * @brief Starts the template benchmark state machine in its first state.
+ *
+ * The event queue is empty after every repetition of the template benchmarks.
+ */
+static void bench_setupTplMachine( void )
+{
+    benchTplMachine.switchState<BenchTplState0>();
+}
+
+
+/**
+ * @brief Starts the benchmark input/output context with settled inputs.
+ */
+static void bench_setupDebounce( void )
+{
+    ioMan_init( &benchIo );
+    ioMan_setInputOverride( &benchIo, true );
+}
+
+
+/**
+ * @brief Reads the level of the pin written by the pin write benchmark.
+ */
+static void bench_setupPinWrite( void )
+{
+    benchPinLevel = ( digitalRead( BENCH_WRITE_PIN ) == HIGH ) ? 1 : 0;
+}
+
+
+/**
+ * @brief Does nothing, the timing overhead.
+ *
+ * @param index The operation index.
+ */
+static void bench_runEmpty( uint16_t index )
+{
+}
+
+
+/**
+ * @brief Queues a single event and dispatches it, including the event allocation.
+ *
+ * @param index The operation index.
+ */
+static void bench_runPushDispatch( uint16_t index )
+{
+    state_machine_t* const machines[] = { &benchMachine };
+
+    pushEvent( &benchMachine.event, BENCH_EVENT );
+    dispatch_event( machines, 1, bench_eventLogger, bench_resultLogger, NULL );
+}
+
+
+/**
+ * @brief Switches to the other benchmark state.
+ *
+ * @param index The operation index.
+ */
+static void bench_runSwitchState( uint16_t index )
+{
+    switch_state( &benchMachine, &benchStates[index & 1] );
+}
+
+
+/**
+ * @brief Queues a single event and dispatches it on the template engine, including the event allocation.
+ *
+ * @param index The operation index.
+ */
+static void bench_runTplPushDispatch( uint16_t index )
+{
+    benchTplMachine.pushEvent( BENCH_EVENT );
+    benchTplMachine.dispatchEvent();
+}
+
+
+/**
+ * @brief Switches to the other state of the template engine.
+ *
+ * @param index The operation index.
+ */
+static void bench_runTplSwitchState( uint16_t index )
+{
+    if ( index & 1 )
+    {
+        benchTplMachine.switchState<BenchTplState1>();
+    }
+    else
+    {
+        benchTplMachine.switchState<BenchTplState0>();
+    }
+}
+
+
+/**
+ * @brief Samples a bouncing input. The input level changes every 4th sample.
+ *
+ * @param index The operation index.
+ */
+static void bench_runDebounce( uint16_t index )
+{
+    benchIo.now++;
+    ioMan_setRawInput( &benchIo, IO_SWITCH_1, ( index >> 2 ) & 1 );
+    benchSink = ioMan_getDoorState( &benchIo, IO_SWITCH_1 ).state;
+}
+
+
+/**
+ * @brief Flushes the output image of the benchmark context, without a level to write after the first one.
+ *
+ * @param index The operation index.
+ */
+static void bench_runFlushOutputs( uint16_t index )
+{
+    ioMan_flushOutputs( &benchIo );
+}
+
+
+/**
+ * @brief Writes the benchmark pin with digitalWrite(), the pin write path of the libraries.
+ *
+ * @param index The operation index. A toggled pin is back at its level after an even number of operations.
+ */
+static void bench_runPinWrite( uint16_t index )
+{
+    digitalWrite( BENCH_WRITE_PIN, ( ( benchPinLevel ^ ( index & BENCH_WRITE_TOGGLE ) ) != 0 ) ? HIGH : LOW );
+}
+
+
+/**
+ * @brief Calculates the CRC of the application settings.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCrc( uint16_t index )
+{
+    benchSink = (uint8_t) appSettings_calculateCrc( appSettings_getSettings() );
+}
+
+
+/**
+ * @brief Converts an event to a string.
+ *
+ * @param index The operation index.
+ */
+static void bench_runToString( uint16_t index )
+{
+    benchSink = logging_eventToString( (door_control_event_t) ( ( index % DOOR_CONTROL_EVENT_INIT_TIMEOUT ) + 1 ) )[0];
+}
+
+
+/**
+ * @brief Formats the log line of the event logger.
+ *
+ * @param index The operation index.
+ */
+static void bench_runLogFormat( uint16_t index )
+{
+    benchLog.noticeln( "%s: Event: %s, State: %s", __func__,
+                       logging_eventToString( (door_control_event_t) ( ( index % DOOR_CONTROL_EVENT_INIT_TIMEOUT ) + 1 ) ),
+                       logging_stateToString( DOOR_CONTROL_STATE_IDLE ) );
+}
+
+
+/**
+ * @brief Parses a command with three named arguments.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCliParse( uint16_t index )
+{
+    char                 line[sizeof( BENCH_CLI_LINE )];
+    com_line_if_cmd_t    command;
+    com_line_if_values_t values;
+
+    memcpy( line, BENCH_CLI_LINE, sizeof( BENCH_CLI_LINE ) );
+    benchSink = comLineIf_parseCommand( line, &command, &values );
+}
+
+
+/**
+ * @brief Decodes a 26-bit Wiegand frame, including the parity check.
+ *
+ * @param index The operation index.
+ */
+static void bench_runBadgeDecode( uint16_t index )
+{
+    uint32_t id;
+
+    benchSink = badgeMan_decode( benchBadgeFrame, BENCH_BADGE_BITS, &id );
+}
+
+
+/**
+ * @brief Looks a credential up in the credential table of the firmware.
+ *
+ * Most of the credentials aren't in the table, a hit costs the same two hashes and
+ * flash reads.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCredLookup( uint16_t index )
+{
+    benchSink = credStore_contains( credStore_getTable(), index * CRED_STORE_GOLDEN );
+}
+
+
+#if defined( BENCH_FIRMWARE )
+/**
+ * @brief Looks a credential up in the table of 100 credentials, every lookup is a hit.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCredLookup100( uint16_t index )
+{
+    benchSink = credStore_contains( &credBench100, bench_getCredential( index % credBench100.count ) );
+}
+
+
+/**
+ * @brief Looks a credential up in the table of 1000 credentials, every lookup is a hit.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCredLookup1k( uint16_t index )
+{
+    benchSink = credStore_contains( &credBench1k, bench_getCredential( index * 5 ) );
+}
+
+
+/**
+ * @brief Looks a credential up in the table of 10000 credentials, every lookup is a hit.
+ *
+ * @param index The operation index.
+ */
+static void bench_runCredLookup10k( uint16_t index )
+{
+    benchSink = credStore_contains( &credBench10k, bench_getCredential( index * 47 ) );
+}
+
+
+/**
+ * @brief Returns a credential of the benchmark tables, must match tools/credentials.py.
+ *
+ * The lower 24 bits of the multiples of an odd number are distinct for the first 2^24
+ * indices, so the first n credentials of every table are distinct.
+ *
+ * @param index The index of the credential, less than the size of the table.
+ * @return uint32_t The credential.
+ */
+static uint32_t bench_getCredential( uint16_t index )
+{
+    return ( index * CRED_STORE_GOLDEN ) & 0x00FFFFFFUL;
+}
+#endif
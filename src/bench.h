@@ -0,0 +1,77 @@
+/**
+ * \file    bench.h
+ * \brief   Header file for the micro benchmarks of the firmware hot paths
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define BENCH_REPETITIONS       7 /*!< Timed repetitions of every benchmark, the median is reported */
+#define BENCH_CALIBRATION_RUNS  16 /*!< Empty operations timed to find the timing overhead */
+
+/*
+ * Timer 5 counts the CPU cycles on the Mega (timer 1 drives the leds), the DWT cycle
+ * counter on the Uno R4. On the host of the native tests, one "cycle" is 1 ns of its
+ * monotonic clock. Other targets fall back to micros(), one "cycle" is 1 us then.
+ */
+#if defined( ARDUINO_AVR_MEGA2560 )
+#define BENCH_TARGET            "mega"                          /*!< Name of the target in the benchmark report */
+#define BENCH_CYCLE_COUNTER     1                               /*!< The operations are timed with a cycle counter */
+#define BENCH_CLOCK_MHZ         ( F_CPU / 1000000UL )           /*!< Frequency of the counter @unit MHz */
+#elif defined( ARDUINO_ARCH_RENESAS )
+#define BENCH_TARGET            "uno_r4"                        /*!< Name of the target in the benchmark report */
+#define BENCH_CYCLE_COUNTER     1                               /*!< The operations are timed with a cycle counter */
+#define BENCH_CLOCK_MHZ         ( SystemCoreClock / 1000000UL ) /*!< Frequency of the counter @unit MHz */
+#elif defined( ARDUINO_ARCH_HOST )
+#define BENCH_TARGET            "host"                          /*!< Name of the target in the benchmark report */
+#define BENCH_CYCLE_COUNTER     1                               /*!< The operations are timed with a cycle counter */
+#define BENCH_CLOCK_MHZ         1000UL                          /*!< Frequency of the counter @unit MHz */
+#else
+#define BENCH_TARGET            "unknown"                       /*!< Name of the target in the benchmark report */
+#define BENCH_CYCLE_COUNTER     0                               /*!< The operations are timed with micros() */
+#define BENCH_CLOCK_MHZ         1UL                             /*!< Frequency of the counter @unit MHz */
+#endif
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The benchmark structure
+ * @details A benchmark repeats a single operation of the firmware
+ */
+typedef struct
+{
+    const char* pName;                        /*!< The name of the benchmark */
+    void        ( *setup )( void );           /*!< Prepares a repetition, not timed, may be NULL */
+    void        ( *run )( uint16_t index );   /*!< Runs the operation once, index counts the operations of a repetition */
+    uint16_t    iterations;                   /*!< Number of operations per repetition */
+} bench_case_t;
+
+/**
+ * @brief The benchmark result structure
+ * @details The mean time of a single operation, without the timing overhead
+ */
+typedef struct
+{
+    uint32_t minCycles;    /*!< Fastest repetition @unit cycles */
+    uint32_t medianCycles; /*!< Median of all repetitions @unit cycles */
+} bench_result_t;
+
+/******************************** Function prototype ************************************/
+
+uint8_t             bench_getCaseCount( void );
+const bench_case_t* bench_getCase( uint8_t index );
+void                bench_measure( uint8_t index, bench_result_t* const pResult );
+void                bench_printJson( void );
+void                bench_printTable( void );
+uint32_t            bench_cyclesToNs( uint32_t cycles );
+
+#endif  // BENCHMARK_H
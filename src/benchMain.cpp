@@ -0,0 +1,92 @@
+/**
+ * \file    benchMain.cpp
+ * \brief   Entry point of the benchmark firmware
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <Arduino.h>
+
+#include "appSettings.h"
+#include "ioMan.h"
+#include "wdtMan.h"
+#include "bench.h"
+
+/*
+ * The benchmark builds (mega_bench, uno_r4_minima_bench) link this file instead of
+ * main.cpp. The door control isn't set up: the doors stay locked and nothing but the
+ * benchmarks runs, so the measurement doesn't share its setup with the production
+ * firmware. The benchmarks run once at boot and again for every bench command.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define BENCH_MAIN_LINE_SIZE    16 /*!< Longest command line, longer lines are cut */
+
+
+/******************************** Global variables ************************************/
+
+static char    benchLine[BENCH_MAIN_LINE_SIZE]; /*!< The command line being received */
+static uint8_t benchLineLength = 0;             /*!< The received characters of the command line */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Initializes the benchmark firmware.
+ *
+ * Stops the watchdog, drives the magnets and leds to their safe state and prints the
+ * JSON report of all benchmarks.
+ */
+void setup()
+{
+    /* After a watchdog reset the watchdog keeps running with its shortest timeout */
+    wdtMan_disable();
+
+    /* The doors stay locked, the benchmarks only use a state machine and inputs of their own */
+    ioMan_lockOutputs();
+
+    Serial.begin( SERIAL_BAUD_RATE );
+    bench_printJson();
+}
+
+
+/**
+ * @brief Runs the benchmarks again for every bench command.
+ *
+ * "bench -j 1" prints the JSON report of tools/bench.py, every other line starting
+ * with "bench" prints the table.
+ */
+void loop()
+{
+    while ( Serial.available() > 0 )
+    {
+        const char character = (char) Serial.read();
+
+        if ( ( character != '\n' ) && ( character != '\r' ) )
+        {
+            if ( benchLineLength < ( BENCH_MAIN_LINE_SIZE - 1 ) )
+            {
+                benchLine[benchLineLength++] = character;
+            }
+            continue;
+        }
+
+        benchLine[benchLineLength] = '\0';
+        benchLineLength            = 0;
+
+        if ( strcmp( benchLine, "bench -j 1" ) == 0 )
+        {
+            bench_printJson();
+        }
+        else if ( strncmp( benchLine, "bench", 5 ) == 0 )
+        {
+            bench_printTable();
+        }
+    }
+}
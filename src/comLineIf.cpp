@@ -9,112 +9,779 @@
  */
 
 #include <Arduino.h>
-#include <SimpleCLI.h>
-#include <TimerOne.h>
 
 #include "comLineIf.h"
 #include "appSettings.h"
 #include "logging.h"
 #include "ioMan.h"
+#include "ledMan.h"
+#include "replay.h"
+#include "memMon.h"
+#include "wdtMan.h"
+#include "bench.h"
+#include "sysClock.h"
+#include "ctrlBus.h"
+#include "badgeMan.h"
+#include "credStore.h"
+#include "rtcClock.h"
+#include "schedMan.h"
+#include "emergMan.h"
+#include "latMon.h"
 
 
-/******************************** Global variables ************************************/
+/*************************************** Defines ****************************************/
+
+#define FLASH_STRING( pString ) ( reinterpret_cast<const __FlashStringHelper*>( pString ) )
+
+#define COM_LINE_IF_INDEX_BITS  5                                 /*!< The command index has 2^bits slots */
+#define COM_LINE_IF_INDEX_SIZE  ( 1 << COM_LINE_IF_INDEX_BITS )   /*!< Number of slots of the command index */
+#define COM_LINE_IF_INDEX_MUL   7297                              /*!< Odd multiplier that spreads the command hashes over the slots */
+#define COM_LINE_IF_NO_COMMAND  0xFF                              /*!< Slot of the command index without a command */
 
-static SimpleCLI cli;                 /*!< The command line interface */
-static Command   cmdGetInfo;          /*!< Get software information */
-static Command   cmdSetLogLevel;      /*!< Set log level */
-static Command   cmdSetTimer;         /*!< Set all timers */
-static Command   cmdSetDebounceDelay; /*!< Setall debounce delays */
-static Command   cmdGetInputState;    /*!< Get the state of all inputs */
-static Command   cmdHelp;             /*!< Pint the help */
 
 /**************************** Static Function prototype *********************************/
 
-static void comLineIf_cmdGetInfoCb( cmd* pCommand );
-static void comLineIf_cmdSetLogLevelCb( cmd* pCommand );
-static void comLineIf_cmdSetTimerCb( cmd* pCommand );
-static void comLineIf_cmdSetDebounceDelayCb( cmd* pCommand );
-static void comLineIf_cmdHelpCb( cmd* pCommand );
-static void comLineIf_cmdGetInputStateCb( cmd* pCommand );
-static void comLineIf_cmdErrorCb( cmd_error* pError );
+static bool comLineIf_cmdGetInfoCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdSetLogLevelCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdSetTimerCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdSetDebounceDelayCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdHelpCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdGetInputStateCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdTraceCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdReplayCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdBeginCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdCommitCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdAbortCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdBenchCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdBusCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdBadgeCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdSchedCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdClockCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdEmergCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdLatCb( const com_line_if_values_t* const pValues );
+static bool comLineIf_cmdBudgetCb( const com_line_if_values_t* const pValues );
+
+static void                     comLineIf_processLine( char* pLine );
+static bool                     comLineIf_parse( char* pLine );
+static bool                     comLineIf_findCommand( const char* pName, com_line_if_cmd_t* const pCommand );
+static void                     comLineIf_readCommand( uint8_t index, com_line_if_cmd_t* const pCommand );
+static void                     comLineIf_readArg( const com_line_if_cmd_t* const pCommand, uint8_t argIdx, com_line_if_arg_t* const pArg );
+static bool                     comLineIf_parseArgs( const com_line_if_cmd_t* const pCommand, char* const* ppTokens, uint8_t tokenCount, com_line_if_values_t* const pValues );
+static bool                     comLineIf_parseValue( const com_line_if_cmd_t* const pCommand, uint8_t argIdx, const char* pToken, com_line_if_values_t* const pValues );
+static void                     comLineIf_printCommand( const com_line_if_cmd_t* const pCommand );
+static settings_t*              comLineIf_stageSettings( void );
+static bool                     comLineIf_finishSettings( void );
+static bool                     comLineIf_commitSettings( void );
+static void                     comLineIf_applySettings( const settings_t* const pSettings );
+static void                     comLineIf_processWatch( void );
+static void                     comLineIf_printInputImage( const io_input_image_t* const pImage );
+static void                     comLineIf_printBus( void );
+static void                     comLineIf_printBadges( void );
+static bool                     comLineIf_toSlot( int32_t time, uint8_t* const pSlot );
+static void                     comLineIf_printSchedules( void );
+static void                     comLineIf_printClock( void );
+static void                     comLineIf_printDay( uint8_t day );
+static void                     comLineIf_printTwoDigits( uint8_t value );
+static void                     comLineIf_printEmergency( void );
+static void                     comLineIf_printBudget( void );
+
+
+/**
+ * @brief Computes the hash of a command name.
+ *
+ * The hash is evaluated at compile time for the command table and at run time for the
+ * received command name, so looking up a command costs one hash, one read of the command
+ * index and a single string compare to confirm the match.
+ *
+ * @param pName The command name.
+ * @param hash The hash of the preceding characters.
+ * @return uint16_t The hash of the command name.
+ */
+static constexpr uint16_t comLineIf_hash( const char* pName, uint16_t hash = 5381 )
+{
+    return ( *pName == '\0' ) ? hash : comLineIf_hash( pName + 1, (uint16_t) ( ( hash * 33 ) ^ (uint8_t) *pName ) );
+}
+
+
+/**
+ * @brief Reduces the hash of a command name to a slot of the command index.
+ *
+ * Multiplicative hashing: the top bits of the product select the slot. The multiplier is
+ * chosen so that every command gets a slot of its own, which is checked at compile time.
+ *
+ * @param hash The hash of the command name.
+ * @return uint8_t The slot of the command index.
+ */
+static constexpr uint8_t comLineIf_slot( uint16_t hash )
+{
+    return (uint8_t) ( (uint16_t) ( hash * COM_LINE_IF_INDEX_MUL ) >> ( 16 - COM_LINE_IF_INDEX_BITS ) );
+}
+
+
+/******************************** Global variables ************************************/
+
+static door_control_t* pCliDoorControl = NULL; /*!< The door control instance configured by the commands */
+static ctrl_bus_t*     pCliCtrlBus     = NULL; /*!< The controller bus configured by the commands */
+
+static char    lineBuffer[COM_LINE_IF_LINE_SIZE]; /*!< The command line being received */
+static uint8_t lineLength   = 0;                  /*!< Number of characters in the line buffer */
+static bool    lineOverflow = false;              /*!< The current line didn't fit into the line buffer */
+
+static settings_t stagedSettings;        /*!< The settings changed by the setters, applied on commit */
+static bool       batchActive  = false;  /*!< The setters stage their changes until the batch is committed */
+
+static bool             watchActive = false; /*!< Input changes are streamed to the serial interface */
+static io_input_image_t watchImage;          /*!< The input image of the last watch record */
+
+/* Help texts */
+static const char descriptionInfo[] PROGMEM   = "Get software information";
+static const char descriptionLog[] PROGMEM    = "Set the log level: log <level (0:Silent, 1:Fatal, 2:Error, 3:Warning, 4:Notice, 5:Trace, 6:Verbose)>";
+static const char descriptionTimer[] PROGMEM  = "Set the timer. timer -u <unlock timeout (s)> -o <open timeout (min)> -b <blink interval (ms)>";
+static const char descriptionDbc[] PROGMEM    = "Set the debounce time. dbc -i <input index (0..3)> -t <debounce time (ms)>";
+static const char descriptionInputs[] PROGMEM = "Get the input state of all buttons and switches. inputs -w <0:stop, 1:watch changes>";
+static const char descriptionTrace[] PROGMEM  = "Record input edges and state changes: trace <0:off, 1:on>";
+static const char descriptionReplay[] PROGMEM = "Replay a recorded trace with a virtual clock. replay -t <tick (ms)>";
+static const char descriptionBegin[] PROGMEM  = "Start a configuration batch. The following settings are applied together on commit";
+static const char descriptionCommit[] PROGMEM = "Validate, apply and save all settings of the configuration batch";
+static const char descriptionAbort[] PROGMEM  = "Discard all settings of the configuration batch";
+static const char descriptionBench[] PROGMEM  = "Run the micro benchmarks, takes about a second. bench -j <0:table, 1:JSON>";
+static const char descriptionBus[] PROGMEM    = "Show or set the controller bus. bus -a <address (0:off, 1..8)> -n <neighbours (bit n-1 = address n)>";
+static const char descriptionBadge[] PROGMEM  = "Show the badge readers or set the badge doors. badge -d <doors (bit n-1 = door n)>";
+static const char descriptionSched[] PROGMEM  = "Show the access schedules or open or lock a window. sched -d <door (0:both, 1..2)> -w <weekday (0:all, 1:Mon..7:Sun)> -f <from (hhmm)> -t <to (hhmm)> -a <0:lock, 1:open>";
+static const char descriptionClock[] PROGMEM  = "Show or set the time of the week. clock -w <weekday (1:Mon..7:Sun)> -h <hour> -m <minute>";
+static const char descriptionEmerg[] PROGMEM  = "Show the emergency release, enable its input or reset it. emerg -e <0:off, 1:on> -r <1:reset>";
+static const char descriptionLat[] PROGMEM    = "Show the event latencies or clear them. lat -j <0:table, 1:JSON> -c <1:clear>";
+static const char descriptionBudget[] PROGMEM = "Show or set the dispatch budget per loop. budget -e <max events (0:unlimited)> -t <max time (us, 0:unlimited)> -d <deferral age (s, 0:never)>";
+static const char descriptionHelp[] PROGMEM   = "Show the help";
+
+/* Command names */
+static constexpr char nameInfo[] PROGMEM   = "info";
+static constexpr char nameLog[] PROGMEM    = "log";
+static constexpr char nameTimer[] PROGMEM  = "timer";
+static constexpr char nameDbc[] PROGMEM    = "dbc";
+static constexpr char nameInputs[] PROGMEM = "inputs";
+static constexpr char nameTrace[] PROGMEM  = "trace";
+static constexpr char nameReplay[] PROGMEM = "replay";
+static constexpr char nameBegin[] PROGMEM  = "begin";
+static constexpr char nameCommit[] PROGMEM = "commit";
+static constexpr char nameAbort[] PROGMEM  = "abort";
+static constexpr char nameBench[] PROGMEM  = "bench";
+static constexpr char nameBus[] PROGMEM    = "bus";
+static constexpr char nameBadge[] PROGMEM  = "badge";
+static constexpr char nameSched[] PROGMEM  = "sched";
+static constexpr char nameClock[] PROGMEM  = "clock";
+static constexpr char nameEmerg[] PROGMEM  = "emerg";
+static constexpr char nameLat[] PROGMEM    = "lat";
+static constexpr char nameBudget[] PROGMEM = "budget";
+static constexpr char nameHelp[] PROGMEM   = "help";
+
+static const char dayNames[] PROGMEM = "MonTueWedThuFriSatSun"; /*!< Three letters per day of the week */
+
+/* Arguments */
+static constexpr com_line_if_arg_t argsLog[] PROGMEM = {
+    { '\0', LOG_LEVEL_SILENT, LOG_LEVEL_VERBOSE, DEFAULT_LOG_LEVEL, true } /*!< Log level */
+};
+
+static constexpr com_line_if_arg_t argsTimer[] PROGMEM = {
+    { 'u', 0, UINT8_MAX,  DOOR_UNLOCK_TIMEOUT, false }, /*!< Unlock timeout @unit s */
+    { 'o', 0, UINT16_MAX, DOOR_OPEN_TIMEOUT,   false }, /*!< Open timeout @unit min */
+    { 'b', 1, UINT16_MAX, LED_BLINK_INTERVAL,  false }  /*!< LED blink interval @unit ms */
+};
+
+static constexpr com_line_if_arg_t argsDbc[] PROGMEM = {
+    { 'i', 0, IO_INPUT_SIZE - 1, 0, true }, /*!< Input index */
+    { 't', 0, UINT16_MAX,        0, true }  /*!< Debounce time @unit ms */
+};
+
+static constexpr com_line_if_arg_t argsInputs[] PROGMEM = {
+    { 'w', 0, 1, 0, false } /*!< Watch */
+};
+
+static constexpr com_line_if_arg_t argsTrace[] PROGMEM = {
+    { '\0', 0, 1, 0, false } /*!< Enable */
+};
+
+static constexpr com_line_if_arg_t argsReplay[] PROGMEM = {
+    { 't', 1, UINT16_MAX, REPLAY_DEFAULT_TICK, false } /*!< Virtual time step @unit ms */
+};
+
+static constexpr com_line_if_arg_t argsBench[] PROGMEM = {
+    { 'j', 0, 1, 0, false } /*!< JSON report */
+};
+
+static constexpr com_line_if_arg_t argsBus[] PROGMEM = {
+    { 'a', 0, CTRL_BUS_MAX_ADDRESS,                CTRL_BUS_ADDRESS,    false }, /*!< Own address */
+    { 'n', 0, ( 1 << CTRL_BUS_MAX_ADDRESS ) - 1,   CTRL_BUS_NEIGHBOURS, false }  /*!< Interlocked controllers */
+};
+
+static constexpr com_line_if_arg_t argsBadge[] PROGMEM = {
+    { 'd', 0, ( 1 << DOOR_TYPE_SIZE ) - 1, BADGE_DOORS, false } /*!< Badge doors */
+};
+
+static constexpr com_line_if_arg_t argsSched[] PROGMEM = {
+    { 'd', 0, DOOR_TYPE_SIZE, 0,    false }, /*!< Door, 0 for both */
+    { 'w', 0, SCHED_DAYS,     0,    false }, /*!< Day of the week, 0 for all */
+    { 'f', 0, 2400,           0,    false }, /*!< Start of the window @unit hhmm */
+    { 't', 0, 2400,           2400, false }, /*!< End of the window @unit hhmm */
+    { 'a', 0, 1,              1,    false }  /*!< Open or lock the window */
+};
+
+static constexpr com_line_if_arg_t argsClock[] PROGMEM = {
+    { 'w', 1, SCHED_DAYS, 1, false }, /*!< Day of the week */
+    { 'h', 0, 23,         0, false }, /*!< Hour */
+    { 'm', 0, 59,         0, false }  /*!< Minute */
+};
+
+static constexpr com_line_if_arg_t argsEmerg[] PROGMEM = {
+    { 'e', 0, 1, EMERGENCY_INPUT, false }, /*!< Emergency input wired */
+    { 'r', 1, 1, 1,               false }  /*!< Reset the latched release */
+};
+
+static constexpr com_line_if_arg_t argsLat[] PROGMEM = {
+    { 'j', 0, 1, 0, false }, /*!< JSON report */
+    { 'c', 1, 1, 1, false }  /*!< Clear the histograms */
+};
+
+static constexpr com_line_if_arg_t argsBudget[] PROGMEM = {
+    { 'e', 0, UINT8_MAX,               DISPATCH_MAX_EVENTS, false }, /*!< Most events per loop */
+    { 't', 0, DISPATCH_MAX_TIME_LIMIT, DISPATCH_MAX_TIME,   false }, /*!< Longest dispatch per loop @unit us */
+    { 'd', 0, DEFER_MAX_AGE_LIMIT,     DEFER_MAX_AGE,       false }  /*!< Age after which a deferred event is dropped @unit s */
+};
+
+/**
+ * @brief The command table
+ * @details The table is complete at compile time, nothing is allocated when a command is
+ *          registered or parsed. The table, the names and the arguments are stored in flash,
+ *          see comLineIf_readCommand() and comLineIf_readArg().
+ */
+static constexpr com_line_if_cmd_t commands[] PROGMEM = {
+    { nameInfo,   comLineIf_hash( nameInfo ),   comLineIf_cmdGetInfoCb,          NULL,       0, descriptionInfo   },
+    { nameLog,    comLineIf_hash( nameLog ),    comLineIf_cmdSetLogLevelCb,      argsLog,    1, descriptionLog    },
+    { nameTimer,  comLineIf_hash( nameTimer ),  comLineIf_cmdSetTimerCb,         argsTimer,  3, descriptionTimer  },
+    { nameDbc,    comLineIf_hash( nameDbc ),    comLineIf_cmdSetDebounceDelayCb, argsDbc,    2, descriptionDbc    },
+    { nameInputs, comLineIf_hash( nameInputs ), comLineIf_cmdGetInputStateCb,    argsInputs, 1, descriptionInputs },
+    { nameTrace,  comLineIf_hash( nameTrace ),  comLineIf_cmdTraceCb,            argsTrace,  1, descriptionTrace  },
+    { nameReplay, comLineIf_hash( nameReplay ), comLineIf_cmdReplayCb,           argsReplay, 1, descriptionReplay },
+    { nameBegin,  comLineIf_hash( nameBegin ),  comLineIf_cmdBeginCb,            NULL,       0, descriptionBegin  },
+    { nameCommit, comLineIf_hash( nameCommit ), comLineIf_cmdCommitCb,           NULL,       0, descriptionCommit },
+    { nameAbort,  comLineIf_hash( nameAbort ),  comLineIf_cmdAbortCb,            NULL,       0, descriptionAbort  },
+    { nameBench,  comLineIf_hash( nameBench ),  comLineIf_cmdBenchCb,            argsBench,  1, descriptionBench  },
+    { nameBus,    comLineIf_hash( nameBus ),    comLineIf_cmdBusCb,              argsBus,    2, descriptionBus    },
+    { nameBadge,  comLineIf_hash( nameBadge ),  comLineIf_cmdBadgeCb,            argsBadge,  1, descriptionBadge  },
+    { nameSched,  comLineIf_hash( nameSched ),  comLineIf_cmdSchedCb,            argsSched,  5, descriptionSched  },
+    { nameClock,  comLineIf_hash( nameClock ),  comLineIf_cmdClockCb,            argsClock,  3, descriptionClock  },
+    { nameEmerg,  comLineIf_hash( nameEmerg ),  comLineIf_cmdEmergCb,            argsEmerg,  2, descriptionEmerg  },
+    { nameLat,    comLineIf_hash( nameLat ),    comLineIf_cmdLatCb,              argsLat,    2, descriptionLat    },
+    { nameBudget, comLineIf_hash( nameBudget ), comLineIf_cmdBudgetCb,           argsBudget, 3, descriptionBudget },
+    { nameHelp,   comLineIf_hash( nameHelp ),   comLineIf_cmdHelpCb,             NULL,       0, descriptionHelp   }
+};
+
+#define COM_LINE_IF_CMD_SIZE    ( sizeof( commands ) / sizeof( commands[0] ) ) /*!< Number of commands */
+
+
+/**
+ * @brief Checks at compile time that no two commands share a slot of the command index.
+ *
+ * Two commands with the same slot also share the hash. If a new command collides, choose
+ * another odd COM_LINE_IF_INDEX_MUL or another COM_LINE_IF_INDEX_BITS.
+ *
+ * @param i Index of the first command to compare.
+ * @param j Index of the second command to compare.
+ * @return true if the slots of all remaining command pairs differ.
+ */
+static constexpr bool comLineIf_isSlotUnique( size_t i, size_t j )
+{
+    return ( i >= COM_LINE_IF_CMD_SIZE ) ? true
+         : ( j >= COM_LINE_IF_CMD_SIZE ) ? comLineIf_isSlotUnique( i + 1, i + 2 )
+         : ( comLineIf_slot( commands[i].hash ) != comLineIf_slot( commands[j].hash ) ) && comLineIf_isSlotUnique( i, j + 1 );
+}
+
+
+/**
+ * @brief Finds the command of a slot of the command index at compile time.
+ *
+ * @param slot The slot of the command index.
+ * @param i Index of the first command to check.
+ * @return The index of the command in the command table, COM_LINE_IF_NO_COMMAND if no command has this slot.
+ */
+static constexpr uint8_t comLineIf_commandOfSlot( uint8_t slot, size_t i )
+{
+    return ( i >= COM_LINE_IF_CMD_SIZE ) ? COM_LINE_IF_NO_COMMAND
+         : ( comLineIf_slot( commands[i].hash ) == slot ) ? (uint8_t) i
+         : comLineIf_commandOfSlot( slot, i + 1 );
+}
+
+/**
+ * @brief Checks at compile time that the arguments of every command fit into com_line_if_values_t.
+ *
+ * @param i Index of the command to check.
+ * @return true if no command has more than COM_LINE_IF_MAX_ARGS arguments.
+ */
+static constexpr bool comLineIf_isArgCountValid( size_t i )
+{
+    return ( i >= COM_LINE_IF_CMD_SIZE ) ? true
+         : ( commands[i].argCount <= COM_LINE_IF_MAX_ARGS ) && comLineIf_isArgCountValid( i + 1 );
+}
+
+static_assert( comLineIf_isSlotUnique( 0, 1 ), "Two commands share a slot of the command index, change COM_LINE_IF_INDEX_MUL" );
+static_assert( comLineIf_isArgCountValid( 0 ), "A command has more than COM_LINE_IF_MAX_ARGS arguments" );
+static_assert( COM_LINE_IF_CMD_SIZE < COM_LINE_IF_NO_COMMAND, "Too many commands for the command index" );
+
+#define COM_LINE_IF_SLOT( slot ) comLineIf_commandOfSlot( slot, 0 ) /*!< Entry of the command index */
+
+/**
+ * @brief The command index
+ * @details Maps the slot of a command name, see comLineIf_slot(), to the index of the
+ *          command in the command table. Built at compile time and stored in flash.
+ */
+static const uint8_t commandIndex[COM_LINE_IF_INDEX_SIZE] PROGMEM = {
+    COM_LINE_IF_SLOT( 0 ),  COM_LINE_IF_SLOT( 1 ),  COM_LINE_IF_SLOT( 2 ),  COM_LINE_IF_SLOT( 3 ),
+    COM_LINE_IF_SLOT( 4 ),  COM_LINE_IF_SLOT( 5 ),  COM_LINE_IF_SLOT( 6 ),  COM_LINE_IF_SLOT( 7 ),
+    COM_LINE_IF_SLOT( 8 ),  COM_LINE_IF_SLOT( 9 ),  COM_LINE_IF_SLOT( 10 ), COM_LINE_IF_SLOT( 11 ),
+    COM_LINE_IF_SLOT( 12 ), COM_LINE_IF_SLOT( 13 ), COM_LINE_IF_SLOT( 14 ), COM_LINE_IF_SLOT( 15 ),
+    COM_LINE_IF_SLOT( 16 ), COM_LINE_IF_SLOT( 17 ), COM_LINE_IF_SLOT( 18 ), COM_LINE_IF_SLOT( 19 ),
+    COM_LINE_IF_SLOT( 20 ), COM_LINE_IF_SLOT( 21 ), COM_LINE_IF_SLOT( 22 ), COM_LINE_IF_SLOT( 23 ),
+    COM_LINE_IF_SLOT( 24 ), COM_LINE_IF_SLOT( 25 ), COM_LINE_IF_SLOT( 26 ), COM_LINE_IF_SLOT( 27 ),
+    COM_LINE_IF_SLOT( 28 ), COM_LINE_IF_SLOT( 29 ), COM_LINE_IF_SLOT( 30 ), COM_LINE_IF_SLOT( 31 )
+};
+
+static_assert( COM_LINE_IF_INDEX_SIZE == 32, "The command index lists 32 slots, adapt its initializer" );
+
 
 /******************************** Function definition ************************************/
 
 
 /**
- * @brief Sets up the command line interface with various commands.
- * 
- * This function initializes the command line interface by adding several commands:
+ * @brief Sets up the command line interface.
+ *
+ * The commands are declared in the command table at compile time:
  * - "info": Retrieves software information.
  * - "log": Sets the log level.
  * - "timer": Configures the timer with unlock timeout, open timeout, and LED blink interval.
  * - "dbc": Sets the debounce time for inputs.
  * - "inputs": Retrieves the state of all buttons and switches.
+ * - "trace": Enables or disables the trace recording.
+ * - "replay": Starts a trace replay.
+ * - "begin", "commit", "abort": Group several settings into one configuration batch.
+ * - "bus": Shows or sets the address and the neighbours on the controller bus.
+ * - "badge": Shows the badge readers or sets the doors that only unlock with a badge.
+ * - "sched": Shows the access schedules or opens or locks a window of them.
+ * - "clock": Shows or sets the time of the week.
+ * - "emerg": Shows the emergency release, enables its input or resets it.
+ * - "lat": Shows the event latencies or clears them.
+ * - "budget": Shows or sets the dispatch budget per loop.
  * - "help": Displays the help information.
- * 
- * It also sets the error callback for the command line interface.
+ *
+ * @param pDoorControl Pointer to the door control instance configured by the commands.
+ * @param pCtrlBus Pointer to the controller bus of the door control instance.
  */
-void comLineIf_setup( void )
+void comLineIf_setup( door_control_t* const pDoorControl, ctrl_bus_t* const pCtrlBus )
 {
     Log.noticeln( "%s: Setting up the command line interface", __func__ );
 
-    /* Initialize the command line interface */
-    cmdGetInfo = cli.addSingleArgCmd( "info", comLineIf_cmdGetInfoCb ); /*!< Get software information */
-    cmdGetInfo.setDescription( "Get software information" );
+    pCliDoorControl = pDoorControl;
+    pCliCtrlBus     = pCtrlBus;
+    lineLength      = 0;
+    lineOverflow    = false;
+    batchActive     = false;
+    watchActive     = false;
+}
+
 
-    cmdSetLogLevel = cli.addSingleArgCmd( "log", comLineIf_cmdSetLogLevelCb ); /*!< Set log level */
-    cmdSetLogLevel.setDescription( "Set the log level: log <level (0:Silent, 1:Fatal, 2:Error, 3:Warning, 4:Notice, 5:Trace, 6:Verbose)>" );
+/**
+ * @brief Processes incoming serial commands.
+ *
+ * This function collects the received characters in the line buffer without blocking.
+ * Once a newline character is received, the line is parsed in place. Carriage returns
+ * are ignored and lines that don't fit into the line buffer are discarded. While the
+ * inputs are watched, changed inputs are reported as well.
+ */
+void comLineIf_process( void )
+{
+    if ( watchActive )
+    {
+        comLineIf_processWatch();
+    }
 
-    cmdSetTimer = cli.addCmd( "timer", comLineIf_cmdSetTimerCb );       /*!< Set timer */
-    cmdSetTimer.addArg( "u", STRINGIFY( DOOR_UNLOCK_TIMEOUT ) ); /*!< Unlock timeout */
-    cmdSetTimer.addArg( "o", STRINGIFY( DOOR_OPEN_TIMEOUT ) );   /*!< Open timeout */
-    cmdSetTimer.addArg( "b", STRINGIFY( LED_BLINK_INTERVAL ) );  /*!< LED blink interval */
-    cmdSetTimer.setDescription( "Set the timer. timer -u <unlock timeout (s)> -o <open timeout (min)> -b <blink interval (ms)>" );
+    while ( Serial.available() )
+    {
+        char c = (char) Serial.read();
+
+        if ( c == '\r' )
+        {
+            continue;
+        }
 
-    cmdSetDebounceDelay = cli.addCmd( "dbc", comLineIf_cmdSetDebounceDelayCb ); /*!< Set debounce time */
-    cmdSetDebounceDelay.addArg( "i" );                                   /*!< Input index */
-    cmdSetDebounceDelay.addArg( "t" );                                   /*!< Debounce time @unit ms */
-    cmdSetDebounceDelay.setDescription( "Set the debounce time. dbc -i <input index (0..3)> -t <debounce time (ms)>" );
+        if ( c != '\n' )
+        {
+            if ( lineLength < ( COM_LINE_IF_LINE_SIZE - 1 ) )
+            {
+                lineBuffer[lineLength++] = c;
+            }
+            else
+            {
+                lineOverflow = true;
+            }
+            continue;
+        }
 
-    cmdGetInputState = cli.addSingleArgCmd( "inputs", comLineIf_cmdGetInputStateCb ); /*!< Get the input state */
-    cmdGetInputState.setDescription( "Get the input state of all buttons and switches" );
+        lineBuffer[lineLength] = '\0';
 
-    cmdHelp = cli.addCmd( "help", comLineIf_cmdHelpCb ); /*!< Help */
-    cmdHelp.setDescription( "Show the help" );
+        if ( lineOverflow )
+        {
+            Log.errorln( "%s: Line exceeds %d characters and is ignored", __func__, COM_LINE_IF_LINE_SIZE - 1 );
+        }
+        else if ( replay_isActive() )
+        {
+            /* During a replay every line is a trace record */
+            char* pLine = lineBuffer;
+            while ( *pLine == ' ' )
+            {
+                pLine++;
+            }
+            replay_processLine( pLine );
+        }
+        else
+        {
+            comLineIf_processLine( lineBuffer );
+        }
 
-    cli.setOnError( comLineIf_cmdErrorCb );
+        lineLength   = 0;
+        lineOverflow = false;
+    }
 }
 
 
 /**
- * @brief Processes incoming serial commands.
+ * @brief Executes a received line.
+ *
+ * A line holding several commands separated by COM_LINE_IF_SEPARATOR is a bulk command
+ * line, e.g. "timer -u 10 -o 5; dbc -i 2 -t 50; log 4". Unless a batch is already open,
+ * it runs as a batch of its own: the settings are only applied and saved if every
+ * command succeeded.
+ *
+ * @param pLine The zero terminated line, modified by the parser.
+ */
+static void comLineIf_processLine( char* pLine )
+{
+    char* pSeparator = strchr( pLine, COM_LINE_IF_SEPARATOR );
+
+    if ( pSeparator == NULL )
+    {
+        comLineIf_parse( pLine );
+        return;
+    }
+
+    const bool implicitBatch = !batchActive;
+    if ( implicitBatch )
+    {
+        comLineIf_cmdBeginCb( NULL );
+    }
+
+    bool success = true;
+    while ( success )
+    {
+        pSeparator = strchr( pLine, COM_LINE_IF_SEPARATOR );
+        if ( pSeparator != NULL )
+        {
+            *pSeparator = '\0';
+        }
+
+        success = comLineIf_parse( pLine );
+
+        if ( pSeparator == NULL )
+        {
+            break;
+        }
+        pLine = pSeparator + 1;
+    }
+
+    if ( implicitBatch )
+    {
+        if ( success )
+        {
+            comLineIf_cmdCommitCb( NULL );
+        }
+        else
+        {
+            comLineIf_cmdAbortCb( NULL );
+        }
+    }
+}
+
+
+/**
+ * @brief Parses and executes a single command.
  *
- * This function checks if there is any data available on the serial port.
- * If data is available, it reads the input string until a newline character
- * is encountered and then parses the input using the command line interface (CLI) parser.
+ * @param pLine The zero terminated command, modified by the parser.
+ * @return true if the command was executed successfully or the command is empty.
+ */
+static bool comLineIf_parse( char* pLine )
+{
+    com_line_if_cmd_t    command;
+    com_line_if_values_t values;
+
+    switch ( comLineIf_parseCommand( pLine, &command, &values ) )
+    {
+        case COM_LINE_IF_PARSE_OK:
+            return command.handler( &values );
+        case COM_LINE_IF_PARSE_EMPTY:
+            return true;
+        case COM_LINE_IF_PARSE_UNKNOWN:
+            Log.noticeln( "Available commands:" );
+            comLineIf_cmdHelpCb( NULL );
+            return false;
+        case COM_LINE_IF_PARSE_INVALID_ARGS:
+            Log.noticeln( "Usage:" );
+            comLineIf_printCommand( &command );
+            return false;
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * @brief Parses a single command without executing it.
  *
- * The function also contains commented-out test commands that can be used
- * for debugging or testing purposes.
+ * The command is split into words in place by terminating each word in the line buffer.
  *
- * @note The function assumes that the `Serial` object and `cli` parser are
- * properly initialized and configured elsewhere in the code.
+ * @param pLine The zero terminated command, modified by the parser.
+ * @param pCommand Pointer to store a copy of the command table entry, valid if the result
+ *                 is COM_LINE_IF_PARSE_OK or COM_LINE_IF_PARSE_INVALID_ARGS.
+ * @param pValues Pointer to store the argument values.
+ * @return com_line_if_parse_t The parse result.
  */
-void comLineIf_process( void )
+com_line_if_parse_t comLineIf_parseCommand( char* pLine, com_line_if_cmd_t* const pCommand, com_line_if_values_t* const pValues )
+{
+    char*   pTokens[COM_LINE_IF_MAX_TOKENS];
+    uint8_t tokenCount = 0;
+
+    /* Split the line into words */
+    while ( *pLine != '\0' )
+    {
+        if ( *pLine == ' ' || *pLine == '\t' )
+        {
+            *pLine++ = '\0';
+            continue;
+        }
+
+        if ( tokenCount == COM_LINE_IF_MAX_TOKENS )
+        {
+            Log.errorln( "%s: Too many words, at most %d are allowed", __func__, COM_LINE_IF_MAX_TOKENS );
+            return COM_LINE_IF_PARSE_TOO_LONG;
+        }
+
+        pTokens[tokenCount++] = pLine;
+        while ( *pLine != '\0' && *pLine != ' ' && *pLine != '\t' )
+        {
+            pLine++;
+        }
+    }
+
+    /* Ignore empty lines */
+    if ( tokenCount == 0 )
+    {
+        return COM_LINE_IF_PARSE_EMPTY;
+    }
+
+    if ( !comLineIf_findCommand( pTokens[0], pCommand ) )
+    {
+        Log.errorln( "%s: Command not found: %s", __func__, pTokens[0] );
+        return COM_LINE_IF_PARSE_UNKNOWN;
+    }
+
+    if ( !comLineIf_parseArgs( pCommand, &pTokens[1], tokenCount - 1, pValues ) )
+    {
+        return COM_LINE_IF_PARSE_INVALID_ARGS;
+    }
+
+    return COM_LINE_IF_PARSE_OK;
+}
+
+
+/**
+ * @brief Looks up a command by its name.
+ *
+ * The slot of the name selects the only command that can match, so a single name is
+ * compared for any number of commands.
+ *
+ * @param pName The command name.
+ * @param pCommand Pointer to store a copy of the command table entry.
+ * @return true if there is a command with this name.
+ */
+static bool comLineIf_findCommand( const char* pName, com_line_if_cmd_t* const pCommand )
+{
+    const uint16_t hash  = comLineIf_hash( pName );
+    const uint8_t  index = pgm_read_byte( &commandIndex[comLineIf_slot( hash )] );
+
+    if ( index == COM_LINE_IF_NO_COMMAND )
+    {
+        return false;
+    }
+
+    comLineIf_readCommand( index, pCommand );
+
+    return ( pCommand->hash == hash ) && ( strcmp_P( pName, pCommand->name ) == 0 );
+}
+
+
+/**
+ * @brief Copies an entry of the command table from flash.
+ *
+ * @param index The index of the command in the command table.
+ * @param pCommand Pointer to store the copy.
+ */
+static void comLineIf_readCommand( uint8_t index, com_line_if_cmd_t* const pCommand )
+{
+    memcpy_P( pCommand, &commands[index], sizeof( com_line_if_cmd_t ) );
+}
+
+
+/**
+ * @brief Copies an argument of a command from flash.
+ *
+ * @param pCommand The command.
+ * @param argIdx The index of the argument.
+ * @param pArg Pointer to store the copy.
+ */
+static void comLineIf_readArg( const com_line_if_cmd_t* const pCommand, uint8_t argIdx, com_line_if_arg_t* const pArg )
+{
+    memcpy_P( pArg, &pCommand->pArgs[argIdx], sizeof( com_line_if_arg_t ) );
+}
+
+
+/**
+ * @brief Parses the arguments of a command.
+ *
+ * Named arguments are given as "-<flag> <value>", positional arguments are assigned in
+ * the order of the command declaration. All values are range checked. Arguments that
+ * aren't given hold their default value.
+ *
+ * @param pCommand The command.
+ * @param ppTokens The words following the command name.
+ * @param tokenCount Number of words following the command name.
+ * @param pValues Pointer to store the argument values.
+ * @return true if all arguments are valid and all required arguments are given.
+ */
+static bool comLineIf_parseArgs( const com_line_if_cmd_t* const pCommand, char* const* ppTokens, uint8_t tokenCount, com_line_if_values_t* const pValues )
+{
+    com_line_if_arg_t arg;
+
+    for ( uint8_t i = 0; i < pCommand->argCount; i++ )
+    {
+        comLineIf_readArg( pCommand, i, &arg );
+        pValues->value[i] = arg.defaultValue;
+        pValues->isSet[i] = false;
+    }
+
+    for ( uint8_t t = 0; t < tokenCount; t++ )
+    {
+        const char* pToken = ppTokens[t];
+        uint8_t     argIdx = 0;
+
+        if ( ( pToken[0] == '-' ) && isalpha( pToken[1] ) && ( pToken[2] == '\0' ) )
+        {
+            /* Named argument */
+            while ( ( argIdx < pCommand->argCount ) && ( (char) pgm_read_byte( &pCommand->pArgs[argIdx].flag ) != pToken[1] ) )
+            {
+                argIdx++;
+            }
+
+            if ( argIdx == pCommand->argCount )
+            {
+                Log.errorln( "%s: Unknown argument: %s", __func__, pToken );
+                return false;
+            }
+
+            if ( ++t == tokenCount )
+            {
+                Log.errorln( "%s: Missing value for argument %s", __func__, pToken );
+                return false;
+            }
+        }
+        else
+        {
+            /* Positional argument */
+            while (    ( argIdx < pCommand->argCount )
+                    && ( ( pgm_read_byte( &pCommand->pArgs[argIdx].flag ) != '\0' ) || pValues->isSet[argIdx] ) )
+            {
+                argIdx++;
+            }
+
+            if ( argIdx == pCommand->argCount )
+            {
+                Log.errorln( "%s: Unexpected argument: %s", __func__, pToken );
+                return false;
+            }
+        }
+
+        if ( !comLineIf_parseValue( pCommand, argIdx, ppTokens[t], pValues ) )
+        {
+            return false;
+        }
+    }
+
+    for ( uint8_t i = 0; i < pCommand->argCount; i++ )
+    {
+        comLineIf_readArg( pCommand, i, &arg );
+        if ( arg.required && !pValues->isSet[i] )
+        {
+            Log.errorln( "%s: Missing argument %d", __func__, i + 1 );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Parses and range checks the value of an argument.
+ *
+ * @param pCommand The command.
+ * @param argIdx The index of the argument.
+ * @param pToken The value as received.
+ * @param pValues Pointer to store the argument value.
+ * @return true if the value is a number within the range of the argument.
+ */
+static bool comLineIf_parseValue( const com_line_if_cmd_t* const pCommand, uint8_t argIdx, const char* pToken, com_line_if_values_t* const pValues )
 {
-    if ( Serial.available() )
+    com_line_if_arg_t arg;
+    char*             pEnd  = NULL;
+    long              value = strtol( pToken, &pEnd, 10 );
+
+    comLineIf_readArg( pCommand, argIdx, &arg );
+
+    if ( ( pEnd == pToken ) || ( *pEnd != '\0' ) )
     {
-        String input = Serial.readStringUntil( '\n' );
-        cli.parse( input );
+        Log.errorln( "%s: Invalid number: %s", __func__, pToken );
+        return false;
+    }
 
-        /* Uncomment the following lines to test the command line interface */
-        // cli.parse( String( "info" ) );
-        // cli.parse( String( "log" ) );
-        // cli.parse( String( "timer -u 30 -o 18 -b 180" ) );
-        // cli.parse( String( "time -f" ) );
-        // cli.parse( String( "dbc -i 3 -t 128" ) );
-        // cli.parse( String( "dbc -t 300" ) );
-        // cli.parse( String( "info" ) );
+    if ( ( value < arg.min ) || ( value > arg.max ) )
+    {
+        Log.errorln( "%s: Value %l out of range (%l..%l)", __func__, value, arg.min, arg.max );
+        return false;
     }
+
+    pValues->value[argIdx] = value;
+    pValues->isSet[argIdx] = true;
+
+    return true;
+}
+
+
+/**
+ * @brief Prints the name and the help text of a command.
+ *
+ * @param pCommand The copy of the command table entry.
+ */
+static void comLineIf_printCommand( const com_line_if_cmd_t* const pCommand )
+{
+    Serial.println( FLASH_STRING( pCommand->name ) );
+    Serial.println( FLASH_STRING( pCommand->pDescription ) );
+    Serial.println();
 }
 
 
@@ -125,41 +792,136 @@ void comLineIf_process( void )
  * to the serial interface. The information includes:
  * - Software version string
  * - Build date and time
+ * - Uptime
  * - Current log level
  * - Door unlock timeout
  * - Door open timeout
  * - LED blink interval
  * - Debounce delays for each input
+ * - Watchdog resets and deadline misses of the main loop stages
+ * - Stack and heap usage, if the memory monitor supports the target
  *
- * @param pCommand Pointer to the command structure.
+ * @param pValues The argument values, not used.
+ * @return true
  */
-static void comLineIf_cmdGetInfoCb( cmd* pCommand )
+static bool comLineIf_cmdGetInfoCb( const com_line_if_values_t* const pValues )
 {
-    Serial.println( "----------------------------------" );
-    Serial.println( "Door Control System Information   " );
-    Serial.println( "----------------------------------" );
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Door Control System Information   " ) );
+    Serial.println( F( "----------------------------------" ) );
 
     /* Output software version string */
-    Serial.println( "Version: " + String( GIT_VERSION_STRING ) );
+    Serial.print( F( "Version: " ) );
+    Serial.println( F( GIT_VERSION_STRING ) );
 
     /* Output the build date and time */
-    Serial.println( "Build date: " + String( __DATE__ ) + " " + String( __TIME__ ) );
+    Serial.print( F( "Build date: " ) );
+    Serial.println( F( __DATE__ " " __TIME__ ) );
+
+    /* Output the time since boot */
+    uint32_t uptime = (uint32_t) ( sysClock_getUptime() / 1000 );
+    Serial.print( F( "Uptime: " ) );
+    Serial.print( uptime / 86400UL );
+    Serial.print( F( " d " ) );
+    Serial.print( ( uptime / 3600UL ) % 24 );
+    Serial.print( F( " h " ) );
+    Serial.print( ( uptime / 60 ) % 60 );
+    Serial.print( F( " min " ) );
+    Serial.print( uptime % 60 );
+    Serial.println( F( " s" ) );
+
+    /* Output the boot times, see setup() */
+    Serial.print( F( "Reset to locked: " ) );
+    Serial.print( sysClock_getBootTime( SYS_CLOCK_BOOT_LOCKED ) );
+    Serial.println( F( " us" ) );
+    Serial.print( F( "Reset to ready: " ) );
+    Serial.print( sysClock_getBootTime( SYS_CLOCK_BOOT_READY ) );
+    Serial.println( F( " us" ) );
 
     /* Output current log level */
-    Serial.println( "Log level: " + logging_logLevelToString( Log.getLevel() ) );
+    Serial.print( F( "Log level: " ) );
+    Serial.println( logging_logLevelToString( Log.getLevel() ) );
 
     /* Output the all times and timeouts */
     settings_t* settings = appSettings_getSettings();
-    Serial.println( "Door unlock timeout: " + String( settings->doorUnlockTimeout ) + " s" );
-    Serial.println( "Door open timeout: " + String( settings->doorOpenTimeout ) + " min" );
-    Serial.println( "Led blink interval: " + String( settings->ledBlinkInterval ) + " ms" );
+    Serial.print( F( "Door unlock timeout: " ) );
+    Serial.print( settings->doorUnlockTimeout );
+    Serial.println( F( " s" ) );
+    Serial.print( F( "Door open timeout: " ) );
+    Serial.print( settings->doorOpenTimeout );
+    Serial.println( F( " min" ) );
+    Serial.print( F( "Led blink interval: " ) );
+    Serial.print( settings->ledBlinkInterval );
+    Serial.println( F( " ms" ) );
 
     for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
     {
-        Serial.println( "Debounce delay " + logging_ioToString( (io_t) i ) + ": " + String( settings->debounceDelay[i] ) + " ms" );
+        Serial.print( F( "Debounce delay " ) );
+        Serial.print( logging_ioToString( (io_t) i ) );
+        Serial.print( F( ": " ) );
+        Serial.print( settings->debounceDelay[i] );
+        Serial.println( F( " ms" ) );
+    }
+
+    Serial.print( F( "Interlock violations: " ) );
+    Serial.println( stateMan_getInterlockViolations( pCliDoorControl ) );
+    Serial.print( F( "Init duration: " ) );
+    Serial.print( stateMan_getInitDuration( pCliDoorControl ) );
+    Serial.println( F( " ms" ) );
+    Serial.print( F( "Dropped events: " ) );
+    Serial.print( stateMan_getDroppedEvents( pCliDoorControl ) );
+    Serial.print( F( ", expired: " ) );
+    Serial.println( stateMan_getExpiredEvents( pCliDoorControl ) );
+    Serial.print( F( "Output writes: " ) );
+    Serial.print( ioMan_getOutputStats( &pCliDoorControl->io )->writes );
+    Serial.print( F( " in " ) );
+    Serial.print( ioMan_getOutputStats( &pCliDoorControl->io )->flushes );
+    Serial.println( F( " flushes" ) );
+
+    const wdt_record_t* pWdtRecord = wdtMan_getRecord();
+    Serial.print( F( "Watchdog resets: " ) );
+    Serial.println( pWdtRecord->resetCount );
+    for ( uint8_t i = 0; i < WDT_STAGE_SIZE; i++ )
+    {
+        Serial.print( F( "Deadline misses " ) );
+        Serial.print( logging_wdtStageToString( (wdt_stage_t) i ) );
+        Serial.print( F( ": " ) );
+        Serial.print( wdtMan_getDeadlineMisses( (wdt_stage_t) i ) );
+        if ( pWdtRecord->lastStages & ( 1 << i ) )
+        {
+            Serial.print( F( " (running at the last reset)" ) );
+        }
+        Serial.println();
     }
 
-    Serial.println( "----------------------------------" );
+#if MEM_MON_SUPPORTED
+    const mem_mon_stats_t* pMemStats = memMon_getStats();
+    Serial.print( F( "Stack max used: " ) );
+    Serial.print( pMemStats->stackMaxUsed );
+    Serial.println( F( " bytes" ) );
+    Serial.print( F( "Heap max used: " ) );
+    Serial.print( pMemStats->heapMaxUsed );
+    Serial.println( F( " bytes" ) );
+    Serial.print( F( "Min free memory: " ) );
+    Serial.print( pMemStats->minFree );
+    Serial.println( F( " bytes" ) );
+    Serial.print( F( "Heap free: " ) );
+    Serial.print( pMemStats->heapFree );
+    Serial.print( F( " bytes (largest block " ) );
+    Serial.print( pMemStats->heapLargestBlock );
+    Serial.print( F( ", min " ) );
+    Serial.print( pMemStats->heapMinFree );
+    Serial.println( F( ")" ) );
+#endif
+
+    if ( batchActive )
+    {
+        Serial.println( F( "Configuration batch open, settings not applied yet" ) );
+    }
+
+    Serial.println( F( "----------------------------------" ) );
+
+    return true;
 }
 
 
@@ -167,38 +929,16 @@ static void comLineIf_cmdGetInfoCb( cmd* pCommand )
  * @brief Callback function to set the log level.
  *
  * This function is called to change the current log level based on the provided command argument.
- * If no log level is specified in the argument, it logs an error message and retains the current log level.
- * Otherwise, it updates the log level to the specified value and logs the change.
+ * The argument is required and range checked by the parser.
  *
- * @param pCommand Pointer to the command containing the log level argument.
+ * @param pValues The argument values: the log level.
+ * @return true if the log level was applied or staged.
  */
-static void comLineIf_cmdSetLogLevelCb( cmd* pCommand )
+static bool comLineIf_cmdSetLogLevelCb( const com_line_if_values_t* const pValues )
 {
-    Command     cmd( pCommand );
-    Argument    arg      = cmd.getArgument();
-    settings_t* settings = appSettings_getSettings();
-
-    /* Check if the log level argument is set */
-    if ( !arg.isSet() )
-    {
-        Log.errorln( "%s: No log level specified, remaining at %s.", __func__, logging_logLevelToString( settings->logLevel ).c_str() );
-        return;
-    }
-
-    /* Check if the log level is valid */
-    if ( arg.getValue().toInt() < LOG_LEVEL_SILENT || arg.getValue().toInt() > LOG_LEVEL_VERBOSE )
-    {
-        Log.errorln( "%s: Invalid log level: %d, remaining at %s.", __func__, arg.getValue().toInt(), logging_logLevelToString( settings->logLevel ).c_str() );
-        return;
-    }
+    comLineIf_stageSettings()->logLevel = (uint8_t) pValues->value[0];
 
-    /* Update the log level and log the change */
-    Log.noticeln( "Setting log level from %s to %s", logging_logLevelToString( settings->logLevel ).c_str(), logging_logLevelToString( arg.getValue().toInt() ).c_str() );
-    settings->logLevel = arg.getValue().toInt();
-    Log.setLevel( settings->logLevel );
-
-    /* Save the settings to the EEPROM */
-    appSettings_saveSettings();
+    return comLineIf_finishSettings();
 }
 
 /**
@@ -206,9 +946,10 @@ static void comLineIf_cmdSetLogLevelCb( cmd* pCommand )
  *
  * This function processes a command to set the door unlock timeout, door open timeout,
  * and LED blink interval. It retrieves the respective arguments from the command and
- * updates the corresponding settings and timers.
+ * updates the corresponding settings.
  *
- * @param pCommand Pointer to the command structure containing the arguments.
+ * @param pValues The argument values.
+ * @return true if the timers were applied or staged.
  *
  * The following command arguments are processed:
  * - "u": Sets the door unlock timeout in seconds.
@@ -220,46 +961,38 @@ static void comLineIf_cmdSetLogLevelCb( cmd* pCommand )
  * - To set the door open timeout to 5 minutes: `cmd -o 5`
  * - To set the LED blink interval to 500 milliseconds: `cmd -b 500`
  */
-static void comLineIf_cmdSetTimerCb( cmd* pCommand )
+static bool comLineIf_cmdSetTimerCb( const com_line_if_values_t* const pValues )
 {
-    Command  cmd( pCommand );
-    settings_t* settings = appSettings_getSettings();
-
     /* Check if at least one argument is set */
-    if (    !cmd.getArgument( "u" ).isSet()
-         && !cmd.getArgument( "o" ).isSet()
-         && !cmd.getArgument( "b" ).isSet() )
+    if ( !pValues->isSet[0] && !pValues->isSet[1] && !pValues->isSet[2] )
     {
-        Log.errorln( "%s",cmd.toString().c_str() );
-        return;
+        static constexpr uint8_t timerIndex = comLineIf_commandOfSlot( comLineIf_slot( comLineIf_hash( nameTimer ) ), 0 );
+        com_line_if_cmd_t        command;
+
+        Log.errorln( "%s: At least one timer must be given", __func__ );
+        comLineIf_readCommand( timerIndex, &command );
+        comLineIf_printCommand( &command );
+        return false;
     }
 
-    Argument argUnlock = cmd.getArgument( "u" );
-    if ( argUnlock.isSet() )
+    settings_t* settings = comLineIf_stageSettings();
+
+    if ( pValues->isSet[0] )
     {
-        settings->doorUnlockTimeout = argUnlock.getValue().toInt();
-        stateMan_setDoorTimer( DOOR_TIMER_TYPE_UNLOCK, settings->doorUnlockTimeout );
-        Log.noticeln( "%s: Door unlock timeout set to %d s", __func__, settings->doorUnlockTimeout );
+        settings->doorUnlockTimeout = (uint8_t) pValues->value[0];
     }
 
-    Argument argOpen = cmd.getArgument( "o" );
-    if ( argOpen.isSet() )
+    if ( pValues->isSet[1] )
     {
-        settings->doorOpenTimeout = argOpen.getValue().toInt();
-        stateMan_setDoorTimer( DOOR_TIMER_TYPE_OPEN, settings->doorOpenTimeout );
-        Log.noticeln( "%s: Door open timeout set to %d min", __func__, settings->doorOpenTimeout );
+        settings->doorOpenTimeout = (uint16_t) pValues->value[1];
     }
 
-    Argument argBlink = cmd.getArgument( "b" );
-    if ( argBlink.isSet() )
+    if ( pValues->isSet[2] )
     {
-        settings->ledBlinkInterval = argBlink.getValue().toInt();
-        Timer1.setPeriod( ( (uint32_t) 2000 ) * ( (uint32_t) settings->ledBlinkInterval ) );
-        Log.noticeln( "%s: Led blink interval set to %d ms", __func__, settings->ledBlinkInterval );
+        settings->ledBlinkInterval = (uint16_t) pValues->value[2];
     }
 
-    /* Save the settings to the EEPROM */
-    appSettings_saveSettings();
+    return comLineIf_finishSettings();
 }
 
 
@@ -268,109 +1001,1003 @@ static void comLineIf_cmdSetTimerCb( cmd* pCommand )
  * @brief Callback function to set the debounce delay for a specified input.
  *
  * This function is called to set the debounce delay for a specific input index.
- * It retrieves the input index and debounce delay from the command arguments,
- * validates the input index, and updates the debounce delay setting if the index
- * is valid. It also logs the operation result.
+ * Both arguments are required and range checked by the parser.
  *
- * @param pCommand Pointer to the command structure containing the arguments.
+ * @param pValues The argument values.
+ * @return true if the debounce delay was applied or staged.
  *
  * Command Arguments:
  * - "i": Input index (uint8_t)
  * - "t": Debounce delay time in milliseconds (int)
- *
- * Logs:
- * - Success: Logs the debounce delay set for the specified input.
- * - Error: Logs an error if the input index is invalid.
  */
-static void comLineIf_cmdSetDebounceDelayCb( cmd* pCommand )
+static bool comLineIf_cmdSetDebounceDelayCb( const com_line_if_values_t* const pValues )
 {
-    Command cmd( pCommand );
-    settings_t* settings = appSettings_getSettings();
+    comLineIf_stageSettings()->debounceDelay[pValues->value[0]] = (uint16_t) pValues->value[1];
 
-    Argument argInputIdx = cmd.getArgument( "i" );
-    uint8_t  inputIdx    = argInputIdx.getValue().toInt();
-
-    if ( inputIdx >= IO_INPUT_SIZE )
-    {
-        Log.errorln( "%s: Invalid input index: %d", __func__, inputIdx );
-        return;
-    }
-
-    /* Update the debounce delay and log the change */
-    settings->debounceDelay[inputIdx] = cmd.getArgument( "t" ).getValue().toInt();
-    ioMan_setDebounceDelay( (io_t) inputIdx, settings->debounceDelay[inputIdx] );
-    Log.noticeln( "%s: Debounce delay for input %s set to %d ms", __func__, logging_ioToString( (io_t) inputIdx ).c_str(), settings->debounceDelay[inputIdx] );
-
-    /* Save the settings to the EEPROM */
-    appSettings_saveSettings();
+    return comLineIf_finishSettings();
 }
 
 
 /**
  * @brief Callback function to get and print the input state.
  *
- * This function prints the state of each input to the serial output.
- * It iterates over all inputs, retrieves their state, and prints the
- * corresponding state as a string.
+ * Without arguments, this function prints the debounced state of each input to the
+ * serial output. With "-w 1", every change of the inputs is streamed as a single watch
+ * record until the watch is stopped with "-w 0". Neither form samples the inputs, so
+ * the debouncers of the door control are not influenced.
  *
- * @param pCommand Pointer to the command structure.
+ * @param pValues The argument values: the optional watch flag.
+ * @return true
  */
-static void comLineIf_cmdGetInputStateCb( cmd* pCommand )
+static bool comLineIf_cmdGetInputStateCb( const com_line_if_values_t* const pValues )
 {
-    Serial.println( "----------------------------------" );
-    Serial.println( "Input State" );
-    Serial.println( "----------------------------------" );
+    if ( pValues->isSet[0] )
+    {
+        watchActive = ( pValues->value[0] != 0 );
+        if ( watchActive )
+        {
+            /* Report the current inputs as first record, without edges */
+            ioMan_getInputImage( &pCliDoorControl->io, &watchImage );
+            io_input_image_t record = watchImage;
+            memset( record.edgeCount, 0, sizeof( record.edgeCount ) );
+            comLineIf_printInputImage( &record );
+        }
+        return true;
+    }
+
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Input State" ) );
+    Serial.println( F( "----------------------------------" ) );
 
     for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
     {
-        input_status_t inputState = ioMan_getDoorState( (io_t) i );
-        Serial.println( logging_ioToString( (io_t) i ) + ": " + logging_inputStateToString( inputState.state ) );
+        input_status_t inputState = ioMan_peekDoorState( &pCliDoorControl->io, (io_t) i );
+        Serial.print( logging_ioToString( (io_t) i ) );
+        Serial.print( F( ": " ) );
+        Serial.println( logging_inputStateToString( inputState.state ) );
     }
 
-    Serial.println( "----------------------------------" );
+    Serial.println( F( "----------------------------------" ) );
+
+    return true;
 }
 
 
 /**
- * @brief Callback function to display help information for commands.
+ * @brief Callback function to enable or disable the trace recording.
  *
- * This function prints out a help message to the serial output, including
- * a header and the string representation of the command line interface.
+ * While the recording is enabled, every sampled input edge and every change of the
+ * state or the magnets is written to the serial interface as a trace record.
  *
- * @param pCommand Pointer to the command structure.
+ * @param pValues The argument values: the optional enable flag.
+ * @return true
  */
-static void comLineIf_cmdHelpCb( cmd* pCommand )
+static bool comLineIf_cmdTraceCb( const com_line_if_values_t* const pValues )
 {
-    Serial.println( "Help:" );
-    Serial.println( "--------------------------------------------" );
-    Serial.println( cli.toString() );
-}
-
-
+    if ( pValues->value[0] != 0 )
+    {
+        replay_startRecording();
+    }
+    else
+    {
+        replay_stopRecording();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to start a trace replay.
+ *
+ * After this command, every line received on the serial interface is treated as a
+ * trace record until the end record "E <time>" is received.
+ *
+ * @param pValues The argument values: the tick.
+ * @return true if the replay started.
+ */
+static bool comLineIf_cmdReplayCb( const com_line_if_values_t* const pValues )
+{
+    replay_start( (uint16_t) pValues->value[0] );
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to start a configuration batch.
+ *
+ * The setters stage their changes in a copy of the settings until the batch is
+ * committed or aborted.
+ *
+ * @param pValues The argument values, not used.
+ * @return true if no batch was open yet.
+ */
+static bool comLineIf_cmdBeginCb( const com_line_if_values_t* const pValues )
+{
+    if ( batchActive )
+    {
+        Log.errorln( "%s: Configuration batch already open", __func__ );
+        return false;
+    }
+
+    memcpy( &stagedSettings, appSettings_getSettings(), sizeof( settings_t ) );
+    batchActive = true;
+    Log.noticeln( "%s: Configuration batch opened", __func__ );
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to commit a configuration batch.
+ *
+ * The staged settings are validated as a whole, applied and saved to the EEPROM once.
+ * Invalid settings are discarded completely.
+ *
+ * @param pValues The argument values, not used.
+ * @return true if the staged settings were applied.
+ */
+static bool comLineIf_cmdCommitCb( const com_line_if_values_t* const pValues )
+{
+    if ( !batchActive )
+    {
+        Log.errorln( "%s: No configuration batch open", __func__ );
+        return false;
+    }
+
+    batchActive = false;
+
+    return comLineIf_commitSettings();
+}
+
+
+/**
+ * @brief Callback function to discard a configuration batch.
+ *
+ * @param pValues The argument values, not used.
+ * @return true if a batch was open.
+ */
+static bool comLineIf_cmdAbortCb( const com_line_if_values_t* const pValues )
+{
+    if ( !batchActive )
+    {
+        Log.errorln( "%s: No configuration batch open", __func__ );
+        return false;
+    }
+
+    batchActive = false;
+    Log.noticeln( "%s: Configuration batch discarded", __func__ );
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to run the micro benchmarks.
+ *
+ * The benchmarks run on their own state machine and inputs, the doors keep their state.
+ * The main loop is blocked until all benchmarks are done.
+ *
+ * @param pValues The argument values: 1 prints the JSON report of tools/bench.py.
+ * @return true
+ */
+static bool comLineIf_cmdBenchCb( const com_line_if_values_t* const pValues )
+{
+    if ( pValues->value[0] != 0 )
+    {
+        bench_printJson();
+    }
+    else
+    {
+        bench_printTable();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to show or set the controller bus.
+ *
+ * Without arguments, the state of the neighbours and the bus statistics are printed.
+ * Otherwise the address and the neighbours are set like any other setting.
+ *
+ * @param pValues The argument values: the optional address and neighbours.
+ * @return true if the bus was printed or the change was applied or staged.
+ */
+static bool comLineIf_cmdBusCb( const com_line_if_values_t* const pValues )
+{
+    if ( !pValues->isSet[0] && !pValues->isSet[1] )
+    {
+        comLineIf_printBus();
+        return true;
+    }
+
+    settings_t* settings = comLineIf_stageSettings();
+
+    if ( pValues->isSet[0] )
+    {
+        settings->busAddress = (uint8_t) pValues->value[0];
+    }
+
+    if ( pValues->isSet[1] )
+    {
+        settings->busNeighbours = (uint8_t) pValues->value[1];
+    }
+
+    return comLineIf_finishSettings();
+}
+
+
+/**
+ * @brief Callback function to show the badge readers or set the badge doors.
+ *
+ * Without arguments, the badge statistics are printed. Otherwise the badge doors are set
+ * like any other setting.
+ *
+ * @param pValues The argument values: the optional badge doors.
+ * @return true if the badge readers were printed or the change was applied or staged.
+ */
+static bool comLineIf_cmdBadgeCb( const com_line_if_values_t* const pValues )
+{
+    if ( !pValues->isSet[0] )
+    {
+        comLineIf_printBadges();
+        return true;
+    }
+
+    comLineIf_stageSettings()->badgeDoors = (uint8_t) pValues->value[0];
+
+    return comLineIf_finishSettings();
+}
+
+
+/**
+ * @brief Callback function to show the access schedules or open or lock a window.
+ *
+ * Without arguments, the open windows of every door and day are printed. Otherwise the
+ * window from -f to -t is opened or locked on the selected doors and days like any other
+ * setting. The window must start and end on a slot boundary.
+ *
+ * @param pValues The argument values: door, day, start, end and action of the window.
+ * @return true if the schedules were printed or the change was applied or staged.
+ */
+static bool comLineIf_cmdSchedCb( const com_line_if_values_t* const pValues )
+{
+    uint8_t firstSlot;
+    uint8_t endSlot;
+
+    if ( !pValues->isSet[0] && !pValues->isSet[1] && !pValues->isSet[2] && !pValues->isSet[3] && !pValues->isSet[4] )
+    {
+        comLineIf_printSchedules();
+        return true;
+    }
+
+    if ( !comLineIf_toSlot( pValues->value[2], &firstSlot ) || !comLineIf_toSlot( pValues->value[3], &endSlot ) )
+    {
+        Log.errorln( "%s: The window must start and end on a multiple of %d minutes", __func__, SCHED_SLOT_LENGTH );
+        return false;
+    }
+
+    if ( firstSlot >= endSlot )
+    {
+        Log.errorln( "%s: The window must end after it starts", __func__ );
+        return false;
+    }
+
+    settings_t* settings = comLineIf_stageSettings();
+
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        for ( uint8_t day = 0; day < SCHED_DAYS; day++ )
+        {
+            if (    ( ( pValues->value[0] == 0 ) || ( pValues->value[0] == door + 1 ) )
+                 && ( ( pValues->value[1] == 0 ) || ( pValues->value[1] == day + 1 ) ) )
+            {
+                schedMan_setWindow( settings, (door_type_t) door, day, firstSlot, endSlot, pValues->value[4] != 0 );
+            }
+        }
+    }
+
+    return comLineIf_finishSettings();
+}
+
+
+/**
+ * @brief Callback function to show or set the time of the week.
+ *
+ * Without arguments, the time of the week is printed. Otherwise the given values replace
+ * the ones of the current time and the seconds start at 0. The clock isn't a setting, so
+ * it is set immediately, even inside of a batch.
+ *
+ * @param pValues The argument values: the optional day of the week, hour and minute.
+ * @return true if the time was printed or set.
+ */
+static bool comLineIf_cmdClockCb( const com_line_if_values_t* const pValues )
+{
+    if ( !pValues->isSet[0] && !pValues->isSet[1] && !pValues->isSet[2] )
+    {
+        comLineIf_printClock();
+        return true;
+    }
+
+    const uint32_t current = rtcClock_getWeekTime();
+    const uint32_t day     = pValues->isSet[0] ? (uint32_t) ( pValues->value[0] - 1 ) : current / RTC_CLOCK_DAY;
+    const uint32_t hour    = pValues->isSet[1] ? (uint32_t) pValues->value[1] : ( current % RTC_CLOCK_DAY ) / 3600;
+    const uint32_t minute  = pValues->isSet[2] ? (uint32_t) pValues->value[2] : ( current % 3600 ) / 60;
+
+    if ( !rtcClock_setWeekTime( day * RTC_CLOCK_DAY + hour * 3600 + minute * 60 ) )
+    {
+        return false;
+    }
+
+    schedMan_update();
+    comLineIf_printClock();
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to show the emergency release, enable its input or reset it.
+ *
+ * Without arguments, the emergency release is printed. The input is enabled like any
+ * other setting. A reset isn't a setting, so it is executed immediately, even inside of
+ * a batch.
+ *
+ * @param pValues The argument values: the optional input setting and reset.
+ * @return true if the release was printed, the change was applied or staged and the reset succeeded.
+ */
+static bool comLineIf_cmdEmergCb( const com_line_if_values_t* const pValues )
+{
+    bool success = true;
+
+    if ( !pValues->isSet[0] && !pValues->isSet[1] )
+    {
+        comLineIf_printEmergency();
+        return true;
+    }
+
+    if ( pValues->isSet[0] )
+    {
+        comLineIf_stageSettings()->emergencyInput = (uint8_t) pValues->value[0];
+        success                                   = comLineIf_finishSettings();
+    }
+
+    if ( pValues->isSet[1] )
+    {
+        success = emergMan_reset() && success;
+    }
+
+    return success;
+}
+
+
+/**
+ * @brief Callback function to show the event latencies or clear them.
+ *
+ * The latencies are printed as a table or as a single JSON line for telemetry. Clearing
+ * starts a new measurement, e.g. before a load test.
+ *
+ * @param pValues The argument values: 1 prints the JSON report, 1 clears the histograms.
+ * @return true
+ */
+static bool comLineIf_cmdLatCb( const com_line_if_values_t* const pValues )
+{
+    if ( pValues->isSet[1] )
+    {
+        latMon_clear();
+        Log.noticeln( "%s: Event latencies cleared", __func__ );
+    }
+    else if ( pValues->value[0] != 0 )
+    {
+        latMon_printJson();
+    }
+    else
+    {
+        latMon_printTable();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Callback function to show or set the dispatch budget per loop.
+ *
+ * Without arguments, the budget and how often it ran out are printed. Otherwise the given
+ * limits are set like any other setting.
+ *
+ * @param pValues The argument values: the most events and the longest dispatch per loop and
+ *                the age after which a deferred event is dropped.
+ * @return true if the budget was printed or the change was applied or staged.
+ */
+static bool comLineIf_cmdBudgetCb( const com_line_if_values_t* const pValues )
+{
+    if ( !pValues->isSet[0] && !pValues->isSet[1] && !pValues->isSet[2] )
+    {
+        comLineIf_printBudget();
+        return true;
+    }
+
+    settings_t* settings = comLineIf_stageSettings();
+
+    if ( pValues->isSet[0] )
+    {
+        settings->dispatchMaxEvents = (uint8_t) pValues->value[0];
+    }
+
+    if ( pValues->isSet[1] )
+    {
+        settings->dispatchMaxTime = (uint16_t) pValues->value[1];
+    }
+
+    if ( pValues->isSet[2] )
+    {
+        settings->deferMaxAge = (uint16_t) pValues->value[2];
+    }
+
+    return comLineIf_finishSettings();
+}
+
+
+/**
+ * @brief Callback function to display help information for commands.
+ *
+ * This function prints out a help message to the serial output, including
+ * a header and the name and help text of every command.
+ *
+ * @param pValues The argument values, not used.
+ * @return true
+ */
+static bool comLineIf_cmdHelpCb( const com_line_if_values_t* const pValues )
+{
+    Serial.println( F( "Help:" ) );
+    Serial.println( F( "--------------------------------------------" ) );
+
+    com_line_if_cmd_t command;
+
+    for ( uint8_t i = 0; i < COM_LINE_IF_CMD_SIZE; i++ )
+    {
+        comLineIf_readCommand( i, &command );
+        comLineIf_printCommand( &command );
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Returns the settings the setters write to.
+ *
+ * Outside of a batch, the staged settings start as a copy of the current settings
+ * for every setter.
+ *
+ * @return settings_t* The staged settings.
+ */
+static settings_t* comLineIf_stageSettings( void )
+{
+    if ( !batchActive )
+    {
+        memcpy( &stagedSettings, appSettings_getSettings(), sizeof( settings_t ) );
+    }
+
+    return &stagedSettings;
+}
+
+
+/**
+ * @brief Completes a setter.
+ *
+ * Inside of a batch the change stays staged, otherwise it is committed immediately.
+ *
+ * @return true if the change was staged or applied.
+ */
+static bool comLineIf_finishSettings( void )
+{
+    if ( batchActive )
+    {
+        Log.noticeln( "%s: Change staged, apply it with 'commit'", __func__ );
+        return true;
+    }
+
+    return comLineIf_commitSettings();
+}
+
+
+/**
+ * @brief Validates, applies and saves the staged settings.
+ *
+ * @return true if the staged settings were valid and applied.
+ */
+static bool comLineIf_commitSettings( void )
+{
+    if ( !appSettings_validateSettings( &stagedSettings ) )
+    {
+        Log.errorln( "%s: Settings rejected, nothing applied", __func__ );
+        return false;
+    }
+
+    comLineIf_applySettings( &stagedSettings );
+
+    /* Save all changes to the EEPROM at once */
+    memcpy( appSettings_getSettings(), &stagedSettings, sizeof( settings_t ) );
+    appSettings_saveSettings();
+
+    return true;
+}
+
+
+/**
+ * @brief Applies all settings that differ from the current settings.
+ *
+ * @param pSettings The new settings.
+ */
+static void comLineIf_applySettings( const settings_t* const pSettings )
+{
+    const settings_t* pCurrent = appSettings_getSettings();
+
+    if ( pSettings->logLevel != pCurrent->logLevel )
+    {
+        Log.noticeln( "Setting log level from %s to %s", logging_logLevelToString( pCurrent->logLevel ), logging_logLevelToString( pSettings->logLevel ) );
+        Log.setLevel( pSettings->logLevel );
+    }
+
+    if ( pSettings->doorUnlockTimeout != pCurrent->doorUnlockTimeout )
+    {
+        stateMan_setDoorTimer( pCliDoorControl, DOOR_TIMER_TYPE_UNLOCK, pSettings->doorUnlockTimeout );
+        Log.noticeln( "%s: Door unlock timeout set to %d s", __func__, pSettings->doorUnlockTimeout );
+    }
+
+    if ( pSettings->doorOpenTimeout != pCurrent->doorOpenTimeout )
+    {
+        stateMan_setDoorTimer( pCliDoorControl, DOOR_TIMER_TYPE_OPEN, pSettings->doorOpenTimeout );
+        Log.noticeln( "%s: Door open timeout set to %d min", __func__, pSettings->doorOpenTimeout );
+    }
+
+    if ( pSettings->ledBlinkInterval != pCurrent->ledBlinkInterval )
+    {
+        ledMan_setTickInterval( pSettings->ledBlinkInterval );
+        Log.noticeln( "%s: Led blink interval set to %d ms", __func__, pSettings->ledBlinkInterval );
+    }
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        if ( pSettings->debounceDelay[i] != pCurrent->debounceDelay[i] )
+        {
+            ioMan_setDebounceDelay( &pCliDoorControl->io, (io_t) i, pSettings->debounceDelay[i] );
+            Log.noticeln( "%s: Debounce delay for input %s set to %d ms", __func__, logging_ioToString( (io_t) i ), pSettings->debounceDelay[i] );
+        }
+    }
+
+    if (    ( pSettings->busAddress != pCurrent->busAddress )
+         || ( pSettings->busNeighbours != pCurrent->busNeighbours ) )
+    {
+        ctrlBus_configure( pCliCtrlBus, pSettings->busAddress, pSettings->busNeighbours );
+    }
+
+    if ( pSettings->badgeDoors != pCurrent->badgeDoors )
+    {
+        badgeMan_setDoors( pSettings->badgeDoors );
+    }
+
+    if ( memcmp( pSettings->lockedSlots, pCurrent->lockedSlots, sizeof( pSettings->lockedSlots ) ) != 0 )
+    {
+        schedMan_update();
+        Log.noticeln( "%s: Access schedules changed", __func__ );
+    }
+
+    if ( pSettings->emergencyInput != pCurrent->emergencyInput )
+    {
+        emergMan_setEnabled( pSettings->emergencyInput );
+    }
+
+    if (    ( pSettings->dispatchMaxEvents != pCurrent->dispatchMaxEvents )
+         || ( pSettings->dispatchMaxTime != pCurrent->dispatchMaxTime ) )
+    {
+        stateMan_setDispatchBudget( pCliDoorControl, pSettings->dispatchMaxEvents, pSettings->dispatchMaxTime );
+        Log.noticeln( "%s: Dispatch budget set to %d events, %d us", __func__, pSettings->dispatchMaxEvents, pSettings->dispatchMaxTime );
+    }
+
+    if ( pSettings->deferMaxAge != pCurrent->deferMaxAge )
+    {
+        stateMan_setDeferMaxAge( pCliDoorControl, pSettings->deferMaxAge );
+        Log.noticeln( "%s: Deferral age set to %d s", __func__, pSettings->deferMaxAge );
+    }
+}
+
+
+/**
+ * @brief Reports changed inputs while the inputs are watched.
+ *
+ * A record is only written if the raw or the debounced state of an input changed since
+ * the previous record, so a stable input costs a single compare per loop.
+ */
+static void comLineIf_processWatch( void )
+{
+    io_input_image_t image;
+
+    ioMan_getInputImage( &pCliDoorControl->io, &image );
+
+    if ( ( image.raw == watchImage.raw ) && ( image.debounced == watchImage.debounced ) )
+    {
+        return;
+    }
+
+    /* Report the edges since the previous record */
+    io_input_image_t record = image;
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        record.edgeCount[i] = image.edgeCount[i] - watchImage.edgeCount[i];
+    }
+
+    comLineIf_printInputImage( &record );
+    watchImage = image;
+}
+
+
+/**
+ * @brief Prints a watch record.
+ *
+ * Format: "W <time> <raw> <debounced> <edges of every input>", where raw and debounced
+ * hold one digit per input in the order of io_t, 1 for active.
+ *
+ * @param pImage The input image to print.
+ */
+static void comLineIf_printInputImage( const io_input_image_t* const pImage )
+{
+    Serial.print( F( "W " ) );
+    Serial.print( pImage->time );
+    Serial.print( ' ' );
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        Serial.print( ( pImage->raw & ( 1 << i ) ) ? '1' : '0' );
+    }
+    Serial.print( ' ' );
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        Serial.print( ( pImage->debounced & ( 1 << i ) ) ? '1' : '0' );
+    }
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        Serial.print( ' ' );
+        Serial.print( pImage->edgeCount[i] );
+    }
+    Serial.println();
+}
+
 
 /**
- * @brief Callback function to handle command errors.
+ * @brief Prints the state of the neighbours and the statistics of the controller bus.
+ */
+static void comLineIf_printBus( void )
+{
+    const settings_t*       settings = appSettings_getSettings();
+    const ctrl_bus_stats_t* pStats   = ctrlBus_getStats( pCliCtrlBus );
+
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Controller Bus" ) );
+    Serial.println( F( "----------------------------------" ) );
+
+    Serial.print( F( "Address: " ) );
+    if ( !ctrlBus_isEnabled( pCliCtrlBus ) )
+    {
+        Serial.println( F( "off" ) );
+        Serial.println( F( "----------------------------------" ) );
+        return;
+    }
+    Serial.println( settings->busAddress );
+
+    for ( uint8_t address = 1; address <= CTRL_BUS_MAX_ADDRESS; address++ )
+    {
+        if ( ( settings->busNeighbours & ( 1 << ( address - 1 ) ) ) == 0 )
+        {
+            continue;
+        }
+
+        const ctrl_bus_node_t* pNode = ctrlBus_getNode( pCliCtrlBus, address );
+        Serial.print( F( "Neighbour " ) );
+        Serial.print( address );
+        if ( pNode->online )
+        {
+            Serial.print( F( ": " ) );
+            Serial.print( logging_stateToString( (door_control_state_t) pNode->state ) );
+            Serial.print( F( ", unlocked doors 0x" ) );
+            Serial.println( pNode->unlockedDoors, HEX );
+        }
+        else
+        {
+            Serial.println( F( ": offline" ) );
+        }
+    }
+
+    Serial.print( F( "Frames: " ) );
+    Serial.print( pStats->framesSent );
+    Serial.print( F( " sent, " ) );
+    Serial.print( pStats->framesReceived );
+    Serial.print( F( " received, " ) );
+    Serial.print( pStats->crcErrors );
+    Serial.println( F( " discarded" ) );
+    Serial.print( F( "Grants: " ) );
+    Serial.print( pStats->grants );
+    Serial.print( F( " granted, " ) );
+    Serial.print( pStats->denials );
+    Serial.print( F( " failed, " ) );
+    Serial.print( pStats->retransmits );
+    Serial.println( F( " retransmits" ) );
+    Serial.print( F( "Grant latency: " ) );
+    Serial.print( pStats->lastLatency );
+    Serial.print( F( " us (max " ) );
+    Serial.print( pStats->maxLatency );
+    Serial.println( F( " us)" ) );
+    Serial.println( F( "----------------------------------" ) );
+}
+
+
+/**
+ * @brief Prints the badge doors, the size of the credential table and the badge statistics.
+ */
+static void comLineIf_printBadges( void )
+{
+    const badge_stats_t* pStats = badgeMan_getStats();
+
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Badge Readers" ) );
+    Serial.println( F( "----------------------------------" ) );
+    Serial.print( F( "Badge doors: 0x" ) );
+    Serial.println( appSettings_getSettings()->badgeDoors, HEX );
+    Serial.print( F( "Credentials: " ) );
+    Serial.println( credStore_getTable()->count );
+    Serial.print( F( "Badges: " ) );
+    Serial.print( pStats->granted );
+    Serial.print( F( " granted, " ) );
+    Serial.print( pStats->denied );
+    Serial.print( F( " denied, " ) );
+    Serial.print( pStats->invalid );
+    Serial.print( F( " invalid, " ) );
+    Serial.print( pStats->expired );
+    Serial.println( F( " expired" ) );
+
+    if ( pStats->lastResult != BADGE_RESULT_NONE )
+    {
+        Serial.print( F( "Last badge: " ) );
+        if ( pStats->lastResult == BADGE_RESULT_INVALID )
+        {
+            Serial.print( F( "invalid" ) );
+        }
+        else
+        {
+            Serial.print( pStats->lastId );
+            Serial.print( ( pStats->lastResult == BADGE_RESULT_GRANTED ) ? F( " granted" ) : F( " denied" ) );
+        }
+        Serial.print( F( " at door " ) );
+        Serial.println( pStats->lastDoor + 1 );
+    }
+    Serial.println( F( "----------------------------------" ) );
+}
+
+
+/**
+ * @brief Converts a time of the day to a slot of the access schedules.
  *
- * This function is called when a command error occurs. It logs the error
- * message and, if a command is associated with the error, suggests the
- * correct command. If no command is associated with the error, it lists
- * all available commands.
+ * @param time The time of the day as hhmm, 2400 for the end of the day.
+ * @param pSlot Pointer to store the slot that starts at the time.
+ * @return true if the time is valid and starts a slot, false otherwise.
+ */
+static bool comLineIf_toSlot( int32_t time, uint8_t* const pSlot )
+{
+    const uint16_t minutes = ( time / 100 ) * 60 + ( time % 100 );
+
+    if ( ( ( time % 100 ) >= 60 ) || ( minutes > SCHED_SLOTS_PER_DAY * SCHED_SLOT_LENGTH ) || ( ( minutes % SCHED_SLOT_LENGTH ) != 0 ) )
+    {
+        return false;
+    }
+
+    *pSlot = (uint8_t) ( minutes / SCHED_SLOT_LENGTH );
+
+    return true;
+}
+
+
+/**
+ * @brief Prints the time of the week and the open windows of every door and day.
+ */
+static void comLineIf_printSchedules( void )
+{
+    const settings_t* pSettings = appSettings_getSettings();
+
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Access Schedules" ) );
+    Serial.println( F( "----------------------------------" ) );
+    comLineIf_printClock();
+
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        Serial.print( F( "Door " ) );
+        Serial.print( door + 1 );
+        Serial.println( schedMan_isOpen( (door_type_t) door ) ? F( " (open now)" ) : F( " (locked now)" ) );
+
+        for ( uint8_t day = 0; day < SCHED_DAYS; day++ )
+        {
+            bool    anyOpen   = false;
+            uint8_t firstSlot = 0;
+
+            Serial.print( F( "  " ) );
+            comLineIf_printDay( day );
+            Serial.print( F( ":" ) );
+
+            /* Print every run of open slots, the slot after the day closes the last run */
+            for ( uint8_t slot = 0; slot <= SCHED_SLOTS_PER_DAY; slot++ )
+            {
+                const bool open = ( slot < SCHED_SLOTS_PER_DAY ) && schedMan_isSlotOpen( pSettings, (door_type_t) door, day, slot );
+
+                if ( open && ( ( slot == 0 ) || !schedMan_isSlotOpen( pSettings, (door_type_t) door, day, slot - 1 ) ) )
+                {
+                    firstSlot = slot;
+                }
+                else if ( !open && ( slot > 0 ) && schedMan_isSlotOpen( pSettings, (door_type_t) door, day, slot - 1 ) )
+                {
+                    anyOpen = true;
+                    Serial.print( F( " " ) );
+                    comLineIf_printTwoDigits( firstSlot * SCHED_SLOT_LENGTH / 60 );
+                    Serial.print( F( ":" ) );
+                    comLineIf_printTwoDigits( firstSlot * SCHED_SLOT_LENGTH % 60 );
+                    Serial.print( F( "-" ) );
+                    comLineIf_printTwoDigits( slot * SCHED_SLOT_LENGTH / 60 );
+                    Serial.print( F( ":" ) );
+                    comLineIf_printTwoDigits( slot * SCHED_SLOT_LENGTH % 60 );
+                }
+            }
+
+            Serial.println( anyOpen ? F( "" ) : F( " locked" ) );
+        }
+    }
+    Serial.println( F( "----------------------------------" ) );
+}
+
+
+/**
+ * @brief Prints the time of the week, or that the clock isn't set.
+ */
+static void comLineIf_printClock( void )
+{
+    Serial.print( F( "Clock: " ) );
+
+    if ( !rtcClock_isValid() )
+    {
+        Serial.println( F( "not set, the schedules aren't applied" ) );
+        return;
+    }
+
+    const uint32_t weekTime = rtcClock_getWeekTime();
+
+    comLineIf_printDay( weekTime / RTC_CLOCK_DAY );
+    Serial.print( F( " " ) );
+    comLineIf_printTwoDigits( ( weekTime % RTC_CLOCK_DAY ) / 3600 );
+    Serial.print( F( ":" ) );
+    comLineIf_printTwoDigits( ( weekTime % 3600 ) / 60 );
+    Serial.print( F( ":" ) );
+    comLineIf_printTwoDigits( weekTime % 60 );
+    Serial.println();
+}
+
+
+/**
+ * @brief Prints the short name of a day of the week.
  *
- * @param pError Pointer to the cmd_error structure containing error details.
+ * @param day The day of the week, 0 = Monday.
+ */
+static void comLineIf_printDay( uint8_t day )
+{
+    for ( uint8_t i = 0; i < 3; i++ )
+    {
+        Serial.print( (char) pgm_read_byte( &dayNames[day * 3 + i] ) );
+    }
+}
+
+
+/**
+ * @brief Prints a value with a leading zero below 10.
+ *
+ * @param value The value, 0..99.
+ */
+static void comLineIf_printTwoDigits( uint8_t value )
+{
+    if ( value < 10 )
+    {
+        Serial.print( '0' );
+    }
+    Serial.print( value );
+}
+
+
+/**
+ * @brief Prints the emergency input, the state of the release and its latency.
  */
-static void comLineIf_cmdErrorCb( cmd_error* pError )
+static void comLineIf_printEmergency( void )
 {
-    CommandError error( pError );
+    const emerg_stats_t* pStats = emergMan_getStats();
 
-    Log.noticeln( "%s: %s", __func__, error.toString().c_str() );
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Emergency Release" ) );
+    Serial.println( F( "----------------------------------" ) );
+    Serial.print( F( "Input: " ) );
+    Serial.print( appSettings_getSettings()->emergencyInput ? F( "on" ) : F( "off" ) );
+    Serial.print( F( ", pin " ) );
+    Serial.print( EMERGENCY_PIN );
+    Serial.println( emergMan_isInputActive() ? F( " open" ) : F( " closed" ) );
+    Serial.print( F( "State: " ) );
+    if ( emergMan_isLatched() )
+    {
+        Serial.println( F( "released" ) );
+    }
+    else
+    {
+        Serial.println( appSettings_getSettings()->emergencyInput ? F( "armed" ) : F( "off" ) );
+    }
+    Serial.print( F( "Releases: " ) );
+    Serial.println( pStats->releases );
+    Serial.print( F( "Release time: " ) );
+    Serial.print( pStats->releaseTime );
+    Serial.println( F( " us" ) );
+    Serial.print( F( "Event latency: " ) );
+    Serial.print( pStats->eventLatency );
+    Serial.println( F( " us" ) );
+    Serial.println( F( "----------------------------------" ) );
+}
+
+
+/**
+ * @brief Prints the dispatch budget per loop and how often it ran out.
+ */
+static void comLineIf_printBudget( void )
+{
+    const door_control_budget_t* pBudget = stateMan_getDispatchBudget( pCliDoorControl );
 
-    if ( error.hasCommand() )
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Dispatch Budget" ) );
+    Serial.println( F( "----------------------------------" ) );
+    Serial.print( F( "Max events: " ) );
+    if ( pBudget->maxEvents != 0 )
+    {
+        Serial.println( pBudget->maxEvents );
+    }
+    else
+    {
+        Serial.println( F( "unlimited" ) );
+    }
+    Serial.print( F( "Max time: " ) );
+    if ( pBudget->maxTime != 0 )
     {
-        Log.noticeln( "Did you mean: %s", error.getCommand().toString().c_str() );
+        Serial.print( pBudget->maxTime );
+        Serial.println( F( " us" ) );
     }
     else
     {
-        Log.noticeln( "Available commands:" );
-        Serial.println( "\n" + cli.toString() );
+        Serial.println( F( "unlimited" ) );
     }
-}
\ No newline at end of file
+    Serial.print( F( "Deferral age: " ) );
+    if ( pBudget->deferMaxAge != 0 )
+    {
+        Serial.print( pBudget->deferMaxAge );
+        Serial.println( F( " s" ) );
+    }
+    else
+    {
+        Serial.println( F( "never" ) );
+    }
+    Serial.print( F( "Exhausted: " ) );
+    Serial.println( pBudget->exhaustions );
+    Serial.print( F( "Carried over: " ) );
+    Serial.println( pBudget->carried );
+    Serial.print( F( "Peak events: " ) );
+    Serial.println( pBudget->peakEvents );
+    Serial.print( F( "Peak time: " ) );
+    Serial.print( pBudget->peakTime );
+    Serial.println( F( " us" ) );
+    Serial.println( F( "----------------------------------" ) );
+}
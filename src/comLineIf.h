@@ -11,14 +11,74 @@
 #ifndef COMMAND_LINE_INTERFACE_H
 #define COMMAND_LINE_INTERFACE_H
 
+#include "stateMan.h"
+#include "ctrlBus.h"
+
+/*************************************** Defines ****************************************/
+
+#define COM_LINE_IF_LINE_SIZE   128 /*!< Maximum length of a command line including the terminator */
+#define COM_LINE_IF_MAX_TOKENS  12  /*!< Maximum number of words of a single command */
+#define COM_LINE_IF_SEPARATOR   ';' /*!< Separates the commands of a bulk command line */
+#define COM_LINE_IF_MAX_ARGS    5   /*!< Maximum number of arguments of a command */
 
 /************************************ ENUMERATION *************************************/
 
+/**
+ * @brief Enumeration of the parse result
+ */
+typedef enum
+{
+    COM_LINE_IF_PARSE_OK,           /*!< The command and its arguments are valid */
+    COM_LINE_IF_PARSE_EMPTY,        /*!< The line holds no command */
+    COM_LINE_IF_PARSE_TOO_LONG,     /*!< The line holds more than COM_LINE_IF_MAX_TOKENS words */
+    COM_LINE_IF_PARSE_UNKNOWN,      /*!< There is no command with this name */
+    COM_LINE_IF_PARSE_INVALID_ARGS  /*!< An argument is invalid or missing */
+} com_line_if_parse_t;
+
 /************************************* STRUCTURE **************************************/
 
+/**
+ * @brief The argument structure
+ * @details Describes a single integer argument of a command
+ */
+typedef struct
+{
+    char    flag;         /*!< The flag of a named argument ("-u" -> 'u'), '\0' for a positional argument */
+    int32_t min;          /*!< The smallest accepted value */
+    int32_t max;          /*!< The largest accepted value */
+    int32_t defaultValue; /*!< The value if the argument isn't given */
+    bool    required;     /*!< The argument must be given */
+} com_line_if_arg_t;
+
+/**
+ * @brief The parsed argument values
+ * @details Indexed in the order of the arguments in the command declaration
+ */
+typedef struct
+{
+    int32_t value[COM_LINE_IF_MAX_ARGS]; /*!< The argument values, the default value if not given */
+    bool    isSet[COM_LINE_IF_MAX_ARGS]; /*!< The argument was given on the command line */
+} com_line_if_values_t;
+
+/**
+ * @brief The command structure
+ * @details Describes a single command of the command table
+ */
+typedef struct
+{
+    const char*              name;                                              /*!< The command name, stored in flash */
+    uint16_t                 hash;                                              /*!< The hash of the command name */
+    bool                     ( *handler )( const com_line_if_values_t* const ); /*!< The command handler, returns false on failure */
+    const com_line_if_arg_t* pArgs;                                             /*!< The arguments, stored in flash, may be NULL */
+    uint8_t                  argCount;                                          /*!< Number of arguments */
+    const char*              pDescription;                                      /*!< The help text, stored in flash */
+} com_line_if_cmd_t;
+
 /******************************** Function prototype ************************************/
 
-void comLineIf_setup( void );
+void comLineIf_setup( door_control_t* const pDoorControl, ctrl_bus_t* const pCtrlBus );
 void comLineIf_process( void );
 
-#endif  // COMMAND_LINE_INTERFACE_H
\ No newline at end of file
+com_line_if_parse_t comLineIf_parseCommand( char* pLine, com_line_if_cmd_t* const pCommand, com_line_if_values_t* const pValues );
+
+#endif  // COMMAND_LINE_INTERFACE_H
@@ -0,0 +1,102 @@
+/**
+ * \file    credStore.cpp
+ * \brief   Source file for the credential store
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "credStore.h"
+
+/*
+ * The credential table is generated by tools/credentials.py from the credential list of
+ * the project (custom_credentials in platformio.ini) while building. A lookup hashes the
+ * credential twice and reads two keys from flash, independent of the size of the table:
+ *
+ *     bucket = reduce( hash( id, bucketSeed ), buckets )
+ *     slot   = reduce( hash( id, slotSeed + displace[bucket] * CRED_STORE_GOLDEN ), slots )
+ *     found  = key[slot] == id
+ *
+ * The hash and the reduction must match tools/credentials.py.
+ */
+#include "credTable.h"
+
+
+/**************************** Static Function prototype *********************************/
+
+static uint16_t credStore_reduce( uint32_t hash, uint16_t range );
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Returns the credential table of the firmware.
+ *
+ * @return const cred_table_t* The credential table.
+ */
+const cred_table_t* credStore_getTable( void )
+{
+    return &credTable;
+}
+
+
+/**
+ * @brief Checks whether a credential is in a table.
+ *
+ * @param pTable Pointer to the credential table.
+ * @param id The credential.
+ * @return true if the credential is in the table, false otherwise.
+ */
+bool credStore_contains( const cred_table_t* const pTable, uint32_t id )
+{
+    if ( id == CRED_STORE_EMPTY )
+    {
+        return false;
+    }
+
+    const uint16_t bucket   = credStore_reduce( credStore_hash( id, pTable->bucketSeed ), pTable->buckets );
+    const uint16_t displace = pgm_read_word( &pTable->pDisplace[bucket] );
+    const uint16_t slot     = credStore_reduce( credStore_hash( id, pTable->slotSeed + displace * CRED_STORE_GOLDEN ), pTable->slots );
+
+    return    ( pgm_read_word( &pTable->pKeyLow[slot] ) == (uint16_t) id )
+           && ( pgm_read_word( &pTable->pKeyHigh[slot] ) == (uint16_t) ( id >> 16 ) );
+}
+
+
+/**
+ * @brief Hashes a credential with the finalizer of MurmurHash3.
+ *
+ * @param id The credential.
+ * @param seed The seed.
+ * @return uint32_t The hash.
+ */
+uint32_t credStore_hash( uint32_t id, uint32_t seed )
+{
+    uint32_t hash = id ^ seed;
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BUL;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35UL;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+
+/**
+ * @brief Maps a hash to 0..range - 1 without a division.
+ *
+ * Uses the upper 16 bits of the hash, a 16 x 16 bit multiplication is cheap on the Mega.
+ *
+ * @param hash The hash.
+ * @param range The number of values.
+ * @return uint16_t The value.
+ */
+static uint16_t credStore_reduce( uint32_t hash, uint16_t range )
+{
+    return (uint16_t) ( ( (uint32_t) (uint16_t) ( hash >> 16 ) * range ) >> 16 );
+}
@@ -0,0 +1,50 @@
+/**
+ * \file    credStore.h
+ * \brief   Header file for the credential store
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef CREDENTIAL_STORE_H
+#define CREDENTIAL_STORE_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define CRED_STORE_EMPTY            0xFFFFFFFFUL /*!< Key of an unused slot, never a valid credential */
+#define CRED_STORE_GOLDEN           0x9E3779B1UL /*!< Spreads the displacement of a bucket over the slot seed */
+#define CRED_STORE_MAX_CREDENTIALS  10000        /*!< Largest table, all tables must fit into the first 64 KB of flash on the Mega */
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The credential table structure
+ * @details A minimal perfect hash table, generated by tools/credentials.py. The arrays are
+ *          stored in flash. Every credential hashes to a bucket, and the displacement of
+ *          the bucket moves all its credentials to distinct slots. The 32-bit keys are
+ *          split into two arrays, so no array exceeds 32 KB on the Mega.
+ */
+typedef struct
+{
+    uint32_t        bucketSeed; /*!< Seed of the bucket hash */
+    uint32_t        slotSeed;   /*!< Seed of the slot hash */
+    uint16_t        buckets;    /*!< Number of buckets */
+    uint16_t        slots;      /*!< Number of slots */
+    uint16_t        count;      /*!< Number of credentials */
+    const uint16_t* pDisplace;  /*!< Displacement of every bucket, in flash */
+    const uint16_t* pKeyLow;    /*!< Lower half of the key in every slot, in flash */
+    const uint16_t* pKeyHigh;   /*!< Upper half of the key in every slot, in flash */
+} cred_table_t;
+
+
+/******************************** Function prototype ************************************/
+
+const cred_table_t* credStore_getTable( void );
+bool                credStore_contains( const cred_table_t* const pTable, uint32_t id );
+uint32_t            credStore_hash( uint32_t id, uint32_t seed );
+
+#endif  // CREDENTIAL_STORE_H
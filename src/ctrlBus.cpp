@@ -0,0 +1,692 @@
+/**
+ * \file    ctrlBus.cpp
+ * \brief   Source file for the controller bus
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "ctrlBus.h"
+#include "logging.h"
+#include "sysClock.h"
+
+/*
+ * Several controllers share a half-duplex RS-485 line. Every frame is
+ *
+ *     SOF | destination | source | type | sequence | length | payload | CRC high | CRC low
+ *
+ * with addresses 1..CTRL_BUS_MAX_ADDRESS and a CRC-16/CCITT over destination to payload.
+ * A receiver resynchronizes on the next SOF after a corrupt frame or a gap within a frame.
+ *
+ * Every controller broadcasts its state when it changes and every CTRL_BUS_HEARTBEAT.
+ * Before a door is unlocked, the controller asks its neighbours one after the other for a
+ * grant. A neighbour grants if its own doors are locked and it hasn't granted another
+ * controller, and then keeps its doors locked until the requester releases the grant or
+ * publishes that its doors are locked again. A request that isn't answered within
+ * CTRL_BUS_RETRY_TIMEOUT is repeated up to CTRL_BUS_RETRIES times, so a grant either
+ * succeeds or fails within a bounded time. If two controllers ask each other at the same
+ * time, the lower address wins. A neighbour that doesn't answer denies the grant, so the
+ * doors stay locked while a neighbour is offline.
+ */
+
+
+/**************************** Static Function prototype *********************************/
+
+static bool    ctrlBus_isUnlockGranted( door_control_t* const pDoorControl, door_type_t door );
+static void    ctrlBus_receive( ctrl_bus_t* const pBus );
+static void    ctrlBus_receiveFrame( ctrl_bus_t* const pBus );
+static void    ctrlBus_answerRequest( ctrl_bus_t* const pBus, uint8_t source, uint8_t sequence );
+static void    ctrlBus_answerGrant( ctrl_bus_t* const pBus, uint8_t source, uint8_t sequence, bool granted );
+static void    ctrlBus_processNodes( ctrl_bus_t* const pBus );
+static void    ctrlBus_processGrant( ctrl_bus_t* const pBus );
+static void    ctrlBus_publishState( ctrl_bus_t* const pBus );
+static void    ctrlBus_requestNext( ctrl_bus_t* const pBus );
+static void    ctrlBus_sendRequest( ctrl_bus_t* const pBus );
+static void    ctrlBus_endGrant( ctrl_bus_t* const pBus, ctrl_bus_grant_t next );
+static void    ctrlBus_send( ctrl_bus_t* const pBus, uint8_t destination, ctrl_bus_frame_type_t type, uint8_t sequence, const uint8_t* pPayload, uint8_t length );
+static uint8_t ctrlBus_getUnlockedDoors( const ctrl_bus_t* const pBus );
+
+
+/******************************** Global variables ************************************/
+
+static ctrl_bus_t* pBuses = NULL; /*!< The controller buses that were set up, to find the bus of a door control instance */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up a controller bus.
+ *
+ * Opens the serial interface of the transceiver, applies the address and the neighbours
+ * of the settings and asks the bus before a door of the instance is unlocked.
+ *
+ * @param pBus Pointer to the controller bus.
+ * @param pDoorControl Pointer to the door control instance on the bus.
+ * @param pSerial The serial interface of the transceiver.
+ * @param dePin The driver enable pin of the transceiver.
+ */
+void ctrlBus_setup( ctrl_bus_t* const pBus, door_control_t* const pDoorControl, HardwareSerial* const pSerial, uint8_t dePin )
+{
+    ctrl_bus_t* pKnown = pBuses;
+
+    while ( ( pKnown != NULL ) && ( pKnown != pBus ) )
+    {
+        pKnown = pKnown->pNext;
+    }
+
+    if ( pKnown == NULL )
+    {
+        pBus->pNext = pBuses;
+        pBuses      = pBus;
+    }
+
+    pBus->pDoorControl = pDoorControl;
+    pBus->pSerial      = pSerial;
+    pBus->dePin        = dePin;
+
+    pinMode( pBus->dePin, OUTPUT );
+    digitalWrite( pBus->dePin, LOW );
+    pBus->pSerial->begin( CTRL_BUS_BAUD_RATE );
+
+    ctrlBus_configure( pBus, appSettings_getSettings()->busAddress, appSettings_getSettings()->busNeighbours );
+
+    pDoorControl->unlockGate = ctrlBus_isUnlockGranted;
+}
+
+
+/**
+ * @brief Sets the own address and the interlocked neighbours.
+ *
+ * A pending grant request and a grant given to a neighbour are dropped.
+ *
+ * @param pBus Pointer to the controller bus.
+ * @param address The own address, 1..CTRL_BUS_MAX_ADDRESS, 0 disables the bus.
+ * @param neighbours The interlocked controllers, bit n-1 = address n.
+ */
+void ctrlBus_configure( ctrl_bus_t* const pBus, uint8_t address, uint8_t neighbours )
+{
+    if ( address > CTRL_BUS_MAX_ADDRESS )
+    {
+        Log.errorln( "%s: Invalid address: %d", __func__, address );
+        return;
+    }
+
+    pBus->address     = address;
+    pBus->neighbours  = ( address != 0 ) ? ( neighbours & ~( 1 << ( address - 1 ) ) ) : 0;
+    pBus->grant       = CTRL_BUS_GRANT_IDLE;
+    pBus->leaseHolder = 0;
+    pBus->rxLength    = 0;
+    pBus->lastPublish = sysClock_millis() - CTRL_BUS_HEARTBEAT;
+    memset( pBus->nodes, 0, sizeof( pBus->nodes ) );
+
+    Log.noticeln( "%s: Address %d, neighbours 0x%x", __func__, pBus->address, pBus->neighbours );
+}
+
+
+/**
+ * @brief Processes a controller bus.
+ *
+ * Must be called once per main loop iteration. Handles the received frames, publishes
+ * the door state and advances the own grant request.
+ *
+ * @param pBus Pointer to the controller bus.
+ */
+void ctrlBus_process( ctrl_bus_t* const pBus )
+{
+    if ( !ctrlBus_isEnabled( pBus ) )
+    {
+        return;
+    }
+
+    pBus->now = sysClock_millis();
+
+    ctrlBus_receive( pBus );
+    ctrlBus_processNodes( pBus );
+    ctrlBus_processGrant( pBus );
+    ctrlBus_publishState( pBus );
+}
+
+
+/**
+ * @brief Checks whether the controller takes part in the bus.
+ *
+ * @param pBus Pointer to the controller bus.
+ * @return true if an address is set, false otherwise.
+ */
+bool ctrlBus_isEnabled( const ctrl_bus_t* const pBus )
+{
+    return pBus->address != 0;
+}
+
+
+/**
+ * @brief Returns the state of a neighbour as seen on the bus.
+ *
+ * @param pBus Pointer to the controller bus.
+ * @param address The address of the neighbour, 1..CTRL_BUS_MAX_ADDRESS.
+ * @return const ctrl_bus_node_t* The neighbour, NULL for an invalid address.
+ */
+const ctrl_bus_node_t* ctrlBus_getNode( const ctrl_bus_t* const pBus, uint8_t address )
+{
+    if ( ( address == 0 ) || ( address > CTRL_BUS_MAX_ADDRESS ) )
+    {
+        return NULL;
+    }
+
+    return &pBus->nodes[address - 1];
+}
+
+
+/**
+ * @brief Returns the controller bus statistics.
+ *
+ * @param pBus Pointer to the controller bus.
+ * @return const ctrl_bus_stats_t* The statistics.
+ */
+const ctrl_bus_stats_t* ctrlBus_getStats( const ctrl_bus_t* const pBus )
+{
+    return &pBus->stats;
+}
+
+
+/**
+ * @brief Calculates the CRC-16/CCITT ( polynomial 0x1021, initial value 0xFFFF ) of a frame.
+ *
+ * @param pData The data.
+ * @param length The length of the data @unit bytes
+ * @return uint16_t The CRC.
+ */
+uint16_t ctrlBus_calculateCrc( const uint8_t* pData, uint8_t length )
+{
+    uint16_t crc = 0xFFFF;
+
+    for ( uint8_t i = 0; i < length; i++ )
+    {
+        crc ^= (uint16_t) pData[i] << 8;
+
+        for ( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc & 0x8000 ) ? (uint16_t) ( ( crc << 1 ) ^ 0x1021 ) : (uint16_t) ( crc << 1 );
+        }
+    }
+
+    return crc;
+}
+
+
+/**
+ * @brief Decides whether a door may be unlocked, installed as unlock gate of the instance.
+ *
+ * The first call for a pressed button starts the grant request. The door is unlocked on
+ * a later call, once all neighbours granted.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param door The door to unlock.
+ * @return true if the door may be unlocked, false otherwise.
+ */
+static bool ctrlBus_isUnlockGranted( door_control_t* const pDoorControl, door_type_t door )
+{
+    ctrl_bus_t* pBus = pBuses;
+
+    while ( ( pBus != NULL ) && ( pBus->pDoorControl != pDoorControl ) )
+    {
+        pBus = pBus->pNext;
+    }
+
+    if ( ( pBus == NULL ) || !ctrlBus_isEnabled( pBus ) || ( pBus->neighbours == 0 ) )
+    {
+        return true;
+    }
+
+    switch ( pBus->grant )
+    {
+    case CTRL_BUS_GRANT_IDLE:
+        /* A neighbour holding a grant has priority */
+        if ( pBus->leaseHolder == 0 )
+        {
+            pBus->grant        = CTRL_BUS_GRANT_REQUESTING;
+            pBus->grantDoor    = door;
+            pBus->granted      = 0;
+            pBus->target       = 0;
+            pBus->requestStart = micros();
+            pBus->txSequence++;
+            ctrlBus_requestNext( pBus );
+        }
+        return false;
+
+    case CTRL_BUS_GRANT_GRANTED:
+        /* A grant unlocks a single door once */
+        return ( door == pBus->grantDoor ) && !pBus->grantUsed;
+
+    default:
+        return false;
+    }
+}
+
+
+/**
+ * @brief Reads the received bytes and assembles them to frames.
+ */
+static void ctrlBus_receive( ctrl_bus_t* const pBus )
+{
+    while ( pBus->pSerial->available() > 0 )
+    {
+        uint8_t byte = (uint8_t) pBus->pSerial->read();
+
+        /* A gap within a frame discards the frame */
+        if ( ( pBus->rxLength > 0 ) && ( ( pBus->now - pBus->rxLastByte ) > CTRL_BUS_BYTE_TIMEOUT ) )
+        {
+            pBus->stats.crcErrors++;
+            pBus->rxLength = 0;
+        }
+        pBus->rxLastByte = pBus->now;
+
+        if ( ( pBus->rxLength == 0 ) && ( byte != CTRL_BUS_SOF ) )
+        {
+            continue;
+        }
+
+        pBus->rxBuffer[pBus->rxLength++] = byte;
+
+        if ( pBus->rxLength < CTRL_BUS_HEADER_SIZE )
+        {
+            continue;
+        }
+
+        uint8_t payloadLength = pBus->rxBuffer[CTRL_BUS_HEADER_SIZE - 1];
+        if ( payloadLength > CTRL_BUS_MAX_PAYLOAD )
+        {
+            pBus->stats.crcErrors++;
+            pBus->rxLength = 0;
+        }
+        else if ( pBus->rxLength == ( CTRL_BUS_HEADER_SIZE + payloadLength + 2 ) )
+        {
+            ctrlBus_receiveFrame( pBus );
+            pBus->rxLength = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Checks and handles the frame in the receive buffer.
+ */
+static void ctrlBus_receiveFrame( ctrl_bus_t* const pBus )
+{
+    const uint8_t* pFrame        = pBus->rxBuffer;
+    uint8_t        payloadLength = pFrame[5];
+    uint16_t       crc           = ctrlBus_calculateCrc( &pFrame[1], CTRL_BUS_HEADER_SIZE - 1 + payloadLength );
+
+    if ( crc != ( ( (uint16_t) pFrame[CTRL_BUS_HEADER_SIZE + payloadLength] << 8 ) | pFrame[CTRL_BUS_HEADER_SIZE + payloadLength + 1] ) )
+    {
+        pBus->stats.crcErrors++;
+        return;
+    }
+
+    uint8_t destination = pFrame[1];
+    uint8_t source      = pFrame[2];
+    uint8_t type        = pFrame[3];
+    uint8_t sequence    = pFrame[4];
+
+    /* Only frames of the neighbours addressed to this controller are of interest */
+    if (    ( ( destination != pBus->address ) && ( destination != CTRL_BUS_BROADCAST ) )
+         || ( source == 0 ) || ( source > CTRL_BUS_MAX_ADDRESS )
+         || ( ( pBus->neighbours & ( 1 << ( source - 1 ) ) ) == 0 ) )
+    {
+        return;
+    }
+
+    pBus->stats.framesReceived++;
+
+    ctrl_bus_node_t* pNode = &pBus->nodes[source - 1];
+    pNode->lastSeen = pBus->now;
+    pNode->online   = true;
+
+    switch ( type )
+    {
+    case CTRL_BUS_FRAME_STATE:
+        if ( payloadLength >= 2 )
+        {
+            pNode->state         = pFrame[CTRL_BUS_HEADER_SIZE];
+            pNode->unlockedDoors = pFrame[CTRL_BUS_HEADER_SIZE + 1];
+
+            /* The holder of the grant is done once its doors are locked again */
+            if ( pBus->leaseHolder == source )
+            {
+                if ( ( pNode->state != DOOR_CONTROL_STATE_IDLE ) || ( pNode->unlockedDoors != 0 ) )
+                {
+                    pBus->leaseUsed = true;
+                }
+                else if ( pBus->leaseUsed )
+                {
+                    pBus->leaseHolder = 0;
+                }
+            }
+        }
+        break;
+
+    case CTRL_BUS_FRAME_REQUEST:
+        ctrlBus_answerRequest( pBus, source, sequence );
+        break;
+
+    case CTRL_BUS_FRAME_GRANT:
+    case CTRL_BUS_FRAME_DENY:
+        ctrlBus_answerGrant( pBus, source, sequence, type == CTRL_BUS_FRAME_GRANT );
+        break;
+
+    case CTRL_BUS_FRAME_RELEASE:
+        if ( pBus->leaseHolder == source )
+        {
+            pBus->leaseHolder = 0;
+        }
+        break;
+
+    default:
+        Log.warningln( "%s: Unknown frame type %d from %d", __func__, type, source );
+        break;
+    }
+}
+
+
+/**
+ * @brief Answers the grant request of a neighbour.
+ *
+ * A repeated request of the current holder is granted again, as the first answer may
+ * have been lost.
+ *
+ * @param source The address of the neighbour.
+ * @param sequence The sequence number of the request.
+ */
+static void ctrlBus_answerRequest( ctrl_bus_t* const pBus, uint8_t source, uint8_t sequence )
+{
+    bool grant = false;
+
+    if ( pBus->leaseHolder == source )
+    {
+        grant = true;
+    }
+    else if (    ( pBus->leaseHolder == 0 )
+              && ( stateMan_getState( pBus->pDoorControl ) == DOOR_CONTROL_STATE_IDLE )
+              && ( ctrlBus_getUnlockedDoors( pBus ) == 0 ) )
+    {
+        if ( ( pBus->grant == CTRL_BUS_GRANT_IDLE ) || ( pBus->grant == CTRL_BUS_GRANT_DENIED ) )
+        {
+            grant = true;
+        }
+        else if ( ( pBus->grant == CTRL_BUS_GRANT_REQUESTING ) && ( source < pBus->address ) )
+        {
+            /* Both ask each other, the lower address wins */
+            ctrlBus_endGrant( pBus, CTRL_BUS_GRANT_DENIED );
+            grant = true;
+        }
+    }
+
+    if ( grant && ( pBus->leaseHolder != source ) )
+    {
+        pBus->leaseHolder = source;
+        pBus->leaseUsed   = false;
+        pBus->leaseSince  = pBus->now;
+    }
+
+    ctrlBus_send( pBus, source, grant ? CTRL_BUS_FRAME_GRANT : CTRL_BUS_FRAME_DENY, sequence, NULL, 0 );
+}
+
+
+/**
+ * @brief Handles the answer of a neighbour to the own grant request.
+ *
+ * @param source The address of the neighbour.
+ * @param sequence The sequence number of the answered request.
+ * @param granted true if the neighbour granted, false if it denied.
+ */
+static void ctrlBus_answerGrant( ctrl_bus_t* const pBus, uint8_t source, uint8_t sequence, bool granted )
+{
+    /* Late answers to an earlier request are ignored */
+    if (    ( pBus->grant != CTRL_BUS_GRANT_REQUESTING )
+         || ( source != pBus->target )
+         || ( sequence != pBus->txSequence ) )
+    {
+        return;
+    }
+
+    if ( !granted )
+    {
+        Log.noticeln( "%s: Grant denied by %d", __func__, source );
+        ctrlBus_endGrant( pBus, CTRL_BUS_GRANT_DENIED );
+        return;
+    }
+
+    pBus->granted |= ( 1 << ( source - 1 ) );
+    ctrlBus_requestNext( pBus );
+}
+
+
+/**
+ * @brief Tracks which neighbours are online and drops the grant of an offline holder.
+ */
+static void ctrlBus_processNodes( ctrl_bus_t* const pBus )
+{
+    for ( uint8_t i = 0; i < CTRL_BUS_MAX_ADDRESS; i++ )
+    {
+        ctrl_bus_node_t* pNode = &pBus->nodes[i];
+
+        if ( pNode->online && ( ( pBus->now - pNode->lastSeen ) > CTRL_BUS_NODE_TIMEOUT ) )
+        {
+            pNode->online = false;
+            Log.warningln( "%s: Controller %d is offline", __func__, i + 1 );
+        }
+    }
+
+    if ( pBus->leaseHolder != 0 )
+    {
+        /* The holder went offline, or never unlocked and its release was lost */
+        if (    !pBus->nodes[pBus->leaseHolder - 1].online
+             || ( !pBus->leaseUsed && ( ( pBus->now - pBus->leaseSince ) > ( CTRL_BUS_GRANT_HOLD + 2 * CTRL_BUS_HEARTBEAT ) ) ) )
+        {
+            pBus->leaseHolder = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Advances the own grant request.
+ *
+ * Repeats an unanswered request, releases a grant that has been used or wasn't used in
+ * time and ends the backoff after a failed request.
+ */
+static void ctrlBus_processGrant( ctrl_bus_t* const pBus )
+{
+    switch ( pBus->grant )
+    {
+    case CTRL_BUS_GRANT_REQUESTING:
+        if ( ( pBus->now - pBus->sentAt ) > CTRL_BUS_RETRY_TIMEOUT )
+        {
+            if ( pBus->attempts < CTRL_BUS_RETRIES )
+            {
+                pBus->attempts++;
+                pBus->stats.retransmits++;
+                ctrlBus_sendRequest( pBus );
+            }
+            else
+            {
+                Log.noticeln( "%s: No answer from %d", __func__, pBus->target );
+                ctrlBus_endGrant( pBus, CTRL_BUS_GRANT_DENIED );
+            }
+        }
+        break;
+
+    case CTRL_BUS_GRANT_GRANTED:
+        if ( stateMan_getState( pBus->pDoorControl ) != DOOR_CONTROL_STATE_IDLE )
+        {
+            pBus->grantUsed = true;
+        }
+        else if ( pBus->grantUsed || ( ( pBus->now - pBus->grantTime ) > CTRL_BUS_GRANT_HOLD ) )
+        {
+            ctrlBus_endGrant( pBus, CTRL_BUS_GRANT_IDLE );
+        }
+        break;
+
+    case CTRL_BUS_GRANT_DENIED:
+        if ( ( pBus->now - pBus->grantTime ) > CTRL_BUS_RETRY_BACKOFF )
+        {
+            pBus->grant = CTRL_BUS_GRANT_IDLE;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/**
+ * @brief Broadcasts the door state when it changed or the heartbeat is due.
+ */
+static void ctrlBus_publishState( ctrl_bus_t* const pBus )
+{
+    uint8_t payload[2] = {
+        (uint8_t) stateMan_getState( pBus->pDoorControl ),
+        ctrlBus_getUnlockedDoors( pBus )
+    };
+
+    /* The heartbeats of the controllers are spread by their address */
+    if (    ( payload[0] != pBus->publishedState )
+         || ( payload[1] != pBus->publishedDoors )
+         || ( ( pBus->now - pBus->lastPublish ) >= (uint32_t) ( CTRL_BUS_HEARTBEAT + pBus->address ) ) )
+    {
+        pBus->publishedState = payload[0];
+        pBus->publishedDoors = payload[1];
+        pBus->lastPublish    = pBus->now;
+        ctrlBus_send( pBus, CTRL_BUS_BROADCAST, CTRL_BUS_FRAME_STATE, 0, payload, sizeof( payload ) );
+    }
+}
+
+
+/**
+ * @brief Asks the next neighbour for the grant, or completes the grant if all granted.
+ */
+static void ctrlBus_requestNext( ctrl_bus_t* const pBus )
+{
+    for ( uint8_t address = pBus->target + 1; address <= CTRL_BUS_MAX_ADDRESS; address++ )
+    {
+        if ( pBus->neighbours & ( 1 << ( address - 1 ) ) )
+        {
+            pBus->target   = address;
+            pBus->attempts = 0;
+            ctrlBus_sendRequest( pBus );
+            return;
+        }
+    }
+
+    pBus->grant             = CTRL_BUS_GRANT_GRANTED;
+    pBus->grantUsed         = false;
+    pBus->grantTime         = pBus->now;
+    pBus->stats.lastLatency = micros() - pBus->requestStart;
+    pBus->stats.grants++;
+
+    if ( pBus->stats.lastLatency > pBus->stats.maxLatency )
+    {
+        pBus->stats.maxLatency = pBus->stats.lastLatency;
+    }
+}
+
+
+/**
+ * @brief Ends the own grant request and releases the neighbours that granted.
+ *
+ * @param next CTRL_BUS_GRANT_IDLE after a used grant, CTRL_BUS_GRANT_DENIED to wait for
+ *             the backoff after a failed request.
+ */
+static void ctrlBus_endGrant( ctrl_bus_t* const pBus, ctrl_bus_grant_t next )
+{
+    for ( uint8_t address = 1; address <= CTRL_BUS_MAX_ADDRESS; address++ )
+    {
+        if ( pBus->granted & ( 1 << ( address - 1 ) ) )
+        {
+            ctrlBus_send( pBus, address, CTRL_BUS_FRAME_RELEASE, pBus->txSequence, NULL, 0 );
+        }
+    }
+
+    if ( next == CTRL_BUS_GRANT_DENIED )
+    {
+        pBus->stats.denials++;
+    }
+
+    pBus->granted   = 0;
+    pBus->grant     = next;
+    pBus->grantTime = pBus->now;
+}
+
+
+/**
+ * @brief Sends the grant request to the current neighbour.
+ */
+static void ctrlBus_sendRequest( ctrl_bus_t* const pBus )
+{
+    uint8_t door = (uint8_t) pBus->grantDoor;
+
+    pBus->sentAt = pBus->now;
+    ctrlBus_send( pBus, pBus->target, CTRL_BUS_FRAME_REQUEST, pBus->txSequence, &door, sizeof( door ) );
+}
+
+
+/**
+ * @brief Transmits a frame.
+ *
+ * The transceiver drives the line until the last byte has been sent, which takes about
+ * 1 ms for the largest frame.
+ *
+ * @param destination The destination address, CTRL_BUS_BROADCAST for all controllers.
+ * @param type The frame type.
+ * @param sequence The sequence number.
+ * @param pPayload The payload, may be NULL if length is 0.
+ * @param length The length of the payload, at most CTRL_BUS_MAX_PAYLOAD @unit bytes
+ */
+static void ctrlBus_send( ctrl_bus_t* const pBus, uint8_t destination, ctrl_bus_frame_type_t type, uint8_t sequence, const uint8_t* pPayload, uint8_t length )
+{
+    uint8_t frame[CTRL_BUS_FRAME_SIZE];
+
+    frame[0] = CTRL_BUS_SOF;
+    frame[1] = destination;
+    frame[2] = pBus->address;
+    frame[3] = (uint8_t) type;
+    frame[4] = sequence;
+    frame[5] = length;
+    memcpy( &frame[CTRL_BUS_HEADER_SIZE], pPayload, length );
+
+    uint16_t crc = ctrlBus_calculateCrc( &frame[1], CTRL_BUS_HEADER_SIZE - 1 + length );
+    frame[CTRL_BUS_HEADER_SIZE + length]     = (uint8_t) ( crc >> 8 );
+    frame[CTRL_BUS_HEADER_SIZE + length + 1] = (uint8_t) crc;
+
+    digitalWrite( pBus->dePin, HIGH );
+    pBus->pSerial->write( frame, CTRL_BUS_HEADER_SIZE + length + 2 );
+    pBus->pSerial->flush();
+    digitalWrite( pBus->dePin, LOW );
+
+    pBus->stats.framesSent++;
+}
+
+
+/**
+ * @brief Returns the unlocked doors of the own controller.
+ *
+ * @return uint8_t The unlocked doors, bit n = door n.
+ */
+static uint8_t ctrlBus_getUnlockedDoors( const ctrl_bus_t* const pBus )
+{
+    uint8_t doors = 0;
+
+    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+    {
+        if ( ioMan_getLockState( &pBus->pDoorControl->io, (door_type_t) i ) == LOCK_STATE_UNLOCKED )
+        {
+            doors |= ( 1 << i );
+        }
+    }
+
+    return doors;
+}
@@ -0,0 +1,148 @@
+/**
+ * \file    ctrlBus.h
+ * \brief   Header file for the controller bus
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef CONTROLLER_BUS_H
+#define CONTROLLER_BUS_H
+
+#include <Arduino.h>
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define CTRL_BUS_SERIAL             Serial1 /*!< The serial interface of the RS-485 transceiver */
+#define CTRL_BUS_BAUD_RATE          115200  /*!< Baud rate of the controller bus @unit bps */
+#define CTRL_BUS_BROADCAST          0xFF    /*!< Destination address of a frame for all controllers */
+#define CTRL_BUS_SOF                0x7E    /*!< First byte of every frame */
+#define CTRL_BUS_MAX_PAYLOAD        4       /*!< Maximum payload of a frame @unit bytes */
+#define CTRL_BUS_HEADER_SIZE        6       /*!< Start, destination, source, type, sequence and length @unit bytes */
+#define CTRL_BUS_FRAME_SIZE         ( CTRL_BUS_HEADER_SIZE + CTRL_BUS_MAX_PAYLOAD + 2 ) /*!< Largest frame including the CRC @unit bytes */
+
+#define CTRL_BUS_HEARTBEAT          250     /*!< Interval of the state frame without a state change @unit ms */
+#define CTRL_BUS_NODE_TIMEOUT       1000    /*!< A neighbour without a frame for this time is offline @unit ms */
+#define CTRL_BUS_RETRY_TIMEOUT      20      /*!< Time to wait for the answer to a request @unit ms */
+#define CTRL_BUS_RETRIES            3       /*!< Retransmissions of a request before the grant fails */
+#define CTRL_BUS_RETRY_BACKOFF      50      /*!< Time after a failed grant until the next request @unit ms */
+#define CTRL_BUS_GRANT_HOLD         500     /*!< Time to start unlocking after the grant @unit ms */
+#define CTRL_BUS_BYTE_TIMEOUT       5       /*!< A gap within a frame discards the frame @unit ms */
+
+#if defined( ARDUINO_ARCH_AVR )
+#define CTRL_BUS_DE_PIN             24      /*!< Driver enable of the RS-485 transceiver */
+#else
+#define CTRL_BUS_DE_PIN             A1      /*!< Driver enable of the RS-485 transceiver */
+#endif
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the frame types
+ */
+typedef enum
+{
+    CTRL_BUS_FRAME_STATE = 1, /*!< Broadcast of the door state: state, unlocked doors */
+    CTRL_BUS_FRAME_REQUEST,   /*!< Asks a neighbour for the grant to unlock a door: door */
+    CTRL_BUS_FRAME_GRANT,     /*!< The neighbour keeps its doors locked until the release */
+    CTRL_BUS_FRAME_DENY,      /*!< The neighbour has a door unlocked or granted another one */
+    CTRL_BUS_FRAME_RELEASE    /*!< The grant isn't needed any more */
+} ctrl_bus_frame_type_t;
+
+/**
+ * @brief Enumeration of the grant request states
+ */
+typedef enum
+{
+    CTRL_BUS_GRANT_IDLE,       /*!< No grant requested */
+    CTRL_BUS_GRANT_REQUESTING, /*!< The neighbours are asked one after the other */
+    CTRL_BUS_GRANT_GRANTED,    /*!< All neighbours granted, the door may be unlocked */
+    CTRL_BUS_GRANT_DENIED      /*!< A neighbour denied or didn't answer, waiting for the backoff */
+} ctrl_bus_grant_t;
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The state of a neighbour as seen on the bus
+ */
+typedef struct
+{
+    uint32_t lastSeen;      /*!< Time of the last frame of the neighbour @unit ms */
+    uint8_t  state;         /*!< The last published door_control_state_t */
+    uint8_t  unlockedDoors; /*!< The last published unlocked doors, bit n = door n */
+    bool     online;        /*!< A frame was received within CTRL_BUS_NODE_TIMEOUT */
+} ctrl_bus_node_t;
+
+/**
+ * @brief The controller bus statistics
+ */
+typedef struct
+{
+    uint32_t framesSent;     /*!< Number of transmitted frames */
+    uint32_t framesReceived; /*!< Number of valid frames addressed to this controller */
+    uint16_t crcErrors;      /*!< Number of discarded frames */
+    uint16_t retransmits;    /*!< Number of repeated requests */
+    uint16_t grants;         /*!< Number of grants obtained from all neighbours */
+    uint16_t denials;        /*!< Number of grants that failed */
+    uint32_t lastLatency;    /*!< Time from the first request to the last grant @unit us */
+    uint32_t maxLatency;     /*!< Largest grant latency since boot @unit us */
+} ctrl_bus_stats_t;
+
+/**
+ * @brief The controller bus structure
+ * @details Holds the receiver, the state publisher, the own grant request and the grant
+ *          given to a neighbour of one controller. Several buses can coexist, e.g. to
+ *          connect the controllers of a corridor on the host.
+ */
+typedef struct ctrl_bus
+{
+    door_control_t*  pDoorControl;                    /*!< The door control instance on the bus */
+    HardwareSerial*  pSerial;                         /*!< The serial interface of the transceiver */
+    uint8_t          dePin;                           /*!< The driver enable pin of the transceiver */
+    struct ctrl_bus* pNext;                           /*!< The next bus that was set up */
+    uint8_t          address;                         /*!< The own address, 0 if the bus is disabled */
+    uint8_t          neighbours;                      /*!< The interlocked controllers, bit n-1 = address n */
+    uint8_t          txSequence;                      /*!< Sequence number of the last request */
+    uint32_t         now;                             /*!< Time of the current processing step @unit ms */
+
+    uint8_t          rxBuffer[CTRL_BUS_FRAME_SIZE];   /*!< The frame being received */
+    uint8_t          rxLength;                        /*!< Number of bytes in the receive buffer */
+    uint32_t         rxLastByte;                      /*!< Time of the last received byte @unit ms */
+
+    uint8_t          publishedState;                  /*!< The last published state */
+    uint8_t          publishedDoors;                  /*!< The last published unlocked doors */
+    uint32_t         lastPublish;                     /*!< Time of the last state frame @unit ms */
+
+    ctrl_bus_grant_t grant;                           /*!< The state of the own grant request */
+    door_type_t      grantDoor;                       /*!< The door the grant is requested for */
+    uint8_t          target;                          /*!< The neighbour asked right now */
+    uint8_t          granted;                         /*!< The neighbours that granted, bit n-1 = address n */
+    uint8_t          attempts;                        /*!< Retransmissions to the current neighbour */
+    bool             grantUsed;                       /*!< The door left the idle state after the grant */
+    uint32_t         sentAt;                          /*!< Time of the last request @unit ms */
+    uint32_t         grantTime;                       /*!< Time the grant succeeded or failed @unit ms */
+    uint32_t         requestStart;                    /*!< Time of the first request @unit us */
+
+    uint8_t          leaseHolder;                     /*!< The neighbour granted to, 0 for none */
+    bool             leaseUsed;                       /*!< The holder published a state other than idle */
+    uint32_t         leaseSince;                      /*!< Time of the grant to the holder @unit ms */
+
+    ctrl_bus_node_t  nodes[CTRL_BUS_MAX_ADDRESS];     /*!< The neighbours by address - 1 */
+    ctrl_bus_stats_t stats;                           /*!< The bus statistics */
+} ctrl_bus_t;
+
+
+/******************************** Function prototype ************************************/
+
+void                    ctrlBus_setup( ctrl_bus_t* const pBus, door_control_t* const pDoorControl, HardwareSerial* const pSerial, uint8_t dePin );
+void                    ctrlBus_configure( ctrl_bus_t* const pBus, uint8_t address, uint8_t neighbours );
+void                    ctrlBus_process( ctrl_bus_t* const pBus );
+bool                    ctrlBus_isEnabled( const ctrl_bus_t* const pBus );
+const ctrl_bus_node_t*  ctrlBus_getNode( const ctrl_bus_t* const pBus, uint8_t address );
+const ctrl_bus_stats_t* ctrlBus_getStats( const ctrl_bus_t* const pBus );
+uint16_t                ctrlBus_calculateCrc( const uint8_t* pData, uint8_t length );
+
+#endif  // CONTROLLER_BUS_H
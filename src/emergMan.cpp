@@ -0,0 +1,238 @@
+/**
+ * \file    emergMan.cpp
+ * \brief   Source file for the emergency release
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <ArduinoLog.h>
+#include "emergMan.h"
+#include "appSettings.h"
+#include "ioMan.h"
+
+/*
+ * The emergency input bypasses polling, debouncing and the event queue: its interrupt
+ * handler releases all magnets with the precomputed port writes of ioMan. The release
+ * latches, the magnets stay released until emergMan_reset() is called with the input
+ * back to normal, whatever the state machine writes in the meantime.
+ *
+ * The main loop then posts the emergency event in the highest priority class, so it is
+ * the next event dispatched. The state machine follows into the emergency state, which only
+ * leaves with the reset event.
+ */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The emergency management structure
+ * @details The volatile members are written by the interrupt handler
+ */
+typedef struct
+{
+    door_control_t*   pDoorControl; /*!< The door control instance released by the input */
+    volatile bool     enabled;      /*!< The input is wired and evaluated */
+    volatile bool     latched;      /*!< The magnets are released until the reset */
+    volatile bool     pending;      /*!< The emergency event wasn't posted yet */
+    volatile uint32_t triggerTime;  /*!< The hardware clock when the interrupt started @unit us */
+    bool              awaitState;   /*!< The event latency isn't measured yet */
+    emerg_stats_t     stats;        /*!< The emergency release statistics */
+} emerg_man_t;
+
+
+/**************************** Static Function prototype *********************************/
+
+static void emergMan_trigger( void );
+
+
+/******************************** Global variables ************************************/
+
+static emerg_man_t emerg; /*!< The emergency release */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the emergency input.
+ *
+ * Enables the interrupt of the input and applies the setting of the input. If the input
+ * is already active, the doors are released right away.
+ *
+ * @param pDoorControl Pointer to the door control instance released by the input.
+ */
+void emergMan_setup( door_control_t* const pDoorControl )
+{
+    emerg.pDoorControl = pDoorControl;
+
+    pinMode( EMERGENCY_PIN, INPUT_PULLUP );
+
+#if defined( ARDUINO_ARCH_AVR )
+    PCMSK0 |= ( 1 << PCINT0 );
+    PCICR  |= ( 1 << PCIE0 );
+#elif !defined( ARDUINO_ARCH_RENESAS )
+    attachInterrupt( digitalPinToInterrupt( EMERGENCY_PIN ), emergMan_trigger, CHANGE );
+#endif
+
+    emergMan_setEnabled( appSettings_getSettings()->emergencyInput );
+}
+
+
+/**
+ * @brief Enables or disables the emergency input.
+ *
+ * A latched release stays latched until it is reset.
+ *
+ * @param enable true if the input is wired and evaluated.
+ */
+void emergMan_setEnabled( bool enable )
+{
+    emerg.enabled = enable;
+
+    Log.noticeln( "%s: Emergency input %s", __func__, enable ? "on" : "off" );
+
+    /* The input may be active already, there is no edge to wait for */
+    noInterrupts();
+    emergMan_trigger();
+    interrupts();
+}
+
+
+/**
+ * @brief Posts the emergency event of a release and measures its latency.
+ *
+ * Must be called once per main loop iteration, before the state machine is processed.
+ */
+void emergMan_process( void )
+{
+#if defined( ARDUINO_ARCH_RENESAS )
+    emergMan_trigger();
+#endif
+
+    if ( emerg.pending )
+    {
+        emerg.pending    = false;
+        emerg.awaitState = true;
+
+        /* Dispatched before all queued events of the lower priority classes */
+        stateMan_postEvent( emerg.pDoorControl, DOOR_CONTROL_EVENT_EMERGENCY, DOOR_CONTROL_SOURCE_EMERGENCY );
+        Log.warningln( "%s: Emergency release, all magnets released", __func__ );
+    }
+
+    if ( emerg.awaitState && ( stateMan_getState( emerg.pDoorControl ) == DOOR_CONTROL_STATE_EMERGENCY ) )
+    {
+        emerg.awaitState         = false;
+        emerg.stats.eventLatency = stateMan_getEmergencyEntry( emerg.pDoorControl ) - emerg.triggerTime;
+    }
+}
+
+
+/**
+ * @brief Resets a latched emergency release.
+ *
+ * The magnets follow the door states again and the state machine restarts in the init
+ * state, which locks the doors once the door switches are stable.
+ *
+ * @return true if the release was reset, false if none is latched or the input is still active.
+ */
+bool emergMan_reset( void )
+{
+    if ( !emerg.latched )
+    {
+        Log.errorln( "%s: No emergency release to reset", __func__ );
+        return false;
+    }
+
+    if ( emerg.enabled && emergMan_isInputActive() )
+    {
+        Log.errorln( "%s: The emergency input is still active", __func__ );
+        return false;
+    }
+
+    /* An edge during the reset is kept pending and releases the magnets again right after it */
+    noInterrupts();
+    ioMan_restoreMagnets();
+    emerg.latched = false;
+    interrupts();
+
+    stateMan_postEvent( emerg.pDoorControl, DOOR_CONTROL_EVENT_EMERGENCY_RESET, DOOR_CONTROL_SOURCE_EMERGENCY );
+    Log.noticeln( "%s: Emergency release reset", __func__ );
+
+    return true;
+}
+
+
+/**
+ * @brief Checks whether an emergency release is latched.
+ *
+ * @return true if the magnets are released until the reset.
+ */
+bool emergMan_isLatched( void )
+{
+    return emerg.latched;
+}
+
+
+/**
+ * @brief Reads the emergency input.
+ *
+ * @return true if the contact is open, i.e. the input is pulled high.
+ */
+bool emergMan_isInputActive( void )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    return ( PINB & ( 1 << PB0 ) ) != 0;
+#else
+    return digitalRead( EMERGENCY_PIN ) == HIGH;
+#endif
+}
+
+
+/**
+ * @brief Returns the emergency release statistics.
+ *
+ * @return const emerg_stats_t* Pointer to the statistics.
+ */
+const emerg_stats_t* emergMan_getStats( void )
+{
+    return &emerg.stats;
+}
+
+
+/**
+ * @brief Releases all magnets if the emergency input is active, called from the interrupt.
+ *
+ * Every edge of the input ends up here, only the first active level of an enabled input
+ * releases the magnets until the reset.
+ */
+static void emergMan_trigger( void )
+{
+    const uint32_t start = micros();
+
+    if ( !emerg.enabled || emerg.latched || !emergMan_isInputActive() )
+    {
+        return;
+    }
+
+    ioMan_releaseMagnets();
+
+    emerg.latched           = true;
+    emerg.pending           = true;
+    emerg.triggerTime       = start;
+    emerg.stats.releaseTime = micros() - start;
+    emerg.stats.releases++;
+}
+
+
+#if defined( ARDUINO_ARCH_AVR )
+/**
+ * @brief Pin change interrupt of port B, only the emergency input is enabled in its mask.
+ */
+ISR( PCINT0_vect )
+{
+    emergMan_trigger();
+}
+#endif
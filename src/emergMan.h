@@ -0,0 +1,55 @@
+/**
+ * \file    emergMan.h
+ * \brief   Header file for the emergency release
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef EMERGENCY_MANAGEMENT_H
+#define EMERGENCY_MANAGEMENT_H
+
+#include <Arduino.h>
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+/*
+ * The emergency input is a normally closed contact to GND, e.g. the relay of the fire
+ * alarm panel. A cut wire releases the doors as well.
+ * - Mega: pin 53, PB0, with the pin change interrupt of port B.
+ * - Uno R4: all pins with an interrupt are used, A0 is polled every main loop iteration.
+ * - Other targets, e.g. the host build: an external interrupt on A0.
+ */
+#if defined( ARDUINO_ARCH_AVR )
+#define EMERGENCY_PIN               53      /*!< The emergency input, PB0 */
+#else
+#define EMERGENCY_PIN               A0      /*!< The emergency input */
+#endif
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The emergency release statistics
+ */
+typedef struct
+{
+    uint16_t releases;     /*!< Number of emergency releases */
+    uint32_t releaseTime;  /*!< Time from the interrupt to the released magnets of the last release @unit us */
+    uint32_t eventLatency; /*!< Time from the interrupt to the emergency state of the last release @unit us */
+} emerg_stats_t;
+
+
+/******************************** Function prototype ************************************/
+
+void                 emergMan_setup( door_control_t* const pDoorControl );
+void                 emergMan_setEnabled( bool enable );
+void                 emergMan_process( void );
+bool                 emergMan_reset( void );
+bool                 emergMan_isLatched( void );
+bool                 emergMan_isInputActive( void );
+const emerg_stats_t* emergMan_getStats( void );
+
+#endif  // EMERGENCY_MANAGEMENT_H
@@ -32,7 +32,8 @@ do
 {                                                                                          \
     if ( handler != NULL )                                                                 \
     {                                                                                      \
-        state_machine_result_t result = handler( state_machine, state_machine->event->id ); \
+        const uint32_t event = ( state_machine->event != NULL ) ? state_machine->event->id : 0; \
+        state_machine_result_t result = handler( state_machine, event );                   \
         switch ( result )                                                                  \
         {                                                                                  \
         case TRIGGERED_TO_SELF:                                                            \
@@ -46,15 +47,32 @@ do
     }                                                                                      \
 } while ( 0 )
 
+/*
+ *  --------------------- STATIC FUNCTION ---------------------
+ */
+
+static void unlink_event(state_machine_t* const pState_Machine, const event_t* const pEvent);
+static void defer_event(state_machine_t* const pState_Machine, event_t* const pEvent);
+static void recall_deferred(state_machine_t* const pState_Machine);
+
 /*
  *  --------------------- FUNCTION BODY ---------------------
  */
 
 /** \brief dispatch events to state machine
+ *
+ * An event deferred by the current state is moved to the deferred queue without calling
+ * the handler, it is recalled by the next state change. An event that isn't handled is
+ * dropped and counted.
+ *
+ * The budget is asked before every handler call, a deferred event doesn't ask it. If it
+ * refuses, the dispatch stops and the event and all events behind it stay queued for
+ * the next call.
  *
  * \param pState_Machine[] state_machine_t* const  array of state machines
  * \param quantity uint32_t number of state machines
- * \return state_machine_result_t result of state machine
+ * \param budget state_machine_budget  budget of the dispatch, NULL to dispatch all events
+ * \return state_machine_result_t result of state machine, EVENT_HANDLED if no handler was called
  *
  */
 state_machine_result_t dispatch_event(state_machine_t* const pState_Machine[]
@@ -63,49 +81,57 @@ state_machine_result_t dispatch_event(state_machine_t* const pState_Machine[]
                                       ,state_machine_event_logger event_logger
                                       ,state_machine_result_logger result_logger
 #endif // STATE_MACHINE_LOGGER
+                                      ,state_machine_budget budget
                                       )
 {
-    state_machine_result_t result;
+    state_machine_result_t result = EVENT_HANDLED;
 
   // Iterate through all state machines in the array to check if event is pending to dispatch.
     for(uint32_t index = 0; index < quantity;)
     {
-        event_t* currentEvent  = pState_Machine[index]->event;
-        event_t* previousEvent = NULL;
+        event_t* currentEvent = pState_Machine[index]->event;
 
         while( currentEvent != NULL )
         {
             const state_t* pState = pState_Machine[index]->State;
 
+            // Park the event until the state changes, this doesn't call a handler and isn't charged to the budget.
+            if( (currentEvent->id < HSM_DEFER_EVENTS) && (pState->Deferred & (1UL << currentEvent->id)) )
+            {
+                unlink_event(pState_Machine[index], currentEvent);
+                defer_event(pState_Machine[index], currentEvent);
+                currentEvent = pState_Machine[index]->event;
+                continue;
+            }
+
+            if( (budget != NULL) && !budget(pState_Machine[index], currentEvent) )
+            {
+                return result;
+            }
+
             do
             {
 #if STATE_MACHINE_LOGGER
-                event_logger(index, pState->Id, pState_Machine[index]->event->id);
+                event_logger(pState_Machine[index], pState->Id, currentEvent);
 #endif // STATE_MACHINE_LOGGER
-        // Call the state handler.
-                result = pState->Handler(pState_Machine[index], pState_Machine[index]->event->id);
+        // Call the state handler. After TRIGGERED_TO_SELF, an event pushed in front of the
+        // current event doesn't replace it, the current event is dispatched again.
+                result = pState->Handler(pState_Machine[index], currentEvent->id);
 #if STATE_MACHINE_LOGGER
-                result_logger(pState_Machine[index]->State->Id, result);
+                result_logger(pState_Machine[index], pState_Machine[index]->State->Id, result);
 #endif // STATE_MACHINE_LOGGER
 
                 switch(result)
                 {
                 case EVENT_HANDLED:
-                    if (previousEvent == NULL)
-                    {
-                        /* Remove the event from the queue */
-                        pState_Machine[index]->event = currentEvent->next;
-                    }
-                    else
-                    {
-                        /* Bypass the current event in the queue */
-                        previousEvent->next = currentEvent->next;
-                    }
-
-                    /* Free the memory allocated for the event */
-                    event_t* temp = currentEvent;
-                    currentEvent  = currentEvent->next;
-                    free( temp );
+                    /* Remove the event from the queue and free it */
+                    unlink_event(pState_Machine[index], currentEvent);
+                    free( currentEvent );
+
+                    /* Continue with the event that is next now, a pushed event of a higher
+                     * priority class is dispatched before the remaining ones.
+                     */
+                    currentEvent = pState_Machine[index]->event;
 
                     // intentional fall through
 
@@ -136,10 +162,12 @@ state_machine_result_t dispatch_event(state_machine_t* const pState_Machine[]
 #endif // HIERARCHICAL_STATES
 
                 // Either state handler could not handle the event or it has returned
-                // the unknown return code. Terminate the state machine.
+                // the unknown return code. Drop the event, so it isn't dispatched forever.
                 default:
-                    previousEvent = currentEvent;
-                    currentEvent  = currentEvent->next;
+                    unlink_event(pState_Machine[index], currentEvent);
+                    free( currentEvent );
+                    pState_Machine[index]->dropped++;
+                    currentEvent = pState_Machine[index]->event;
                 }
                 break;
 
@@ -175,6 +203,9 @@ extern state_machine_result_t switch_state( state_machine_t* const pState_Machin
     // Call entry function before entering the target state.
     EXECUTE_HANDLER( pTarget_State->Entry, triggered_to_self, pState_Machine );
 
+    // The deferred events get another chance in the new state.
+    recall_deferred( pState_Machine );
+
     if ( triggered_to_self == true )
     {
         return TRIGGERED_TO_SELF;
@@ -261,6 +292,9 @@ state_machine_result_t traverse_state(state_machine_t* const pState_Machine,
       EXECUTE_HANDLER(pTarget_Path[index]->Entry, triggered_to_self, pState_Machine);
     }
 
+  // The deferred events get another chance in the new state.
+  recall_deferred(pState_Machine);
+
   if(triggered_to_self == true)
   {
     return TRIGGERED_TO_SELF;
@@ -270,38 +304,202 @@ state_machine_result_t traverse_state(state_machine_t* const pState_Machine,
 #endif // HIERARCHICAL_STATES
 
 
-/** \brief Push event to the event queue
+/** \brief Push event of the lowest priority class to the event queue
  *
  * \param head event_t* head of the event queue
  * \param event uint32_t event to be pushed
  */
 void pushEvent( event_t** head, uint32_t event )
 {
-    /* Check if head is empty */
-    if ( *head == NULL )
+    pushEventPriority( head, event, 0 );
+}
+
+
+/** \brief Push event to the event queue, behind all events of its own and higher priority classes
+ *
+ * The queue is kept sorted by priority class, so the highest class is dispatched first
+ * and the events of a class are dispatched in the order they were pushed.
+ *
+ * \param head event_t* head of the event queue
+ * \param event uint32_t event to be pushed
+ * \param priority uint8_t priority class of the event
+ * \return event_t* the queued event to stamp its time and source, NULL if out of memory
+ */
+event_t* pushEventPriority( event_t** head, uint32_t event, uint8_t priority )
+{
+    event_t* newEvent = (event_t*) malloc( sizeof( event_t ) );
+
+    /* Check if memory allocation was successful */
+    if ( newEvent == NULL )
     {
-        *head           = (event_t*) malloc( sizeof( event_t ) );
-        ( *head )->id   = event;
-        ( *head )->next = NULL;
-        return;
+        return NULL;
     }
 
-    event_t* current = *head;
+    newEvent->id       = event;
+    newEvent->time     = 0;
+    newEvent->posted   = 0;
+    newEvent->priority = priority;
+    newEvent->source   = 0;
+    newEvent->stamped  = false;
 
-    while ( current->next != NULL )
+    /* Find the first event of a lower priority class */
+    event_t** link = head;
+
+    while ( ( *link != NULL ) && ( ( *link )->priority >= priority ) )
     {
-        current = current->next;
+        link = &( *link )->next;
     }
 
-    /* Now we can add a new variable */
-    current->next = (event_t*) malloc( sizeof( event_t ) );
+    newEvent->next = *link;
+    *link          = newEvent;
 
-    /* Check if memory allocation was successful */
-    if ( current->next == NULL )
+    return newEvent;
+}
+
+
+/** \brief Drop the deferred events that waited too long
+ *
+ * An event without a time stamp never expires. The clock may wrap around, so a time of
+ * 0 is a valid time stamp, see event_t::stamped.
+ *
+ * \param pState_Machine state_machine_t* const   pointer to state machine
+ * \param now uint32_t                            current time, in the clock of event_t::posted
+ * \param max_age uint32_t                        age after which a deferred event expires
+ * \return uint32_t                               number of expired events
+ */
+uint32_t expire_deferred( state_machine_t* const pState_Machine, uint32_t now, uint32_t max_age )
+{
+    event_t** link    = &pState_Machine->deferred;
+    uint32_t  expired = 0;
+
+    while ( *link != NULL )
     {
+        event_t* const pEvent = *link;
+
+        if ( pEvent->stamped && ( ( now - pEvent->posted ) > max_age ) )
+        {
+            *link = pEvent->next;
+            free( pEvent );
+            expired++;
+        }
+        else
+        {
+            link = &pEvent->next;
+        }
+    }
+
+    pState_Machine->deferredCount -= expired;
+    pState_Machine->expired       += expired;
+
+    return expired;
+}
+
+
+/** \brief Discard all queued and deferred events
+ *
+ * \param pState_Machine state_machine_t* const   pointer to state machine
+ */
+void clear_events( state_machine_t* const pState_Machine )
+{
+    event_t** const queues[] = { &pState_Machine->event, &pState_Machine->deferred };
+
+    for ( uint8_t i = 0; i < sizeof( queues ) / sizeof( queues[0] ); i++ )
+    {
+        while ( *queues[i] != NULL )
+        {
+            event_t* const pEvent = *queues[i];
+            *queues[i]            = pEvent->next;
+            free( pEvent );
+        }
+    }
+
+    pState_Machine->deferredCount = 0;
+}
+
+
+/** \brief Remove an event from the event queue without freeing it
+ *
+ * A handler may have pushed events of a higher priority class in front of the event,
+ * so the link to it is looked up from the head.
+ *
+ * \param pState_Machine state_machine_t* const   pointer to state machine
+ * \param pEvent const event_t* const             the queued event
+ */
+static void unlink_event( state_machine_t* const pState_Machine, const event_t* const pEvent )
+{
+    event_t** link = &pState_Machine->event;
+
+    while ( *link != pEvent )
+    {
+        link = &( *link )->next;
+    }
+
+    *link = pEvent->next;
+}
+
+
+/** \brief Append an event to the deferred queue, drop it if the queue is full
+ *
+ * \param pState_Machine state_machine_t* const   pointer to state machine
+ * \param pEvent event_t* const                   the event, removed from the event queue
+ */
+static void defer_event( state_machine_t* const pState_Machine, event_t* const pEvent )
+{
+    if ( pState_Machine->deferredCount >= HSM_DEFER_CAPACITY )
+    {
+        free( pEvent );
+        pState_Machine->dropped++;
         return;
     }
 
-    current->next->id   = event;
-    current->next->next = NULL;
+    event_t** link = &pState_Machine->deferred;
+
+    while ( *link != NULL )
+    {
+        link = &( *link )->next;
+    }
+
+    pEvent->next = NULL;
+    *link        = pEvent;
+    pState_Machine->deferredCount++;
+}
+
+
+/** \brief Move all deferred events back to the event queue
+ *
+ * The deferred events were posted before the queued ones, so each one is queued in
+ * front of the events of its own priority class, in the order they were deferred.
+ *
+ * \param pState_Machine state_machine_t* const   pointer to state machine
+ */
+static void recall_deferred( state_machine_t* const pState_Machine )
+{
+    event_t* reversed = NULL;
+
+    /* Reverse the deferred queue, the last event is queued first */
+    while ( pState_Machine->deferred != NULL )
+    {
+        event_t* const pEvent    = pState_Machine->deferred;
+        pState_Machine->deferred = pEvent->next;
+        pEvent->next             = reversed;
+        reversed                 = pEvent;
+    }
+
+    while ( reversed != NULL )
+    {
+        event_t* const pEvent = reversed;
+        event_t**      link   = &pState_Machine->event;
+        reversed              = pEvent->next;
+
+        /* Find the first event of the same or a lower priority class */
+        while ( ( *link != NULL ) && ( ( *link )->priority > pEvent->priority ) )
+        {
+            link = &( *link )->next;
+        }
+
+        pEvent->next = *link;
+        *link        = pEvent;
+    }
+
+    pState_Machine->deferredCount = 0;
 }
@@ -33,6 +33,14 @@
 #define HSM_USE_VARIABLE_LENGTH_ARRAY 1
 #endif
 
+#ifndef HSM_DEFER_CAPACITY
+//! Most deferred events of a state machine, more are dropped
+#define HSM_DEFER_CAPACITY      8
+#endif // HSM_DEFER_CAPACITY
+
+//! Events below this id can be deferred, one bit of the Deferred mask each
+#define HSM_DEFER_EVENTS        32
+
 /*
  *  --------------------- ENUMERATION ---------------------
  */
@@ -58,14 +66,20 @@ typedef struct finite_state state_t;
 
 typedef struct state_machine_t state_machine_t;
 typedef state_machine_result_t (*state_handler) (state_machine_t* const State, const uint32_t event);
-typedef void (*state_machine_event_logger)(uint32_t state_machine, uint32_t state, uint32_t event);
-typedef void (*state_machine_result_logger)(uint32_t state, state_machine_result_t result);
+typedef struct event_t event_t;
+//! Called before every handler call with the event that is dispatched, which isn't always the queue head
+typedef void (*state_machine_event_logger)(state_machine_t* const State_Machine, uint32_t state, const event_t* const pEvent);
+typedef void (*state_machine_result_logger)(state_machine_t* const State_Machine, uint32_t state, state_machine_result_t result);
+
+//! Asked before every handler call, returns false to stop the dispatch and keep the event queued
+typedef bool (*state_machine_budget)(state_machine_t* const State_Machine, const event_t* const pEvent);
 
 //! finite state structure
 struct finite_state{
   state_handler Handler;      //!< State handler function
   state_handler Entry;        //!< Entry action for state
   state_handler Exit;          //!< Exit action for state.
+  uint32_t Deferred;          //!< Bit n set: event n is deferred until the state changes
 
 #if STATE_MACHINE_LOGGER
   uint32_t Id;              //!< unique identifier of state within the single state machine
@@ -78,6 +92,7 @@ struct hierarchical_state
   state_handler Handler;      //!< State handler function
   state_handler Entry;        //!< Entry action for state
   state_handler Exit;          //!< Exit action for state.
+  uint32_t Deferred;          //!< Bit n set: event n is deferred until the state changes
 
 #if STATE_MACHINE_LOGGER
   uint32_t Id;              //!< unique identifier of state within the single state machine
@@ -88,15 +103,24 @@ struct hierarchical_state
   uint32_t Level;            //!< Hierarchy level from the top state.
 };
 
-typedef struct event_t {
-    uint32_t        id;     //!< Event to be dispatched
-    struct event_t* next;   //!< Pointer to next event
-} event_t;
+struct event_t {
+    uint32_t        id;       //!< Event to be dispatched
+    uint32_t        time;     //!< Time the event was pushed, in the clock of the latency measurement, valid if stamped
+    uint32_t        posted;   //!< Time the event was pushed, in the clock of expire_deferred(), valid if stamped
+    uint8_t         priority; //!< Priority class, higher classes are dispatched first
+    uint8_t         source;   //!< Origin of the event, defined by the application, 0 if not stamped
+    bool            stamped;  //!< The application set the time, any value of the clock is a valid time
+    struct event_t* next;     //!< Pointer to next event
+};
 
 //! Abstract state machine structure
 struct state_machine_t {
-    event_t*       event;   //!< Pointer to head of event queue
-    const state_t* State;   //!< State of state machine.
+    event_t*       event;         //!< Pointer to head of event queue
+    const state_t* State;         //!< State of state machine.
+    event_t*       deferred;      //!< Pointer to head of the deferred events, in the order they were deferred
+    uint8_t        deferredCount; //!< Number of deferred events
+    uint32_t       dropped;       //!< Events dropped as not handled or with the deferred queue full
+    uint32_t       expired;       //!< Deferred events dropped by expire_deferred()
 };
 
 /*
@@ -113,6 +137,7 @@ extern state_machine_result_t dispatch_event(state_machine_t* const pState_Machi
                                             ,state_machine_event_logger event_logger
                                             ,state_machine_result_logger result_logger
 #endif // STATE_MACHINE_LOGGER
+                                            ,state_machine_budget budget
                                             );
 
 #if HIERARCHICAL_STATES
@@ -124,6 +149,9 @@ extern state_machine_result_t switch_state(state_machine_t* const pState_Machine
                                                     const state_t* const pTarget_State);
 
 void pushEvent( event_t** head, uint32_t event );
+uint32_t expire_deferred( state_machine_t* const pState_Machine, uint32_t now, uint32_t max_age );
+void clear_events( state_machine_t* const pState_Machine );
+event_t* pushEventPriority( event_t** head, uint32_t event, uint8_t priority );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,317 @@
+/**
+ * \file    hsmEngine.h
+ * \brief   Header only state machine engine with statically dispatched states
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HSM_ENGINE_H
+#define HSM_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "hsm.h"
+
+/*
+ * The engine is an alternative to the finite state machine of hsm.c, see HsmEngine.
+ * The states are types instead of tables of function pointers. The current state is an
+ * index into the list of states, the dispatch is a chain of compares over that list,
+ * resolved at compile time, so the compiler can inline the handlers, entry and exit
+ * actions of the states into the dispatch.
+ *
+ * The behavior matches dispatch_event() and switch_state() of a single flat state
+ * machine: the same event queue with its priority classes, the same results and the
+ * same order of the exit and entry actions. Deferred events and the dispatch budget
+ * of hsm.c aren't supported yet. A state machine can be migrated state by
+ * state, the handlers keep their signature except for the machine parameter.
+ *
+ * Only C++11 is used, the AVR toolchain has neither a standard library nor C++17.
+ *
+ * Example:
+ *
+ *   class Door;
+ *   struct Locked : HsmState { static state_machine_result_t handler( Door& door, uint32_t event ); };
+ *   struct Open   : HsmState { static state_machine_result_t handler( Door& door, uint32_t event );
+ *                              static state_machine_result_t entry( Door& door, uint32_t event ); };
+ *   class Door : public HsmEngine<Door, Locked, Open> {};
+ *
+ *   door.switchState<Locked>();
+ *   door.pushEvent( EVENT_OPEN );
+ *   door.dispatchEvent();
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define HSM_ENGINE_INLINE       inline __attribute__( ( always_inline ) ) /*!< Forces the dispatch into the caller */
+#define HSM_ENGINE_NO_STATE     0xFF                                      /*!< The state index before the first switch */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The base of all states
+ * @details A state must define a static handler, entry and exit are optional:
+ *          static state_machine_result_t handler( Machine& machine, uint32_t event );
+ *          static state_machine_result_t entry( Machine& machine, uint32_t event );
+ *          static state_machine_result_t exit( Machine& machine, uint32_t event );
+ */
+struct HsmState
+{
+    template <typename Machine>
+    static HSM_ENGINE_INLINE state_machine_result_t entry( Machine& machine, uint32_t event )
+    {
+        return EVENT_HANDLED;
+    }
+
+    template <typename Machine>
+    static HSM_ENGINE_INLINE state_machine_result_t exit( Machine& machine, uint32_t event )
+    {
+        return EVENT_HANDLED;
+    }
+};
+
+
+/**
+ * @brief The index of a state in the list of states
+ * @details A state that isn't in the list fails to compile
+ */
+template <typename State, typename... States>
+struct HsmStateIndex;
+
+template <typename State, typename... Rest>
+struct HsmStateIndex<State, State, Rest...>
+{
+    static const uint8_t value = 0;
+};
+
+template <typename State, typename First, typename... Rest>
+struct HsmStateIndex<State, First, Rest...>
+{
+    static const uint8_t value = 1 + HsmStateIndex<State, Rest...>::value;
+};
+
+
+/**
+ * @brief Calls a static function of the state at a runtime index of the list of states
+ */
+template <typename Machine, typename... States>
+struct HsmStateVisitor;
+
+template <typename Machine>
+struct HsmStateVisitor<Machine>
+{
+    static HSM_ENGINE_INLINE state_machine_result_t handler( Machine& machine, uint8_t index, uint32_t event )
+    {
+        return EVENT_UN_HANDLED;
+    }
+
+    static HSM_ENGINE_INLINE state_machine_result_t exit( Machine& machine, uint8_t index, uint32_t event )
+    {
+        return EVENT_HANDLED;
+    }
+};
+
+template <typename Machine, typename First, typename... Rest>
+struct HsmStateVisitor<Machine, First, Rest...>
+{
+    static HSM_ENGINE_INLINE state_machine_result_t handler( Machine& machine, uint8_t index, uint32_t event )
+    {
+        return ( index == 0 ) ? First::handler( machine, event ) : HsmStateVisitor<Machine, Rest...>::handler( machine, index - 1, event );
+    }
+
+    static HSM_ENGINE_INLINE state_machine_result_t exit( Machine& machine, uint8_t index, uint32_t event )
+    {
+        return ( index == 0 ) ? First::exit( machine, event ) : HsmStateVisitor<Machine, Rest...>::exit( machine, index - 1, event );
+    }
+};
+
+
+/**
+ * @brief The state machine engine
+ * @details Machine derives from HsmEngine<Machine, States...>. It may hide logEvent() and
+ *          logResult() to log like the loggers of dispatch_event(), both are public.
+ */
+template <typename Machine, typename... States>
+class HsmEngine
+{
+public:
+    HsmEngine( void ) : pEvent( NULL ), dropped( 0 ), state( HSM_ENGINE_NO_STATE )
+    {
+    }
+
+    /**
+     * @brief Switches to a state, like switch_state().
+     *
+     * The state is changed first, then the exit action of the old state and the entry
+     * action of the new state are called with the event at the head of the queue.
+     *
+     * @return state_machine_result_t EVENT_HANDLED, TRIGGERED_TO_SELF if an action returned
+     *         it, or the first other result of an action.
+     */
+    template <typename Target>
+    HSM_ENGINE_INLINE state_machine_result_t switchState( void )
+    {
+        const uint8_t  source    = state;
+        const uint32_t event     = ( pEvent != NULL ) ? pEvent->id : 0;
+        bool           triggered = false;
+
+        state = HsmStateIndex<Target, States...>::value;
+
+        if ( source != HSM_ENGINE_NO_STATE )
+        {
+            const state_machine_result_t result = HsmStateVisitor<Machine, States...>::exit( machine(), source, event );
+
+            if ( ( result != EVENT_HANDLED ) && ( result != TRIGGERED_TO_SELF ) )
+            {
+                return result;
+            }
+            triggered = ( result == TRIGGERED_TO_SELF );
+        }
+
+        const state_machine_result_t result = Target::entry( machine(), event );
+
+        if ( ( result != EVENT_HANDLED ) && ( result != TRIGGERED_TO_SELF ) )
+        {
+            return result;
+        }
+
+        return ( triggered || ( result == TRIGGERED_TO_SELF ) ) ? TRIGGERED_TO_SELF : EVENT_HANDLED;
+    }
+
+    /**
+     * @brief Dispatches all queued events to the current state, like dispatch_event().
+     *
+     * A handled event is removed from the queue, an event handled with TRIGGERED_TO_SELF
+     * is dispatched again, an unhandled event is dropped and counted. Deferred events
+     * aren't supported, the dispatch has no budget.
+     *
+     * @return state_machine_result_t The result of the last handler, EVENT_HANDLED if the queue is empty.
+     */
+    state_machine_result_t dispatchEvent( void )
+    {
+        state_machine_result_t result       = EVENT_HANDLED;
+        event_t*               currentEvent = pEvent;
+
+        while ( currentEvent != NULL )
+        {
+            machine().logEvent( state, currentEvent->id );
+            result = HsmStateVisitor<Machine, States...>::handler( machine(), state, currentEvent->id );
+            machine().logResult( state, result );
+
+            if ( result == TRIGGERED_TO_SELF )
+            {
+                continue;
+            }
+
+            /* The handler may have pushed events of a higher priority class in front */
+            event_t** link = &pEvent;
+
+            while ( *link != currentEvent )
+            {
+                link = &( *link )->next;
+            }
+
+            *link = currentEvent->next;
+            free( currentEvent );
+
+            if ( result != EVENT_HANDLED )
+            {
+                dropped++;
+            }
+
+            currentEvent = pEvent;
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Pushes an event of the lowest priority class, like pushEvent().
+     *
+     * @param event The event.
+     */
+    void pushEvent( uint32_t event )
+    {
+        ::pushEvent( &pEvent, event );
+    }
+
+    /**
+     * @brief Pushes an event behind all events of its own and higher classes, like pushEventPriority().
+     *
+     * @param event The event.
+     * @param priority The priority class.
+     * @return event_t* The queued event, NULL if out of memory.
+     */
+    event_t* pushEventPriority( uint32_t event, uint8_t priority )
+    {
+        return ::pushEventPriority( &pEvent, event, priority );
+    }
+
+    /**
+     * @brief Returns the index of the current state, the Id of the state in hsm.c.
+     *
+     * @return uint8_t The index in the list of states, HSM_ENGINE_NO_STATE before the first switch.
+     */
+    uint8_t getState( void ) const
+    {
+        return state;
+    }
+
+    /**
+     * @brief Returns the number of events dropped as not handled, the dropped counter of hsm.c.
+     *
+     * @return uint32_t The number of dropped events.
+     */
+    uint32_t getDroppedEvents( void ) const
+    {
+        return dropped;
+    }
+
+    /**
+     * @brief Checks whether a state is the current state.
+     *
+     * @return true if State is the current state.
+     */
+    template <typename State>
+    bool isIn( void ) const
+    {
+        return state == HsmStateIndex<State, States...>::value;
+    }
+
+    /**
+     * @brief Called before a handler, logs nothing unless Machine hides it.
+     *
+     * @param stateIndex The index of the current state.
+     * @param event The event.
+     */
+    HSM_ENGINE_INLINE void logEvent( uint8_t stateIndex, uint32_t event )
+    {
+    }
+
+    /**
+     * @brief Called after a handler, logs nothing unless Machine hides it.
+     *
+     * @param stateIndex The index of the current state, after a switch of the handler.
+     * @param result The result of the handler.
+     */
+    HSM_ENGINE_INLINE void logResult( uint8_t stateIndex, state_machine_result_t result )
+    {
+    }
+
+private:
+    event_t* pEvent;  /*!< Head of the event queue */
+    uint32_t dropped; /*!< Events dropped as not handled */
+    uint8_t  state;   /*!< Index of the current state in States */
+
+    HSM_ENGINE_INLINE Machine& machine( void )
+    {
+        return *static_cast<Machine*>( this );
+    }
+};
+
+#endif  // HSM_ENGINE_H
@@ -17,10 +17,12 @@
 
 /**************************** Static Function prototype *********************************/
 
+static uint8_t ioMan_readInput( const io_context_t* const pIo, const io_t input );
+static void    ioMan_writeOutput( const uint8_t index, uint8_t level );
 
 /******************************** Global variables ************************************/
 
-static io_config_t buttonSwitchIoConfig[] = {
+static const io_config_t buttonSwitchIoConfig[IO_INPUT_SIZE] = {
     { IO_BUTTON_1, DOOR_1_BUTTON, INPUT,  HIGH, DEBOUNCE_DELAY_DOOR_BUTTON_1 }, /*!< Button 1 */
     { IO_BUTTON_2, DOOR_2_BUTTON, INPUT,  HIGH, DEBOUNCE_DELAY_DOOR_BUTTON_2 }, /*!< Button 2 */
     { IO_SWITCH_1, DOOR_1_SWITCH, INPUT,  LOW,  DEBOUNCE_DELAY_DOOR_SWITCH_1 }, /*!< Switch 1 */
@@ -48,22 +50,101 @@ static const io_config_t ledIoConfig[DOOR_TYPE_SIZE][RGB_LED_PIN_SIZE] = {
 };
 
 
+/**
+ * @brief The RGB pins that are switched on for each led color
+ * @details Index LED_COLOR_SIZE switches all pins off.
+ */
+static const uint8_t ledColorPins[LED_COLOR_SIZE + 1] = {
+    [LED_COLOR_RED]     = ( 1 << RGB_LED_PIN_R ),
+    [LED_COLOR_GREEN]   = ( 1 << RGB_LED_PIN_G ),
+    [LED_COLOR_BLUE]    = ( 1 << RGB_LED_PIN_B ),
+    [LED_COLOR_YELLOW]  = ( 1 << RGB_LED_PIN_R ) | ( 1 << RGB_LED_PIN_G ),
+    [LED_COLOR_MAGENTA] = ( 1 << RGB_LED_PIN_R ) | ( 1 << RGB_LED_PIN_B ),
+    [LED_COLOR_CYAN]    = ( 1 << RGB_LED_PIN_G ) | ( 1 << RGB_LED_PIN_B ),
+    [LED_COLOR_WHITE]   = ( 1 << RGB_LED_PIN_R ) | ( 1 << RGB_LED_PIN_G ) | ( 1 << RGB_LED_PIN_B ),
+    [LED_COLOR_SIZE]    = 0
+};
+
+
+/**
+ * @brief The pin configuration of every output, indexed by IO_OUTPUT_INDEX()
+ */
+static const io_config_t* const outputIoConfig[IO_OUTPUT_SIZE] = {
+    &magnetIoConfig[DOOR_TYPE_DOOR_1],
+    &magnetIoConfig[DOOR_TYPE_DOOR_2],
+    &ledIoConfig[DOOR_TYPE_DOOR_1][RGB_LED_PIN_R],
+    &ledIoConfig[DOOR_TYPE_DOOR_1][RGB_LED_PIN_G],
+    &ledIoConfig[DOOR_TYPE_DOOR_1][RGB_LED_PIN_B],
+    &ledIoConfig[DOOR_TYPE_DOOR_2][RGB_LED_PIN_R],
+    &ledIoConfig[DOOR_TYPE_DOOR_2][RGB_LED_PIN_G],
+    &ledIoConfig[DOOR_TYPE_DOOR_2][RGB_LED_PIN_B]
+};
+
+
+/**
+ * @brief The input/output context whose output image drives the pins
+ * @details Setters only update the requested level in the output image of their context,
+ *          ioMan_flushOutputs() writes the levels of the bound context that differ from its
+ *          committed image. One byte per output keeps every update atomic, so the led tick
+ *          interrupt may set the led outputs without locking.
+ */
+static io_context_t* volatile pOutputIo = NULL;
+
+static volatile bool magnetsReleased = false; /*!< The emergency release holds all magnet pins released */
+
+
+#if defined( ARDUINO_ARCH_AVR )
+/**
+ * @brief The output register and bit of every output pin
+ * @details Resolved once in ioMan_lockOutputs(), so a flush doesn't need the pin lookup of digitalWrite().
+ */
+static struct
+{
+    volatile uint8_t* pOutput; /*!< The port output register */
+    uint8_t           bitMask; /*!< The bit of the pin within the port */
+} outputPort[IO_OUTPUT_SIZE];
+#endif
+
+
 /******************************** Function definition ************************************/
 
 
 
 /**
- * @brief Sets up the input/output management for the system.
+ * @brief Drives all outputs to their inactive level: doors locked, leds off.
  *
- * This function initializes the pin modes for various input/output configurations
- * including button switches, magnets, and RGB LEDs. It iterates through the 
- * configuration arrays and sets the pin modes accordingly.
+ * Called first thing after reset, before the serial interface, the settings or the logging
+ * are set up, so it doesn't log. After reset the pins are inputs and the magnets are
+ * undriven. On the Mega the level is written before the pin becomes an output, so the
+ * outputs never glitch to their active level. No context is bound yet, the pins keep
+ * this level until the first flush of the bound context.
+ */
+void ioMan_lockOutputs( void )
+{
+    for ( uint8_t i = 0; i < IO_OUTPUT_SIZE; i++ )
+    {
+        const uint8_t level = !outputIoConfig[i]->activeState;
+
+#if defined( ARDUINO_ARCH_AVR )
+        const uint8_t port = digitalPinToPort( outputIoConfig[i]->pinNumber );
+
+        outputPort[i].pOutput = portOutputRegister( port );
+        outputPort[i].bitMask = digitalPinToBitMask( outputIoConfig[i]->pinNumber );
+        ioMan_writeOutput( i, level );
+        *portModeRegister( port ) |= outputPort[i].bitMask;
+#else
+        pinMode( outputIoConfig[i]->pinNumber, outputIoConfig[i]->direction );
+        ioMan_writeOutput( i, level );
+#endif
+    }
+}
+
+
+/**
+ * @brief Sets up the input/output management for the system.
  *
- * The function performs the following steps:
- * 1. Logs the start of the setup process.
- * 2. Configures the pin modes for button switches.
- * 3. Configures the pin modes for magnets.
- * 4. Configures the pin modes for RGB LEDs for each door type.
+ * This function initializes the pin modes of the buttons and switches. The magnets and
+ * the RGB LEDs are already driven by ioMan_lockOutputs().
  */
 void ioMan_Setup( void )
 {
@@ -72,34 +153,68 @@ void ioMan_Setup( void )
     for ( uint8_t i = 0; i < sizeof( buttonSwitchIoConfig ) / sizeof( buttonSwitchIoConfig[0] ); i++ )
     {
         pinMode( buttonSwitchIoConfig[i].pinNumber, buttonSwitchIoConfig[i].direction );
-        ioMan_setDebounceDelay( (io_t) i, appSettings_getSettings()->debounceDelay[i] );
     }
+}
 
-    for ( uint8_t i = 0; i < sizeof( magnetIoConfig ) / sizeof( magnetIoConfig[0] ); i++ )
+
+/**
+ * @brief Initializes an input/output context.
+ *
+ * All inputs start undebounced, both doors are considered locked and the debounce
+ * delays are taken from the application settings. The output image requests the
+ * inactive level of every output, the next flush writes all of them.
+ *
+ * @param pIo Pointer to the input/output context to initialize.
+ */
+void ioMan_init( io_context_t* const pIo )
+{
+    memset( pIo, 0, sizeof( io_context_t ) );
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
     {
-        pinMode( magnetIoConfig[i].pinNumber, magnetIoConfig[i].direction );
+        pIo->debounceDelay[i] = appSettings_getSettings()->debounceDelay[i];
     }
 
     for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
     {
-        for ( uint8_t j = 0; j < RGB_LED_PIN_SIZE; j++ )
-        {
-            pinMode( ledIoConfig[i][j].pinNumber, ledIoConfig[i][j].direction );
-        }
+        pIo->lockState[i] = LOCK_STATE_LOCKED;
+    }
+
+    /* The pin levels may differ from the image, e.g. if the bound context is initialized again */
+    for ( uint8_t i = 0; i < IO_OUTPUT_SIZE; i++ )
+    {
+        pIo->outputShadow[i]    = !outputIoConfig[i]->activeState;
+        pIo->outputCommitted[i] = IO_OUTPUT_UNKNOWN;
     }
 }
 
 
+/**
+ * @brief Binds an input/output context to the output pins.
+ *
+ * Only the output image of the bound context is written to the magnet and led pins,
+ * the contexts of a replay or a benchmark never drive the hardware. The leds are shared
+ * hardware, so ioMan_setLedColor() sets them in the bound context.
+ *
+ * @param pIo Pointer to the input/output context driving the hardware.
+ */
+void ioMan_bindOutputs( io_context_t* const pIo )
+{
+    noInterrupts();
+    pOutputIo = pIo;
+    interrupts();
+}
+
+
 /**
  * @brief Set the state of the door
  *
+ * @param pIo - The input/output context
  * @param door - The door type
  * @param state - The state of the door
  */
-void ioMan_setDoorState( const door_type_t door, const lock_state_t state )
+void ioMan_setDoorState( io_context_t* const pIo, const door_type_t door, const lock_state_t state )
 {
-    static lock_state_t lastState[DOOR_TYPE_SIZE] = {LOCK_STATE_LOCKED, LOCK_STATE_LOCKED};
-
     /* Check if the door is valid */
     if ( door >= DOOR_TYPE_SIZE )
     {
@@ -108,15 +223,15 @@ void ioMan_setDoorState( const door_type_t door, const lock_state_t state )
     }
 
     /* Set the lock state ( The magnet is active low ) */
-    digitalWrite(  magnetIoConfig[door].pinNumber, 
-                 ( state == LOCK_STATE_LOCKED ) ? !magnetIoConfig[door].activeState : magnetIoConfig[door].activeState );
+    pIo->outputShadow[IO_OUTPUT_INDEX( magnetIoConfig[door].io )] =
+        ( state == LOCK_STATE_LOCKED ) ? !magnetIoConfig[door].activeState : magnetIoConfig[door].activeState;
 
-    if ( lastState[door] != state )
+    if ( pIo->lockState[door] != state )
     {
         Log.noticeln( "%s: Door %d is %s", __func__, door, ( state == LOCK_STATE_UNLOCKED ) ? "unlocked" : "locked" );
     }
 
-    lastState[door] = state;
+    pIo->lockState[door] = state;
 }
 
 
@@ -128,6 +243,7 @@ void ioMan_setDoorState( const door_type_t door, const lock_state_t state )
  * taking into account debounce logic to filter out noise. It logs the state changes and returns
  * the current state of the input.
  *
+ * @param pIo The input/output context.
  * @param input The input to check the state of.
  * @return input_status_t The current state of the input, including its activity state and debounce stability.
  *
@@ -140,15 +256,9 @@ void ioMan_setDoorState( const door_type_t door, const lock_state_t state )
  * 6. Logs the new state if it has changed.
  * 7. Saves the current reading for future comparisons.
  */
-input_status_t ioMan_getDoorState( const io_t input )
+input_status_t ioMan_getDoorState( io_context_t* const pIo, const io_t input )
 {
-    Log.verboseln( "%s: input: %s", __func__, logging_ioToString( input ).c_str() );
-
-    static bool           initialReadingDone[IO_INPUT_SIZE] = {0};
-    static uint8_t        ioState[IO_INPUT_SIZE]            = {0};
-    static uint8_t        lastIoState[IO_INPUT_SIZE]        = {0};
-    static uint32_t       lastDebounceTime[IO_INPUT_SIZE]   = {0};
-    static input_status_t state[IO_INPUT_SIZE]              = {INPUT_STATE_INACTIVE, INPUT_DEBOUNCE_UNSTABLE};
+    Log.verboseln( "%s: input: %s", __func__, logging_ioToString( input ) );
 
     if ( input >= IO_INPUT_SIZE )
     {
@@ -156,56 +266,120 @@ input_status_t ioMan_getDoorState( const io_t input )
         return ( ( input_status_t ){INPUT_STATE_INACTIVE, INPUT_DEBOUNCE_UNSTABLE} );
     }
 
+    input_debouncer_t* pDebouncer = &pIo->debouncer[input];
+
     /* Read the state of the switch into a local variable */
-    uint8_t reading = digitalRead( buttonSwitchIoConfig[input].pinNumber );
+    uint8_t reading = ioMan_readInput( pIo, input );
 
     /* check to see if you just pressed the input
      * (i.e. the input went from LOW to HIGH), and you've waited long enough
      * since the last press to ignore any noise: */
 
     /* If the switch changed, due to noise or pressing: */
-    if ( reading != lastIoState[input] )
+    if ( reading != pDebouncer->lastIoState )
     {
         /* reset the debouncing timer */
-        lastDebounceTime[input] = millis();
-        state[input].state      = INPUT_STATE_INACTIVE;
-        state[input].debounce   = INPUT_DEBOUNCE_UNSTABLE;
+        pDebouncer->lastDebounceTime = pIo->now;
+        pDebouncer->status.state     = INPUT_STATE_INACTIVE;
+        pDebouncer->status.debounce  = INPUT_DEBOUNCE_UNSTABLE;
+        pDebouncer->edgeCount++;
+
+        /* Report the raw edge */
+        if ( pIo->edgeHandler != NULL )
+        {
+            pIo->edgeHandler( pIo, input, reading );
+        }
     }
 
-    if ( ( millis() - lastDebounceTime[input] ) > buttonSwitchIoConfig[input].debounceDelay )
+    if ( ( pIo->now - pDebouncer->lastDebounceTime ) > pIo->debounceDelay[input] )
     {
         /* whatever the reading is at, it's been there for longer than the debounce
          * delay, so take it as the actual current state: */
-        state[input].debounce = INPUT_DEBOUNCE_STABLE;
+        pDebouncer->status.debounce = INPUT_DEBOUNCE_STABLE;
 
         /* if the input state has changed or it's the first reading */
-        if ( ( reading != ioState[input] ) || !initialReadingDone[input] )
+        if ( ( reading != pDebouncer->ioState ) || !pDebouncer->initialReadingDone )
         {
-            ioState[input] = reading;
+            pDebouncer->ioState = reading;
 
-            if ( ioState[input] == buttonSwitchIoConfig[input].activeState )
+            if ( pDebouncer->ioState == buttonSwitchIoConfig[input].activeState )
             {
-                state[input].state = INPUT_STATE_ACTIVE;
-                Log.noticeln( "%s: %s is active", __func__, logging_ioToString( input ).c_str() );
+                pDebouncer->status.state = INPUT_STATE_ACTIVE;
+                Log.noticeln( "%s: %s is active", __func__, logging_ioToString( input ) );
             }
             else
             {
-                state[input].state = INPUT_STATE_INACTIVE;
-                Log.noticeln( "%s: %s is inactive", __func__, logging_ioToString( input ).c_str() );
+                pDebouncer->status.state = INPUT_STATE_INACTIVE;
+                Log.noticeln( "%s: %s is inactive", __func__, logging_ioToString( input ) );
             }
 
             /* Set the first reading done flag */
-            if ( !initialReadingDone[input] )
+            if ( !pDebouncer->initialReadingDone )
             {
-                initialReadingDone[input] = true;
+                pDebouncer->initialReadingDone = true;
             }
         }
     }
 
     /* save the reading. Next time through the loop, it'll be the lastIoState: */
-    lastIoState[input] = reading;
+    pDebouncer->lastIoState = reading;
 
-    return state[input];
+    return pDebouncer->status;
+}
+
+
+/**
+ * @brief Returns the debounced state of an input without sampling the pin.
+ *
+ * Unlike ioMan_getDoorState(), this function does not advance the debouncer.
+ *
+ * @param pIo The input/output context.
+ * @param input The input to get the state of.
+ * @return input_status_t The state of the input as of the last ioMan_getDoorState() call.
+ */
+input_status_t ioMan_peekDoorState( const io_context_t* const pIo, const io_t input )
+{
+    if ( input >= IO_INPUT_SIZE )
+    {
+        Log.errorln( "%s: Invalid input: %d", __func__, input );
+        return ( ( input_status_t ){INPUT_STATE_INACTIVE, INPUT_DEBOUNCE_UNSTABLE} );
+    }
+
+    return pIo->debouncer[input].status;
+}
+
+
+/**
+ * @brief Takes a snapshot of all inputs without sampling the pins.
+ *
+ * Like ioMan_peekDoorState(), this function does not advance the debouncers, so it can
+ * be called at any rate without influencing the door control.
+ *
+ * @param pIo The input/output context.
+ * @param pImage Pointer to store the input image.
+ */
+void ioMan_getInputImage( const io_context_t* const pIo, io_input_image_t* const pImage )
+{
+    pImage->time      = pIo->now;
+    pImage->raw       = 0;
+    pImage->debounced = 0;
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        const input_debouncer_t* pDebouncer = &pIo->debouncer[i];
+
+        if ( pDebouncer->lastIoState == buttonSwitchIoConfig[i].activeState )
+        {
+            pImage->raw |= ( 1 << i );
+        }
+
+        if ( pDebouncer->initialReadingDone && ( pDebouncer->ioState == buttonSwitchIoConfig[i].activeState ) )
+        {
+            pImage->debounced |= ( 1 << i );
+        }
+
+        pImage->edgeCount[i] = pDebouncer->edgeCount;
+    }
 }
 
 
@@ -219,15 +393,6 @@ input_status_t ioMan_getDoorState( const io_t input )
  * @param door The door type for which the LED state is being set.
  * @param color The color to set the LED to, if enabling.
  *
- * The function supports the following LED colors:
- * - LED_COLOR_RED
- * - LED_COLOR_GREEN
- * - LED_COLOR_BLUE
- * - LED_COLOR_YELLOW
- * - LED_COLOR_MAGENTA
- * - LED_COLOR_CYAN
- * - LED_COLOR_WHITE
- *
  * If the door type is invalid, an error is logged and the function returns without making changes.
  * When disabling the LED, all color pins are set to their inactive state.
  */
@@ -242,55 +407,141 @@ void ioMan_setLed( bool enable, door_type_t door, led_color_t color )
         return;
     }
 
-    if ( enable )
+    ioMan_setLedColor( door, enable ? color : LED_COLOR_SIZE );
+}
+
+
+/**
+ * @brief Sets the LED color of a door in the output image of the bound context.
+ *
+ * The pin levels of every color are precomputed, so this function neither logs nor
+ * branches on the color and may be called from an interrupt service routine. The
+ * pins follow with the next ioMan_flushOutputs(). Does nothing until a context is bound.
+ *
+ * @param door The door type. Must be less than DOOR_TYPE_SIZE.
+ * @param color The color to show, LED_COLOR_SIZE switches the LED off.
+ */
+void ioMan_setLedColor( door_type_t door, led_color_t color )
+{
+    io_context_t* const pIo       = pOutputIo;
+    const uint8_t       colorPins = ledColorPins[( color < LED_COLOR_SIZE ) ? color : LED_COLOR_SIZE];
+
+    if ( pIo == NULL )
+    {
+        return;
+    }
+
+    for ( uint8_t i = 0; i < RGB_LED_PIN_SIZE; i++ )
     {
-        switch ( color )
+        pIo->outputShadow[IO_OUTPUT_INDEX( ledIoConfig[door][i].io )] =
+            ( colorPins & ( 1 << i ) ) ? ledIoConfig[door][i].activeState : !ledIoConfig[door][i].activeState;
+    }
+}
+
+
+/**
+ * @brief Commits all outputs whose requested level differs from the committed level.
+ *
+ * Must be called once per main loop iteration. Repeatedly requesting the same output
+ * level therefore costs no pin write at all. Only the bound context writes the pins,
+ * any other context just commits its image and counts the writes it would have done.
+ *
+ * @param pIo The input/output context.
+ */
+void ioMan_flushOutputs( io_context_t* const pIo )
+{
+    const bool bound = ( pIo == pOutputIo );
+
+    pIo->outputStats.flushes++;
+
+    for ( uint8_t i = 0; i < IO_OUTPUT_SIZE; i++ )
+    {
+        /* The emergency release writes the image of the bound context from its interrupt */
+        noInterrupts();
+
+        const uint8_t level = pIo->outputShadow[i];
+
+        if ( level != pIo->outputCommitted[i] )
         {
-            case LED_COLOR_RED:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber,  ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber, !ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber, !ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_GREEN:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber, !ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber,  ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber, !ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_BLUE:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber, !ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber, !ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber,  ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_YELLOW:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber,  ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber,  ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber, !ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_MAGENTA:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber,  ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber, !ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber,  ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_CYAN:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber, !ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber,  ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber,  ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            case LED_COLOR_WHITE:
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber,  ledIoConfig[door][RGB_LED_PIN_R].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber,  ledIoConfig[door][RGB_LED_PIN_G].activeState );
-                digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber,  ledIoConfig[door][RGB_LED_PIN_B].activeState );
-                break;
-            default:
-                break;
+            if ( bound )
+            {
+                ioMan_writeOutput( i, level );
+            }
+            pIo->outputCommitted[i] = level;
+            pIo->outputStats.writes++;
         }
+
+        interrupts();
     }
-    else
+}
+
+
+/**
+ * @brief Releases all magnets at once, may be called from an interrupt.
+ *
+ * The magnet pins are written directly, without waiting for the next flush, and the
+ * output image of the bound context follows. Until ioMan_restoreMagnets() is called,
+ * every write of a magnet pin keeps it released. The magnet pins are hardware, so the
+ * release applies to all contexts.
+ */
+void ioMan_releaseMagnets( void )
+{
+    io_context_t* const pIo = pOutputIo;
+
+    magnetsReleased = true;
+
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        const uint8_t index = IO_OUTPUT_INDEX( magnetIoConfig[door].io );
+
+        ioMan_writeOutput( index, magnetIoConfig[door].activeState );
+
+        if ( pIo != NULL )
+        {
+            pIo->outputShadow[index]    = magnetIoConfig[door].activeState;
+            pIo->outputCommitted[index] = magnetIoConfig[door].activeState;
+        }
+    }
+}
+
+
+/**
+ * @brief Ends the release of all magnets, the next flush writes the door states again.
+ */
+void ioMan_restoreMagnets( void )
+{
+    io_context_t* const pIo = pOutputIo;
+
+    for ( uint8_t door = 0; ( pIo != NULL ) && ( door < DOOR_TYPE_SIZE ); door++ )
     {
-        digitalWrite( ledIoConfig[door][RGB_LED_PIN_R].pinNumber, !ledIoConfig[door][RGB_LED_PIN_R].activeState );
-        digitalWrite( ledIoConfig[door][RGB_LED_PIN_G].pinNumber, !ledIoConfig[door][RGB_LED_PIN_G].activeState );
-        digitalWrite( ledIoConfig[door][RGB_LED_PIN_B].pinNumber, !ledIoConfig[door][RGB_LED_PIN_B].activeState );
+        /* The pins are still released, whatever a flush during the release committed */
+        pIo->outputCommitted[IO_OUTPUT_INDEX( magnetIoConfig[door].io )] = magnetIoConfig[door].activeState;
     }
+
+    magnetsReleased = false;
+}
+
+
+/**
+ * @brief Checks whether the emergency release holds all magnets released.
+ *
+ * @return true if the magnets are released until ioMan_restoreMagnets() is called.
+ */
+bool ioMan_areMagnetsReleased( void )
+{
+    return magnetsReleased;
+}
+
+
+/**
+ * @brief Returns the output write counters of a context.
+ *
+ * @param pIo The input/output context.
+ * @return const io_output_stats_t* Pointer to the output write counters.
+ */
+const io_output_stats_t* ioMan_getOutputStats( const io_context_t* const pIo )
+{
+    return &pIo->outputStats;
 }
 
 
@@ -302,18 +553,183 @@ void ioMan_setLed( bool enable, door_type_t door, led_color_t color )
  * when a button is pressed or released, preventing multiple signals
  * caused by mechanical noise.
  *
+ * @param pIo The input/output context.
  * @param io The input pin identifier. Must be less than IO_INPUT_SIZE.
  * @param delay The debounce delay in milliseconds.
  *
  * @note If the input pin identifier is invalid (greater than or equal to IO_INPUT_SIZE),
  *       an error message is logged and the function returns without making any changes.
  */
-void ioMan_setDebounceDelay( const io_t io, const uint16_t delay )
+void ioMan_setDebounceDelay( io_context_t* const pIo, const io_t io, const uint16_t delay )
 {
     if ( io >= IO_INPUT_SIZE )
     {
         Log.errorln( "%s: Invalid input: %d", __func__, io );
         return;
     }
-    buttonSwitchIoConfig[io].debounceDelay = delay;
+    pIo->debounceDelay[io] = delay;
+}
+
+
+
+/**
+ * @brief Resets the debounce state of all inputs.
+ *
+ * After the reset, every input behaves as if it had never been read before. This is used
+ * to start a trace replay from a well-defined state.
+ *
+ * @param pIo The input/output context.
+ */
+void ioMan_reset( io_context_t* const pIo )
+{
+    memset( pIo->debouncer, 0, sizeof( pIo->debouncer ) );
+}
+
+
+/**
+ * @brief Enables or disables the input override.
+ *
+ * While the override is enabled, ioMan_getDoorState() reads the pin levels set by
+ * ioMan_setRawInput() instead of the physical pins.
+ *
+ * @param pIo The input/output context.
+ * @param enable true to read the override levels, false to read the pins.
+ */
+void ioMan_setInputOverride( io_context_t* const pIo, bool enable )
+{
+    pIo->inputOverrideEnabled = enable;
+}
+
+
+/**
+ * @brief Sets the overridden pin level of an input.
+ *
+ * @param pIo The input/output context.
+ * @param input The input to set. Must be less than IO_INPUT_SIZE.
+ * @param level The pin level ( HIGH or LOW ).
+ */
+void ioMan_setRawInput( io_context_t* const pIo, const io_t input, const uint8_t level )
+{
+    if ( input >= IO_INPUT_SIZE )
+    {
+        Log.errorln( "%s: Invalid input: %d", __func__, input );
+        return;
+    }
+
+    pIo->inputOverride[input] = level;
+}
+
+
+/**
+ * @brief Returns the pin level of an input as seen by the last ioMan_getDoorState() call.
+ *
+ * @param pIo The input/output context.
+ * @param input The input to get. Must be less than IO_INPUT_SIZE.
+ * @return uint8_t The last read pin level ( HIGH or LOW ).
+ */
+uint8_t ioMan_getRawInput( const io_context_t* const pIo, const io_t input )
+{
+    if ( input >= IO_INPUT_SIZE )
+    {
+        Log.errorln( "%s: Invalid input: %d", __func__, input );
+        return LOW;
+    }
+
+    return pIo->debouncer[input].lastIoState;
+}
+
+
+/**
+ * @brief Returns the last lock state that was set for a door.
+ *
+ * @param pIo The input/output context.
+ * @param door The door type.
+ * @return lock_state_t The lock state of the door.
+ */
+lock_state_t ioMan_getLockState( const io_context_t* const pIo, const door_type_t door )
+{
+    if ( door >= DOOR_TYPE_SIZE )
+    {
+        Log.errorln( "%s: Invalid door type: %d", __func__, door );
+        return LOCK_STATE_LOCKED;
+    }
+
+    return pIo->lockState[door];
+}
+
+
+/**
+ * @brief Checks whether all inputs have finished debouncing.
+ *
+ * @param pIo The input/output context.
+ * @return true if the last pin level change of every input is older than its debounce delay.
+ */
+bool ioMan_isSettled( const io_context_t* const pIo )
+{
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        if ( ( pIo->now - pIo->debouncer[i].lastDebounceTime ) <= pIo->debounceDelay[i] )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Writes the level of an output pin.
+ *
+ * @param index The output index, see IO_OUTPUT_INDEX().
+ * @param level The pin level.
+ */
+static void ioMan_writeOutput( const uint8_t index, uint8_t level )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    /* Precomputed port write, see ioMan_lockOutputs() */
+    const uint8_t oldSreg = SREG;
+    cli();
+
+    /* Released magnets stay released */
+    if ( magnetsReleased && ( index <= IO_OUTPUT_INDEX( IO_MAGNET_2 ) ) )
+    {
+        level = outputIoConfig[index]->activeState;
+    }
+
+    if ( level )
+    {
+        *outputPort[index].pOutput |= outputPort[index].bitMask;
+    }
+    else
+    {
+        *outputPort[index].pOutput &= ~outputPort[index].bitMask;
+    }
+    SREG = oldSreg;
+#else
+    if ( magnetsReleased && ( index <= IO_OUTPUT_INDEX( IO_MAGNET_2 ) ) )
+    {
+        level = outputIoConfig[index]->activeState;
+    }
+
+    digitalWrite( outputIoConfig[index]->pinNumber, level );
+#endif
+}
+
+
+/**
+ * @brief Reads the pin level of an input.
+ *
+ * @param pIo The input/output context.
+ * @param input The input to read.
+ * @return uint8_t The pin level, either from the physical pin or from the input override.
+ */
+static uint8_t ioMan_readInput( const io_context_t* const pIo, const io_t input )
+{
+    if ( pIo->inputOverrideEnabled )
+    {
+        return pIo->inputOverride[input];
+    }
+
+    return digitalRead( buttonSwitchIoConfig[input].pinNumber );
 }
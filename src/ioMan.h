@@ -112,12 +112,29 @@ typedef enum
 {
     DOOR_TIMER_TYPE_UNLOCK, /*!< The unlock timer */
     DOOR_TIMER_TYPE_OPEN,   /*!< The open timer */
+    DOOR_TIMER_TYPE_INIT,   /*!< The init timer, bounds the wait for stable door switches */
     DOOR_TIMER_TYPE_SIZE    /*!< Number of timers */
 } door_timer_type_t;
 
 
+/*************************************** Defines ****************************************/
+
+#define IO_OUTPUT_SIZE          ( IO_LED_2_B - IO_MAGNET_1 + 1 ) /*!< Number of outputs */
+#define IO_OUTPUT_INDEX( io )   ( ( io ) - IO_MAGNET_1 )         /*!< Index of an output in the output image */
+#define IO_OUTPUT_UNKNOWN       0xFF                             /*!< Committed level of an output that wasn't flushed yet */
+
 /************************************* STRUCTURE **************************************/
 
+/**
+ * @brief The output write counters
+ * @details Used to confirm that unchanged outputs aren't written again
+ */
+typedef struct
+{
+    uint32_t flushes; /*!< Number of output flushes */
+    uint32_t writes;  /*!< Number of pin writes */
+} io_output_stats_t;
+
 /**
  * @brief The sensor status structure
  * @details The sensor status structure is used to hold the state and the debounce state of the sensor
@@ -140,13 +157,82 @@ typedef struct
     uint16_t      debounceDelay; /*!< The debounce delay of the pin */
 } io_config_t;
 
+/**
+ * @brief The input debouncer structure
+ * @details The input debouncer structure is used to hold the debounce state of a single input
+ */
+typedef struct
+{
+    uint32_t       lastDebounceTime;   /*!< The time of the last pin level change @unit ms */
+    input_status_t status;             /*!< The debounced input status */
+    uint8_t        ioState;            /*!< The debounced pin level */
+    uint8_t        lastIoState;        /*!< The pin level of the previous reading */
+    bool           initialReadingDone; /*!< The first stable reading has been taken */
+    uint16_t       edgeCount;          /*!< Number of raw pin level changes, wraps around */
+} input_debouncer_t;
+
+/**
+ * @brief The input image structure
+ * @details A snapshot of all inputs, taken without advancing the debouncers
+ */
+typedef struct
+{
+    uint32_t time;                     /*!< The time of the last input sampling @unit ms */
+    uint8_t  raw;                      /*!< Bit n is set if input n was active at the last reading */
+    uint8_t  debounced;                /*!< Bit n is set if input n is active after debouncing */
+    uint16_t edgeCount[IO_INPUT_SIZE]; /*!< Number of raw pin level changes of each input, wraps around */
+} io_input_image_t;
+
+typedef struct io_context io_context_t;
+
+/**
+ * @brief The input/output context structure
+ * @details The input/output context holds all mutable input/output state of one controller instance.
+ *          The pin configuration tables are shared and read-only. Only the context bound by
+ *          ioMan_bindOutputs() writes its output image to the pins, the output image of every
+ *          other context is only committed.
+ */
+struct io_context
+{
+    uint32_t          now;                              /*!< The time of the current processing step @unit ms */
+    input_debouncer_t debouncer[IO_INPUT_SIZE];         /*!< The debounce state of all inputs */
+    uint16_t          debounceDelay[IO_INPUT_SIZE];     /*!< The debounce delay of all inputs @unit ms */
+    uint8_t           inputOverride[IO_INPUT_SIZE];     /*!< The overridden pin levels of all inputs */
+    lock_state_t      lockState[DOOR_TYPE_SIZE];        /*!< The last lock state of the doors */
+    bool              inputOverrideEnabled;             /*!< Read the inputs from the override instead of the pins */
+    volatile uint8_t  outputShadow[IO_OUTPUT_SIZE];     /*!< The requested output levels, see IO_OUTPUT_INDEX() */
+    volatile uint8_t  outputCommitted[IO_OUTPUT_SIZE];  /*!< The output levels of the last flush, IO_OUTPUT_UNKNOWN before */
+    io_output_stats_t outputStats;                      /*!< The output write counters */
+
+    /*!< Called for every raw input edge, may be NULL */
+    void ( *edgeHandler )( const io_context_t* const pIo, const io_t input, const uint8_t level );
+};
+
 
 /******************************** Function prototype ************************************/
 
+void           ioMan_lockOutputs( void );
 void           ioMan_Setup( void );
-void           ioMan_setDoorState( const door_type_t door, const lock_state_t state );
-input_status_t ioMan_getDoorState( const io_t sensor );
+void           ioMan_init( io_context_t* const pIo );
+void           ioMan_bindOutputs( io_context_t* const pIo );
+void           ioMan_setDoorState( io_context_t* const pIo, const door_type_t door, const lock_state_t state );
+input_status_t ioMan_getDoorState( io_context_t* const pIo, const io_t input );
+input_status_t ioMan_peekDoorState( const io_context_t* const pIo, const io_t input );
 void           ioMan_setLed( bool enable, door_type_t door, led_color_t color );
-void           ioMan_setDebounceDelay( const io_t io, const uint16_t delay );
+void           ioMan_setLedColor( door_type_t door, led_color_t color );
+void           ioMan_flushOutputs( io_context_t* const pIo );
+void           ioMan_releaseMagnets( void );
+void           ioMan_restoreMagnets( void );
+bool           ioMan_areMagnetsReleased( void );
+void           ioMan_setDebounceDelay( io_context_t* const pIo, const io_t io, const uint16_t delay );
+void           ioMan_reset( io_context_t* const pIo );
+void           ioMan_setInputOverride( io_context_t* const pIo, bool enable );
+void           ioMan_setRawInput( io_context_t* const pIo, const io_t input, const uint8_t level );
+uint8_t        ioMan_getRawInput( const io_context_t* const pIo, const io_t input );
+lock_state_t   ioMan_getLockState( const io_context_t* const pIo, const door_type_t door );
+bool           ioMan_isSettled( const io_context_t* const pIo );
+void           ioMan_getInputImage( const io_context_t* const pIo, io_input_image_t* const pImage );
+
+const io_output_stats_t* ioMan_getOutputStats( const io_context_t* const pIo );
 
 #endif  // IO_MANAGEMENT_H
\ No newline at end of file
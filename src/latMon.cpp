@@ -0,0 +1,223 @@
+/**
+ * \file    latMon.cpp
+ * \brief   Source file for the event latency monitor
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "latMon.h"
+#include "logging.h"
+
+/*
+ * Every event is stamped with the hardware clock when it is posted. Right before its
+ * handler runs, the time it waited in the queue is counted in the histogram of the event.
+ * The buckets double in width, so 16 buckets cover 1 us to 32 ms at a fixed cost per
+ * event and a fixed amount of memory, without storing single samples.
+ *
+ * The percentiles are read from the buckets: the reported value is the upper bound of the
+ * bucket holding the percentile, but never more than the longest latency.
+ */
+
+
+/******************************** Global variables ************************************/
+
+static lat_mon_hist_t histograms[DOOR_CONTROL_EVENT_SIZE]; /*!< The histograms, indexed by door_control_event_t */
+
+
+/**************************** Static Function prototype *********************************/
+
+static uint32_t latMon_getPercentile( const lat_mon_hist_t* const pHist, uint8_t percent );
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Counts the latency of a dispatched event.
+ *
+ * @param event The event.
+ * @param source The origin of the event.
+ * @param latency The time the event waited in the queue @unit us
+ */
+void latMon_record( door_control_event_t event, door_control_source_t source, uint32_t latency )
+{
+    if ( event >= DOOR_CONTROL_EVENT_SIZE )
+    {
+        return;
+    }
+
+    lat_mon_hist_t* const pHist  = &histograms[event];
+    uint8_t               bucket = 0;
+
+    for ( uint32_t rest = latency >> 1; ( rest != 0 ) && ( bucket < ( LAT_MON_BUCKETS - 1 ) ); rest >>= 1 )
+    {
+        bucket++;
+    }
+
+    if ( pHist->buckets[bucket] == UINT16_MAX )
+    {
+        for ( uint8_t i = 0; i < LAT_MON_BUCKETS; i++ )
+        {
+            pHist->buckets[i] >>= 1;
+        }
+    }
+
+    pHist->buckets[bucket]++;
+    pHist->count++;
+
+    if ( latency >= pHist->max )
+    {
+        pHist->max       = latency;
+        pHist->maxSource = source;
+    }
+}
+
+
+/**
+ * @brief Clears all histograms.
+ */
+void latMon_clear( void )
+{
+    memset( histograms, 0, sizeof( histograms ) );
+}
+
+
+/**
+ * @brief Summarizes the histogram of an event.
+ *
+ * @param event The event.
+ * @param pSummary Pointer to store the summary.
+ * @return true if the event was dispatched since the last clear, false otherwise.
+ */
+bool latMon_getSummary( door_control_event_t event, lat_mon_summary_t* const pSummary )
+{
+    if ( ( event >= DOOR_CONTROL_EVENT_SIZE ) || ( histograms[event].count == 0 ) )
+    {
+        return false;
+    }
+
+    const lat_mon_hist_t* const pHist = &histograms[event];
+
+    pSummary->count     = pHist->count;
+    pSummary->p50       = latMon_getPercentile( pHist, 50 );
+    pSummary->p99       = latMon_getPercentile( pHist, 99 );
+    pSummary->max       = pHist->max;
+    pSummary->maxSource = pHist->maxSource;
+
+    return true;
+}
+
+
+/**
+ * @brief Prints the latency summary of every dispatched event.
+ */
+void latMon_printTable( void )
+{
+    Serial.println( F( "----------------------------------" ) );
+    Serial.println( F( "Event Latency" ) );
+    Serial.println( F( "----------------------------------" ) );
+
+    for ( uint8_t event = 0; event < DOOR_CONTROL_EVENT_SIZE; event++ )
+    {
+        lat_mon_summary_t summary;
+
+        if ( !latMon_getSummary( (door_control_event_t) event, &summary ) )
+        {
+            continue;
+        }
+
+        Serial.println( logging_eventToString( (door_control_event_t) event ) );
+        Serial.print( F( "  " ) );
+        Serial.print( summary.count );
+        Serial.print( F( " events, p50 " ) );
+        Serial.print( summary.p50 );
+        Serial.print( F( " us, p99 " ) );
+        Serial.print( summary.p99 );
+        Serial.print( F( " us, max " ) );
+        Serial.print( summary.max );
+        Serial.print( F( " us (" ) );
+        Serial.print( logging_sourceToString( (door_control_source_t) summary.maxSource ) );
+        Serial.println( F( ")" ) );
+    }
+    Serial.println( F( "----------------------------------" ) );
+}
+
+
+/**
+ * @brief Prints the latency summary of every dispatched event as a single JSON line.
+ *
+ * Format: {"lat":1,"version":"...","events":[{"name":"...","count":n,"p50_us":n,"p99_us":n,
+ *          "max_us":n,"max_source":"..."},...]}
+ */
+void latMon_printJson( void )
+{
+    bool first = true;
+
+    Serial.print( F( "{\"lat\":1,\"version\":\"" GIT_VERSION_STRING "\",\"events\":[" ) );
+
+    for ( uint8_t event = 0; event < DOOR_CONTROL_EVENT_SIZE; event++ )
+    {
+        lat_mon_summary_t summary;
+
+        if ( !latMon_getSummary( (door_control_event_t) event, &summary ) )
+        {
+            continue;
+        }
+
+        Serial.print( first ? F( "{\"name\":\"" ) : F( ",{\"name\":\"" ) );
+        Serial.print( logging_eventToString( (door_control_event_t) event ) );
+        Serial.print( F( "\",\"count\":" ) );
+        Serial.print( summary.count );
+        Serial.print( F( ",\"p50_us\":" ) );
+        Serial.print( summary.p50 );
+        Serial.print( F( ",\"p99_us\":" ) );
+        Serial.print( summary.p99 );
+        Serial.print( F( ",\"max_us\":" ) );
+        Serial.print( summary.max );
+        Serial.print( F( ",\"max_source\":\"" ) );
+        Serial.print( logging_sourceToString( (door_control_source_t) summary.maxSource ) );
+        Serial.print( F( "\"}" ) );
+        first = false;
+    }
+
+    Serial.println( F( "]}" ) );
+}
+
+
+/**
+ * @brief Reads a percentile from a histogram.
+ *
+ * @param pHist The histogram, with at least one dispatch.
+ * @param percent The percentile, 1..100.
+ * @return uint32_t The upper bound of the bucket holding the percentile, at most the longest latency @unit us
+ */
+static uint32_t latMon_getPercentile( const lat_mon_hist_t* const pHist, uint8_t percent )
+{
+    uint32_t total = 0;
+
+    for ( uint8_t i = 0; i < LAT_MON_BUCKETS; i++ )
+    {
+        total += pHist->buckets[i];
+    }
+
+    /* The rank of the percentile, rounded up */
+    const uint32_t rank   = ( total * percent + 99 ) / 100;
+    uint32_t       seen   = 0;
+    uint8_t        bucket = 0;
+
+    for ( ; bucket < ( LAT_MON_BUCKETS - 1 ); bucket++ )
+    {
+        seen += pHist->buckets[bucket];
+        if ( seen >= rank )
+        {
+            break;
+        }
+    }
+
+    const uint32_t upper = ( 2UL << bucket ) - 1;
+
+    return ( ( bucket == ( LAT_MON_BUCKETS - 1 ) ) || ( upper > pHist->max ) ) ? pHist->max : upper;
+}
@@ -0,0 +1,56 @@
+/**
+ * \file    latMon.h
+ * \brief   Header file for the event latency monitor
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef LATENCY_MONITOR_H
+#define LATENCY_MONITOR_H
+
+#include <Arduino.h>
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define LAT_MON_BUCKETS         16 /*!< Buckets of a histogram, bucket n counts 2^n..2^(n+1)-1 us, the last one all above */
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The latency histogram of an event
+ * @details If a bucket is full, all buckets are halved, so the histogram keeps its shape
+ */
+typedef struct
+{
+    uint16_t buckets[LAT_MON_BUCKETS]; /*!< Number of dispatches per latency range */
+    uint32_t count;                    /*!< Number of dispatches since the last clear */
+    uint32_t max;                      /*!< Longest latency @unit us */
+    uint8_t  maxSource;                /*!< The door_control_source_t of the longest latency */
+} lat_mon_hist_t;
+
+/**
+ * @brief The latency summary of an event
+ */
+typedef struct
+{
+    uint32_t count;     /*!< Number of dispatches since the last clear */
+    uint32_t p50;       /*!< Median latency, upper bound of its bucket @unit us */
+    uint32_t p99;       /*!< 99th percentile latency, upper bound of its bucket @unit us */
+    uint32_t max;       /*!< Longest latency @unit us */
+    uint8_t  maxSource; /*!< The door_control_source_t of the longest latency */
+} lat_mon_summary_t;
+
+
+/******************************** Function prototype ************************************/
+
+void latMon_record( door_control_event_t event, door_control_source_t source, uint32_t latency );
+void latMon_clear( void );
+bool latMon_getSummary( door_control_event_t event, lat_mon_summary_t* const pSummary );
+void latMon_printTable( void );
+void latMon_printJson( void );
+
+#endif  // LATENCY_MONITOR_H
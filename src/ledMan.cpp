@@ -0,0 +1,203 @@
+/**
+ * \file    ledMan.cpp
+ * \brief   Source file for the led pattern sequencer
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <TimerOne.h>
+#include "logging.h"
+
+#include "ledMan.h"
+
+
+/**************************** Static Function prototype *********************************/
+
+static void ledMan_tickIsrHandler( void );
+static void ledMan_applyStep( void );
+
+
+/******************************** Global variables ************************************/
+
+/**
+ * @brief The steps of all led patterns
+ * @details The table lives in flash and is only read when the sequencer moves to the next step.
+ */
+static const led_pattern_step_t ledPatternSteps[] PROGMEM = {
+    /* LED_PATTERN_TYPE_OFF */
+    { { LED_PATTERN_COLOR_OFF, LED_PATTERN_COLOR_OFF }, LED_PATTERN_HOLD },
+
+    /* LED_PATTERN_TYPE_IDLE */
+    { { LED_COLOR_WHITE,       LED_COLOR_WHITE       }, LED_PATTERN_HOLD },
+
+    /* LED_PATTERN_TYPE_FAULT */
+    { { LED_COLOR_MAGENTA,     LED_COLOR_MAGENTA     }, 1 },
+    { { LED_PATTERN_COLOR_OFF, LED_PATTERN_COLOR_OFF }, 1 },
+
+    /* LED_PATTERN_TYPE_DOOR_1_RELEASED */
+    { { LED_COLOR_GREEN,       LED_COLOR_RED         }, 1 },
+    { { LED_PATTERN_COLOR_OFF, LED_PATTERN_COLOR_OFF }, 1 },
+
+    /* LED_PATTERN_TYPE_DOOR_2_RELEASED */
+    { { LED_COLOR_RED,         LED_COLOR_GREEN       }, 1 },
+    { { LED_PATTERN_COLOR_OFF, LED_PATTERN_COLOR_OFF }, 1 },
+
+    /* LED_PATTERN_TYPE_EMERGENCY */
+    { { LED_COLOR_GREEN,       LED_COLOR_GREEN       }, 1 },
+    { { LED_PATTERN_COLOR_OFF, LED_PATTERN_COLOR_OFF }, 1 },
+};
+
+
+/**
+ * @brief The position of each pattern in the step table
+ */
+static const led_pattern_t ledPatterns[LED_PATTERN_TYPE_SIZE] PROGMEM = {
+    [LED_PATTERN_TYPE_OFF]             = { 0, 1 },
+    [LED_PATTERN_TYPE_IDLE]            = { 1, 1 },
+    [LED_PATTERN_TYPE_FAULT]           = { 2, 2 },
+    [LED_PATTERN_TYPE_DOOR_1_RELEASED] = { 4, 2 },
+    [LED_PATTERN_TYPE_DOOR_2_RELEASED] = { 6, 2 },
+    [LED_PATTERN_TYPE_EMERGENCY]       = { 8, 2 },
+};
+
+
+/**
+ * @brief The sequencer state shared with the tick interrupt
+ */
+static volatile struct
+{
+    led_pattern_type_t pattern;               /*!< The selected pattern */
+    led_pattern_t      steps;                 /*!< The steps of the selected pattern */
+    uint8_t            step;                  /*!< The current step within the pattern */
+    uint8_t            ticksLeft;             /*!< Ticks until the next step, 0 while holding */
+    uint8_t            color[DOOR_TYPE_SIZE]; /*!< The color currently shown per door */
+} ledSequencer;
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the led pattern sequencer.
+ *
+ * The tick timer is started once and keeps running. State changes only select another
+ * pattern and never touch the timer configuration.
+ *
+ * @param tickInterval The led blink interval, see appSettings_t::ledBlinkInterval @unit ms
+ */
+void ledMan_setup( uint16_t tickInterval )
+{
+    Log.noticeln( "%s: Setting up the led pattern sequencer", __func__ );
+
+    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+    {
+        ledSequencer.color[i] = LED_PATTERN_COLOR_OFF;
+        ioMan_setLedColor( (door_type_t) i, LED_PATTERN_COLOR_OFF );
+    }
+
+    ledSequencer.pattern = LED_PATTERN_TYPE_OFF;
+    memcpy_P( (void*) &ledSequencer.steps, &ledPatterns[LED_PATTERN_TYPE_OFF], sizeof( led_pattern_t ) );
+
+    Timer1.initialize( ( (uint32_t) 2000 ) * ( (uint32_t) tickInterval ) );
+    Timer1.attachInterrupt( ledMan_tickIsrHandler );
+    Timer1.start();
+}
+
+
+/**
+ * @brief Changes the duration of a led tick.
+ *
+ * @param tickInterval The led blink interval, see appSettings_t::ledBlinkInterval @unit ms
+ */
+void ledMan_setTickInterval( uint16_t tickInterval )
+{
+    Timer1.setPeriod( ( (uint32_t) 2000 ) * ( (uint32_t) tickInterval ) );
+}
+
+
+/**
+ * @brief Selects the led pattern.
+ *
+ * The first step of the pattern is shown immediately. Selecting the pattern that is
+ * already running keeps its phase.
+ *
+ * @param pattern The pattern to show. Must be less than LED_PATTERN_TYPE_SIZE.
+ */
+void ledMan_setPattern( led_pattern_type_t pattern )
+{
+    if ( pattern >= LED_PATTERN_TYPE_SIZE )
+    {
+        Log.errorln( "%s: Invalid led pattern: %d", __func__, pattern );
+        return;
+    }
+
+    if ( pattern == ledSequencer.pattern )
+    {
+        return;
+    }
+
+    Log.verboseln( "%s: Pattern: %d", __func__, pattern );
+
+    noInterrupts();
+    ledSequencer.pattern = pattern;
+    ledSequencer.step    = 0;
+    memcpy_P( (void*) &ledSequencer.steps, &ledPatterns[pattern], sizeof( led_pattern_t ) );
+    ledMan_applyStep();
+    interrupts();
+}
+
+
+/**
+ * @brief Returns the selected led pattern.
+ *
+ * @return led_pattern_type_t The selected pattern.
+ */
+led_pattern_type_t ledMan_getPattern( void )
+{
+    return ledSequencer.pattern;
+}
+
+
+/**
+ * @brief Handler for the led tick interrupt
+ *
+ * Counts down the current step and moves to the next step of the pattern once it
+ * has elapsed. Holding steps cost a single compare.
+ */
+static void ledMan_tickIsrHandler( void )
+{
+    if ( ( ledSequencer.ticksLeft == 0 ) || ( --ledSequencer.ticksLeft != 0 ) )
+    {
+        return;
+    }
+
+    ledSequencer.step = ( ledSequencer.step + 1 < ledSequencer.steps.stepCount ) ? ledSequencer.step + 1 : 0;
+    ledMan_applyStep();
+}
+
+
+/**
+ * @brief Shows the current step of the selected pattern.
+ *
+ * Only doors whose color changes are written. Must be called with interrupts disabled.
+ */
+static void ledMan_applyStep( void )
+{
+    led_pattern_step_t step;
+
+    memcpy_P( &step, &ledPatternSteps[ledSequencer.steps.firstStep + ledSequencer.step], sizeof( led_pattern_step_t ) );
+
+    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+    {
+        if ( step.color[i] != ledSequencer.color[i] )
+        {
+            ledSequencer.color[i] = step.color[i];
+            ioMan_setLedColor( (door_type_t) i, (led_color_t) step.color[i] );
+        }
+    }
+
+    ledSequencer.ticksLeft = step.ticks;
+}
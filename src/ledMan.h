@@ -0,0 +1,68 @@
+/**
+ * \file    ledMan.h
+ * \brief   Header file for the led pattern sequencer
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef LED_MANAGEMENT_H
+#define LED_MANAGEMENT_H
+
+#include <Arduino.h>
+#include "ioMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define LED_PATTERN_COLOR_OFF   LED_COLOR_SIZE /*!< Pattern color that switches the led off */
+#define LED_PATTERN_HOLD        0              /*!< Step duration that holds the step until the pattern changes */
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the led pattern
+ */
+typedef enum
+{
+    LED_PATTERN_TYPE_OFF,             /*!< Both leds are off */
+    LED_PATTERN_TYPE_IDLE,            /*!< Both leds are white */
+    LED_PATTERN_TYPE_FAULT,           /*!< Both leds blink magenta */
+    LED_PATTERN_TYPE_DOOR_1_RELEASED, /*!< Door 1 blinks green, door 2 blinks red */
+    LED_PATTERN_TYPE_DOOR_2_RELEASED, /*!< Door 1 blinks red, door 2 blinks green */
+    LED_PATTERN_TYPE_EMERGENCY,       /*!< Both leds blink green */
+    LED_PATTERN_TYPE_SIZE             /*!< Number of patterns */
+} led_pattern_type_t;
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief A single step of a led pattern
+ * @details The colors of both doors are stored per step, so the phase between the doors
+ *          is part of the pattern.
+ */
+typedef struct
+{
+    uint8_t color[DOOR_TYPE_SIZE]; /*!< The led color of each door, LED_PATTERN_COLOR_OFF for off */
+    uint8_t ticks;                 /*!< Duration of the step, LED_PATTERN_HOLD to hold it @unit led ticks */
+} led_pattern_step_t;
+
+/**
+ * @brief The led pattern structure
+ * @details A pattern is a sequence of steps in the step table, which is repeated endlessly
+ */
+typedef struct
+{
+    uint8_t firstStep; /*!< Index of the first step in the step table */
+    uint8_t stepCount; /*!< Number of steps */
+} led_pattern_t;
+
+/******************************** Function prototype ************************************/
+
+void               ledMan_setup( uint16_t tickInterval );
+void               ledMan_setTickInterval( uint16_t tickInterval );
+void               ledMan_setPattern( led_pattern_type_t pattern );
+led_pattern_type_t ledMan_getPattern( void );
+
+#endif  // LED_MANAGEMENT_H
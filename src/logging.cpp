@@ -35,52 +35,52 @@ void logging_setup( void )
 
 
 /**
- * @brief Convert the event to string
+ * @brief Logs the event dispatched to a state
  * 
- * @param event - The event to convert
- * @return String - The string representation of the event
+ * @param pStateMachine - The state machine, which is part of a door control instance
+ * @param state - The state the event is dispatched to
+ * @param event - The dispatched event
  */
-void logging_eventLogger( uint32_t stateMachine, uint32_t state, uint32_t event )
+void logging_eventLogger( state_machine_t* const pStateMachine, uint32_t state, uint32_t event )
 {
-    (void) stateMachine;
-    static uint32_t lastEvent = 0;
-    static uint32_t lastState = 0;
+    door_control_logger_t* pLogger = &( (door_control_t*) pStateMachine )->logger;
 
     /* Only log if the event and state are changed */
-    if (    ( lastEvent != event )
-         && ( lastState != state ) )
+    if (    ( pLogger->lastEvent != event )
+         && ( pLogger->lastState != state ) )
     {
         Log.noticeln( "%s: Event: %s, State: %s", __func__,
-                    logging_eventToString( (door_control_event_t) event ).c_str(),
-                    logging_stateToString( (door_control_state_t) state ).c_str() );
+                    logging_eventToString( (door_control_event_t) event ),
+                    logging_stateToString( (door_control_state_t) state ) );
     }
 
     /* Save the last event and state */
-    lastEvent = event;
-    lastState = state;
+    pLogger->lastEvent = event;
+    pLogger->lastState = state;
 }
 
 
 /**
- * @brief Convert the state to string
+ * @brief Logs the result of a state handler
  * 
- * @param state - The state to convert
- * @return String - The string representation of the state
+ * @param pStateMachine - The state machine, which is part of a door control instance
+ * @param state - The state after the handler has been called
+ * @param result - The result of the handler
  */
-void logging_resultLogger(uint32_t state, state_machine_result_t result)
+void logging_resultLogger( state_machine_t* const pStateMachine, uint32_t state, state_machine_result_t result )
 {
-    static uint32_t lastState = 0;
+    door_control_logger_t* pLogger = &( (door_control_t*) pStateMachine )->logger;
 
     /* Only log if the state is changed */
-    if ( lastState != state )
+    if ( pLogger->lastResultState != state )
     {
         Log.noticeln( "%s: Result: %s, Current state: %s", __func__,
-                                                            logging_resultToString( result ).c_str(),
-                                                            logging_stateToString( (door_control_state_t) state ).c_str() );
+                                                            logging_resultToString( result ),
+                                                            logging_stateToString( (door_control_state_t) state ) );
     }
 
     /* Save the last state */
-    lastState = state;
+    pLogger->lastResultState = state;
 }
 
 
@@ -88,9 +88,9 @@ void logging_resultLogger(uint32_t state, state_machine_result_t result)
  * @brief Convert the state to string
  * 
  * @param state - The state to convert
- * @return String - The string representation of the state
+ * @return const char* - The string representation of the state
  */
-String logging_stateToString( door_control_state_t state )
+const char* logging_stateToString( door_control_state_t state )
 {
     switch ( state )
     {
@@ -108,6 +108,8 @@ String logging_stateToString( door_control_state_t state )
         return "DOOR_CONTROL_STATE_DOOR_2_UNLOCKED";
     case DOOR_CONTROL_STATE_DOOR_2_OPEN:
         return "DOOR_CONTROL_STATE_DOOR_2_OPEN";
+    case DOOR_CONTROL_STATE_EMERGENCY:
+        return "DOOR_CONTROL_STATE_EMERGENCY";
     default:
         return "UNKNOWN";
     }
@@ -118,9 +120,9 @@ String logging_stateToString( door_control_state_t state )
  * @brief Convert the event to string
  * 
  * @param event - The event to convert
- * @return String - The string representation of the event
+ * @return const char* - The string representation of the event
  */
-String logging_eventToString( door_control_event_t event )
+const char* logging_eventToString( door_control_event_t event )
 {
     Log.verboseln( "%s: Event: %d", __func__, event );
 
@@ -152,6 +154,38 @@ String logging_eventToString( door_control_event_t event )
         return "DOOR_CONTROL_EVENT_DOOR_1_2_OPEN";
     case DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE:
         return "DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE";
+    case DOOR_CONTROL_EVENT_INIT_TIMEOUT:
+        return "DOOR_CONTROL_EVENT_INIT_TIMEOUT";
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        return "DOOR_CONTROL_EVENT_EMERGENCY";
+    case DOOR_CONTROL_EVENT_EMERGENCY_RESET:
+        return "DOOR_CONTROL_EVENT_EMERGENCY_RESET";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+
+/**
+ * @brief Convert the event source to string
+ * 
+ * @param source - The event source to convert
+ * @return const char* - The string representation of the event source
+ */
+const char* logging_sourceToString( door_control_source_t source )
+{
+    switch ( source )
+    {
+    case DOOR_CONTROL_SOURCE_NONE:
+        return "none";
+    case DOOR_CONTROL_SOURCE_SWITCH:
+        return "switch";
+    case DOOR_CONTROL_SOURCE_REQUEST:
+        return "request";
+    case DOOR_CONTROL_SOURCE_TIMER:
+        return "timer";
+    case DOOR_CONTROL_SOURCE_EMERGENCY:
+        return "emergency";
     default:
         return "UNKNOWN";
     }
@@ -162,9 +196,9 @@ String logging_eventToString( door_control_event_t event )
  * @brief Convert the result to string
  * 
  * @param result - The result to convert
- * @return String - The string representation of the result
+ * @return const char* - The string representation of the result
  */
-String logging_resultToString( state_machine_result_t result )
+const char* logging_resultToString( state_machine_result_t result )
 {
     Log.verboseln( "%s: Result: %d", __func__, result );
 
@@ -186,9 +220,9 @@ String logging_resultToString( state_machine_result_t result )
  * @brief Convert the input/output to string
  * 
  * @param sensor - The input/output to convert
- * @return String - The string representation of the input/output
+ * @return const char* - The string representation of the input/output
  */
-String logging_ioToString( io_t io )
+const char* logging_ioToString( io_t io )
 {
     Log.verboseln( "%s: IO: %d", __func__, io );
 
@@ -228,9 +262,9 @@ String logging_ioToString( io_t io )
  * @brief Convert the timer type to string
  * 
  * @param timerType - The timer type to convert
- * @return String - The string representation of the timer type
+ * @return const char* - The string representation of the timer type
  */
-String logging_timerTypeToString( door_timer_type_t timerType )
+const char* logging_timerTypeToString( door_timer_type_t timerType )
 {
     Log.verboseln( "%s: Timer type: %d", __func__, timerType );
 
@@ -240,6 +274,8 @@ String logging_timerTypeToString( door_timer_type_t timerType )
         return "DOOR_TIMER_TYPE_OPEN";
     case DOOR_TIMER_TYPE_UNLOCK:
         return "DOOR_TIMER_TYPE_UNLOCK";
+    case DOOR_TIMER_TYPE_INIT:
+        return "DOOR_TIMER_TYPE_INIT";
     default:
         return "UNKNOWN";
     }
@@ -250,9 +286,9 @@ String logging_timerTypeToString( door_timer_type_t timerType )
  * @brief Convert the input state to string
  * 
  * @param state - The input state to convert
- * @return String - The string representation of the input state
+ * @return const char* - The string representation of the input state
  */
-String logging_inputStateToString( input_state_t state )
+const char* logging_inputStateToString( input_state_t state )
 {
     Log.verboseln( "%s: State: %d", __func__, state );
 
@@ -268,7 +304,7 @@ String logging_inputStateToString( input_state_t state )
 }
 
 
-String logging_logLevelToString( uint8_t level )
+const char* logging_logLevelToString( uint8_t level )
 {
     Log.verboseln( "%s: Level: %d", __func__, level );
 
@@ -292,3 +328,29 @@ String logging_logLevelToString( uint8_t level )
         return "UNKNOWN";
     }
 }
+
+
+/**
+ * @brief Convert the watchdog stage to string
+ * 
+ * @param stage - The watchdog stage to convert
+ * @return const char* - The string representation of the watchdog stage
+ */
+const char* logging_wdtStageToString( wdt_stage_t stage )
+{
+    switch ( stage )
+    {
+    case WDT_STAGE_CLI:
+        return "WDT_STAGE_CLI";
+    case WDT_STAGE_EVENTS:
+        return "WDT_STAGE_EVENTS";
+    case WDT_STAGE_TIMERS:
+        return "WDT_STAGE_TIMERS";
+    case WDT_STAGE_DISPATCH:
+        return "WDT_STAGE_DISPATCH";
+    case WDT_STAGE_ACCESS:
+        return "WDT_STAGE_ACCESS";
+    default:
+        return "UNKNOWN";
+    }
+}
@@ -16,6 +16,7 @@
 
 #include "hsm.h"
 #include "stateMan.h"
+#include "wdtMan.h"
 
 /************************************ ENUMERATION *************************************/
 
@@ -25,15 +26,17 @@
 
 /******************************** Function prototype ************************************/
 
-void   logging_setup( void );
-void   logging_eventLogger( uint32_t stateMachine, uint32_t state, uint32_t event );
-void   logging_resultLogger( uint32_t state, state_machine_result_t result );
-String logging_stateToString( door_control_state_t state );
-String logging_inputStateToString( input_state_t state );
-String logging_eventToString( door_control_event_t event );
-String logging_resultToString( state_machine_result_t result );
-String logging_ioToString( io_t io );
-String logging_timerTypeToString( door_timer_type_t timerType );
-String logging_logLevelToString( uint8_t level );
+void        logging_setup( void );
+void        logging_eventLogger( state_machine_t* const pStateMachine, uint32_t state, uint32_t event );
+void        logging_resultLogger( state_machine_t* const pStateMachine, uint32_t state, state_machine_result_t result );
+const char* logging_stateToString( door_control_state_t state );
+const char* logging_inputStateToString( input_state_t state );
+const char* logging_eventToString( door_control_event_t event );
+const char* logging_sourceToString( door_control_source_t source );
+const char* logging_resultToString( state_machine_result_t result );
+const char* logging_ioToString( io_t io );
+const char* logging_timerTypeToString( door_timer_type_t timerType );
+const char* logging_logLevelToString( uint8_t level );
+const char* logging_wdtStageToString( wdt_stage_t stage );
 
 #endif  // LOGGING_H
\ No newline at end of file
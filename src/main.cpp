@@ -2,9 +2,25 @@
 
 #include "stateMan.h"
 #include "ioMan.h"
+#include "ledMan.h"
 #include "comLineIf.h"
 #include "logging.h"
 #include "appSettings.h"
+#include "replay.h"
+#include "sysClock.h"
+#include "memMon.h"
+#include "wdtMan.h"
+#include "ctrlBus.h"
+#include "badgeMan.h"
+#include "rtcClock.h"
+#include "schedMan.h"
+#include "emergMan.h"
+
+
+/******************************** Global variables ************************************/
+
+static door_control_t doorControl; /*!< The door control instance driving the hardware */
+static ctrl_bus_t     ctrlBus;     /*!< The controller bus of the door control instance */
 
 
 /**
@@ -12,32 +28,63 @@
  * 
  * This function sets up the necessary components for the door control application.
  * It performs the following tasks:
- * - Initializes serial communication and logging.
- * - Logs the application version and startup message.
+ * - Stops the watchdog that a watchdog reset leaves running.
+ * - Drives the magnets and leds to their safe state: doors locked, leds off.
+ * - Paints the unused stack for the memory monitor.
+ * - Takes the first snapshot of the system clock.
+ * - Loads the application settings, which hold the timeouts and debounce delays.
+ * - Sets up input/output management and the led pattern sequencer.
+ * - Initializes state management and the emergency release.
+ * - Initializes serial communication and logging, which aren't needed to control the doors.
+ * - Starts the watchdog supervision.
+ * - Connects to the controller bus.
+ * - Starts the badge readers, the real time clock and the access schedules.
  * - Initializes the command line interface.
- * - Sets up input/output management.
- * - Initializes state management.
+ * - Logs the application version and the boot times.
  */
 void setup()
 {
-    /* Initialize serial communication and logging */
-    Serial.begin( SERIAL_BAUD_RATE );
+    /* After a watchdog reset the watchdog keeps running with its shortest timeout */
+    wdtMan_disable();
+
+    /* Lock the doors before anything else runs, the pins are undriven after reset */
+    ioMan_lockOutputs();
+    sysClock_markBoot( SYS_CLOCK_BOOT_LOCKED );
 
-    /* Initialize application settings */
+    /* Paint the unused stack before the modules are set up */
+    memMon_setup();
+
+    /* Take the clock snapshot used by the setup of all modules */
+    sysClock_update();
+
+    /* The door control needs the timeouts and debounce delays of the settings */
     appSettings_setup();
 
-    /* Initialize logging */
+    /* Initialize input/output management and state management first, they drive the doors */
+    ioMan_Setup();
+    ledMan_setup( appSettings_getSettings()->ledBlinkInterval );
+    stateMan_setup( &doorControl );
+    emergMan_setup( &doorControl );
+
+    /* Initialize serial communication and logging, the setup above isn't logged */
+    Serial.begin( SERIAL_BAUD_RATE );
     logging_setup();
-    Log.noticeln( "Door control application %s", GIT_VERSION_STRING );
-    Log.noticeln( "Starting ... " );
+    appSettings_logStatus();
 
+    /* Start the watchdog supervision */
+    wdtMan_setup();
 
-    /* Initialize command line interface, input/output management and state management */
-    comLineIf_setup();
-    ioMan_Setup();
-    stateMan_setup();
+    replay_setup( &doorControl );
+    ctrlBus_setup( &ctrlBus, &doorControl, &CTRL_BUS_SERIAL, CTRL_BUS_DE_PIN );
+    badgeMan_setup( &doorControl );
+    rtcClock_setup();
+    schedMan_setup( &doorControl );
+
+    /* The command line interface and the banner aren't needed to control the doors */
+    comLineIf_setup( &doorControl, &ctrlBus );
+    Log.noticeln( "Door control application %s, locked after %l us", GIT_VERSION_STRING, sysClock_getBootTime( SYS_CLOCK_BOOT_LOCKED ) );
 
-    Log.noticeln( "... Done" );
+    sysClock_markBoot( SYS_CLOCK_BOOT_READY );
 }
 
 
@@ -46,12 +93,49 @@ void setup()
  * @brief Main loop function that processes the command line interface and state management.
  * 
  * This function is called repeatedly and is responsible for:
+ * - Taking the system clock snapshot of this iteration using `sysClock_update()`.
+ * - Posting the event of an emergency release using `emergMan_process()`.
  * - Processing the command line interface using `comLineIf_process()`.
+ * - Advancing the time of the week using `rtcClock_process()`.
+ * - Opening and locking the doors by their schedules using `schedMan_process()`.
+ * - Checking the badges of the badge readers using `badgeMan_process()`.
+ * - Exchanging the door states and grants with the other controllers using `ctrlBus_process()`.
  * - Managing the state using `stateMan_process()`.
+ * - Reporting state changes of a trace recording using `replay_process()`.
+ * - Writing the changed outputs using `ioMan_flushOutputs()`.
+ * - Tracking the memory usage using `memMon_process()`.
+ * - Kicking the watchdog using `wdtMan_process()`.
  */
 void loop()
 {
+    /* All modules see the same time during this iteration */
+    sysClock_update();
+
+    /* The magnets are released already, the state machine follows with the next dispatch */
+    emergMan_process();
+
     /* Process the command line interface, and state management */
+    wdtMan_beginStage( WDT_STAGE_CLI );
     comLineIf_process();
-    stateMan_process();
+    wdtMan_endStage( WDT_STAGE_CLI );
+
+    wdtMan_beginStage( WDT_STAGE_ACCESS );
+    rtcClock_process();
+    schedMan_process();
+    badgeMan_process();
+    ctrlBus_process( &ctrlBus );
+    wdtMan_endStage( WDT_STAGE_ACCESS );
+
+    stateMan_process( &doorControl, sysClock_millis() );
+
+    replay_process();
+
+    /* Write the outputs that changed during this iteration */
+    ioMan_flushOutputs( &doorControl.io );
+
+    /* Track the stack and heap usage */
+    memMon_process();
+
+    /* Kick the watchdog if every stage finished in time */
+    wdtMan_process();
 }
@@ -0,0 +1,195 @@
+/**
+ * \file    memMon.cpp
+ * \brief   Source file for the stack and heap monitor
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "memMon.h"
+
+/*
+ * Memory layout (AVR):
+ *
+ *   __heap_start ... __brkval | free ... | stack ... RAMEND
+ *
+ * The heap grows upwards from __heap_start, its top is __brkval. The stack grows
+ * downwards from RAMEND. At boot, the gap between both is painted with MEM_MON_PAINT.
+ * The stack overwrites the paint from above, so the highest painted byte that is still
+ * intact marks the deepest stack usage. The scan starts at the highest heap top seen so
+ * far, as freed heap blocks leave non-paint bytes behind.
+ */
+
+
+#if MEM_MON_SUPPORTED
+
+/**
+ * @brief A block of the malloc free list, see avr-libc stdlib_private.h
+ */
+struct __freelist
+{
+    size_t             sz; /*!< Size of the block without this header */
+    struct __freelist* nx; /*!< The next free block */
+};
+
+extern char               __heap_start;    /*!< Start of the heap, set by the linker */
+extern char*              __brkval;        /*!< Top of the heap, NULL until the first malloc */
+extern size_t             __malloc_margin; /*!< Bytes malloc keeps free below the stack pointer */
+extern struct __freelist* __flp;           /*!< The malloc free list */
+
+
+/**************************** Static Function prototype *********************************/
+
+static uint8_t* memMon_getHeapTop( void );
+static void     memMon_sampleHeap( void );
+
+
+/******************************** Global variables ************************************/
+
+static uint8_t* pHeapPeak  = NULL; /*!< Highest heap top seen so far */
+static uint8_t* pUntouched = NULL; /*!< Lowest stack byte known to be overwritten */
+static uint8_t* pScan      = NULL; /*!< Next painted byte to check */
+
+#endif
+
+static mem_mon_stats_t memStats; /*!< The memory statistics */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the memory monitor.
+ *
+ * Paints the memory between the heap and the stack. Must be called first thing in
+ * setup(), before the call depth and the heap grow.
+ */
+void memMon_setup( void )
+{
+#if MEM_MON_SUPPORTED
+    uint8_t* pPaint = memMon_getHeapTop();
+    uint8_t* pEnd   = (uint8_t*) SP - MEM_MON_STACK_GUARD;
+
+    pHeapPeak  = pPaint;
+    pUntouched = pEnd;
+    pScan      = pPaint;
+
+    while ( pPaint < pEnd )
+    {
+        *pPaint++ = MEM_MON_PAINT;
+    }
+
+    memStats.heapMinFree = UINT16_MAX;
+    memMon_sampleHeap();
+    memStats.minFree      = pUntouched - pHeapPeak;
+    memStats.stackMaxUsed = (uint8_t*) RAMEND + 1 - pUntouched;
+#endif
+}
+
+
+/**
+ * @brief Updates the memory statistics.
+ *
+ * Called once per main loop iteration. The heap is sampled on every call, the painted
+ * stack area is scanned in chunks of MEM_MON_SCAN_CHUNK bytes, so a single call takes
+ * constant time.
+ */
+void memMon_process( void )
+{
+#if MEM_MON_SUPPORTED
+    memMon_sampleHeap();
+
+    /* Continue the scan for the deepest stack usage */
+    if ( pScan < pHeapPeak )
+    {
+        pScan = pHeapPeak;
+    }
+
+    for ( uint8_t i = 0; ( i < MEM_MON_SCAN_CHUNK ) && ( pScan < pUntouched ); i++, pScan++ )
+    {
+        if ( *pScan != MEM_MON_PAINT )
+        {
+            /* The stack reached down to here */
+            pUntouched = pScan;
+            break;
+        }
+    }
+
+    if ( pScan >= pUntouched )
+    {
+        /* Scan complete, start over at the heap */
+        pScan = pHeapPeak;
+    }
+
+    memStats.minFree      = ( pUntouched > pHeapPeak ) ? pUntouched - pHeapPeak : 0;
+    memStats.stackMaxUsed = (uint8_t*) RAMEND + 1 - pUntouched;
+#endif
+}
+
+
+/**
+ * @brief Returns the memory statistics.
+ *
+ * @return const mem_mon_stats_t* Pointer to the memory statistics, all zero if the target
+ *         isn't supported.
+ */
+const mem_mon_stats_t* memMon_getStats( void )
+{
+    return &memStats;
+}
+
+
+#if MEM_MON_SUPPORTED
+
+/**
+ * @brief Returns the current top of the heap.
+ *
+ * @return uint8_t* The first byte above the heap.
+ */
+static uint8_t* memMon_getHeapTop( void )
+{
+    return (uint8_t*) ( ( __brkval != NULL ) ? __brkval : &__heap_start );
+}
+
+
+/**
+ * @brief Samples the free heap memory.
+ *
+ * The memory available to malloc is the gap up to the stack, less the malloc margin,
+ * plus all blocks of the free list.
+ */
+static void memMon_sampleHeap( void )
+{
+    uint8_t* pHeapTop = memMon_getHeapTop();
+    uint8_t* pLimit   = (uint8_t*) SP - __malloc_margin;
+    uint16_t gap      = ( pLimit > pHeapTop ) ? pLimit - pHeapTop : 0;
+    uint16_t freeSize = gap;
+    uint16_t largest  = gap;
+
+    for ( struct __freelist* pBlock = __flp; pBlock != NULL; pBlock = pBlock->nx )
+    {
+        freeSize += pBlock->sz;
+        if ( pBlock->sz > largest )
+        {
+            largest = pBlock->sz;
+        }
+    }
+
+    if ( pHeapTop > pHeapPeak )
+    {
+        pHeapPeak = pHeapTop;
+    }
+
+    memStats.heapFree         = freeSize;
+    memStats.heapLargestBlock = largest;
+    memStats.heapMaxUsed      = pHeapPeak - (uint8_t*) &__heap_start;
+
+    if ( freeSize < memStats.heapMinFree )
+    {
+        memStats.heapMinFree = freeSize;
+    }
+}
+
+#endif
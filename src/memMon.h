@@ -0,0 +1,52 @@
+/**
+ * \file    memMon.h
+ * \brief   Header file for the stack and heap monitor
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#if defined( ARDUINO_ARCH_AVR )
+#define MEM_MON_SUPPORTED       1    /*!< The memory layout of the target is known */
+#else
+#define MEM_MON_SUPPORTED       0    /*!< The memory layout of the target is known */
+#endif
+
+#define MEM_MON_PAINT           0xC5 /*!< Value written into the unused stack at boot */
+#define MEM_MON_STACK_GUARD     32   /*!< Bytes below the stack pointer left unpainted at boot @unit byte */
+#define MEM_MON_SCAN_CHUNK      32   /*!< Painted bytes checked per call of memMon_process() @unit byte */
+
+/************************************ ENUMERATION *************************************/
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The memory statistics
+ * @details All values are in bytes. The maximum and minimum values are tracked since boot.
+ */
+typedef struct
+{
+    uint16_t stackMaxUsed;     /*!< Deepest stack usage @unit byte */
+    uint16_t heapMaxUsed;      /*!< Highest heap top above the heap start @unit byte */
+    uint16_t minFree;          /*!< Smallest gap between the highest heap top and the deepest stack @unit byte */
+    uint16_t heapFree;         /*!< Memory currently available to malloc, free list included @unit byte */
+    uint16_t heapLargestBlock; /*!< Largest block malloc can currently return @unit byte */
+    uint16_t heapMinFree;      /*!< Smallest sampled value of heapFree @unit byte */
+} mem_mon_stats_t;
+
+/******************************** Function prototype ************************************/
+
+void                   memMon_setup( void );
+void                   memMon_process( void );
+const mem_mon_stats_t* memMon_getStats( void );
+
+#endif  // MEMORY_MONITOR_H
@@ -0,0 +1,109 @@
+/**
+ * \file    pt.h
+ * \brief   Header file for stackless protothreads
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef PROTOTHREAD_H
+#define PROTOTHREAD_H
+
+#include <stdint.h>
+
+/*
+ * A protothread is a function that can wait in the middle of its body and continue there
+ * on the next call. It has no stack of its own: the position to continue at is stored in
+ * a pt_t, which costs 2 bytes of RAM per protothread.
+ *
+ *     static pt_result_t blink( pt_t* const pPt )
+ *     {
+ *         PT_BEGIN( pPt );
+ *         for ( ;; )
+ *         {
+ *             led on;
+ *             PT_WAIT_UNTIL( pPt, elapsed );
+ *             led off;
+ *             PT_WAIT_UNTIL( pPt, elapsed );
+ *         }
+ *         PT_END( pPt );
+ *     }
+ *
+ * Restrictions, as the body is one switch statement:
+ * - Local variables don't keep their value across a wait, keep such values in a structure
+ *   that embeds the pt_t.
+ * - The body must not contain a switch statement of its own.
+ * - A wait must not be placed in a nested function.
+ */
+
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the protothread results
+ */
+typedef enum
+{
+    PT_WAITING, /*!< The protothread waits for its condition */
+    PT_YIELDED, /*!< The protothread gave up the processor */
+    PT_ENDED    /*!< The protothread reached its end and starts over on the next call */
+} pt_result_t;
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The protothread structure
+ * @details Holds the position at which the protothread continues
+ */
+typedef struct
+{
+    uint16_t lc; /*!< The source line to continue at, 0 to start at the beginning */
+} pt_t;
+
+
+/*************************************** Defines ****************************************/
+
+/**
+ * @brief Starts the protothread at the beginning on the next call.
+ */
+#define PT_INIT( pPt )          do { ( pPt )->lc = 0; } while ( 0 )
+
+/**
+ * @brief Starts the body of a protothread. Must be the first statement of the function.
+ */
+#define PT_BEGIN( pPt )         switch ( ( pPt )->lc ) { case 0:
+
+/**
+ * @brief Ends the body of a protothread. Must be the last statement of the function.
+ */
+#define PT_END( pPt )           } ( pPt )->lc = 0; return PT_ENDED
+
+/**
+ * @brief Waits until the condition is true. The condition is evaluated once per call.
+ */
+#define PT_WAIT_UNTIL( pPt, condition )                                                      \
+    do                                                                                       \
+    {                                                                                        \
+        ( pPt )->lc = __LINE__; /* FALLTHRU */                                               \
+    case __LINE__:                                                                           \
+        if ( !( condition ) )                                                                \
+        {                                                                                    \
+            return PT_WAITING;                                                               \
+        }                                                                                    \
+    } while ( 0 )
+
+/**
+ * @brief Returns from the protothread and continues behind this statement on the next call.
+ */
+#define PT_YIELD( pPt )                                                                      \
+    do                                                                                       \
+    {                                                                                        \
+        ( pPt )->lc = __LINE__;                                                              \
+        return PT_YIELDED;                                                                   \
+    case __LINE__:;                                                                          \
+    } while ( 0 )
+
+#endif  // PROTOTHREAD_H
@@ -0,0 +1,444 @@
+/**
+ * \file    replay.cpp
+ * \brief   Source file for the trace recording and replay
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "replay.h"
+#include "logging.h"
+#include "sysClock.h"
+#include "wdtMan.h"
+
+/*
+ * Trace format (one record per line, all times relative to the start of the trace):
+ *
+ *   I <time ms> <input index> <pin level>   Raw input edge
+ *   S <time ms> <state> <unlocked doors>    State/output change ( bit 0: door 1, bit 1: door 2 )
+ *   V <time ms> <state> <unlocked doors>    Interlock violation ( controller output only )
+ *   E <time ms>                             End of the trace
+ *
+ * While recording, the controller writes I- and S-records for every input edge it samples
+ * and every change of its state or magnets. During a replay, the host feeds the I-records
+ * back (S-records are ignored), the controller acknowledges each record with "A <count>"
+ * and reports its own S-records, which can be diffed against the recording.
+ *
+ * The trace is replayed on a door control instance of its own with a virtual clock. It
+ * reads its inputs from the trace and isn't bound to the outputs, so the magnets and the
+ * leds keep following the controller of the airlock, which keeps running meanwhile.
+ */
+
+
+/**************************** Static Function prototype *********************************/
+
+static void    replay_advanceTo( uint32_t time );
+static void    replay_stop( void );
+static void    replay_step( uint32_t time );
+static void    replay_reportState( bool force );
+static void    replay_onInputEdge( const io_context_t* const pIo, const io_t input, const uint8_t level );
+static void    replay_onViolation( const door_control_t* const pDoorControl );
+static uint8_t replay_getUnlockedDoors( void );
+
+
+/******************************** Global variables ************************************/
+
+static door_control_t replayControl; /*!< The replayed door control instance */
+
+static replay_t replay = {
+    .pDoorControl = NULL,
+    .pInstance    = NULL,
+    .mode         = REPLAY_MODE_OFF,
+    .started      = false,
+    .tick         = REPLAY_DEFAULT_TICK,
+    .timeBase     = 0,
+    .time         = 0,
+    .records      = 0,
+    .steps        = 0,
+    .lastState    = DOOR_CONTROL_STATE_INIT,
+    .lastLocks    = 0
+};
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the trace recording and replay.
+ *
+ * @param pDoorControl Pointer to the door control instance to record, its input levels start a replay.
+ */
+void replay_setup( door_control_t* const pDoorControl )
+{
+    replay.pDoorControl = pDoorControl;
+}
+
+
+/**
+ * @brief Starts recording a trace.
+ *
+ * The current level of every input and the current state are written as the first
+ * records, so a replay of the trace starts from the same input levels.
+ */
+void replay_startRecording( void )
+{
+    if ( replay.mode == REPLAY_MODE_PLAY )
+    {
+        Log.errorln( "%s: Replay is active", __func__ );
+        return;
+    }
+
+    replay.mode      = REPLAY_MODE_RECORD;
+    replay.pInstance = replay.pDoorControl;
+    replay.timeBase  = replay.pDoorControl->io.now;
+
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        replay_onInputEdge( &replay.pDoorControl->io, (io_t) i, ioMan_getRawInput( &replay.pDoorControl->io, (io_t) i ) );
+    }
+
+    replay.pDoorControl->io.edgeHandler   = replay_onInputEdge;
+    replay.pDoorControl->violationHandler = replay_onViolation;
+
+    replay_reportState( true );
+}
+
+
+/**
+ * @brief Stops recording a trace.
+ */
+void replay_stopRecording( void )
+{
+    if ( replay.mode == REPLAY_MODE_RECORD )
+    {
+        replay.mode                           = REPLAY_MODE_OFF;
+        replay.pInstance                      = NULL;
+        replay.pDoorControl->io.edgeHandler   = NULL;
+        replay.pDoorControl->violationHandler = NULL;
+    }
+}
+
+
+/**
+ * @brief Starts a trace replay.
+ *
+ * The replayed instance is initialized with the virtual clock and reads its inputs from
+ * the trace. It is reset as soon as the initial input levels ( all I-records at time 0 )
+ * have been received. A running recording is stopped.
+ *
+ * @param tick The virtual time step while inputs are debouncing @unit ms
+ */
+void replay_start( uint16_t tick )
+{
+    io_context_t* pIo = &replayControl.io;
+
+    replay_stopRecording();
+
+    replay.mode      = REPLAY_MODE_PLAY;
+    replay.pInstance = &replayControl;
+    replay.started   = false;
+    replay.tick      = ( tick == 0 ) ? REPLAY_DEFAULT_TICK : tick;
+    replay.timeBase  = REPLAY_TIME_OFFSET;
+    replay.time      = replay.timeBase;
+    replay.records   = 0;
+    replay.steps     = 0;
+
+    stateMan_init( &replayControl, replay.time );
+
+    /* Start with the current input levels of the airlock until the trace provides its own */
+    for ( uint8_t i = 0; i < IO_INPUT_SIZE; i++ )
+    {
+        ioMan_setRawInput( pIo, (io_t) i, ioMan_getRawInput( &replay.pDoorControl->io, (io_t) i ) );
+    }
+
+    ioMan_setInputOverride( pIo, true );
+    replayControl.violationHandler = replay_onViolation;
+
+    Serial.println( "R start" );
+}
+
+
+/**
+ * @brief Checks whether a trace replay is active.
+ *
+ * While a replay is active, every line received on the serial interface is a trace record.
+ *
+ * @return true if a trace replay is active, false otherwise.
+ */
+bool replay_isActive( void )
+{
+    return ( replay.mode == REPLAY_MODE_PLAY );
+}
+
+
+/**
+ * @brief Returns the instance being recorded or replayed.
+ *
+ * @return door_control_t* The recorded or replayed instance, NULL if neither a recording nor a replay is active.
+ */
+door_control_t* replay_getInstance( void )
+{
+    return replay.pInstance;
+}
+
+
+/**
+ * @brief Processes a single trace record during a replay.
+ *
+ * @param line The trace record, see the trace format at the top of this file.
+ */
+void replay_processLine( const char* line )
+{
+    unsigned long time  = 0;
+    unsigned int  input = 0;
+    unsigned int  level = 0;
+
+    switch ( line[0] )
+    {
+    case 'I':
+        if ( sscanf( line + 1, "%lu %u %u", &time, &input, &level ) != 3 || input >= IO_INPUT_SIZE )
+        {
+            Log.errorln( "%s: Invalid record: %s", __func__, line );
+            return;
+        }
+
+        /* Initial input levels are applied before the controller is reset. The recorded
+         * controller sampled the edge in its step at the record time, the steps before saw
+         * the previous level.
+         */
+        if ( replay.started || ( time != 0 ) )
+        {
+            replay_advanceTo( replay.timeBase + time - 1 );
+        }
+
+        ioMan_setRawInput( &replayControl.io, (io_t) input, ( level != 0 ) ? HIGH : LOW );
+
+        /* Let the controller sample the edge at the time it occurred */
+        if ( replay.started )
+        {
+            replay_step( sysClock_isEarlier( replay.time, replay.timeBase + time ) ? replay.timeBase + time : replay.time );
+        }
+        break;
+
+    case 'E':
+        if ( sscanf( line + 1, "%lu", &time ) != 1 )
+        {
+            Log.errorln( "%s: Invalid record: %s", __func__, line );
+            return;
+        }
+
+        replay_advanceTo( replay.timeBase + time );
+        replay_stop();
+        return;
+
+    case 'S':
+    case '#':
+    case '\0':
+        /* Expected states and comments are not replayed */
+        break;
+
+    default:
+        Log.errorln( "%s: Invalid record: %s", __func__, line );
+        return;
+    }
+
+    replay.records++;
+    Serial.print( "A " );
+    Serial.println( replay.records );
+}
+
+
+/**
+ * @brief Reports state changes while a trace is recorded.
+ *
+ * Must be called once per main loop iteration after stateMan_process().
+ */
+void replay_process( void )
+{
+    if ( replay.mode == REPLAY_MODE_RECORD )
+    {
+        replay_reportState( false );
+    }
+}
+
+
+/**
+ * @brief Records a raw input edge.
+ *
+ * Installed as edge handler of the input/output context while a trace is recorded, so it
+ * is called whenever a sampled pin level differs from the previous sample.
+ *
+ * @param pIo The input/output context.
+ * @param input The input that changed.
+ * @param level The new pin level.
+ */
+static void replay_onInputEdge( const io_context_t* const pIo, const io_t input, const uint8_t level )
+{
+    Serial.print( "I " );
+    Serial.print( pIo->now - replay.timeBase );
+    Serial.print( ' ' );
+    Serial.print( input );
+    Serial.print( ' ' );
+    Serial.println( level );
+}
+
+
+/**
+ * @brief Reports an interlock violation while a trace is recorded or replayed.
+ *
+ * Installed as violation handler of the door control instance, so it is called before
+ * the state management locks the doors again and the record holds the offending state
+ * and magnets.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ */
+static void replay_onViolation( const door_control_t* const pDoorControl )
+{
+    Serial.print( "V " );
+    Serial.print( pDoorControl->io.now - replay.timeBase );
+    Serial.print( ' ' );
+    Serial.print( stateMan_getState( pDoorControl ) );
+    Serial.print( ' ' );
+    Serial.println( replay_getUnlockedDoors() );
+}
+
+
+/**
+ * @brief Advances the virtual clock to the given time.
+ *
+ * The controller is processed every tick while an input is debouncing. Otherwise nothing
+ * can change until the next trace record or the next door timer expiry, so the virtual
+ * clock jumps straight to the earlier of both.
+ *
+ * @param time The virtual time to advance to @unit ms
+ */
+static void replay_advanceTo( uint32_t time )
+{
+    if ( !replay.started )
+    {
+        /* All initial input levels are known, start the controller from scratch */
+        ioMan_reset( &replayControl.io );
+        stateMan_reset( &replayControl, replay.time );
+        replay.started = true;
+
+        /* The first sample of the initial levels happens right after the reset. Like the
+         * first S-record of a recording, the first one of the replay holds the state after it.
+         */
+        replay_step( replay.time );
+        replay_reportState( true );
+    }
+
+    uint32_t currentTime = replay.time;
+
+    while ( sysClock_isEarlier( currentTime, time ) )
+    {
+        uint32_t nextTime = currentTime + replay.tick;
+        uint32_t deadline;
+
+        if ( ioMan_isSettled( &replayControl.io ) )
+        {
+            nextTime = time;
+
+            if (    stateMan_getNextTimerDeadline( &replayControl, &deadline )
+                 && sysClock_isEarlier( currentTime, deadline )
+                 && sysClock_isEarlier( deadline, nextTime ) )
+            {
+                nextTime = deadline;
+            }
+        }
+
+        if ( sysClock_isEarlier( time, nextTime ) )
+        {
+            nextTime = time;
+        }
+
+        replay_step( nextTime );
+        currentTime = nextTime;
+
+        /* A long trace runs within the command line stage, every step reports progress */
+        wdtMan_feedStage( WDT_STAGE_CLI );
+    }
+}
+
+
+/**
+ * @brief Processes the controller once at the given virtual time.
+ *
+ * @param time The virtual time of the processing step @unit ms
+ */
+static void replay_step( uint32_t time )
+{
+    replay.time = time;
+
+    stateMan_process( &replayControl, time );
+    replay.steps++;
+    replay_reportState( false );
+}
+
+
+/**
+ * @brief Ends the trace replay.
+ */
+static void replay_stop( void )
+{
+    Serial.print( "R done " );
+    Serial.print( replay.records );
+    Serial.print( ' ' );
+    Serial.println( replay.steps );
+
+    replay.mode      = REPLAY_MODE_OFF;
+    replay.pInstance = NULL;
+
+    /* Free the events the replayed instance still holds */
+    clear_events( &replayControl.machine );
+}
+
+
+/**
+ * @brief Writes an S-record if the state or the magnets changed.
+ *
+ * @param force Write the record even if nothing changed.
+ */
+static void replay_reportState( bool force )
+{
+    door_control_state_t state = stateMan_getState( replay.pInstance );
+    uint8_t              locks = replay_getUnlockedDoors();
+
+    if ( !force && ( state == replay.lastState ) && ( locks == replay.lastLocks ) )
+    {
+        return;
+    }
+
+    replay.lastState = state;
+    replay.lastLocks = locks;
+
+    Serial.print( "S " );
+    Serial.print( replay.pInstance->io.now - replay.timeBase );
+    Serial.print( ' ' );
+    Serial.print( state );
+    Serial.print( ' ' );
+    Serial.println( locks );
+}
+
+
+/**
+ * @brief Returns a bitmap of the unlocked doors.
+ *
+ * @return uint8_t Bit 0 is set if door 1 is unlocked, bit 1 if door 2 is unlocked.
+ */
+static uint8_t replay_getUnlockedDoors( void )
+{
+    uint8_t locks = 0;
+
+    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+    {
+        if ( ioMan_getLockState( &replay.pInstance->io, (door_type_t) i ) == LOCK_STATE_UNLOCKED )
+        {
+            locks |= ( 1 << i );
+        }
+    }
+
+    return locks;
+}
@@ -0,0 +1,67 @@
+/**
+ * \file    replay.h
+ * \brief   Header file for the trace recording and replay
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <Arduino.h>
+#include "ioMan.h"
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define REPLAY_TIME_OFFSET      1000 /*!< Virtual time at which a replayed trace starts @unit ms */
+#define REPLAY_DEFAULT_TICK     1    /*!< Default virtual time step while inputs are debouncing @unit ms */
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the replay mode
+ */
+typedef enum
+{
+    REPLAY_MODE_OFF,    /*!< Neither recording nor replaying */
+    REPLAY_MODE_RECORD, /*!< Input edges and state changes are written to the serial interface */
+    REPLAY_MODE_PLAY    /*!< A trace is fed in via the serial interface and replayed on an instance of its own */
+} replay_mode_t;
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The replay structure
+ * @details The replay structure is used to hold the state of the trace recording and replay
+ */
+typedef struct
+{
+    door_control_t*      pDoorControl; /*!< The recorded door control instance, driving the hardware */
+    door_control_t*      pInstance;    /*!< The instance being recorded or replayed */
+    replay_mode_t        mode;         /*!< The current mode */
+    bool                 started;      /*!< The replayed controller has been reset and is running */
+    uint16_t             tick;         /*!< The virtual time step while inputs are debouncing @unit ms */
+    uint32_t             timeBase;     /*!< The time that corresponds to trace time 0 @unit ms */
+    uint32_t             time;         /*!< The virtual clock of the replayed instance @unit ms */
+    uint32_t             records;      /*!< Number of trace records processed */
+    uint32_t             steps;        /*!< Number of stateMan_process() calls during the replay */
+    door_control_state_t lastState;    /*!< The last reported state */
+    uint8_t              lastLocks;    /*!< The last reported unlocked-door bitmap */
+} replay_t;
+
+/******************************** Function prototype ************************************/
+
+void replay_setup( door_control_t* const pDoorControl );
+void replay_startRecording( void );
+void replay_stopRecording( void );
+void replay_start( uint16_t tick );
+bool replay_isActive( void );
+door_control_t* replay_getInstance( void );
+void replay_processLine( const char* line );
+void replay_process( void );
+
+#endif  // REPLAY_H
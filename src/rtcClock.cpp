@@ -0,0 +1,405 @@
+/**
+ * \file    rtcClock.cpp
+ * \brief   Source file for the real time clock
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <ArduinoLog.h>
+#include "rtcClock.h"
+#include "sysClock.h"
+
+#if defined( ARDUINO_ARCH_AVR )
+#include <Wire.h>
+#elif defined( ARDUINO_ARCH_RENESAS )
+#include <RTC.h>
+#endif
+
+/*
+ * The access schedules only need the time of the week: the seconds since Monday 00:00.
+ * The real time clock is read at setup and every RTC_CLOCK_SYNC_INTERVAL, in between the
+ * time of the week is advanced with the hardware clock. So checking the time costs no bus
+ * transfer.
+ *
+ * - Mega: a DS3231 module on I2C (SDA 20, SCL 21), kept running by its battery. Its day
+ *   register counts 1 = Monday to 7 = Sunday. A transfer waits at most
+ *   RTC_CLOCK_I2C_TIMEOUT for the bus, e.g. if a disconnected module holds SDA low. The
+ *   bus is reset then and the clock isn't valid until it is read again.
+ * - Uno R4: the real time clock of the microcontroller. It stops without power.
+ * - Other targets, e.g. the host build: no clock, the time set with the CLI is advanced
+ *   with the hardware clock only.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define DS3231_REG_SECONDS          0x00 /*!< First time register: seconds, minutes, hours, day */
+#define DS3231_REG_STATUS           0x0F /*!< Status register */
+#define DS3231_STATUS_OSF           0x80 /*!< The oscillator stopped, the time is invalid */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The real time clock structure
+ */
+typedef struct
+{
+    bool     valid;      /*!< The time of the week is known */
+    uint32_t baseTime;   /*!< The time of the week at baseMillis @unit s */
+    uint32_t baseMillis; /*!< The hardware clock at the last read of the real time clock @unit ms */
+    uint32_t lastSync;   /*!< The hardware clock at the last attempt to read the real time clock @unit ms */
+} rtc_clock_t;
+
+
+/**************************** Static Function prototype *********************************/
+
+static void rtcClock_sync( uint32_t now );
+static bool rtcClock_read( uint32_t* const pWeekTime );
+static bool rtcClock_write( uint32_t weekTime );
+
+#if defined( ARDUINO_ARCH_AVR )
+static uint8_t rtcClock_fromBcd( uint8_t value );
+static uint8_t rtcClock_toBcd( uint8_t value );
+static bool    rtcClock_readRegisters( uint8_t reg, uint8_t* const pData, uint8_t length );
+#endif
+
+static bool rtcClock_checkTimeout( void );
+
+
+/******************************** Global variables ************************************/
+
+static rtc_clock_t rtcClock; /*!< The real time clock */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the real time clock and reads the time of the week.
+ */
+void rtcClock_setup( void )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    Wire.begin();
+    Wire.setWireTimeout( RTC_CLOCK_I2C_TIMEOUT, true );
+#elif defined( ARDUINO_ARCH_RENESAS )
+    RTC.begin();
+#endif
+
+    rtcClock_sync( sysClock_millis() );
+
+    if ( !rtcClock.valid )
+    {
+        Log.warningln( "%s: The clock isn't set", __func__ );
+    }
+}
+
+
+/**
+ * @brief Reads the real time clock every RTC_CLOCK_SYNC_INTERVAL.
+ *
+ * Must be called once per main loop iteration.
+ */
+void rtcClock_process( void )
+{
+    const uint32_t now = sysClock_millis();
+
+    if ( ( now - rtcClock.lastSync ) >= RTC_CLOCK_SYNC_INTERVAL )
+    {
+        rtcClock_sync( now );
+    }
+}
+
+
+/**
+ * @brief Checks whether the time of the week is known.
+ *
+ * @return true if the real time clock was read or set, false otherwise.
+ */
+bool rtcClock_isValid( void )
+{
+    return rtcClock.valid;
+}
+
+
+/**
+ * @brief Returns the time of the week.
+ *
+ * @return uint32_t The seconds since Monday 00:00, 0 if the clock isn't valid.
+ */
+uint32_t rtcClock_getWeekTime( void )
+{
+    if ( !rtcClock.valid )
+    {
+        return 0;
+    }
+
+    return ( rtcClock.baseTime + ( sysClock_millis() - rtcClock.baseMillis ) / 1000 ) % RTC_CLOCK_WEEK;
+}
+
+
+/**
+ * @brief Sets the time of the week and writes it to the real time clock.
+ *
+ * @param weekTime The seconds since Monday 00:00.
+ * @return true if the time was set, false otherwise.
+ */
+bool rtcClock_setWeekTime( uint32_t weekTime )
+{
+    if ( weekTime >= RTC_CLOCK_WEEK )
+    {
+        Log.errorln( "%s: Invalid time of the week: %l", __func__, weekTime );
+        return false;
+    }
+
+    if ( !rtcClock_write( weekTime ) )
+    {
+        /* A transfer cut off by the timeout may have written a part of the time */
+        if ( rtcClock_checkTimeout() )
+        {
+            rtcClock.valid = false;
+        }
+
+        Log.errorln( "%s: The real time clock doesn't answer", __func__ );
+        return false;
+    }
+
+    rtcClock.valid      = true;
+    rtcClock.baseTime   = weekTime;
+    rtcClock.baseMillis = sysClock_millis();
+    rtcClock.lastSync   = rtcClock.baseMillis;
+
+    return true;
+}
+
+
+/**
+ * @brief Reads the real time clock and restarts the time of the week from it.
+ *
+ * If the real time clock doesn't answer, the time of the week keeps running on the
+ * hardware clock. If the bus timed out, the clock isn't valid anymore.
+ *
+ * @param now The hardware clock @unit ms
+ */
+static void rtcClock_sync( uint32_t now )
+{
+    uint32_t weekTime;
+
+    rtcClock.lastSync = now;
+
+    if ( rtcClock_read( &weekTime ) )
+    {
+        rtcClock.valid      = true;
+        rtcClock.baseTime   = weekTime;
+        rtcClock.baseMillis = now;
+    }
+    else if ( rtcClock_checkTimeout() )
+    {
+        rtcClock.valid = false;
+        Log.errorln( "%s: The I2C bus timed out, the clock isn't valid", __func__ );
+    }
+}
+
+
+/**
+ * @brief Checks whether a transfer of the real time clock timed out since the last check.
+ *
+ * @return true if the bus timed out and was reset, false otherwise.
+ */
+static bool rtcClock_checkTimeout( void )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    if ( Wire.getWireTimeoutFlag() )
+    {
+        Wire.clearWireTimeoutFlag();
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+
+#if defined( ARDUINO_ARCH_AVR )
+/**
+ * @brief Reads the time of the week from the DS3231.
+ *
+ * @param pWeekTime Pointer to store the seconds since Monday 00:00.
+ * @return true if the DS3231 answered with a valid time, false otherwise.
+ */
+static bool rtcClock_read( uint32_t* const pWeekTime )
+{
+    uint8_t time[4];
+    uint8_t status;
+
+    if (    !rtcClock_readRegisters( DS3231_REG_SECONDS, time, sizeof( time ) )
+         || !rtcClock_readRegisters( DS3231_REG_STATUS, &status, 1 )
+         || ( status & DS3231_STATUS_OSF )
+         || ( time[3] < 1 ) || ( time[3] > 7 ) )
+    {
+        return false;
+    }
+
+    *pWeekTime =   ( time[3] - 1 ) * RTC_CLOCK_DAY
+                 + rtcClock_fromBcd( time[2] & 0x3F ) * 3600UL
+                 + rtcClock_fromBcd( time[1] & 0x7F ) * 60UL
+                 + rtcClock_fromBcd( time[0] & 0x7F );
+
+    return true;
+}
+
+
+/**
+ * @brief Writes the time of the week to the DS3231 in 24 hour mode and clears the oscillator stop flag.
+ *
+ * @param weekTime The seconds since Monday 00:00.
+ * @return true if the DS3231 answered, false otherwise.
+ */
+static bool rtcClock_write( uint32_t weekTime )
+{
+    const uint32_t dayTime = weekTime % RTC_CLOCK_DAY;
+    uint8_t        status;
+
+    Wire.beginTransmission( RTC_CLOCK_I2C_ADDRESS );
+    Wire.write( DS3231_REG_SECONDS );
+    Wire.write( rtcClock_toBcd( dayTime % 60 ) );
+    Wire.write( rtcClock_toBcd( ( dayTime / 60 ) % 60 ) );
+    Wire.write( rtcClock_toBcd( dayTime / 3600 ) );
+    Wire.write( (uint8_t) ( weekTime / RTC_CLOCK_DAY + 1 ) );
+
+    if ( ( Wire.endTransmission() != 0 ) || !rtcClock_readRegisters( DS3231_REG_STATUS, &status, 1 ) )
+    {
+        return false;
+    }
+
+    Wire.beginTransmission( RTC_CLOCK_I2C_ADDRESS );
+    Wire.write( DS3231_REG_STATUS );
+    Wire.write( (uint8_t) ( status & ~DS3231_STATUS_OSF ) );
+
+    return Wire.endTransmission() == 0;
+}
+
+
+/**
+ * @brief Reads consecutive registers of the DS3231.
+ *
+ * @param reg The first register.
+ * @param pData Pointer to store the registers.
+ * @param length The number of registers.
+ * @return true if the DS3231 answered, false otherwise.
+ */
+static bool rtcClock_readRegisters( uint8_t reg, uint8_t* const pData, uint8_t length )
+{
+    Wire.beginTransmission( RTC_CLOCK_I2C_ADDRESS );
+    Wire.write( reg );
+
+    if (    ( Wire.endTransmission() != 0 )
+         || ( Wire.requestFrom( (uint8_t) RTC_CLOCK_I2C_ADDRESS, length ) != length ) )
+    {
+        return false;
+    }
+
+    for ( uint8_t i = 0; i < length; i++ )
+    {
+        pData[i] = Wire.read();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Converts a BCD register value to binary.
+ *
+ * @param value The BCD value.
+ * @return uint8_t The binary value.
+ */
+static uint8_t rtcClock_fromBcd( uint8_t value )
+{
+    return ( value >> 4 ) * 10 + ( value & 0x0F );
+}
+
+
+/**
+ * @brief Converts a binary value to a BCD register value.
+ *
+ * @param value The binary value, 0..99.
+ * @return uint8_t The BCD value.
+ */
+static uint8_t rtcClock_toBcd( uint8_t value )
+{
+    return (uint8_t) ( ( ( value / 10 ) << 4 ) | ( value % 10 ) );
+}
+
+#elif defined( ARDUINO_ARCH_RENESAS )
+/**
+ * @brief Reads the time of the week from the real time clock of the microcontroller.
+ *
+ * @param pWeekTime Pointer to store the seconds since Monday 00:00.
+ * @return true if the real time clock is running, false otherwise.
+ */
+static bool rtcClock_read( uint32_t* const pWeekTime )
+{
+    RTCTime time;
+
+    if ( !RTC.isRunning() || !RTC.getTime( time ) )
+    {
+        return false;
+    }
+
+    /* The day of the week counts from Sunday = 0 */
+    const uint8_t day = ( static_cast<uint8_t>( time.getDayOfWeek() ) + 6 ) % 7;
+
+    *pWeekTime = day * RTC_CLOCK_DAY + time.getHour() * 3600UL + time.getMinutes() * 60UL + time.getSeconds();
+
+    return true;
+}
+
+
+/**
+ * @brief Writes the time of the week to the real time clock of the microcontroller.
+ *
+ * The date is set to the first week of January 2024, which starts on a Monday, so the
+ * date matches the day of the week.
+ *
+ * @param weekTime The seconds since Monday 00:00.
+ * @return true if the time was set, false otherwise.
+ */
+static bool rtcClock_write( uint32_t weekTime )
+{
+    const uint8_t  day     = weekTime / RTC_CLOCK_DAY;
+    const uint32_t dayTime = weekTime % RTC_CLOCK_DAY;
+    RTCTime        time( day + 1, Month::JANUARY, 2024, dayTime / 3600, ( dayTime / 60 ) % 60, dayTime % 60,
+                         static_cast<DayOfWeek>( ( day + 1 ) % 7 ), SaveLight::SAVING_TIME_INACTIVE );
+
+    return RTC.setTime( time );
+}
+
+#else
+/**
+ * @brief Without a real time clock, the time set with the CLI keeps running on the hardware clock.
+ *
+ * @param pWeekTime Pointer to store the seconds since Monday 00:00.
+ * @return false
+ */
+static bool rtcClock_read( uint32_t* const pWeekTime )
+{
+    return false;
+}
+
+
+/**
+ * @brief Without a real time clock, nothing is written.
+ *
+ * @param weekTime The seconds since Monday 00:00.
+ * @return true
+ */
+static bool rtcClock_write( uint32_t weekTime )
+{
+    return true;
+}
+#endif
@@ -0,0 +1,32 @@
+/**
+ * \file    rtcClock.h
+ * \brief   Header file for the real time clock
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef RTC_CLOCK_H
+#define RTC_CLOCK_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define RTC_CLOCK_WEEK              604800UL /*!< Length of a week @unit s */
+#define RTC_CLOCK_DAY               86400UL  /*!< Length of a day @unit s */
+#define RTC_CLOCK_SYNC_INTERVAL     600000UL /*!< Interval of reading the real time clock @unit ms */
+#define RTC_CLOCK_I2C_ADDRESS       0x68     /*!< I2C address of the DS3231 on the Mega */
+#define RTC_CLOCK_I2C_TIMEOUT       3000     /*!< Longest wait for the I2C bus, a stuck bus is reset after it @unit us */
+
+/******************************** Function prototype ************************************/
+
+void     rtcClock_setup( void );
+void     rtcClock_process( void );
+bool     rtcClock_isValid( void );
+uint32_t rtcClock_getWeekTime( void );
+bool     rtcClock_setWeekTime( uint32_t weekTime );
+
+#endif  // RTC_CLOCK_H
@@ -0,0 +1,197 @@
+/**
+ * \file    schedMan.cpp
+ * \brief   Source file for the access schedules
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <ArduinoLog.h>
+#include "schedMan.h"
+#include "rtcClock.h"
+#include "sysClock.h"
+
+/*
+ * The access schedule of a door is a bitmap in the settings: one bit per slot of
+ * SCHED_SLOT_LENGTH minutes and day of the week. A set bit keeps the door locked in that
+ * slot, so the default schedule of the settings, all bits cleared, never locks a door.
+ *
+ * The bitmap is only read when a slot begins, or the schedule or the clock changed. The
+ * result is cached for every door, so the check before an unlock is a single flag.
+ * While the clock isn't set the schedules aren't applied, so an unset clock doesn't lock
+ * anybody in the airlock.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define SCHED_SLOT_SECONDS          ( SCHED_SLOT_LENGTH * 60UL ) /*!< Length of a slot @unit s */
+#define SCHED_CLOCK_RETRY           1000UL                       /*!< Interval of checking an unset clock @unit ms */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The schedule management structure
+ */
+typedef struct
+{
+    bool     open[DOOR_TYPE_SIZE]; /*!< The doors may be unlocked in the current slot */
+    bool     stale;                /*!< The schedule or the clock changed */
+    uint32_t slotStart;            /*!< The hardware clock when the current slot was evaluated @unit ms */
+    uint32_t slotRemaining;        /*!< Time until the next slot begins @unit ms */
+} sched_man_t;
+
+
+/**************************** Static Function prototype *********************************/
+
+static bool schedMan_isAccessAllowed( door_control_t* const pDoorControl, door_type_t door );
+
+
+/******************************** Global variables ************************************/
+
+static sched_man_t sched; /*!< The access schedules */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Sets up the access schedules of a door control instance.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ */
+void schedMan_setup( door_control_t* const pDoorControl )
+{
+    schedMan_update();
+    schedMan_process();
+
+    pDoorControl->accessWindow = schedMan_isAccessAllowed;
+}
+
+
+/**
+ * @brief Evaluates the schedules when a slot begins or something changed.
+ *
+ * Must be called once per main loop iteration.
+ */
+void schedMan_process( void )
+{
+    const uint32_t now = sysClock_millis();
+
+    if ( !sched.stale && ( ( now - sched.slotStart ) < sched.slotRemaining ) )
+    {
+        return;
+    }
+
+    sched.stale     = false;
+    sched.slotStart = now;
+
+    if ( !rtcClock_isValid() )
+    {
+        sched.open[DOOR_TYPE_DOOR_1] = true;
+        sched.open[DOOR_TYPE_DOOR_2] = true;
+        sched.slotRemaining          = SCHED_CLOCK_RETRY;
+        return;
+    }
+
+    const uint32_t weekTime = rtcClock_getWeekTime();
+    const uint16_t slot     = weekTime / SCHED_SLOT_SECONDS;
+
+    sched.slotRemaining = ( SCHED_SLOT_SECONDS - ( weekTime % SCHED_SLOT_SECONDS ) ) * 1000UL;
+
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        const bool open = schedMan_isSlotOpen( appSettings_getSettings(), (door_type_t) door, slot / SCHED_SLOTS_PER_DAY, slot % SCHED_SLOTS_PER_DAY );
+
+        if ( open != sched.open[door] )
+        {
+            sched.open[door] = open;
+            Log.noticeln( "%s: Door %d %s by the schedule", __func__, door + 1, open ? "opened" : "locked" );
+        }
+    }
+}
+
+
+/**
+ * @brief Evaluates the schedules again at the next processing step.
+ *
+ * Must be called after the schedule or the clock changed.
+ */
+void schedMan_update( void )
+{
+    sched.stale = true;
+}
+
+
+/**
+ * @brief Checks whether the schedule allows to unlock a door now.
+ *
+ * @param door The door.
+ * @return true if the door may be unlocked in the current slot.
+ */
+bool schedMan_isOpen( door_type_t door )
+{
+    return sched.open[door];
+}
+
+
+/**
+ * @brief Checks whether a schedule allows to unlock a door in a slot.
+ *
+ * @param pSettings Pointer to the settings holding the schedule.
+ * @param door The door.
+ * @param day The day of the week, 0 = Monday.
+ * @param slot The slot of the day.
+ * @return true if the door may be unlocked in the slot.
+ */
+bool schedMan_isSlotOpen( const settings_t* const pSettings, door_type_t door, uint8_t day, uint8_t slot )
+{
+    return ( pSettings->lockedSlots[door][day][slot >> 3] & ( 1 << ( slot & 7 ) ) ) == 0;
+}
+
+
+/**
+ * @brief Opens or locks a door in a window of a schedule.
+ *
+ * @param pSettings Pointer to the settings holding the schedule.
+ * @param door The door.
+ * @param day The day of the week, 0 = Monday.
+ * @param firstSlot The first slot of the window.
+ * @param endSlot The slot after the window, up to SCHED_SLOTS_PER_DAY.
+ * @param open true to allow unlocking the door in the window, false to keep it locked.
+ */
+void schedMan_setWindow( settings_t* const pSettings, door_type_t door, uint8_t day, uint8_t firstSlot, uint8_t endSlot, bool open )
+{
+    uint8_t* const pDay = pSettings->lockedSlots[door][day];
+
+    for ( uint8_t slot = firstSlot; slot < endSlot; slot++ )
+    {
+        if ( open )
+        {
+            pDay[slot >> 3] &= (uint8_t) ~( 1 << ( slot & 7 ) );
+        }
+        else
+        {
+            pDay[slot >> 3] |= (uint8_t) ( 1 << ( slot & 7 ) );
+        }
+    }
+}
+
+
+/**
+ * @brief Asked before a door is unlocked, checks the cached schedule.
+ *
+ * A replayed trace was recorded at another time, so the replayed instance has no
+ * access window and the schedules aren't applied to it.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param door The door to unlock.
+ * @return true if the door may be unlocked now.
+ */
+static bool schedMan_isAccessAllowed( door_control_t* const pDoorControl, door_type_t door )
+{
+    return sched.open[door];
+}
@@ -0,0 +1,27 @@
+/**
+ * \file    schedMan.h
+ * \brief   Header file for the access schedules
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef SCHEDULE_MANAGEMENT_H
+#define SCHEDULE_MANAGEMENT_H
+
+#include <Arduino.h>
+#include "stateMan.h"
+#include "appSettings.h"
+
+/******************************** Function prototype ************************************/
+
+void schedMan_setup( door_control_t* const pDoorControl );
+void schedMan_process( void );
+void schedMan_update( void );
+bool schedMan_isOpen( door_type_t door );
+bool schedMan_isSlotOpen( const settings_t* const pSettings, door_type_t door, uint8_t day, uint8_t slot );
+void schedMan_setWindow( settings_t* const pSettings, door_type_t door, uint8_t day, uint8_t firstSlot, uint8_t endSlot, bool open );
+
+#endif  // SCHEDULE_MANAGEMENT_H
@@ -0,0 +1,136 @@
+/**
+ * \file    seqMan.cpp
+ * \brief   Source file for the event driven sequences
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "seqMan.h"
+#include "sysClock.h"
+
+/*
+ * A sequence runs its body until the first wait when it is started. From then on, the
+ * body is only called again when a signal it waits for is posted, or when its deadline
+ * expires. The owner posts the signals and calls seqMan_process() once per processing
+ * step, which costs a single flag check for a sequence without a deadline.
+ */
+
+
+/**************************** Static Function prototype *********************************/
+
+static void seqMan_resume( seq_t* const pSeq, uint8_t signal, uint32_t now );
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Starts a sequence at the beginning of its body.
+ *
+ * The body runs until its first wait.
+ *
+ * @param pSeq The sequence.
+ * @param body The sequence body.
+ * @param pContext The owner of the sequence, available to the body.
+ * @param id Identifies the sequence within its owner.
+ * @param now The current time @unit ms
+ */
+void seqMan_start( seq_t* const pSeq, pt_result_t ( *body )( seq_t* const pSeq ), void* pContext, uint8_t id, uint32_t now )
+{
+    memset( pSeq, 0, sizeof( seq_t ) );
+    PT_INIT( &pSeq->pt );
+    pSeq->body     = body;
+    pSeq->pContext = pContext;
+    pSeq->id       = id;
+
+    seqMan_resume( pSeq, 0, now );
+}
+
+
+/**
+ * @brief Posts a signal to a sequence.
+ *
+ * The sequence is resumed if it waits for the signal, otherwise the signal is dropped.
+ *
+ * @param pSeq The sequence.
+ * @param signal The signal, a single bit.
+ * @param now The current time @unit ms
+ */
+void seqMan_post( seq_t* const pSeq, uint8_t signal, uint32_t now )
+{
+    if ( ( pSeq->awaitSignals & signal ) != 0 )
+    {
+        seqMan_resume( pSeq, signal, now );
+    }
+}
+
+
+/**
+ * @brief Resumes a sequence whose deadline expired.
+ *
+ * @param pSeq The sequence.
+ * @param now The current time @unit ms
+ */
+void seqMan_process( seq_t* const pSeq, uint32_t now )
+{
+    if ( pSeq->deadlineActive && sysClock_isExpired( now, pSeq->deadline ) )
+    {
+        seqMan_resume( pSeq, 0, now );
+    }
+}
+
+
+/**
+ * @brief Sets up the wait of a sequence, see SEQ_AWAIT() and SEQ_AWAIT_TIMEOUT().
+ *
+ * @param pSeq The sequence.
+ * @param signals The signals that end the wait, bit mask.
+ * @param deadlineActive The wait ends after the timeout.
+ * @param timeout The timeout @unit ms
+ */
+void seqMan_await( seq_t* const pSeq, uint8_t signals, bool deadlineActive, uint32_t timeout )
+{
+    pSeq->awaitSignals   = signals;
+    pSeq->deadlineActive = deadlineActive;
+    pSeq->deadline       = pSeq->now + timeout;
+    pSeq->waitStart      = pSeq->now;
+}
+
+
+/**
+ * @brief Returns the time at which the wait of a sequence times out.
+ *
+ * @param pSeq The sequence.
+ * @param pDeadline Pointer to store the deadline @unit ms
+ * @return true if the sequence waits with a timeout, false otherwise.
+ */
+bool seqMan_getDeadline( const seq_t* const pSeq, uint32_t* pDeadline )
+{
+    if ( pSeq->deadlineActive )
+    {
+        *pDeadline = pSeq->deadline;
+    }
+
+    return pSeq->deadlineActive;
+}
+
+
+/**
+ * @brief Runs the sequence body until its next wait.
+ *
+ * @param pSeq The sequence.
+ * @param signal The signal that ends the wait, 0 for the deadline.
+ * @param now The current time @unit ms
+ */
+static void seqMan_resume( seq_t* const pSeq, uint8_t signal, uint32_t now )
+{
+    pSeq->awaitSignals   = 0;
+    pSeq->deadlineActive = false;
+    pSeq->signal         = signal;
+    pSeq->now            = now;
+
+    pSeq->body( pSeq );
+}
@@ -0,0 +1,80 @@
+/**
+ * \file    seqMan.h
+ * \brief   Header file for the event driven sequences
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef SEQUENCE_MANAGEMENT_H
+#define SEQUENCE_MANAGEMENT_H
+
+#include <Arduino.h>
+#include "pt.h"
+
+/*************************************** Defines ****************************************/
+
+/**
+ * @brief Waits until one of the signals is posted.
+ * @details A sequence waiting without a timeout costs nothing until a signal arrives.
+ */
+#define SEQ_AWAIT( pSeq, signals )                                                           \
+    do                                                                                       \
+    {                                                                                        \
+        seqMan_await( ( pSeq ), ( signals ), false, 0 );                                     \
+        PT_YIELD( &( pSeq )->pt );                                                           \
+    } while ( 0 )
+
+/**
+ * @brief Waits until one of the signals is posted or the timeout expires.
+ * @details The timeout is counted from the time of the call @unit ms
+ */
+#define SEQ_AWAIT_TIMEOUT( pSeq, signals, timeout )                                          \
+    do                                                                                       \
+    {                                                                                        \
+        seqMan_await( ( pSeq ), ( signals ), true, ( timeout ) );                            \
+        PT_YIELD( &( pSeq )->pt );                                                           \
+    } while ( 0 )
+
+/**
+ * @brief True if the last wait ended by its timeout instead of a signal.
+ */
+#define SEQ_TIMED_OUT( pSeq )   ( ( pSeq )->signal == 0 )
+
+/************************************* STRUCTURE **************************************/
+
+typedef struct seq seq_t;
+
+/**
+ * @brief The sequence structure
+ * @details A sequence is a protothread that is only resumed when a signal it waits for is
+ *          posted or its deadline expires.
+ */
+struct seq
+{
+    pt_t     pt;             /*!< The position in the sequence body */
+    uint8_t  id;             /*!< Identifies the sequence within its owner */
+    uint8_t  awaitSignals;   /*!< The signals that resume the sequence, bit mask */
+    uint8_t  signal;         /*!< The signal that resumed the sequence, 0 if the deadline expired */
+    bool     deadlineActive; /*!< The deadline is running */
+    uint32_t deadline;       /*!< The time at which the wait times out @unit ms */
+    uint32_t waitStart;      /*!< The time at which the current wait started @unit ms */
+    uint32_t now;            /*!< The time at which the sequence is resumed @unit ms */
+    void*    pContext;       /*!< The owner of the sequence */
+
+    /*!< The sequence body */
+    pt_result_t ( *body )( seq_t* const pSeq );
+};
+
+
+/******************************** Function prototype ************************************/
+
+void seqMan_start( seq_t* const pSeq, pt_result_t ( *body )( seq_t* const pSeq ), void* pContext, uint8_t id, uint32_t now );
+void seqMan_post( seq_t* const pSeq, uint8_t signal, uint32_t now );
+void seqMan_process( seq_t* const pSeq, uint32_t now );
+void seqMan_await( seq_t* const pSeq, uint8_t signals, bool deadlineActive, uint32_t timeout );
+bool seqMan_getDeadline( const seq_t* const pSeq, uint32_t* pDeadline );
+
+#endif  // SEQUENCE_MANAGEMENT_H
@@ -8,18 +8,27 @@
  *  Copyright (c) 2024 Mathias Buder
  */
 
-#include <TimerOne.h>
-
 #include "stateMan.h"
 #include "ioMan.h"
+#include "ledMan.h"
 #include "logging.h"
+#include "sysClock.h"
+#include "wdtMan.h"
+#include "latMon.h"
+
+
+/*************************************** Defines ****************************************/
+
+#define STATE_MAN_DEFER( event )    ( 1UL << ( event ) ) /*!< Bit of an event in the deferred events of a state */
+
+static_assert( DOOR_CONTROL_EVENT_SIZE <= HSM_DEFER_EVENTS, "Every door control event must be deferrable" );
 
 
 /**************************** Static Function prototype *********************************/
 
 static state_machine_result_t initHandler( state_machine_t* const pState, const uint32_t event );
 static state_machine_result_t initEntryHandler( state_machine_t* const pState, const uint32_t event );
-/* static state_machine_result_t initExitHandler( state_machine_t* const pState, const uint32_t event ); */
+static state_machine_result_t initExitHandler( state_machine_t* const pState, const uint32_t event );
 
 static state_machine_result_t idleHandler( state_machine_t* const pState, const uint32_t event );
 static state_machine_result_t idleEntryHandler( state_machine_t* const pState, const uint32_t event );
@@ -43,25 +52,29 @@ static state_machine_result_t door2OpenHandler( state_machine_t* const pState, c
 static state_machine_result_t door2OpenEntryHandler( state_machine_t* const pState, const uint32_t event );
 static state_machine_result_t door2OpenExitHandler( state_machine_t* const pState, const uint32_t event );
 
-static void                   faultBlinkLedIsrHandler( void );
-static void                   door1BlinkLedIsrHandler( void );
-static void                   door2BlinkLedIsrHandler( void );
-static void                   doorOpenTimeoutHandler( uint32_t time );
-static void                   doorUnlockTimeoutHandler( uint32_t time );
+static state_machine_result_t emergencyHandler( state_machine_t* const pState, const uint32_t event );
+static state_machine_result_t emergencyEntryHandler( state_machine_t* const pState, const uint32_t event );
+static state_machine_result_t emergencyExitHandler( state_machine_t* const pState, const uint32_t event );
+
+static pt_result_t            doorSequence( seq_t* const pSeq );
+static pt_result_t            initSequence( seq_t* const pSeq );
 
 
 /******************************** Global variables ************************************/
 
 /**
  * @brief The state machine for the door control
- * @details The state machine is defined as an array of states and its handlers
+ * @details The state machine is defined as an array of states and its handlers. While a
+ *          door is unlocked or open, the unlock request of the other door is deferred: it
+ *          is dispatched once the door is locked again, unless it expired before. The idle
+ *          state then asks the access window and the unlock gate again.
  */
 static const state_t doorControlStates[] = {
 
     [DOOR_CONTROL_STATE_INIT] = {
         .Handler = initHandler,
         .Entry   = initEntryHandler,
-        .Exit    = NULL,
+        .Exit    = initExitHandler,
         .Id      = DOOR_CONTROL_STATE_INIT
     },
 
@@ -80,58 +93,73 @@ static const state_t doorControlStates[] = {
     },
 
     [DOOR_CONTROL_STATE_DOOR_1_UNLOCKED] = {
-        .Handler = door1UnlockHandler,
-        .Entry   = door1UnlockEntryHandler,
-        .Exit    = door1UnlockExitHandler,
-        .Id      = DOOR_CONTROL_STATE_DOOR_1_UNLOCKED
+        .Handler  = door1UnlockHandler,
+        .Entry    = door1UnlockEntryHandler,
+        .Exit     = door1UnlockExitHandler,
+        .Deferred = STATE_MAN_DEFER( DOOR_CONTROL_EVENT_DOOR_2_UNLOCK ),
+        .Id       = DOOR_CONTROL_STATE_DOOR_1_UNLOCKED
     },
 
     [DOOR_CONTROL_STATE_DOOR_1_OPEN] = {
-        .Handler = door1OpenHandler,
-        .Entry   = door1OpenEntryHandler,
-        .Exit    = door1OpenExitHandler,
-        .Id      = DOOR_CONTROL_STATE_DOOR_1_OPEN
+        .Handler  = door1OpenHandler,
+        .Entry    = door1OpenEntryHandler,
+        .Exit     = door1OpenExitHandler,
+        .Deferred = STATE_MAN_DEFER( DOOR_CONTROL_EVENT_DOOR_2_UNLOCK ),
+        .Id       = DOOR_CONTROL_STATE_DOOR_1_OPEN
     },
 
     [DOOR_CONTROL_STATE_DOOR_2_UNLOCKED] = {
-        .Handler = door2UnlockHandler,
-        .Entry   = door2UnlockEntryHandler,
-        .Exit    = door2UnlockExitHandler,
-        .Id      = DOOR_CONTROL_STATE_DOOR_2_UNLOCKED
+        .Handler  = door2UnlockHandler,
+        .Entry    = door2UnlockEntryHandler,
+        .Exit     = door2UnlockExitHandler,
+        .Deferred = STATE_MAN_DEFER( DOOR_CONTROL_EVENT_DOOR_1_UNLOCK ),
+        .Id       = DOOR_CONTROL_STATE_DOOR_2_UNLOCKED
     },
 
     [DOOR_CONTROL_STATE_DOOR_2_OPEN] = {
-        .Handler = door2OpenHandler,
-        .Entry   = door2OpenEntryHandler,
-        .Exit    = door2OpenExitHandler,
-        .Id      = DOOR_CONTROL_STATE_DOOR_2_OPEN
+        .Handler  = door2OpenHandler,
+        .Entry    = door2OpenEntryHandler,
+        .Exit     = door2OpenExitHandler,
+        .Deferred = STATE_MAN_DEFER( DOOR_CONTROL_EVENT_DOOR_1_UNLOCK ),
+        .Id       = DOOR_CONTROL_STATE_DOOR_2_OPEN
+    },
+
+    [DOOR_CONTROL_STATE_EMERGENCY] = {
+        .Handler = emergencyHandler,
+        .Entry   = emergencyEntryHandler,
+        .Exit    = emergencyExitHandler,
+        .Id      = DOOR_CONTROL_STATE_EMERGENCY
     }
 };
 
 
 /**
- * @brief The door control state machine
- * @details The door control state machine is defined with the state machine and the door timers.
- *          The state machine is initialized with the init-state and no event.
+ * @brief The door control instance owning the leds
+ * @details The leds are shared hardware, so only the instance passed to stateMan_setup()
+ *          selects the led pattern.
  */
-door_control_t doorControl = {
-    .machine = { NULL, NULL },
-    .doorTimer = {
-                    { doorUnlockTimeoutHandler, (uint32_t) DOOR_UNLOCK_TIMEOUT * 1000, 0 },
-                    { doorOpenTimeoutHandler,   (uint32_t) DOOR_OPEN_TIMEOUT   * 1000, 0 }
-                }
-};
+static door_control_t* pLedDoorControl = NULL;
 
 /**
- * @brief The array of state machines
- * @details The array of state machines is used to dispatch the event to the state machines.
+ * @brief The open timeout event of each door, indexed by door_type_t
  */
-state_machine_t* const stateMachines[] = {(state_machine_t*) &doorControl};
+static const door_control_event_t doorOpenTimeoutEvent[DOOR_TYPE_SIZE] = {
+    DOOR_CONTROL_EVENT_DOOR_1_OPEN_TIMEOUT,
+    DOOR_CONTROL_EVENT_DOOR_2_OPEN_TIMEOUT
+};
 
 /**************************** Static Function prototype *********************************/
 
 static void stateMan_generateEvent( door_control_t* const pDoorControl );
-static void stateMan_processTimers( door_control_t* const pDoorControl );
+static void stateMan_startSequences( door_control_t* const pDoorControl );
+static void stateMan_processSequences( door_control_t* const pDoorControl );
+static void stateMan_checkInterlock( door_control_t* const pDoorControl );
+static bool stateMan_isUnlockGranted( door_control_t* const pDoorControl, door_type_t door );
+static input_state_t stateMan_getUnlockRequest( door_control_t* const pDoorControl, door_type_t door, input_state_t button );
+static void stateMan_setLedPattern( const door_control_t* const pDoorControl, led_pattern_type_t pattern );
+static void stateMan_eventLogger( state_machine_t* const pStateMachine, uint32_t state, const event_t* const pEvent );
+static void stateMan_dispatchEvents( door_control_t* const pDoorControl );
+static bool stateMan_isBudgetLeft( state_machine_t* const pStateMachine, const event_t* const pEvent );
 
 
 /******************************** Function definition ************************************/
@@ -140,21 +168,48 @@ static void stateMan_processTimers( door_control_t* const pDoorControl );
 /**
  * @brief Sets up the state manager.
  *
- * This function initializes the LED blink timer with an interval specified
- * by the settings.ledBlinkInterval. It also initializes the state machine
- * by switching to the initial state defined in doorControlStates.
+ * This function binds the given door control instance to the magnets and the
+ * leds and initializes it.
+ *
+ * @param pDoorControl Pointer to the door control instance driving the hardware.
  */
-void stateMan_setup( void )
+void stateMan_setup( door_control_t* const pDoorControl )
 {
     Log.noticeln( "%s: Setting up the state manager", __func__ );
 
-    /* Initialize timers */
-    Timer1.initialize( ( (uint32_t) 2000 ) * ( (uint32_t) appSettings_getSettings()->ledBlinkInterval ) );
-    stateMan_setDoorTimer( DOOR_TIMER_TYPE_UNLOCK, appSettings_getSettings()->doorUnlockTimeout );
-    stateMan_setDoorTimer( DOOR_TIMER_TYPE_OPEN, appSettings_getSettings()->doorOpenTimeout );
+    pLedDoorControl = pDoorControl;
+
+    stateMan_init( pDoorControl, sysClock_millis() );
+    ioMan_bindOutputs( &pDoorControl->io );
+}
+
+
+/**
+ * @brief Initializes a door control instance.
+ *
+ * This function initializes the door timers and the input/output context from the
+ * application settings and starts the state machine in the init state.
+ *
+ * @param pDoorControl Pointer to the door control instance to initialize.
+ * @param now The time of the instance @unit ms
+ */
+void stateMan_init( door_control_t* const pDoorControl, const uint32_t now )
+{
+    memset( pDoorControl, 0, sizeof( door_control_t ) );
+
+    /* Initialize the input/output context */
+    ioMan_init( &pDoorControl->io );
+    pDoorControl->io.now = now;
+
+    /* Initialize the timeouts and start the sequences */
+    stateMan_setDoorTimer( pDoorControl, DOOR_TIMER_TYPE_UNLOCK, appSettings_getSettings()->doorUnlockTimeout );
+    stateMan_setDoorTimer( pDoorControl, DOOR_TIMER_TYPE_OPEN, appSettings_getSettings()->doorOpenTimeout );
+    stateMan_setDispatchBudget( pDoorControl, appSettings_getSettings()->dispatchMaxEvents, appSettings_getSettings()->dispatchMaxTime );
+    stateMan_setDeferMaxAge( pDoorControl, appSettings_getSettings()->deferMaxAge );
+    stateMan_startSequences( pDoorControl );
 
     /* Initialize the state machine */
-    switch_state( &doorControl.machine, &doorControlStates[DOOR_CONTROL_STATE_INIT] );
+    switch_state( &pDoorControl->machine, &doorControlStates[DOOR_CONTROL_STATE_INIT] );
 }
 
 
@@ -163,22 +218,35 @@ void stateMan_setup( void )
  *
  * This function performs the following tasks:
  * 1. Generates and processes events related to the door control.
- * 2. Processes door open timers.
- * 3. Dispatches the event to the state machine and logs an error if the event is not handled.
+ * 2. Resumes the door sequences whose timeout expired.
+ * 3. Dispatches the queued events within the dispatch budget, the rest waits for the next step.
+ * 4. Checks the door interlock.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param now The time of this processing step @unit ms
  */
-void stateMan_process( void )
+void stateMan_process( door_control_t* const pDoorControl, const uint32_t now )
 {
-    /* Generate/Process events */
-    stateMan_generateEvent( &doorControl );
-
-    /* Process door open timers */
-    stateMan_processTimers( &doorControl );
+    /* All consumers of this step see the same time */
+    pDoorControl->io.now = now;
 
-    /* Dispatch the event to the state machine */
-    if ( dispatch_event( stateMachines, 1, logging_eventLogger, logging_resultLogger ) == EVENT_UN_HANDLED )
-    {
-        Log.errorln( "Event is not handled" );
-    }
+    /* Generate/Process events */
+    wdtMan_beginStage( WDT_STAGE_EVENTS );
+    stateMan_generateEvent( pDoorControl );
+    wdtMan_endStage( WDT_STAGE_EVENTS );
+
+    /* Resume the sequences whose timeout expired */
+    wdtMan_beginStage( WDT_STAGE_TIMERS );
+    stateMan_processSequences( pDoorControl );
+    wdtMan_endStage( WDT_STAGE_TIMERS );
+
+    /* Dispatch the events to the state machine */
+    wdtMan_beginStage( WDT_STAGE_DISPATCH );
+    stateMan_dispatchEvents( pDoorControl );
+    wdtMan_endStage( WDT_STAGE_DISPATCH );
+
+    /* Check the door interlock after every step */
+    stateMan_checkInterlock( pDoorControl );
 }
 
 
@@ -191,59 +259,22 @@ void stateMan_process( void )
  */
 static state_machine_result_t initEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
-
-    /* Initialize both doors to locked */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
-    ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
-
-    /* Check whether the door switches are debouncing. This "waiting" mechanism is only used
-     * for the initialization as the door switches are checked here in an one-shot manner. If
-     * the switches are not stable within the timeout, the state machine switches to the fault state.
-     */
-    input_status_t door1SwitchStatus, door2SwitchStatus;
-    uint64_t        currentTime = millis();
-
-    do {
-        door1SwitchStatus = ioMan_getDoorState( IO_SWITCH_1 );
-        door2SwitchStatus = ioMan_getDoorState( IO_SWITCH_2 );
-
-        if ( ( millis() - currentTime ) >= DEBOUNCE_STABLE_TIMEOUT )
-        {
-            Log.errorln( "Door switches wheren't stable within %d ms", DEBOUNCE_STABLE_TIMEOUT );
-
-            /* Switch to fault state */
-            return switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
-        }
-    }
-    while (    ( door1SwitchStatus.debounce == INPUT_DEBOUNCE_UNSTABLE )
-            || ( door2SwitchStatus.debounce == INPUT_DEBOUNCE_UNSTABLE ) );
-    
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-     /* Get pointer to the current event */
-    event_t** pCurrentEvent = &pState->event;
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    if (    ( door1SwitchStatus.state == INPUT_STATE_ACTIVE )
-         && ( door2SwitchStatus.state == INPUT_STATE_ACTIVE) )
-    {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE );
-    }
+    /* Initialize both doors to locked */
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_OFF );
 
-    if ( door1SwitchStatus.state == INPUT_STATE_INACTIVE )
-    {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_OPEN );
-    }
-
-    if ( door2SwitchStatus.state == INPUT_STATE_INACTIVE )
-    {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_2_OPEN );
-    }
+    /* Start waiting for the door switches to become stable */
+    seqMan_post( &pDoorControl->initSequence, DOOR_SIGNAL_INIT, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
 
 
-
 /**
  * @brief Handler for the init state
  * 
@@ -253,7 +284,9 @@ static state_machine_result_t initEntryHandler( state_machine_t* const pState, c
  */
 static state_machine_result_t initHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     switch ( event )
     {
@@ -264,6 +297,13 @@ static state_machine_result_t initHandler( state_machine_t* const pState, const
     case DOOR_CONTROL_EVENT_DOOR_2_OPEN:
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
         break;
+    case DOOR_CONTROL_EVENT_INIT_TIMEOUT:
+        Log.errorln( "%s: Door switches weren't stable within %d ms", __func__, pDoorControl->doorTimeout[DOOR_TIMER_TYPE_INIT] );
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
+        break;
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+        break;
     default:
        break;
     }
@@ -272,13 +312,26 @@ static state_machine_result_t initHandler( state_machine_t* const pState, const
 }
 
 
-/*
-static state_machine_result_t initExitHandler( state_machine_t* const pState )
+/**
+ * @brief Handler for the init state exit
+ *
+ * @param pState - The state machine
+ * @param event - The event
+ * @return state_machine_result_t - The result of the handler
+ */
+static state_machine_result_t initExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    /* The init sequence stores how long the initialization took */
+    seqMan_post( &pDoorControl->initSequence, DOOR_SIGNAL_INIT_DONE, pDoorControl->io.now );
+
+    Log.noticeln( "%s: Initialization took %d ms", __func__, pDoorControl->initDuration );
+
     return EVENT_HANDLED;
 }
-*/
 
 
 /**
@@ -290,11 +343,12 @@ static state_machine_result_t initExitHandler( state_machine_t* const pState )
  */
 static state_machine_result_t idleEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     /* Set both door leds to white */
-    ioMan_setLed( true, DOOR_TYPE_DOOR_1, LED_COLOR_WHITE );
-    ioMan_setLed( true, DOOR_TYPE_DOOR_2, LED_COLOR_WHITE );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_IDLE );
 
     return EVENT_HANDLED;
 }
@@ -309,19 +363,36 @@ static state_machine_result_t idleEntryHandler( state_machine_t* const pState, c
  */
 static state_machine_result_t idleHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     /* Process the event */
     switch ( event )
     {
         case DOOR_CONTROL_EVENT_DOOR_1_UNLOCK:
-            return switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_DOOR_1_UNLOCKED] );
         case DOOR_CONTROL_EVENT_DOOR_2_UNLOCK:
-            return switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_DOOR_2_UNLOCKED] );
+        {
+            const door_type_t door = ( event == DOOR_CONTROL_EVENT_DOOR_1_UNLOCK ) ? DOOR_TYPE_DOOR_1 : DOOR_TYPE_DOOR_2;
+
+            /* A deferred request is handled long after it was posted, the access window
+             * may have closed and the unlock gate may have been given to another door
+             * since, so both are asked again. A request that isn't granted anymore is dropped.
+             */
+            if ( !stateMan_isUnlockGranted( pDoorControl, door ) )
+            {
+                Log.noticeln( "%s: Unlock of door %d not granted anymore, request dropped", __func__, door + 1 );
+                break;
+            }
+
+            return switch_state( pState, &doorControlStates[( door == DOOR_TYPE_DOOR_1 ) ? DOOR_CONTROL_STATE_DOOR_1_UNLOCKED : DOOR_CONTROL_STATE_DOOR_2_UNLOCKED] );
+        }
         case DOOR_CONTROL_EVENT_DOOR_1_OPEN:
         case DOOR_CONTROL_EVENT_DOOR_2_OPEN:
         case DOOR_CONTROL_EVENT_DOOR_1_2_OPEN:
             return switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
+        case DOOR_CONTROL_EVENT_EMERGENCY:
+            return switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
         default:
             break;
     }
@@ -329,24 +400,30 @@ static state_machine_result_t idleHandler( state_machine_t* const pState, const
     /* Get the state of the door buttons. The debounce state isn't used here,
      * but it is necessary to call the function.
      */
-    input_state_t door1Button = ioMan_getDoorState( IO_BUTTON_1 ).state;
-    input_state_t door2Button = ioMan_getDoorState( IO_BUTTON_2 ).state;
+    input_state_t door1Button = stateMan_getUnlockRequest( pDoorControl, DOOR_TYPE_DOOR_1, ioMan_getDoorState( &pDoorControl->io, IO_BUTTON_1 ).state );
+    input_state_t door2Button = stateMan_getUnlockRequest( pDoorControl, DOOR_TYPE_DOOR_2, ioMan_getDoorState( &pDoorControl->io, IO_BUTTON_2 ).state );
 
     /* XOR-logic to allow only one door to be open */
     if (    ( door1Button == INPUT_STATE_ACTIVE )
          && ( door2Button == INPUT_STATE_INACTIVE ) )
     {
-        pushEvent( &pState->event, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK );
+        if ( stateMan_isUnlockGranted( pDoorControl, DOOR_TYPE_DOOR_1 ) )
+        {
+            stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+        }
     }
     else if (    ( door1Button == INPUT_STATE_INACTIVE )
               && ( door2Button == INPUT_STATE_ACTIVE ) )
     {
-        pushEvent( &pState->event, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK );
+        if ( stateMan_isUnlockGranted( pDoorControl, DOOR_TYPE_DOOR_2 ) )
+        {
+            stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+        }
     }
     else
     {
-        ioMan_setDoorState( DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
-        ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
+        ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
+        ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
     }
 
     return EVENT_HANDLED;
@@ -362,11 +439,7 @@ static state_machine_result_t idleHandler( state_machine_t* const pState, const
  */
 static state_machine_result_t idleExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
-
-    /* Set both door leds to off */
-    ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-    ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     return EVENT_HANDLED;
 }
@@ -381,10 +454,11 @@ static state_machine_result_t idleExitHandler( state_machine_t* const pState, co
  */
 static state_machine_result_t faultEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    Timer1.attachInterrupt( faultBlinkLedIsrHandler );
-    Timer1.start();
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_FAULT );
 
     return EVENT_HANDLED;
 }
@@ -399,13 +473,16 @@ static state_machine_result_t faultEntryHandler( state_machine_t* const pState,
  */
 static state_machine_result_t faultHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
         switch ( event )
     {
         case DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE:
             switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_IDLE] );
             break;
+        case DOOR_CONTROL_EVENT_EMERGENCY:
+            switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+            break;
         default:
             break;
     }
@@ -423,29 +500,12 @@ static state_machine_result_t faultHandler( state_machine_t* const pState, const
  */
 static state_machine_result_t faultExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
-
-    Timer1.stop();
-    Timer1.detachInterrupt();
-    ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-    ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     return EVENT_HANDLED;
 }
 
 
-/**
- * @brief Handler for the fault led blink
- */
-static void faultBlinkLedIsrHandler( void )
-{
-    static uint8_t ledState = false;
-    ledState                = !ledState;
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_1, LED_COLOR_MAGENTA );
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_2, LED_COLOR_MAGENTA );
-}
-
-
 /**
  * @brief Handler for the door 1 unlock entry
  * 
@@ -455,14 +515,16 @@ static void faultBlinkLedIsrHandler( void )
  */
 static state_machine_result_t door1UnlockEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     /* Unlock the door and start led blink */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_1, LOCK_STATE_UNLOCKED );
-    Timer1.attachInterrupt( door1BlinkLedIsrHandler );
-    Timer1.start();
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_UNLOCKED );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_DOOR_1_RELEASED );
 
-    doorControl.doorTimer[DOOR_TIMER_TYPE_UNLOCK].timeReference = millis();
+    /* Start the unlock timeout */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_1], DOOR_SIGNAL_UNLOCKED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
@@ -477,7 +539,7 @@ static state_machine_result_t door1UnlockEntryHandler( state_machine_t* const pS
  */
 static state_machine_result_t door1UnlockHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     switch ( event )
     {
@@ -487,6 +549,9 @@ static state_machine_result_t door1UnlockHandler( state_machine_t* const pState,
     case DOOR_CONTROL_EVENT_DOOR_1_OPEN:
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_DOOR_1_OPEN] );
         break;
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+        break;
     default:
         break;
     }
@@ -503,24 +568,23 @@ static state_machine_result_t door1UnlockHandler( state_machine_t* const pState,
  */
 static state_machine_result_t door1UnlockExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    /* Only lock the door and disable the led blink if we move back to the idle state */
+    /* Only lock the door if we move back to the idle state */
     const state_t* pNextState = pState->State;
     if ( pNextState->Id == DOOR_CONTROL_STATE_IDLE )
     {
         /* Lock the door */
-        ioMan_setDoorState( DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
-
-        /* Stop the led blink and disable leds */
-        Timer1.stop();
-        Timer1.detachInterrupt();
-        ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-        ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+        ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
     }
 
-    /* Reset the door unlock timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_UNLOCK].timeReference = 0;
+    /* Stop the door sequence unless the door is opened */
+    if ( pNextState->Id != DOOR_CONTROL_STATE_DOOR_1_OPEN )
+    {
+        seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_1], DOOR_SIGNAL_LOCKED, pDoorControl->io.now );
+    }
 
     return EVENT_HANDLED;
 }
@@ -535,10 +599,15 @@ static state_machine_result_t door1UnlockExitHandler( state_machine_t* const pSt
  */
 static state_machine_result_t door1OpenEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-    /* Start the door open timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_OPEN].timeReference = millis();
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    /* Keep the led blink of the unlocked door */
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_DOOR_1_RELEASED );
+
+    /* Start the door open timeout */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_1], DOOR_SIGNAL_OPENED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
@@ -553,7 +622,7 @@ static state_machine_result_t door1OpenEntryHandler( state_machine_t* const pSta
  */
 static state_machine_result_t door1OpenHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     switch ( event )
     {
@@ -561,8 +630,12 @@ static state_machine_result_t door1OpenHandler( state_machine_t* const pState, c
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_IDLE] );
         break;
     case DOOR_CONTROL_EVENT_DOOR_2_OPEN:
+    case DOOR_CONTROL_EVENT_DOOR_1_OPEN_TIMEOUT:
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
         break;
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+        break;
     default:
         break;
     }
@@ -579,36 +652,20 @@ static state_machine_result_t door1OpenHandler( state_machine_t* const pState, c
  */
 static state_machine_result_t door1OpenExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-    /* Lock the door */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    /* Stop the led blink */
-    Timer1.stop();
-    Timer1.detachInterrupt();
-    ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-    ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+    /* Lock the door */
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
 
-    /* Reset the door open timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_OPEN].timeReference = 0;
+    /* Stop the door sequence */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_1], DOOR_SIGNAL_LOCKED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
 
 
-/**
- * @brief Handler for the door 1 led blink
- */
-static void door1BlinkLedIsrHandler( void )
-{
-    static uint8_t ledState = false;
-    ledState                = !ledState;
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_1, LED_COLOR_GREEN );
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_2, LED_COLOR_RED );
-}
-
-
 /**
  * @brief Handler for the door 2 unlock entry
  * 
@@ -618,14 +675,16 @@ static void door1BlinkLedIsrHandler( void )
  */
 static state_machine_result_t door2UnlockEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     /* Unlock the door and start led blink */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
-    Timer1.attachInterrupt( door2BlinkLedIsrHandler );
-    Timer1.start();
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_DOOR_2_RELEASED );
 
-    doorControl.doorTimer[DOOR_TIMER_TYPE_UNLOCK].timeReference = millis();
+    /* Start the unlock timeout */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_2], DOOR_SIGNAL_UNLOCKED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
@@ -640,7 +699,7 @@ static state_machine_result_t door2UnlockEntryHandler( state_machine_t* const pS
  */
 static state_machine_result_t door2UnlockHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     switch ( event )
     {
@@ -650,6 +709,9 @@ static state_machine_result_t door2UnlockHandler( state_machine_t* const pState,
     case DOOR_CONTROL_EVENT_DOOR_2_OPEN:
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_DOOR_2_OPEN] );
         break;
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+        break;
     default:
         break;
     }
@@ -666,24 +728,23 @@ static state_machine_result_t door2UnlockHandler( state_machine_t* const pState,
  */
 static state_machine_result_t door2UnlockExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-    /* Only lock the door and disable the led blink if we move back to the idle state */
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    /* Only lock the door if we move back to the idle state */
     const state_t* pNextState = pState->State;
     if ( pNextState->Id == DOOR_CONTROL_STATE_IDLE )
     {
         /* Lock the door */
-        ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
-
-        /* Stop the led blink and disable leds */
-        Timer1.stop();
-        Timer1.detachInterrupt();
-        ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-        ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+        ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
     }
 
-    /* Reset the door unlock timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_UNLOCK].timeReference = 0;
+    /* Stop the door sequence unless the door is opened */
+    if ( pNextState->Id != DOOR_CONTROL_STATE_DOOR_2_OPEN )
+    {
+        seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_2], DOOR_SIGNAL_LOCKED, pDoorControl->io.now );
+    }
 
     return EVENT_HANDLED;
 }
@@ -698,16 +759,16 @@ static state_machine_result_t door2UnlockExitHandler( state_machine_t* const pSt
  */
 static state_machine_result_t door2OpenEntryHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-    /* Unlock the door */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    Timer1.attachInterrupt( door2BlinkLedIsrHandler );
-    Timer1.start();
+    /* Unlock the door */
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_DOOR_2_RELEASED );
 
-    /* Start the door open timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_OPEN].timeReference = millis();
+    /* Start the door open timeout */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_2], DOOR_SIGNAL_OPENED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
@@ -722,7 +783,7 @@ static state_machine_result_t door2OpenEntryHandler( state_machine_t* const pSta
  */
 static state_machine_result_t door2OpenHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
     switch ( event )
     {
@@ -730,8 +791,12 @@ static state_machine_result_t door2OpenHandler( state_machine_t* const pState, c
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_IDLE] );
         break;
     case DOOR_CONTROL_EVENT_DOOR_1_OPEN:
+    case DOOR_CONTROL_EVENT_DOOR_2_OPEN_TIMEOUT:
         switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
         break;
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_EMERGENCY] );
+        break;
     default:
         break;
     }
@@ -748,86 +813,178 @@ static state_machine_result_t door2OpenHandler( state_machine_t* const pState, c
  */
 static state_machine_result_t door2OpenExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ).c_str() );
+    door_control_t* const pDoorControl = (door_control_t*) pState;
 
-    /* Lock the door */
-    ioMan_setDoorState( DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
+    Log.verboseln("%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
 
-    /* Stop the led blink */
-    Timer1.stop();
-    Timer1.detachInterrupt();
-    ioMan_setLed( false, DOOR_TYPE_DOOR_1, LED_COLOR_SIZE );
-    ioMan_setLed( false, DOOR_TYPE_DOOR_2, LED_COLOR_SIZE );
+    /* Lock the door */
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
 
-    /* Reset the door open timer */
-    doorControl.doorTimer[DOOR_TIMER_TYPE_OPEN].timeReference = 0;
+    /* Stop the door sequence */
+    seqMan_post( &pDoorControl->doorSequence[DOOR_TYPE_DOOR_2], DOOR_SIGNAL_LOCKED, pDoorControl->io.now );
 
     return EVENT_HANDLED;
 }
 
 
+/**
+ * @brief Handler for the emergency entry
+ *
+ * The emergency input already released the magnets in its interrupt, the door states
+ * follow here.
+ *
+ * @param pState - The state machine
+ * @param event - The event
+ * @return state_machine_result_t - The result of the handler
+ */
+static state_machine_result_t emergencyEntryHandler( state_machine_t* const pState, const uint32_t event )
+{
+    door_control_t* const pDoorControl = (door_control_t*) pState;
+
+    pDoorControl->emergencyEntry = micros();
+
+    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_UNLOCKED );
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
+    stateMan_setLedPattern( pDoorControl, LED_PATTERN_TYPE_EMERGENCY );
+
+    return EVENT_HANDLED;
+}
+
 
 /**
- * @brief Interrupt Service Routine (ISR) handler for blinking LEDs on door 2.
+ * @brief Handler for the emergency state
  *
- * This function toggles the state of two LEDs each time it is called. The red LED
- * on door 1 and the green LED on door 2 will be toggled between on and off states.
+ * All events are ignored until the emergency release is reset.
  *
- * The function uses a static variable to keep track of the current state of the LEDs.
- * Each time the function is called, the state is inverted and the LEDs are updated
- * accordingly.
+ * @param pState - The state machine
+ * @param event - The event
+ * @return state_machine_result_t - The result of the handler
+ */
+static state_machine_result_t emergencyHandler( state_machine_t* const pState, const uint32_t event )
+{
+    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    /* The emergency input may have released the magnets again since the reset was requested */
+    if ( ( event == DOOR_CONTROL_EVENT_EMERGENCY_RESET ) && !ioMan_areMagnetsReleased() )
+    {
+        switch_state( pState, &doorControlStates[DOOR_CONTROL_STATE_INIT] );
+    }
+
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Handler for the emergency exit
  *
- * @note This function is intended to be used as an ISR handler and should be kept
- *       as short and efficient as possible.
+ * @param pState - The state machine
+ * @param event - The event
+ * @return state_machine_result_t - The result of the handler
  */
-static void door2BlinkLedIsrHandler( void )
+static state_machine_result_t emergencyExitHandler( state_machine_t* const pState, const uint32_t event )
 {
-    static uint8_t ledState = false;
-    ledState                = !ledState;
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_1, LED_COLOR_RED );
-    ioMan_setLed( ledState, DOOR_TYPE_DOOR_2, LED_COLOR_GREEN );
+    Log.verboseln( "%s: Event %s", __func__, logging_eventToString( (door_control_event_t) event ) );
+
+    return EVENT_HANDLED;
 }
 
 
 
 /**
- * @brief Handles the timeout event for the door open state.
+ * @brief The sequence of a door: unlock, wait for open, wait for close, relock.
  *
- * This function is called when the door open timeout occurs. It logs the event
- * and switches the state machine to the fault state if the door is not closed
- * within the specified time.
+ * The state handlers post the signals when the door enters and leaves its unlocked and
+ * open states. While the door is locked, the sequence waits without a timeout and costs
+ * nothing. A timeout pushes the timeout event of the door, the state handlers decide
+ * what happens.
  *
- * @param time The time elapsed since the door was opened.
+ * @param pSeq The door sequence, its id is the door_type_t.
+ * @return pt_result_t The protothread result.
  */
-static void doorOpenTimeoutHandler( uint32_t time )
+static pt_result_t doorSequence( seq_t* const pSeq )
 {
-    Log.verboseln("%s: Time: %d", __func__, time );
+    door_control_t* const pDoorControl = (door_control_t*) pSeq->pContext;
+    const door_type_t     door         = (door_type_t) pSeq->id;
+
+    PT_BEGIN( &pSeq->pt );
 
-    /* Switch to the fault state if the door is not closed in time */
-    switch_state( &doorControl.machine, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
+    for ( ;; )
+    {
+        SEQ_AWAIT( pSeq, DOOR_SIGNAL_UNLOCKED );
+
+        /* The door must be opened within the unlock timeout */
+        SEQ_AWAIT_TIMEOUT( pSeq, DOOR_SIGNAL_OPENED | DOOR_SIGNAL_LOCKED, pDoorControl->doorTimeout[DOOR_TIMER_TYPE_UNLOCK] );
+        if ( SEQ_TIMED_OUT( pSeq ) )
+        {
+            Log.noticeln( "%s: %s expired", __func__, logging_timerTypeToString( DOOR_TIMER_TYPE_UNLOCK ) );
+
+            /* Both events, as before: the idle state samples the buttons once per event */
+            stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK_TIMEOUT, DOOR_CONTROL_SOURCE_TIMER );
+            stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK_TIMEOUT, DOOR_CONTROL_SOURCE_TIMER );
+
+            /* The door may still be opened before the timeout event is dispatched */
+            SEQ_AWAIT( pSeq, DOOR_SIGNAL_OPENED | DOOR_SIGNAL_LOCKED );
+        }
+
+        if ( pSeq->signal == DOOR_SIGNAL_LOCKED )
+        {
+            continue;
+        }
+
+        /* The door must be closed within the open timeout */
+        SEQ_AWAIT_TIMEOUT( pSeq, DOOR_SIGNAL_LOCKED, pDoorControl->doorTimeout[DOOR_TIMER_TYPE_OPEN] );
+        if ( SEQ_TIMED_OUT( pSeq ) )
+        {
+            Log.noticeln( "%s: %s expired", __func__, logging_timerTypeToString( DOOR_TIMER_TYPE_OPEN ) );
+            stateMan_postEvent( pDoorControl, doorOpenTimeoutEvent[door], DOOR_CONTROL_SOURCE_TIMER );
+            SEQ_AWAIT( pSeq, DOOR_SIGNAL_LOCKED );
+        }
+    }
+
+    PT_END( &pSeq->pt );
 }
 
 
 /**
- * @brief Handles the timeout event for door unlocking.
+ * @brief The sequence of the init state: wait for stable door switches.
  *
- * This function is called when the door unlock timeout occurs. It logs the 
- * event with the provided time and switches the state machine back to the 
- * idle state if the door is not opened in time by pushing the appropriate 
- * timeout events.
+ * The switches are sampled by stateMan_generateEvent() on every processing step, which
+ * pushes the door events handled by initHandler() once both debouncers are stable. If
+ * they aren't stable within the slower debounce delay plus a margin, the init timeout
+ * event moves the state machine to the fault state.
  *
- * @param time The time at which the timeout event occurred.
+ * @param pSeq The init sequence.
+ * @return pt_result_t The protothread result.
  */
-static void doorUnlockTimeoutHandler( uint32_t time )
+static pt_result_t initSequence( seq_t* const pSeq )
 {
-    Log.verboseln("%s: Time: %d", __func__, time );
+    door_control_t* const pDoorControl = (door_control_t*) pSeq->pContext;
+    const uint16_t        switch1Delay = pDoorControl->io.debounceDelay[IO_SWITCH_1];
+    const uint16_t        switch2Delay = pDoorControl->io.debounceDelay[IO_SWITCH_2];
 
-    /* Switch back to the idle state if the door is not opened in time */
-    pushEvent( &doorControl.machine.event, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK_TIMEOUT );
-    pushEvent( &doorControl.machine.event, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK_TIMEOUT );
-}
+    PT_BEGIN( &pSeq->pt );
 
+    for ( ;; )
+    {
+        SEQ_AWAIT( pSeq, DOOR_SIGNAL_INIT );
+
+        pDoorControl->doorTimeout[DOOR_TIMER_TYPE_INIT] = ( ( switch1Delay > switch2Delay ) ? switch1Delay : switch2Delay ) + DEBOUNCE_STABLE_TIMEOUT;
+        SEQ_AWAIT_TIMEOUT( pSeq, DOOR_SIGNAL_INIT_DONE, pDoorControl->doorTimeout[DOOR_TIMER_TYPE_INIT] );
+
+        /* Remember how long the initialization took */
+        pDoorControl->initDuration = pSeq->now - pSeq->waitStart;
+
+        if ( SEQ_TIMED_OUT( pSeq ) )
+        {
+            stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_INIT_TIMEOUT, DOOR_CONTROL_SOURCE_TIMER );
+            SEQ_AWAIT( pSeq, DOOR_SIGNAL_INIT_DONE );
+        }
+    }
 
+    PT_END( &pSeq->pt );
+}
 
 
 /**
@@ -850,15 +1007,12 @@ static void doorUnlockTimeoutHandler( uint32_t time )
 static void stateMan_generateEvent( door_control_t* const pDoorControl )
 {
     /* Read the state of both door switches */
-    input_status_t door1SwitchStatus = ioMan_getDoorState( IO_SWITCH_1 );
-    input_status_t door2SwitchStatus = ioMan_getDoorState( IO_SWITCH_2 );
+    input_status_t door1SwitchStatus = ioMan_getDoorState( &pDoorControl->io, IO_SWITCH_1 );
+    input_status_t door2SwitchStatus = ioMan_getDoorState( &pDoorControl->io, IO_SWITCH_2 );
 
     Log.verboseln( "%s: Door 1 switch: %s, Door 2 switch: %s", __func__, 
-                    logging_inputStateToString( door1SwitchStatus.state ).c_str(),
-                    logging_inputStateToString( door2SwitchStatus.state ).c_str() );
-
-    /* Get pointer to the current event */
-    event_t** pCurrentEvent = &pDoorControl->machine.event;
+                    logging_inputStateToString( door1SwitchStatus.state ),
+                    logging_inputStateToString( door2SwitchStatus.state ) );
 
     /* Generate the event */
     if (    (     ( door1SwitchStatus.state   == INPUT_STATE_INACTIVE  )
@@ -866,7 +1020,7 @@ static void stateMan_generateEvent( door_control_t* const pDoorControl )
          && (     ( door2SwitchStatus.state   == INPUT_STATE_INACTIVE  )
               && ( door2SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) ) )
     {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_2_OPEN );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_2_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
     }
 
     if (    (    ( door1SwitchStatus.state    == INPUT_STATE_ACTIVE    )
@@ -874,72 +1028,165 @@ static void stateMan_generateEvent( door_control_t* const pDoorControl )
          && (    ( door2SwitchStatus.state    == INPUT_STATE_ACTIVE    )
               && ( door2SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) ) )
     {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE, DOOR_CONTROL_SOURCE_SWITCH );
     }
 
     if (    ( door1SwitchStatus.state    == INPUT_STATE_ACTIVE    )
          && ( door1SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) )
     {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_CLOSE );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_CLOSE, DOOR_CONTROL_SOURCE_SWITCH );
     }
 
     if (    ( door1SwitchStatus.state    == INPUT_STATE_INACTIVE  )
          && ( door1SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) )
     {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_1_OPEN );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_1_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
     }
 
     if (    ( door2SwitchStatus.state    == INPUT_STATE_ACTIVE    )
          && ( door2SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) )
     {
-        pushEvent( pCurrentEvent, DOOR_CONTROL_EVENT_DOOR_2_CLOSE );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_2_CLOSE, DOOR_CONTROL_SOURCE_SWITCH );
     }
 
     if (    ( door2SwitchStatus.state    == INPUT_STATE_INACTIVE  )
          && ( door2SwitchStatus.debounce == INPUT_DEBOUNCE_STABLE ) )
     {
-        pushEvent( &pDoorControl->machine.event, DOOR_CONTROL_EVENT_DOOR_2_OPEN );
+        stateMan_postEvent( pDoorControl, DOOR_CONTROL_EVENT_DOOR_2_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
     }
 }
 
 
 
 /**
- * @brief Processes the door control timers and handles timer expiration.
+ * @brief Starts all sequences of a door control instance.
  *
- * This function checks the status of each door timer in the door control structure.
- * If a timer is running and has expired, it calls the associated handler and resets the timer.
- * It also logs the remaining time for each running timer.
+ * The sequences start waiting for their first signal.
  *
- * @param pDoorControl Pointer to the door control structure containing the timers.
+ * @param pDoorControl Pointer to the door control instance.
  */
-static void stateMan_processTimers( door_control_t* const pDoorControl )
+static void stateMan_startSequences( door_control_t* const pDoorControl )
 {
-    Log.verboseln( "%s", __func__ );
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
+    {
+        seqMan_start( &pDoorControl->doorSequence[door], doorSequence, pDoorControl, door, pDoorControl->io.now );
+    }
+
+    seqMan_start( &pDoorControl->initSequence, initSequence, pDoorControl, 0, pDoorControl->io.now );
+}
 
-    /* Get the current time */
-    uint64_t currentTime = millis();
 
-    /* Loop through all door timers */
-    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+/**
+ * @brief Resumes the sequences whose timeout expired.
+ *
+ * A sequence that waits without a timeout isn't touched, so the locked doors cost no
+ * time here.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ */
+static void stateMan_processSequences( door_control_t* const pDoorControl )
+{
+    for ( uint8_t door = 0; door < DOOR_TYPE_SIZE; door++ )
     {
-        /* Check if the timer is running */
-        if ( pDoorControl->doorTimer[i].timeReference != 0 )
-        {
-            /* Check if the timer has expired */
-            if ( ( currentTime - pDoorControl->doorTimer[i].timeReference ) >= pDoorControl->doorTimer[i].timeout )
-            {
-                /* Call the timer handler */
-                pDoorControl->doorTimer[i].handler( currentTime );
-                /* Reset the timer */
-                pDoorControl->doorTimer[i].timeReference = 0;
-                return;
-            }
+        seqMan_process( &pDoorControl->doorSequence[door], pDoorControl->io.now );
+    }
 
-            /* Calculate remaining time */
-            String remainingTime = String( ( pDoorControl->doorTimer[i].timeout - ( currentTime - pDoorControl->doorTimer[i].timeReference ) ) / 1000.0F );
-            Log.noticeln( "%s: %s", logging_timerTypeToString( (door_timer_type_t) i ).c_str(), remainingTime.c_str() );
-        }
+    seqMan_process( &pDoorControl->initSequence, pDoorControl->io.now );
+}
+
+
+/**
+ * @brief Checks the door interlock.
+ *
+ * The safety property of the airlock is that both magnets are never released while
+ * either door is open. This is independent of the state machine logic and therefore
+ * checked after every processing step. On a violation both doors are locked immediately,
+ * the violation is counted and reported and the state machine switches to the fault state.
+ *
+ * @param pDoorControl Pointer to the door control structure.
+ */
+static void stateMan_checkInterlock( door_control_t* const pDoorControl )
+{
+    bool bothUnlocked =    ( ioMan_getLockState( &pDoorControl->io, DOOR_TYPE_DOOR_1 ) == LOCK_STATE_UNLOCKED )
+                        && ( ioMan_getLockState( &pDoorControl->io, DOOR_TYPE_DOOR_2 ) == LOCK_STATE_UNLOCKED );
+
+    /* A door counts as open unless its switch reports it closed */
+    input_status_t door1SwitchStatus = ioMan_peekDoorState( &pDoorControl->io, IO_SWITCH_1 );
+    input_status_t door2SwitchStatus = ioMan_peekDoorState( &pDoorControl->io, IO_SWITCH_2 );
+    bool           anyDoorOpen       =    ( door1SwitchStatus.state != INPUT_STATE_ACTIVE )
+                                       || ( door2SwitchStatus.state != INPUT_STATE_ACTIVE );
+
+    /* The emergency release opens both doors on purpose */
+    if ( !bothUnlocked || !anyDoorOpen || ( stateMan_getState( pDoorControl ) == DOOR_CONTROL_STATE_EMERGENCY ) )
+    {
+        return;
+    }
+
+    pDoorControl->interlockViolations++;
+    Log.errorln( "%s: Both doors released while a door is open in state %s", __func__,
+                 logging_stateToString( stateMan_getState( pDoorControl ) ) );
+    if ( pDoorControl->violationHandler != NULL )
+    {
+        pDoorControl->violationHandler( pDoorControl );
+    }
+
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_1, LOCK_STATE_LOCKED );
+    ioMan_setDoorState( &pDoorControl->io, DOOR_TYPE_DOOR_2, LOCK_STATE_LOCKED );
+    switch_state( &pDoorControl->machine, &doorControlStates[DOOR_CONTROL_STATE_FAULT] );
+}
+
+
+/**
+ * @brief Checks whether a door may be unlocked.
+ *
+ * The access window of the instance is checked first, e.g. the schedule of the door, so
+ * the interlocked controllers aren't asked for a door that stays locked anyway. Then the
+ * unlock gate of the instance decides, e.g. the controller bus asks the interlocked
+ * controllers. Without a window and a gate every door may be unlocked.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param door The door to unlock.
+ * @return true if the door may be unlocked, false otherwise.
+ */
+static bool stateMan_isUnlockGranted( door_control_t* const pDoorControl, door_type_t door )
+{
+    if ( ( pDoorControl->accessWindow != NULL ) && !pDoorControl->accessWindow( pDoorControl, door ) )
+    {
+        return false;
+    }
+
+    return ( pDoorControl->unlockGate == NULL ) || pDoorControl->unlockGate( pDoorControl, door );
+}
+
+
+/**
+ * @brief Returns the unlock request of a door.
+ *
+ * The unlock request filter of the instance decides, e.g. a badge door only unlocks for
+ * an accepted badge. Without a filter the button requests the unlock.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param door The door.
+ * @param button The debounced state of the button of the door.
+ * @return input_state_t INPUT_STATE_ACTIVE if the door is requested to unlock.
+ */
+static input_state_t stateMan_getUnlockRequest( door_control_t* const pDoorControl, door_type_t door, input_state_t button )
+{
+    return ( pDoorControl->unlockRequest == NULL ) ? button : pDoorControl->unlockRequest( pDoorControl, door, button );
+}
+
+
+/**
+ * @brief Selects the led pattern if the door control instance owns the leds.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param pattern The led pattern to show.
+ */
+static void stateMan_setLedPattern( const door_control_t* const pDoorControl, led_pattern_type_t pattern )
+{
+    if ( pDoorControl == pLedDoorControl )
+    {
+        ledMan_setPattern( pattern );
     }
 }
 
@@ -950,6 +1197,7 @@ static void stateMan_processTimers( door_control_t* const pDoorControl )
  * This function configures the timeout for a specific door timer type. The timeout
  * value is converted to milliseconds or minutes depending on the timer type.
  *
+ * @param pDoorControl Pointer to the door control instance.
  * @param timerType The type of the door timer to set. Must be a value of type `door_timer_type_t`.
  *                  Valid values are:
  *                  - DOOR_TIMER_TYPE_UNLOCK: Sets the unlock timer (timeout in seconds).
@@ -962,7 +1210,7 @@ static void stateMan_processTimers( door_control_t* const pDoorControl )
  * @note If an invalid timer type is provided, the function logs an error and returns without
  *       making any changes.
  */
-void stateMan_setDoorTimer( door_timer_type_t timerType, uint32_t timeout )
+void stateMan_setDoorTimer( door_control_t* const pDoorControl, door_timer_type_t timerType, uint32_t timeout )
 {
     if ( timerType >= DOOR_TIMER_TYPE_SIZE )
     {
@@ -973,12 +1221,384 @@ void stateMan_setDoorTimer( door_timer_type_t timerType, uint32_t timeout )
     switch ( timerType )
     {
     case DOOR_TIMER_TYPE_UNLOCK:
-        doorControl.doorTimer[DOOR_TIMER_TYPE_UNLOCK].timeout = ( (uint32_t)timeout * 1000 );
+        pDoorControl->doorTimeout[DOOR_TIMER_TYPE_UNLOCK] = ( (uint32_t)timeout * 1000 );
         break;
     case DOOR_TIMER_TYPE_OPEN:
-        doorControl.doorTimer[DOOR_TIMER_TYPE_OPEN].timeout = ( (uint32_t) timeout ) * 60000;
+        pDoorControl->doorTimeout[DOOR_TIMER_TYPE_OPEN] = ( (uint32_t) timeout ) * 60000;
         break;
     default:
         break;
     }
 }
+
+
+/**
+ * @brief Sets the dispatch budget of a processing step.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param maxEvents The most events dispatched per step ( 0 = unlimited ).
+ * @param maxTime The longest dispatch per step ( 0 = unlimited ) @unit us
+ */
+void stateMan_setDispatchBudget( door_control_t* const pDoorControl, uint8_t maxEvents, uint16_t maxTime )
+{
+    pDoorControl->budget.maxEvents = maxEvents;
+    pDoorControl->budget.maxTime   = maxTime;
+}
+
+
+/**
+ * @brief Sets the age after which a deferred event is dropped.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param maxAge The age after which a deferred event is dropped ( 0 = never ) @unit s
+ */
+void stateMan_setDeferMaxAge( door_control_t* const pDoorControl, uint16_t maxAge )
+{
+    pDoorControl->budget.deferMaxAge = maxAge;
+}
+
+
+/**
+ * @brief Resets the state manager to its initial state.
+ *
+ * All pending and deferred events are discarded, the door sequences are restarted and the state machine
+ * is restarted from the init state. This is used to start a trace replay from a
+ * well-defined state.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param now The time of the instance @unit ms
+ */
+void stateMan_reset( door_control_t* const pDoorControl, const uint32_t now )
+{
+    Log.noticeln( "%s: Resetting the state manager", __func__ );
+
+    /* Discard all pending and deferred events */
+    clear_events( &pDoorControl->machine );
+
+    /* Restart the sequences and the state machine from the init state */
+    pDoorControl->io.now = now;
+    stateMan_startSequences( pDoorControl );
+    switch_state( &pDoorControl->machine, &doorControlStates[DOOR_CONTROL_STATE_INIT] );
+}
+
+
+/**
+ * @brief Posts an event to the state machine in the priority class of the event.
+ *
+ * The event is stamped with the hardware clock and its source, so the dispatch can
+ * measure how long it waited in the queue. It is also stamped with the time of the
+ * instance, which the deferral age is counted in, so a deferred event expires at the
+ * same virtual time in a replay as it did on the controller. An event of the door switches is dropped
+ * while the same event is still queued or deferred.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param event The event.
+ * @param source The origin of the event.
+ */
+void stateMan_postEvent( door_control_t* const pDoorControl, door_control_event_t event, door_control_source_t source )
+{
+    /* The door switches post their state every step. While a carried over or deferred
+     * event of the same state is still waiting, it isn't queued again, so neither the
+     * backlog nor the deferred queue grows.
+     */
+    if ( source == DOOR_CONTROL_SOURCE_SWITCH )
+    {
+        const event_t* const queues[] = { pDoorControl->machine.event, pDoorControl->machine.deferred };
+
+        for ( uint8_t i = 0; i < sizeof( queues ) / sizeof( queues[0] ); i++ )
+        {
+            for ( const event_t* pQueued = queues[i]; pQueued != NULL; pQueued = pQueued->next )
+            {
+                if ( pQueued->id == (uint32_t) event )
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    event_t* const pEvent = pushEventPriority( &pDoorControl->machine.event, event, stateMan_getEventPriority( event ) );
+
+    if ( pEvent != NULL )
+    {
+        pEvent->time    = micros();
+        pEvent->posted  = pDoorControl->io.now;
+        pEvent->source  = source;
+        pEvent->stamped = true;
+    }
+}
+
+
+/**
+ * @brief Returns the priority class of an event.
+ *
+ * Both doors open and the timeouts that move the state machine to the fault state
+ * preempt the routine door events, the emergency release preempts everything.
+ *
+ * @param event The event.
+ * @return door_control_priority_t The priority class.
+ */
+door_control_priority_t stateMan_getEventPriority( door_control_event_t event )
+{
+    switch ( event )
+    {
+    case DOOR_CONTROL_EVENT_EMERGENCY:
+    case DOOR_CONTROL_EVENT_EMERGENCY_RESET:
+        return DOOR_CONTROL_PRIORITY_EMERGENCY;
+    case DOOR_CONTROL_EVENT_DOOR_1_2_OPEN:
+    case DOOR_CONTROL_EVENT_DOOR_1_OPEN_TIMEOUT:
+    case DOOR_CONTROL_EVENT_DOOR_2_OPEN_TIMEOUT:
+    case DOOR_CONTROL_EVENT_INIT_TIMEOUT:
+        return DOOR_CONTROL_PRIORITY_SAFETY;
+    default:
+        return DOOR_CONTROL_PRIORITY_ROUTINE;
+    }
+}
+
+
+/**
+ * @brief Returns the current state of the door control state machine.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return door_control_state_t The current state.
+ */
+door_control_state_t stateMan_getState( const door_control_t* const pDoorControl )
+{
+    return (door_control_state_t) pDoorControl->machine.State->Id;
+}
+
+
+/**
+ * @brief Returns the time at which the next timeout of a door sequence or of a deferred event expires.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @param pDeadline Pointer to store the expiry time @unit ms
+ * @return true if at least one sequence waits with a timeout or a deferred event can expire, false otherwise.
+ */
+bool stateMan_getNextTimerDeadline( const door_control_t* const pDoorControl, uint32_t* pDeadline )
+{
+    const seq_t* const sequences[] = {
+        &pDoorControl->doorSequence[DOOR_TYPE_DOOR_1],
+        &pDoorControl->doorSequence[DOOR_TYPE_DOOR_2],
+        &pDoorControl->initSequence
+    };
+    bool timerRunning = false;
+
+    for ( uint8_t i = 0; i < sizeof( sequences ) / sizeof( sequences[0] ); i++ )
+    {
+        uint32_t deadline;
+
+        if ( seqMan_getDeadline( sequences[i], &deadline ) )
+        {
+            if ( !timerRunning || sysClock_isEarlier( deadline, *pDeadline ) )
+            {
+                *pDeadline = deadline;
+            }
+
+            timerRunning = true;
+        }
+    }
+
+    /* A deferred event is dropped in the first step after its age exceeded the deferral age */
+    if ( pDoorControl->budget.deferMaxAge != 0 )
+    {
+        for ( const event_t* pEvent = pDoorControl->machine.deferred; pEvent != NULL; pEvent = pEvent->next )
+        {
+            const uint32_t deadline = pEvent->posted + pDoorControl->budget.deferMaxAge * 1000UL + 1;
+
+            if ( pEvent->stamped )
+            {
+                if ( !timerRunning || sysClock_isEarlier( deadline, *pDeadline ) )
+                {
+                    *pDeadline = deadline;
+                }
+
+                timerRunning = true;
+            }
+        }
+    }
+
+    return timerRunning;
+}
+
+
+/**
+ * @brief Returns the number of detected interlock violations since boot.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return uint32_t The number of interlock violations.
+ */
+uint32_t stateMan_getInterlockViolations( const door_control_t* const pDoorControl )
+{
+    return pDoorControl->interlockViolations;
+}
+
+
+/**
+ * @brief Returns the time the last initialization took until the init state was left.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return uint32_t The duration of the last initialization @unit ms
+ */
+uint32_t stateMan_getInitDuration( const door_control_t* const pDoorControl )
+{
+    return pDoorControl->initDuration;
+}
+
+
+/**
+ * @brief Returns the time the emergency state was entered last.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return uint32_t The hardware clock when the emergency state was entered @unit us
+ */
+uint32_t stateMan_getEmergencyEntry( const door_control_t* const pDoorControl )
+{
+    return pDoorControl->emergencyEntry;
+}
+
+
+/**
+ * @brief Returns the number of events dropped since boot.
+ *
+ * An event is dropped if no state handled it or the deferred events were full.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return uint32_t The number of dropped events.
+ */
+uint32_t stateMan_getDroppedEvents( const door_control_t* const pDoorControl )
+{
+    return pDoorControl->machine.dropped;
+}
+
+
+/**
+ * @brief Returns the number of deferred events that expired since boot.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return uint32_t The number of expired events.
+ */
+uint32_t stateMan_getExpiredEvents( const door_control_t* const pDoorControl )
+{
+    return pDoorControl->machine.expired;
+}
+
+
+/**
+ * @brief Returns the dispatch budget with the statistics of its exhaustions.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ * @return const door_control_budget_t* Pointer to the dispatch budget.
+ */
+const door_control_budget_t* stateMan_getDispatchBudget( const door_control_t* const pDoorControl )
+{
+    return &pDoorControl->budget;
+}
+
+
+/**
+ * @brief Called by the dispatch before the handler of an event runs.
+ *
+ * Records the time the event waited in the queue, then logs the event.
+ *
+ * @param pStateMachine The state machine.
+ * @param state The current state.
+ * @param pEvent The dispatched event. A handler that returned TRIGGERED_TO_SELF gets its
+ *               event again, also if an event of a higher priority class was pushed in front of it.
+ */
+static void stateMan_eventLogger( state_machine_t* const pStateMachine, uint32_t state, const event_t* const pEvent )
+{
+    if ( pEvent->source != DOOR_CONTROL_SOURCE_NONE )
+    {
+        latMon_record( (door_control_event_t) pEvent->id, (door_control_source_t) pEvent->source, micros() - pEvent->time );
+    }
+
+    logging_eventLogger( pStateMachine, state, pEvent->id );
+}
+
+
+/**
+ * @brief Dispatches the queued events within the dispatch budget.
+ *
+ * The events beyond the budget stay queued in their order and are dispatched first in
+ * the next step. The events of the emergency class are always dispatched. The deferred
+ * events older than the deferral age are dropped first.
+ *
+ * @param pDoorControl Pointer to the door control instance.
+ */
+static void stateMan_dispatchEvents( door_control_t* const pDoorControl )
+{
+    state_machine_t* const       stateMachines[] = { &pDoorControl->machine };
+    door_control_budget_t* const pBudget         = &pDoorControl->budget;
+
+    pBudget->start      = micros();
+    pBudget->dispatched = 0;
+    pBudget->exhausted  = false;
+
+    /* A deferred event that waited too long is stale, e.g. a request nobody waits for anymore */
+    if ( pBudget->deferMaxAge != 0 )
+    {
+        expire_deferred( &pDoorControl->machine, pDoorControl->io.now, pBudget->deferMaxAge * 1000UL );
+    }
+
+    if ( dispatch_event( stateMachines, 1, stateMan_eventLogger, logging_resultLogger, stateMan_isBudgetLeft ) == EVENT_UN_HANDLED )
+    {
+        Log.errorln( "Event is not handled" );
+    }
+
+    const uint32_t duration = micros() - pBudget->start;
+
+    if ( pBudget->dispatched > pBudget->peakEvents )
+    {
+        pBudget->peakEvents = pBudget->dispatched;
+    }
+
+    if ( duration > pBudget->peakTime )
+    {
+        pBudget->peakTime = duration;
+    }
+
+    if ( pBudget->exhausted )
+    {
+        pBudget->exhaustions++;
+        pBudget->carried = 0;
+        for ( const event_t* pEvent = pDoorControl->machine.event; pEvent != NULL; pEvent = pEvent->next )
+        {
+            pBudget->carried++;
+        }
+        Log.verboseln( "%s: Dispatch budget exhausted, %d events carried over", __func__, pBudget->carried );
+    }
+}
+
+
+/**
+ * @brief Asked by the dispatch before the handler of an event runs.
+ *
+ * The first event of a step is always granted. A time budget shorter than the
+ * resolution of micros() would otherwise be used up before any handler ran, and no
+ * event would ever be dispatched again.
+ *
+ * @param pStateMachine The state machine.
+ * @param pEvent The event to dispatch.
+ * @return true if the event may be dispatched in this step, false to keep it queued.
+ */
+static bool stateMan_isBudgetLeft( state_machine_t* const pStateMachine, const event_t* const pEvent )
+{
+    door_control_budget_t* const pBudget = &( (door_control_t*) pStateMachine )->budget;
+
+    if (    ( pEvent->priority < DOOR_CONTROL_PRIORITY_EMERGENCY )
+         && ( pBudget->dispatched != 0 )
+         && (    ( ( pBudget->maxEvents != 0 ) && ( pBudget->dispatched >= pBudget->maxEvents ) )
+              || ( ( pBudget->maxTime != 0 ) && ( ( micros() - pBudget->start ) >= pBudget->maxTime ) ) ) )
+    {
+        pBudget->exhausted = true;
+        return false;
+    }
+
+    if ( pBudget->dispatched < UINT16_MAX )
+    {
+        pBudget->dispatched++;
+    }
+
+    return true;
+}
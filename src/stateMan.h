@@ -15,6 +15,7 @@
 #include "hsm.h"
 #include "appSettings.h"
 #include "ioMan.h"
+#include "seqMan.h"
 
 /************************************ ENUMERATION *************************************/
 
@@ -29,7 +30,8 @@ typedef enum
     DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, /*!< The door 1 is unlocked */
     DOOR_CONTROL_STATE_DOOR_1_OPEN,     /*!< The door 1 is open */
     DOOR_CONTROL_STATE_DOOR_2_UNLOCKED, /*!< The door 2 is unlocked */
-    DOOR_CONTROL_STATE_DOOR_2_OPEN      /*!< The door 2 is open */
+    DOOR_CONTROL_STATE_DOOR_2_OPEN,     /*!< The door 2 is open */
+    DOOR_CONTROL_STATE_EMERGENCY        /*!< The emergency input released all magnets */
 } door_control_state_t;
 
 /**
@@ -49,39 +51,140 @@ typedef enum
     DOOR_CONTROL_EVENT_DOOR_2_CLOSE,          /*!< The door 2 is closed */
     DOOR_CONTROL_EVENT_DOOR_2_OPEN_TIMEOUT,   /*!< The door 2 is open timeout */
     DOOR_CONTROL_EVENT_DOOR_1_2_OPEN,         /*!< The door 1 and 2 are open */
-    DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE         /*!< The door 1 and 2 are closed */
+    DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE,        /*!< The door 1 and 2 are closed */
+    DOOR_CONTROL_EVENT_INIT_TIMEOUT,          /*!< The door switches weren't stable in time */
+    DOOR_CONTROL_EVENT_EMERGENCY,             /*!< The emergency input released all magnets */
+    DOOR_CONTROL_EVENT_EMERGENCY_RESET,       /*!< The emergency release was reset */
+    DOOR_CONTROL_EVENT_SIZE                   /*!< Last event + 1 */
 } door_control_event_t;
 
+/**
+ * @brief Enumeration of the signals posted to the door sequences by the state handlers
+ */
+typedef enum
+{
+    DOOR_SIGNAL_UNLOCKED  = 0x01, /*!< The door entered its unlocked state */
+    DOOR_SIGNAL_OPENED    = 0x02, /*!< The door entered its open state */
+    DOOR_SIGNAL_LOCKED    = 0x04, /*!< The door left its unlocked or open state, other than to open */
+    DOOR_SIGNAL_INIT      = 0x08, /*!< The init state was entered */
+    DOOR_SIGNAL_INIT_DONE = 0x10  /*!< The init state was left */
+} door_signal_t;
+
+/**
+ * @brief Enumeration of the priority classes of the door control events
+ * @details A queued event of a higher class is dispatched before all events of lower
+ *          classes, the events of a class are dispatched in the order they were posted.
+ */
+typedef enum
+{
+    DOOR_CONTROL_PRIORITY_ROUTINE,  /*!< Door changes, unlocks and unlock timeouts */
+    DOOR_CONTROL_PRIORITY_SAFETY,   /*!< Events that move the state machine to the fault state */
+    DOOR_CONTROL_PRIORITY_EMERGENCY /*!< The emergency release and its reset */
+} door_control_priority_t;
+
+/**
+ * @brief Enumeration of the sources of the door control events
+ */
+typedef enum
+{
+    DOOR_CONTROL_SOURCE_NONE,      /*!< The event wasn't stamped */
+    DOOR_CONTROL_SOURCE_SWITCH,    /*!< The door switches */
+    DOOR_CONTROL_SOURCE_REQUEST,   /*!< An unlock request of a button or a badge */
+    DOOR_CONTROL_SOURCE_TIMER,     /*!< A timeout of a door sequence */
+    DOOR_CONTROL_SOURCE_EMERGENCY, /*!< The emergency release */
+    DOOR_CONTROL_SOURCE_SIZE       /*!< Number of sources */
+} door_control_source_t;
+
 
 /************************************* STRUCTURE **************************************/
 
+typedef struct door_control door_control_t;
+
 /**
- * @brief The timer structure
- * @details The timer structure is used to hold the door 1/2 open timeout timers
+ * @brief The state machine logger structure
+ * @details The state machine logger structure is used to hold the last logged event and states
  */
 typedef struct
 {
-    void ( *handler )( uint32_t time );   //!< The handler function that is called when the timer expires
-    uint32_t timeout;                     //!< The timeout after which the handler is called @unit ms
-    uint64_t timeReference;               //!< The time reference when the timer is started @unit ms
-} door_timer_t;
+    uint8_t lastEvent;       /*!< The last logged event */
+    uint8_t lastState;       /*!< The state of the last logged event */
+    uint8_t lastResultState; /*!< The state of the last logged result */
+} door_control_logger_t;
 
 /**
- * @brief The door control state machine
- * @details The door control state machine is used to control the door 1 and 2
+ * @brief The dispatch budget structure
+ * @details Bounds the events dispatched per processing step, the events beyond the
+ *          budget stay queued for the next step
  */
 typedef struct
 {
-    state_machine_t machine;                         /*!< Abstract state machine */
-    door_timer_t    doorTimer[DOOR_TIMER_TYPE_SIZE]; /*!< The door timers */
-} door_control_t;
+    uint8_t  maxEvents;   /*!< Most events dispatched per step ( 0 = unlimited ) */
+    uint16_t maxTime;     /*!< Longest dispatch per step ( 0 = unlimited ) @unit us */
+    uint32_t start;       /*!< The hardware clock when the dispatch of the current step started @unit us */
+    uint16_t dispatched;  /*!< Events dispatched in the current step */
+    bool     exhausted;   /*!< The budget of the current step ran out */
+    uint32_t exhaustions; /*!< Number of steps that ran out of the budget */
+    uint16_t carried;     /*!< Events carried over by the last step that ran out of the budget */
+    uint16_t peakEvents;  /*!< Most events dispatched in a step */
+    uint32_t peakTime;    /*!< Longest dispatch of a step @unit us */
+    uint16_t deferMaxAge; /*!< Age after which a deferred event is dropped ( 0 = never ) @unit s */
+} door_control_budget_t;
+
+/**
+ * @brief The door control state machine
+ * @details The door control state machine is used to control the door 1 and 2. It holds
+ *          the complete mutable state of one controller instance, so several independent
+ *          instances can coexist. The state machine must be the first member, as the state
+ *          handlers cast the state machine pointer back to the door control structure.
+ */
+struct door_control
+{
+    state_machine_t       machine;                           /*!< Abstract state machine */
+    uint32_t              doorTimeout[DOOR_TIMER_TYPE_SIZE]; /*!< The timeouts of the door sequences @unit ms */
+    seq_t                 doorSequence[DOOR_TYPE_SIZE];      /*!< The unlock, open and relock sequence of each door */
+    seq_t                 initSequence;                      /*!< Bounds the wait for stable door switches */
+    io_context_t          io;                                /*!< The input/output context */
+    uint32_t              interlockViolations;               /*!< Number of detected interlock violations */
+    uint32_t              initDuration;                      /*!< Time spent in the init state @unit ms */
+    uint32_t              emergencyEntry;                    /*!< The hardware clock when the emergency state was entered @unit us */
+    door_control_budget_t budget;                            /*!< The dispatch budget of a processing step */
+
+    /*!< Called for every detected interlock violation, may be NULL */
+    void ( *violationHandler )( const door_control_t* const pDoorControl );
+
+    /*!< Asked before a door is unlocked, may be NULL. The door stays locked while it returns false */
+    bool ( *unlockGate )( door_control_t* const pDoorControl, door_type_t door );
+
+    /*!< Asked before the unlock gate, may be NULL. The door stays locked outside of its access window */
+    bool ( *accessWindow )( door_control_t* const pDoorControl, door_type_t door );
+
+    /*!< Turns the button of a door into the unlock request of the door, may be NULL to use the button */
+    input_state_t ( *unlockRequest )( door_control_t* const pDoorControl, door_type_t door, input_state_t button );
+
+    door_control_logger_t logger;                            /*!< The state machine logger state */
+};
 
 
 
 /******************************** Function prototype ************************************/
 
-void stateMan_setup( void );
-void stateMan_process( void );
-void stateMan_setDoorTimer( door_timer_type_t timerType, uint32_t timeout );
+void stateMan_setup( door_control_t* const pDoorControl );
+void stateMan_init( door_control_t* const pDoorControl, const uint32_t now );
+void stateMan_process( door_control_t* const pDoorControl, const uint32_t now );
+void stateMan_setDoorTimer( door_control_t* const pDoorControl, door_timer_type_t timerType, uint32_t timeout );
+void stateMan_setDispatchBudget( door_control_t* const pDoorControl, uint8_t maxEvents, uint16_t maxTime );
+void stateMan_setDeferMaxAge( door_control_t* const pDoorControl, uint16_t maxAge );
+void stateMan_reset( door_control_t* const pDoorControl, const uint32_t now );
+void stateMan_postEvent( door_control_t* const pDoorControl, door_control_event_t event, door_control_source_t source );
+bool stateMan_getNextTimerDeadline( const door_control_t* const pDoorControl, uint32_t* pDeadline );
+
+uint32_t                stateMan_getInterlockViolations( const door_control_t* const pDoorControl );
+uint32_t                stateMan_getInitDuration( const door_control_t* const pDoorControl );
+uint32_t                stateMan_getEmergencyEntry( const door_control_t* const pDoorControl );
+uint32_t                stateMan_getDroppedEvents( const door_control_t* const pDoorControl );
+uint32_t                stateMan_getExpiredEvents( const door_control_t* const pDoorControl );
+const door_control_budget_t* stateMan_getDispatchBudget( const door_control_t* const pDoorControl );
+door_control_state_t    stateMan_getState( const door_control_t* const pDoorControl );
+door_control_priority_t stateMan_getEventPriority( door_control_event_t event );
 
 #endif // STATEMANAGEMENT_H
\ No newline at end of file
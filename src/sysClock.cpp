@@ -0,0 +1,133 @@
+/**
+ * \file    sysClock.cpp
+ * \brief   Source file for the system clock
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include "sysClock.h"
+
+/*
+ * The hardware clock is read once per main loop iteration by sysClock_update(). All
+ * consumers of that iteration see the same snapshot, so the interrupts are only masked
+ * once per iteration to read millis().
+ *
+ * The snapshot is a 32-bit time that wraps around after 49.7 days. Time spans are the
+ * difference of two times, which is correct across the wraparound as long as the span is
+ * shorter than 49.7 days. Deadlines are compared with sysClock_isExpired() and
+ * sysClock_isEarlier(), which are correct as long as the deadline is less than 24.8 days
+ * away. The wraparounds are counted to extend the hardware clock to a 64-bit uptime.
+ */
+
+
+/******************************** Global variables ************************************/
+
+static uint32_t hardwareTime        = 0;     /*!< The hardware clock of the current iteration @unit ms */
+static uint32_t wrapCount           = 0;     /*!< The wraparounds of the hardware clock */
+static bool     updated             = false; /*!< The hardware clock has been read at least once */
+static uint32_t bootTime[SYS_CLOCK_BOOT_SIZE] = { 0 }; /*!< The time of each boot milestone since the start of the firmware @unit us */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Takes the snapshot of the hardware clock for this main loop iteration.
+ *
+ * Must be called once at the beginning of every main loop iteration, and once in setup()
+ * before the first consumer. It must be called at least once per 49.7 days to detect the
+ * wraparound of the hardware clock.
+ */
+void sysClock_update( void )
+{
+    const uint32_t time = (uint32_t) millis() + SYS_CLOCK_START_OFFSET;
+
+    if ( updated && ( time < hardwareTime ) )
+    {
+        wrapCount++;
+    }
+
+    hardwareTime = time;
+    updated      = true;
+}
+
+
+/**
+ * @brief Returns the current system time.
+ *
+ * All time based logic (debouncing, door timeouts) shall use this function instead
+ * of calling millis() directly. The door control instances get the time passed in,
+ * so the trace replay drives its instance with a virtual clock of its own.
+ *
+ * @return The time of the current main loop iteration, see sysClock_update() @unit ms
+ */
+uint32_t sysClock_millis( void )
+{
+    return hardwareTime;
+}
+
+
+/**
+ * @brief Returns the time since boot.
+ *
+ * @return The uptime of the current main loop iteration @unit ms
+ */
+uint64_t sysClock_getUptime( void )
+{
+    return ( ( ( (uint64_t) wrapCount ) << 32 ) | hardwareTime ) - SYS_CLOCK_START_OFFSET;
+}
+
+
+/**
+ * @brief Checks whether a deadline has been reached, across the wraparound.
+ *
+ * @param now The current time @unit ms
+ * @param deadline The deadline, less than 24.8 days away from now @unit ms
+ * @return true if now is at or after the deadline, false otherwise.
+ */
+bool sysClock_isExpired( uint32_t now, uint32_t deadline )
+{
+    return (int32_t) ( now - deadline ) >= 0;
+}
+
+
+/**
+ * @brief Checks whether a time lies before another one, across the wraparound.
+ *
+ * @param time The time to check @unit ms
+ * @param reference The time to compare with, less than 24.8 days away @unit ms
+ * @return true if time is before reference, false otherwise.
+ */
+bool sysClock_isEarlier( uint32_t time, uint32_t reference )
+{
+    return (int32_t) ( time - reference ) < 0;
+}
+
+
+/**
+ * @brief Records the time of a boot milestone.
+ *
+ * The time is read from micros(), which counts from the start of the firmware. The time
+ * the bootloader waits after a reset isn't included.
+ *
+ * @param milestone The reached boot milestone.
+ */
+void sysClock_markBoot( sys_clock_boot_t milestone )
+{
+    bootTime[milestone] = micros();
+}
+
+
+/**
+ * @brief Returns the time of a boot milestone.
+ *
+ * @param milestone The boot milestone.
+ * @return The time since the start of the firmware, 0 if not reached yet @unit us
+ */
+uint32_t sysClock_getBootTime( sys_clock_boot_t milestone )
+{
+    return bootTime[milestone];
+}
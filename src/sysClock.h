@@ -0,0 +1,51 @@
+/**
+ * \file    sysClock.h
+ * \brief   Header file for the system clock
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef SYSTEM_CLOCK_H
+#define SYSTEM_CLOCK_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#ifndef SYS_CLOCK_START_OFFSET
+/**
+ * @brief Offset added to the hardware clock @unit ms
+ * @details A value close to 2^32 lets the 32-bit clock wrap around shortly after boot,
+ *          e.g. -D SYS_CLOCK_START_OFFSET=4294907296UL wraps after one minute.
+ */
+#define SYS_CLOCK_START_OFFSET  0UL
+#endif
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the measured boot milestones
+ */
+typedef enum
+{
+    SYS_CLOCK_BOOT_LOCKED, /*!< All outputs are in their safe state: doors locked, leds off */
+    SYS_CLOCK_BOOT_READY,  /*!< setup() is done, the main loop starts */
+    SYS_CLOCK_BOOT_SIZE    /*!< Number of boot milestones */
+} sys_clock_boot_t;
+
+/************************************* STRUCTURE **************************************/
+
+/******************************** Function prototype ************************************/
+
+void     sysClock_update( void );
+uint32_t sysClock_millis( void );
+uint64_t sysClock_getUptime( void );
+bool     sysClock_isExpired( uint32_t now, uint32_t deadline );
+bool     sysClock_isEarlier( uint32_t time, uint32_t reference );
+void     sysClock_markBoot( sys_clock_boot_t milestone );
+uint32_t sysClock_getBootTime( sys_clock_boot_t milestone );
+
+#endif  // SYSTEM_CLOCK_H
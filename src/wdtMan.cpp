@@ -0,0 +1,254 @@
+/**
+ * \file    wdtMan.cpp
+ * \brief   Source file for the watchdog supervision
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#if defined( ARDUINO_ARCH_AVR )
+#include <avr/wdt.h>
+#elif defined( ARDUINO_ARCH_RENESAS )
+#include <WDT.h>
+#endif
+
+#include "wdtMan.h"
+#include "logging.h"
+
+/*
+ * The hardware watchdog is only kicked at the end of a main loop iteration in which no
+ * stage is running and every stage that ran finished within its deadline. A stage that
+ * hangs, or keeps overrunning its deadline, therefore resets the controller after
+ * WDT_TIMEOUT at the latest.
+ *
+ * The stages that are running are tracked in a record that isn't initialized at startup.
+ * After a reset, a valid record with running stages tells which stage overran. Only the
+ * AVR linker script has a section that isn't initialized, on the other targets the record
+ * is cleared at startup and only the deadline misses since then are known.
+ *
+ * The stage durations are measured with the hardware clock, never with the virtual
+ * clock of a trace replay.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#if defined( ARDUINO_ARCH_AVR )
+#define WDT_RECORD_SECTION      __attribute__( ( section( ".noinit" ) ) ) /*!< Keeps the reset record over a reset */
+#else
+#define WDT_RECORD_SECTION                                                /*!< No section survives the reset */
+#endif
+
+
+/**************************** Static Function prototype *********************************/
+
+static void wdtMan_kick( void );
+
+
+/******************************** Global variables ************************************/
+
+static wdt_record_t wdtRecord WDT_RECORD_SECTION; /*!< Survives the watchdog reset, see WDT_RECORD_SECTION */
+
+static uint16_t stageDeadline[WDT_STAGE_SIZE] = {
+    [WDT_STAGE_CLI]      = WDT_DEADLINE_CLI,
+    [WDT_STAGE_EVENTS]   = WDT_DEADLINE_EVENTS,
+    [WDT_STAGE_TIMERS]   = WDT_DEADLINE_TIMERS,
+    [WDT_STAGE_DISPATCH] = WDT_DEADLINE_DISPATCH,
+    [WDT_STAGE_ACCESS]   = WDT_DEADLINE_ACCESS,
+}; /*!< The deadline of each stage @unit ms */
+
+static uint32_t stageStart[WDT_STAGE_SIZE];     /*!< The start time of each running stage @unit ms */
+static uint16_t deadlineMisses[WDT_STAGE_SIZE]; /*!< Number of deadline misses of each stage */
+static bool     deadlineMissed = false;         /*!< A stage overran since the last kick */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Stops the hardware watchdog left running by a watchdog reset.
+ *
+ * Must be the first call of setup(). After a watchdog reset the watchdog of the Mega keeps
+ * running with its shortest timeout of about 16 ms, which would reset the controller again
+ * before wdtMan_setup() arms it. The watchdog of the Uno R4 is stopped by every reset.
+ */
+void wdtMan_disable( void )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    MCUSR &= ~( 1 << WDRF );
+    wdt_disable();
+#endif
+}
+
+
+/**
+ * @brief Sets up the watchdog supervision.
+ *
+ * Evaluates the reset record of the previous run and arms the hardware watchdog, which
+ * wdtMan_disable() stopped at the start of setup().
+ */
+void wdtMan_setup( void )
+{
+    Log.noticeln( "%s: Setting up the watchdog", __func__ );
+
+    if ( wdtRecord.magic != WDT_RECORD_MAGIC )
+    {
+        /* Power-up, the record holds random data */
+        memset( &wdtRecord, 0, sizeof( wdt_record_t ) );
+        wdtRecord.magic = WDT_RECORD_MAGIC;
+    }
+    else if ( wdtRecord.activeStages != 0 )
+    {
+        wdtRecord.lastStages = wdtRecord.activeStages;
+        wdtRecord.resetCount++;
+        Log.warningln( "%s: Reset while stages 0x%x were running", __func__, wdtRecord.lastStages );
+    }
+
+    wdtRecord.activeStages = 0;
+
+#if defined( ARDUINO_ARCH_AVR )
+    wdt_enable( WDTO_2S ); /* WDT_TIMEOUT */
+#elif defined( ARDUINO_ARCH_RENESAS )
+    WDT.begin( WDT_TIMEOUT );
+#endif
+}
+
+
+/**
+ * @brief Marks the start of a stage.
+ *
+ * @param stage The stage. Must be less than WDT_STAGE_SIZE.
+ */
+void wdtMan_beginStage( wdt_stage_t stage )
+{
+    stageStart[stage]       = millis();
+    wdtRecord.activeStages |= ( 1 << stage );
+}
+
+
+/**
+ * @brief Marks the end of a stage and checks its deadline.
+ *
+ * @param stage The stage. Must be less than WDT_STAGE_SIZE.
+ */
+void wdtMan_endStage( wdt_stage_t stage )
+{
+    wdtRecord.activeStages &= ~( 1 << stage );
+
+    if ( ( millis() - stageStart[stage] ) > stageDeadline[stage] )
+    {
+        deadlineMisses[stage]++;
+        deadlineMissed = true;
+    }
+}
+
+
+/**
+ * @brief Reports the progress of a long running stage.
+ *
+ * A stage that runs longer than its deadline on purpose, like the benchmark command,
+ * calls this between steps that each fit into the deadline. The deadline restarts and
+ * the watchdog is kicked if the step finished in time. Does nothing if the stage isn't
+ * running.
+ *
+ * @param stage The stage. Must be less than WDT_STAGE_SIZE.
+ */
+void wdtMan_feedStage( wdt_stage_t stage )
+{
+    if ( ( wdtRecord.activeStages & ( 1 << stage ) ) == 0 )
+    {
+        return;
+    }
+
+    const uint32_t now = millis();
+
+    if ( ( now - stageStart[stage] ) > stageDeadline[stage] )
+    {
+        deadlineMisses[stage]++;
+        deadlineMissed = true;
+    }
+    else if ( !deadlineMissed )
+    {
+        wdtMan_kick();
+    }
+
+    stageStart[stage] = now;
+}
+
+
+/**
+ * @brief Kicks the watchdog if all stages made progress in time.
+ *
+ * Must be called once at the end of every main loop iteration.
+ */
+void wdtMan_process( void )
+{
+    if ( !deadlineMissed && ( wdtRecord.activeStages == 0 ) )
+    {
+        wdtMan_kick();
+    }
+
+    deadlineMissed = false;
+}
+
+
+/**
+ * @brief Changes the deadline of a stage.
+ *
+ * @param stage The stage.
+ * @param deadline The deadline @unit ms
+ */
+void wdtMan_setDeadline( wdt_stage_t stage, uint16_t deadline )
+{
+    if ( stage >= WDT_STAGE_SIZE )
+    {
+        Log.errorln( "%s: Invalid stage: %d", __func__, stage );
+        return;
+    }
+
+    stageDeadline[stage] = deadline;
+}
+
+
+/**
+ * @brief Returns the number of deadline misses of a stage since startup.
+ *
+ * @param stage The stage.
+ * @return uint16_t The number of deadline misses.
+ */
+uint16_t wdtMan_getDeadlineMisses( wdt_stage_t stage )
+{
+    if ( stage >= WDT_STAGE_SIZE )
+    {
+        Log.errorln( "%s: Invalid stage: %d", __func__, stage );
+        return 0;
+    }
+
+    return deadlineMisses[stage];
+}
+
+
+/**
+ * @brief Returns the reset record.
+ *
+ * @return const wdt_record_t* Pointer to the reset record.
+ */
+const wdt_record_t* wdtMan_getRecord( void )
+{
+    return &wdtRecord;
+}
+
+
+/**
+ * @brief Restarts the hardware watchdog timeout.
+ */
+static void wdtMan_kick( void )
+{
+#if defined( ARDUINO_ARCH_AVR )
+    wdt_reset();
+#elif defined( ARDUINO_ARCH_RENESAS )
+    WDT.refresh();
+#endif
+}
@@ -0,0 +1,68 @@
+/**
+ * \file    wdtMan.h
+ * \brief   Header file for the watchdog supervision
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef WATCHDOG_MANAGEMENT_H
+#define WATCHDOG_MANAGEMENT_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define WDT_TIMEOUT             2000       /*!< Time without a watchdog kick until the reset @unit ms */
+#define WDT_DEADLINE_CLI        250        /*!< Deadline of the command line interface stage @unit ms */
+#define WDT_DEADLINE_EVENTS     20         /*!< Deadline of the event generation stage @unit ms */
+#define WDT_DEADLINE_TIMERS     20         /*!< Deadline of the door timer stage @unit ms */
+#define WDT_DEADLINE_DISPATCH   50         /*!< Deadline of the event dispatch stage @unit ms */
+#define WDT_DEADLINE_ACCESS     20         /*!< Deadline of the access control stage @unit ms */
+#define WDT_RECORD_MAGIC        0x57445431 /*!< Marks a valid reset record ("WDT1") */
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the supervised main loop stages
+ */
+typedef enum
+{
+    WDT_STAGE_CLI,      /*!< comLineIf_process() */
+    WDT_STAGE_EVENTS,   /*!< Event generation of stateMan_process() */
+    WDT_STAGE_TIMERS,   /*!< Door sequence timeouts of stateMan_process() */
+    WDT_STAGE_DISPATCH, /*!< Event dispatch of stateMan_process() */
+    WDT_STAGE_ACCESS,   /*!< rtcClock_process(), schedMan_process(), badgeMan_process() and ctrlBus_process() */
+    WDT_STAGE_SIZE      /*!< Number of stages */
+} wdt_stage_t;
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The reset record
+ * @details Kept in a section that isn't initialized at startup on the Mega, so it survives a reset
+ */
+typedef struct
+{
+    uint32_t magic;        /*!< WDT_RECORD_MAGIC if the record is valid */
+    uint8_t  activeStages; /*!< Bit n is set while stage n is running */
+    uint8_t  lastStages;   /*!< The stages that were running at the last reset */
+    uint16_t resetCount;   /*!< Number of resets while a stage was running */
+} wdt_record_t;
+
+/******************************** Function prototype ************************************/
+
+void     wdtMan_disable( void );
+void     wdtMan_setup( void );
+void     wdtMan_beginStage( wdt_stage_t stage );
+void     wdtMan_endStage( wdt_stage_t stage );
+void     wdtMan_feedStage( wdt_stage_t stage );
+void     wdtMan_process( void );
+void     wdtMan_setDeadline( wdt_stage_t stage, uint16_t deadline );
+uint16_t wdtMan_getDeadlineMisses( wdt_stage_t stage );
+
+const wdt_record_t* wdtMan_getRecord( void );
+
+#endif  // WATCHDOG_MANAGEMENT_H
@@ -0,0 +1,169 @@
+/**
+ * \file    Arduino.h
+ * \brief   Host stand-in for the Arduino core, used by the native test environment
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include <string>
+
+/*
+ * Only the part of the Arduino core that the firmware uses is provided. The time, the
+ * pins and the serial interfaces are controlled by the tests, see hostShim.h. Flash
+ * memory is ordinary memory on the host, so the PROGMEM accessors read it directly.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define ARDUINO_ARCH_HOST       /*!< The architecture of the stand-in, the real cores set theirs on the command line */
+
+#define LOW             0
+#define HIGH            1
+
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+
+#define CHANGE          1
+#define FALLING         2
+#define RISING          3
+
+#define DEC             10
+#define HEX             16
+
+#define A0              14
+#define A1              15
+#define A2              16
+#define A3              17
+#define A4              18
+#define A5              19
+
+#define PROGMEM
+#define F( string )             ( reinterpret_cast<const __FlashStringHelper*>( string ) )
+#define pgm_read_byte( pAddress ) ( *(const uint8_t*) ( pAddress ) )
+#define pgm_read_word( pAddress ) ( *(const uint16_t*) ( pAddress ) )
+#define pgm_read_ptr( pAddress )  ( *(void* const*) ( pAddress ) )
+#define memcpy_P                memcpy
+#define strcmp_P                strcmp
+#define strlen_P                strlen
+
+#ifndef min
+#define min( a, b )             ( ( a ) < ( b ) ? ( a ) : ( b ) )
+#endif
+#ifndef max
+#define max( a, b )             ( ( a ) > ( b ) ? ( a ) : ( b ) )
+#endif
+
+typedef bool boolean;
+
+class __FlashStringHelper;
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The string class of the Arduino core
+ */
+class String : public std::string
+{
+public:
+    String() {}
+    String( const char* pString ) : std::string( pString ) {}
+    String( const std::string& string ) : std::string( string ) {}
+    String( int value ) : std::string( std::to_string( value ) ) {}
+    String( unsigned int value ) : std::string( std::to_string( value ) ) {}
+    String( long value ) : std::string( std::to_string( value ) ) {}
+    String( unsigned long value ) : std::string( std::to_string( value ) ) {}
+
+    long toInt( void ) const { return atol( c_str() ); }
+
+    String operator+( const String& other ) const { return String( std::string( *this ) + std::string( other ) ); }
+    String operator+( const char* pOther ) const { return String( std::string( *this ) + pOther ); }
+};
+
+/**
+ * @brief The formatted output of the Arduino core
+ * @details All output ends in write( uint8_t ) of the derived class
+ */
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write( uint8_t character ) = 0;
+    virtual size_t write( const uint8_t* pBuffer, size_t size );
+    size_t         write( const char* pBuffer, size_t size ) { return write( (const uint8_t*) pBuffer, size ); }
+
+    size_t print( const __FlashStringHelper* pString ) { return print( (const char*) pString ); }
+    size_t print( const char* pString ) { return write( pString, strlen( pString ) ); }
+    size_t print( const String& string ) { return write( string.c_str(), string.size() ); }
+    size_t print( char character ) { return write( (uint8_t) character ); }
+    size_t print( unsigned char value, int base = DEC ) { return print( (unsigned long) value, base ); }
+    size_t print( int value, int base = DEC ) { return print( (long) value, base ); }
+    size_t print( unsigned int value, int base = DEC ) { return print( (unsigned long) value, base ); }
+    size_t print( long value, int base = DEC );
+    size_t print( unsigned long value, int base = DEC );
+    size_t print( double value, int digits = 2 );
+
+    size_t println( void ) { return print( "\r\n" ); }
+    template <typename T> size_t println( T value ) { return print( value ) + println(); }
+    template <typename T> size_t println( T value, int format ) { return print( value, format ) + println(); }
+};
+
+/**
+ * @brief A serial interface fed by the tests
+ */
+class HardwareSerial : public Print
+{
+public:
+    void   begin( unsigned long baudRate ) { (void) baudRate; }
+    void   end( void ) {}
+    void   flush( void ) {}
+    int    available( void );
+    int    availableForWrite( void ) { return 64; }
+    int    read( void );
+    int    peek( void );
+    size_t write( uint8_t character ) override;
+    size_t write( const uint8_t* pBuffer, size_t size ) override;
+    operator bool() { return true; }
+
+    using Print::write;
+
+    std::string input;  /*!< The characters the firmware hasn't read yet */
+    std::string output; /*!< The characters the firmware wrote */
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+
+/******************************** Function prototype ************************************/
+
+unsigned long millis( void );
+unsigned long micros( void );
+void          delay( unsigned long ms );
+void          delayMicroseconds( unsigned int us );
+
+void    pinMode( uint8_t pin, uint8_t mode );
+void    digitalWrite( uint8_t pin, uint8_t level );
+int     digitalRead( uint8_t pin );
+uint8_t digitalPinToInterrupt( uint8_t pin );
+void    attachInterrupt( uint8_t interrupt, void ( *isr )( void ), int mode );
+void    detachInterrupt( uint8_t interrupt );
+
+void noInterrupts( void );
+void interrupts( void );
+long random( long max );
+
+#endif  // HOST_ARDUINO_H
@@ -0,0 +1,55 @@
+/**
+ * \file    ArduinoLog.h
+ * \brief   Host stand-in for the ArduinoLog library, used by the native test environment
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HOST_ARDUINO_LOG_H
+#define HOST_ARDUINO_LOG_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define LOG_LEVEL_SILENT    0
+#define LOG_LEVEL_FATAL     1
+#define LOG_LEVEL_ERROR     2
+#define LOG_LEVEL_WARNING   3
+#define LOG_LEVEL_INFO      4
+#define LOG_LEVEL_NOTICE    4
+#define LOG_LEVEL_TRACE     5
+#define LOG_LEVEL_VERBOSE   6
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The logger of the ArduinoLog library
+ * @details Keeps the log level, the messages are dropped
+ */
+class Logging
+{
+public:
+    void begin( int level, Print* pOutput, bool showLevel = true ) { this->level = level; (void) pOutput; (void) showLevel; }
+    int  getLevel( void ) { return level; }
+    void setLevel( int level ) { this->level = level; }
+
+    template <class T, typename... Args> void fatalln( T message, Args... args ) {}
+    template <class T, typename... Args> void error( T message, Args... args ) {}
+    template <class T, typename... Args> void errorln( T message, Args... args ) {}
+    template <class T, typename... Args> void warningln( T message, Args... args ) {}
+    template <class T, typename... Args> void notice( T message, Args... args ) {}
+    template <class T, typename... Args> void noticeln( T message, Args... args ) {}
+    template <class T, typename... Args> void traceln( T message, Args... args ) {}
+    template <class T, typename... Args> void verboseln( T message, Args... args ) {}
+
+private:
+    int level = LOG_LEVEL_SILENT; /*!< The log level */
+};
+
+extern Logging Log;
+
+#endif  // HOST_ARDUINO_LOG_H
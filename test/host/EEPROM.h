@@ -0,0 +1,53 @@
+/**
+ * \file    EEPROM.h
+ * \brief   Host stand-in for the EEPROM library, used by the native test environment
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define HOST_EEPROM_SIZE    4096 /*!< Size of the EEPROM of the Mega @unit bytes */
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The EEPROM, erased (0xFF) at the start of the test
+ */
+class EEPROMClass
+{
+public:
+    EEPROMClass() { erase(); }
+
+    void     erase( void ) { memset( memory, 0xFF, sizeof( memory ) ); }
+    uint16_t length( void ) { return HOST_EEPROM_SIZE; }
+    uint8_t  read( int address ) { return memory[address]; }
+    void     write( int address, uint8_t value ) { memory[address] = value; }
+    void     update( int address, uint8_t value ) { memory[address] = value; }
+
+    template <typename T> T& get( int address, T& value )
+    {
+        memcpy( &value, &memory[address], sizeof( T ) );
+        return value;
+    }
+
+    template <typename T> const T& put( int address, const T& value )
+    {
+        memcpy( &memory[address], &value, sizeof( T ) );
+        return value;
+    }
+
+    uint8_t memory[HOST_EEPROM_SIZE]; /*!< The EEPROM content */
+};
+
+extern EEPROMClass EEPROM;
+
+#endif  // HOST_EEPROM_H
@@ -0,0 +1,37 @@
+/**
+ * \file    TimerOne.h
+ * \brief   Host stand-in for the TimerOne library, used by the native test environment
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HOST_TIMER_ONE_H
+#define HOST_TIMER_ONE_H
+
+#include <Arduino.h>
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief Timer 1, the tests call the attached interrupt themselves
+ */
+class TimerOne
+{
+public:
+    void initialize( unsigned long period = 1000000 ) { this->period = period; }
+    void setPeriod( unsigned long period ) { this->period = period; }
+    void start( void ) {}
+    void stop( void ) {}
+    void attachInterrupt( void ( *isr )( void ) ) { this->isr = isr; }
+    void detachInterrupt( void ) { isr = NULL; }
+
+    unsigned long period = 0;    /*!< The period @unit us */
+    void ( *isr )( void ) = NULL; /*!< The attached interrupt, may be NULL */
+};
+
+extern TimerOne Timer1;
+
+#endif  // HOST_TIMER_ONE_H
@@ -0,0 +1,296 @@
+/**
+ * \file    hostShim.cpp
+ * \brief   Source file for the host stand-ins of the Arduino core and libraries
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <stdio.h>
+#include <chrono>
+
+#include <Arduino.h>
+#include <ArduinoLog.h>
+#include <EEPROM.h>
+#include <TimerOne.h>
+
+#include "hostShim.h"
+
+/*
+ * The clock only advances when a test advances it or sets a step for every call of
+ * micros(), so every test is repeatable. It counts microseconds in 64 bits, millis() and
+ * micros() wrap like on the target. Only the benchmarks read the real time of the host,
+ * through hostShim_readCounter().
+ */
+
+
+/******************************** Global variables ************************************/
+
+HardwareSerial Serial;  /*!< The serial interface of the command line */
+HardwareSerial Serial1; /*!< The serial interface of the controller bus */
+Logging        Log;     /*!< The logger */
+EEPROMClass    EEPROM;  /*!< The EEPROM */
+TimerOne       Timer1;  /*!< Timer 1 */
+
+static uint64_t hostTime = 0;                               /*!< The simulated time @unit us */
+static uint32_t hostMicrosStep = 0;                         /*!< Time that passes with every micros() call @unit us */
+static uint8_t  hostPinLevel[HOST_SHIM_PIN_SIZE];           /*!< The level of every pin */
+static uint32_t hostPinWrites[HOST_SHIM_PIN_SIZE];          /*!< The writes of every pin */
+
+
+/******************************** Function definition ************************************/
+
+
+/**
+ * @brief Restores the power-up state: time 0, pins low, serial interfaces empty.
+ *
+ * The EEPROM keeps its content, like on the target.
+ */
+void hostShim_reset( void )
+{
+    hostTime       = 0;
+    hostMicrosStep = 0;
+    memset( hostPinLevel, LOW, sizeof( hostPinLevel ) );
+    memset( hostPinWrites, 0, sizeof( hostPinWrites ) );
+    Serial.input.clear();
+    Serial.output.clear();
+    Serial1.input.clear();
+    Serial1.output.clear();
+}
+
+
+/**
+ * @brief Sets the time returned by millis().
+ *
+ * @param ms The time @unit ms
+ */
+void hostShim_setMillis( uint32_t ms )
+{
+    hostTime = (uint64_t) ms * 1000;
+}
+
+
+/**
+ * @brief Advances the time.
+ *
+ * @param ms The time span @unit ms
+ */
+void hostShim_advanceMillis( uint32_t ms )
+{
+    hostTime += (uint64_t) ms * 1000;
+}
+
+
+/**
+ * @brief Advances the time.
+ *
+ * @param us The time span @unit us
+ */
+void hostShim_advanceMicros( uint32_t us )
+{
+    hostTime += us;
+}
+
+
+/**
+ * @brief Lets the time pass with every call of micros(), like a running clock.
+ *
+ * @param us The time that passes per call, 0 to stop the clock @unit us
+ */
+void hostShim_setMicrosStep( uint32_t us )
+{
+    hostMicrosStep = us;
+}
+
+
+/**
+ * @brief Sets the level of an input pin.
+ *
+ * @param pin The pin number.
+ * @param level The pin level.
+ */
+void hostShim_setPin( uint8_t pin, uint8_t level )
+{
+    hostPinLevel[pin] = level;
+}
+
+
+/**
+ * @brief Returns the level of a pin.
+ *
+ * @param pin The pin number.
+ * @return The level last written or set.
+ */
+uint8_t hostShim_getPin( uint8_t pin )
+{
+    return hostPinLevel[pin];
+}
+
+
+/**
+ * @brief Returns the number of writes of a pin.
+ *
+ * @param pin The pin number.
+ * @return The number of digitalWrite() calls since hostShim_reset().
+ */
+uint32_t hostShim_getPinWrites( uint8_t pin )
+{
+    return hostPinWrites[pin];
+}
+
+
+/**
+ * @brief Reads the monotonic clock of the host, independent of the simulated time.
+ *
+ * @return uint32_t The clock, wraps every 4.3 s @unit ns
+ */
+uint32_t hostShim_readCounter( void )
+{
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+/************************************ Arduino core **************************************/
+
+unsigned long millis( void )
+{
+    return (uint32_t) ( hostTime / 1000 );
+}
+
+unsigned long micros( void )
+{
+    hostTime += hostMicrosStep;
+    return (uint32_t) hostTime;
+}
+
+void delay( unsigned long ms )
+{
+    hostShim_advanceMillis( ms );
+}
+
+void delayMicroseconds( unsigned int us )
+{
+    hostShim_advanceMicros( us );
+}
+
+void pinMode( uint8_t pin, uint8_t mode )
+{
+    (void) pin;
+    (void) mode;
+}
+
+void digitalWrite( uint8_t pin, uint8_t level )
+{
+    hostPinLevel[pin] = level;
+    hostPinWrites[pin]++;
+}
+
+int digitalRead( uint8_t pin )
+{
+    return hostPinLevel[pin];
+}
+
+uint8_t digitalPinToInterrupt( uint8_t pin )
+{
+    return pin;
+}
+
+void attachInterrupt( uint8_t interrupt, void ( *isr )( void ), int mode )
+{
+    (void) interrupt;
+    (void) isr;
+    (void) mode;
+}
+
+void detachInterrupt( uint8_t interrupt )
+{
+    (void) interrupt;
+}
+
+void noInterrupts( void )
+{
+}
+
+void interrupts( void )
+{
+}
+
+long random( long max )
+{
+    return rand() % max;
+}
+
+
+/******************************** Print and serial ***************************************/
+
+size_t Print::write( const uint8_t* pBuffer, size_t size )
+{
+    for ( size_t i = 0; i < size; i++ )
+    {
+        write( pBuffer[i] );
+    }
+
+    return size;
+}
+
+size_t Print::print( long value, int base )
+{
+    if ( ( value < 0 ) && ( base == DEC ) )
+    {
+        return print( '-' ) + print( (unsigned long) -value, base );
+    }
+
+    return print( (unsigned long) value, base );
+}
+
+size_t Print::print( unsigned long value, int base )
+{
+    char buffer[24];
+
+    snprintf( buffer, sizeof( buffer ), ( base == HEX ) ? "%lX" : "%lu", value );
+    return print( buffer );
+}
+
+size_t Print::print( double value, int digits )
+{
+    char buffer[32];
+
+    snprintf( buffer, sizeof( buffer ), "%.*f", digits, value );
+    return print( buffer );
+}
+
+int HardwareSerial::available( void )
+{
+    return (int) input.size();
+}
+
+int HardwareSerial::read( void )
+{
+    if ( input.empty() )
+    {
+        return -1;
+    }
+
+    const int character = (uint8_t) input[0];
+    input.erase( 0, 1 );
+    return character;
+}
+
+int HardwareSerial::peek( void )
+{
+    return input.empty() ? -1 : (uint8_t) input[0];
+}
+
+size_t HardwareSerial::write( uint8_t character )
+{
+    output += (char) character;
+    return 1;
+}
+
+size_t HardwareSerial::write( const uint8_t* pBuffer, size_t size )
+{
+    output.append( (const char*) pBuffer, size );
+    return size;
+}
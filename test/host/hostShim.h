@@ -0,0 +1,32 @@
+/**
+ * \file    hostShim.h
+ * \brief   Header file for the control of the host stand-ins by the tests
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include <Arduino.h>
+
+/*************************************** Defines ****************************************/
+
+#define HOST_SHIM_PIN_SIZE      128 /*!< Number of simulated pins */
+
+/******************************** Function prototype ************************************/
+
+void     hostShim_reset( void );
+void     hostShim_setMillis( uint32_t ms );
+void     hostShim_advanceMillis( uint32_t ms );
+void     hostShim_advanceMicros( uint32_t us );
+void     hostShim_setMicrosStep( uint32_t us );
+void     hostShim_setPin( uint8_t pin, uint8_t level );
+uint8_t  hostShim_getPin( uint8_t pin );
+uint32_t hostShim_getPinWrites( uint8_t pin );
+uint32_t hostShim_readCounter( void );
+
+#endif  // HOST_SHIM_H
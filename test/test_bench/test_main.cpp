@@ -0,0 +1,131 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Runs the micro benchmarks of the firmware hot paths on the host
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "hostShim.h"
+#include "bench.h"
+
+/*
+ * The benchmarks time the real sources with the monotonic clock of the host. The
+ * report has the format of the bench command and is compared with tools/bench.py
+ * against a report of the host, never against one of a controller. The environment
+ * variable BENCH_REPORT names a file to store the report in:
+ *
+ *     BENCH_REPORT=current.json pio test -e native -f test_bench
+ *     python tools/bench.py compare baseline.json current.json --threshold 10
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define TEST_CLI_CASE           "cli_parse" /*!< The benchmark of the command line parser */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    hostShim_reset();
+    Serial.output.clear();
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Returns the index of a benchmark.
+ */
+static uint8_t test_findCase( const char* pName )
+{
+    for ( uint8_t i = 0; i < bench_getCaseCount(); i++ )
+    {
+        if ( strcmp( bench_getCase( i )->pName, pName ) == 0 )
+        {
+            return i;
+        }
+    }
+
+    TEST_FAIL_MESSAGE( pName );
+    return 0;
+}
+
+
+void test_everyBenchmarkIsMeasured( void )
+{
+    for ( uint8_t i = 0; i < bench_getCaseCount(); i++ )
+    {
+        bench_result_t result = { UINT32_MAX, UINT32_MAX };
+
+        bench_measure( i, &result );
+        TEST_ASSERT_TRUE( result.minCycles <= result.medianCycles );
+        TEST_ASSERT_TRUE( result.medianCycles != UINT32_MAX );
+    }
+}
+
+
+void test_parseThroughput( void )
+{
+    bench_result_t result;
+
+    bench_measure( test_findCase( TEST_CLI_CASE ), &result );
+
+    /* A parse takes longer than reading the clock of the host */
+    TEST_ASSERT_TRUE( result.medianCycles > 0 );
+
+    printf( "%s: %lu ns per command, %lu commands/s\n", TEST_CLI_CASE, (unsigned long) bench_cyclesToNs( result.medianCycles ),
+            1000000000UL / bench_cyclesToNs( result.medianCycles ) );
+}
+
+
+void test_reportHasTheFormatOfBenchPy( void )
+{
+    bench_printJson();
+
+    const std::string report = Serial.output;
+
+    TEST_ASSERT_EQUAL( 0, report.find( "{\"bench\":1,\"version\":\"" ) );
+    TEST_ASSERT_TRUE( report.find( "\"target\":\"host\",\"clock_mhz\":1000,\"cases\":[" ) != std::string::npos );
+    TEST_ASSERT_EQUAL( report.size() - 4, report.rfind( "]}\r\n" ) );
+
+    for ( uint8_t i = 0; i < bench_getCaseCount(); i++ )
+    {
+        const std::string name = std::string( "{\"name\":\"" ) + bench_getCase( i )->pName + "\",\"iterations\":";
+
+        TEST_ASSERT_TRUE( report.find( name ) != std::string::npos );
+    }
+
+    printf( "%s", report.c_str() );
+
+    const char* pFileName = getenv( "BENCH_REPORT" );
+    if ( pFileName != NULL )
+    {
+        FILE* pFile = fopen( pFileName, "w" );
+
+        TEST_ASSERT_NOT_NULL( pFile );
+        fputs( report.c_str(), pFile );
+        fclose( pFile );
+    }
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_everyBenchmarkIsMeasured );
+    RUN_TEST( test_parseThroughput );
+    RUN_TEST( test_reportHasTheFormatOfBenchPy );
+    return UNITY_END();
+}
@@ -0,0 +1,228 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the command line parser and the configuration batches
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+#include <EEPROM.h>
+
+#include "hostShim.h"
+#include "comLineIf.h"
+#include "appSettings.h"
+#include "stateMan.h"
+
+/******************************** Global variables **************************************/
+
+static door_control_t       doorControl; /*!< The door control instance configured by the commands */
+static ctrl_bus_t           ctrlBus;     /*!< The controller bus configured by the commands, disabled */
+static com_line_if_cmd_t    command;     /*!< The parsed command */
+static com_line_if_values_t values;      /*!< The parsed argument values */
+
+static const char* const commandNames[] = {
+    "info", "log", "timer", "dbc", "inputs", "trace", "replay", "begin", "commit", "abort",
+    "bench", "bus", "badge", "sched", "clock", "emerg", "lat", "budget", "help"
+};
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    memset( &command, 0, sizeof( command ) );
+    memset( &values, 0, sizeof( values ) );
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Parses a command without executing it.
+ *
+ * @param pText The command.
+ * @return The parse result.
+ */
+static com_line_if_parse_t test_parse( const char* pText )
+{
+    char line[COM_LINE_IF_LINE_SIZE];
+
+    strncpy( line, pText, sizeof( line ) - 1 );
+    line[sizeof( line ) - 1] = '\0';
+
+    return comLineIf_parseCommand( line, &command, &values );
+}
+
+
+/**
+ * @brief Sends command lines to the command line interface and processes them.
+ *
+ * @param pText The command lines, each terminated by a newline.
+ */
+static void test_send( const char* pText )
+{
+    Serial.input += pText;
+    comLineIf_process();
+    Serial.output.clear();
+}
+
+
+void test_findsEveryCommand( void )
+{
+    for ( uint8_t i = 0; i < sizeof( commandNames ) / sizeof( commandNames[0] ); i++ )
+    {
+        TEST_ASSERT_TRUE_MESSAGE( test_parse( commandNames[i] ) != COM_LINE_IF_PARSE_UNKNOWN, commandNames[i] );
+        TEST_ASSERT_EQUAL_STRING( commandNames[i], command.name );
+    }
+}
+
+
+void test_unknownCommand( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_UNKNOWN, test_parse( "inf" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_UNKNOWN, test_parse( "infos" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_UNKNOWN, test_parse( "INFO" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_UNKNOWN, test_parse( "xyzzy" ) );
+}
+
+
+void test_emptyLine( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_EMPTY, test_parse( "" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_EMPTY, test_parse( "  \t " ) );
+}
+
+
+void test_namedArguments( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_OK, test_parse( "timer  -b 250\t-u 10" ) );
+    TEST_ASSERT_EQUAL_STRING( "timer", command.name );
+    TEST_ASSERT_TRUE( values.isSet[0] );
+    TEST_ASSERT_EQUAL_INT32( 10, values.value[0] );
+    TEST_ASSERT_FALSE( values.isSet[1] );
+    TEST_ASSERT_EQUAL_INT32( DOOR_OPEN_TIMEOUT, values.value[1] );
+    TEST_ASSERT_TRUE( values.isSet[2] );
+    TEST_ASSERT_EQUAL_INT32( 250, values.value[2] );
+}
+
+
+void test_positionalArgument( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_OK, test_parse( "log 3" ) );
+    TEST_ASSERT_TRUE( values.isSet[0] );
+    TEST_ASSERT_EQUAL_INT32( 3, values.value[0] );
+}
+
+
+void test_invalidArguments( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "log 7" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "log 3 4" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "timer -u 256" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "timer -u 1x" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "timer -z 1" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "timer -u" ) );
+    TEST_ASSERT_EQUAL_STRING( "timer", command.name );
+}
+
+
+void test_missingRequiredArgument( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "dbc -i 1" ) );
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_OK, test_parse( "dbc -t 50 -i 1" ) );
+}
+
+
+void test_tooManyWords( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_TOO_LONG, test_parse( "sched -d 1 -w 1 -f 800 -t 1700 -a 1 1 1" ) );
+}
+
+
+void test_singleCommandIsSaved( void )
+{
+    test_send( "timer -u 12\n" );
+
+    TEST_ASSERT_EQUAL_UINT8( 12, appSettings_getSettings()->doorUnlockTimeout );
+    TEST_ASSERT_EQUAL_UINT8( 12, EEPROM.read( 0 ) );
+}
+
+
+void test_batchIsAppliedOnCommit( void )
+{
+    test_send( "begin\ntimer -u 20\r\ndbc -i 0 -t 55\n" );
+    TEST_ASSERT_EQUAL_UINT8( 12, appSettings_getSettings()->doorUnlockTimeout );
+
+    test_send( "commit\n" );
+    TEST_ASSERT_EQUAL_UINT8( 20, appSettings_getSettings()->doorUnlockTimeout );
+    TEST_ASSERT_EQUAL_UINT16( 55, appSettings_getSettings()->debounceDelay[0] );
+    TEST_ASSERT_EQUAL_UINT8( 20, EEPROM.read( 0 ) );
+}
+
+
+void test_batchIsDiscardedOnAbort( void )
+{
+    test_send( "begin\ntimer -u 30\nabort\n" );
+
+    TEST_ASSERT_EQUAL_UINT8( 20, appSettings_getSettings()->doorUnlockTimeout );
+    TEST_ASSERT_EQUAL_UINT8( 20, EEPROM.read( 0 ) );
+}
+
+
+void test_bulkLineIsAppliedTogether( void )
+{
+    test_send( "timer -u 40; timer -o 7\n" );
+
+    TEST_ASSERT_EQUAL_UINT8( 40, appSettings_getSettings()->doorUnlockTimeout );
+    TEST_ASSERT_EQUAL_UINT16( 7, appSettings_getSettings()->doorOpenTimeout );
+}
+
+
+void test_bulkLineWithErrorChangesNothing( void )
+{
+    test_send( "timer -u 50; dbc -i 9 -t 1\n" );
+
+    TEST_ASSERT_EQUAL_UINT8( 40, appSettings_getSettings()->doorUnlockTimeout );
+    TEST_ASSERT_EQUAL_UINT8( 40, EEPROM.read( 0 ) );
+}
+
+
+void test_deferralAgeIsApplied( void )
+{
+    TEST_ASSERT_EQUAL( COM_LINE_IF_PARSE_INVALID_ARGS, test_parse( "budget -d 65536" ) );
+
+    test_send( "budget -d 30\n" );
+
+    TEST_ASSERT_EQUAL_UINT16( 30, appSettings_getSettings()->deferMaxAge );
+    TEST_ASSERT_EQUAL_UINT16( 30, stateMan_getDispatchBudget( &doorControl )->deferMaxAge );
+}
+
+
+int main( int argc, char** argv )
+{
+    hostShim_reset();
+    stateMan_init( &doorControl, millis() );
+    comLineIf_setup( &doorControl, &ctrlBus );
+
+    UNITY_BEGIN();
+    RUN_TEST( test_findsEveryCommand );
+    RUN_TEST( test_unknownCommand );
+    RUN_TEST( test_emptyLine );
+    RUN_TEST( test_namedArguments );
+    RUN_TEST( test_positionalArgument );
+    RUN_TEST( test_invalidArguments );
+    RUN_TEST( test_missingRequiredArgument );
+    RUN_TEST( test_tooManyWords );
+    RUN_TEST( test_singleCommandIsSaved );
+    RUN_TEST( test_batchIsAppliedOnCommit );
+    RUN_TEST( test_batchIsDiscardedOnAbort );
+    RUN_TEST( test_bulkLineIsAppliedTogether );
+    RUN_TEST( test_bulkLineWithErrorChangesNothing );
+    RUN_TEST( test_deferralAgeIsApplied );
+    return UNITY_END();
+}
@@ -0,0 +1,18 @@
+/* Generated by tools/credentials.py from test/test_credStore/testCredentials.txt, do not edit */
+
+static const uint16_t testTableDisplace[] PROGMEM = {
+    0x0007, 0x00C2, 0x0001, 0x0002, 0x0008, 0x03BD, 0x0081, 0x0010, 0x0148, 0x0061, 0x0000
+};
+static const uint16_t testTableKeyLow[] PROGMEM = {
+    0x03EC, 0x03F1, 0x03EB, 0x03EF, 0x03FE, 0x040A, 0xFFFE, 0x03F0, 0x03FA, 0x0409, 0x040E, 0x03F2,
+    0x03E9, 0x0406, 0x03F8, 0x03EE, 0x03E8, 0x03ED, 0x0407, 0x03F5, 0x0000, 0x03FC, 0x0401, 0xCBB1,
+    0x040D, 0x0405, 0x03F4, 0x03FD, 0x03F6, 0x03FB, 0x0402, 0x0403, 0x03FF, 0x0408, 0x0404, 0xFFFF,
+    0x040F, 0x040B, 0xFFEE, 0x0400, 0x03F3, 0x03EA, 0x03F7, 0x040C, 0x03F9
+};
+static const uint16_t testTableKeyHigh[] PROGMEM = {
+    0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0xFFFF, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C,
+    0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x0000, 0x000C, 0x000C, 0x0074,
+    0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0xFFFF,
+    0x000C, 0x000C, 0x00C0, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C, 0x000C
+};
+static const cred_table_t testTable = { 0x2265B1F5UL, 0x91B7584AUL, 11, 45, 44, testTableDisplace, testTableKeyLow, testTableKeyHigh };
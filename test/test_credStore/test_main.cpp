@@ -0,0 +1,175 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the credential hash and the credential tables
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "credStore.h"
+
+/*
+ * testCredTable.h holds the table of the credentials in testCredentials.txt. It must be
+ * generated again if the hash or the table layout changes:
+ *
+ *     python tools/credentials.py build test/test_credStore/testCredentials.txt
+ *         --output test/test_credStore/testCredTable.h --name testTable
+ *
+ * The table of the firmware depends on the credential list of the project, so it is
+ * only checked for consistency.
+ */
+#include "testCredTable.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_FACILITY           12    /*!< Facility of the 26-bit test badges */
+#define TEST_FIRST_CARD         1000  /*!< First card of the 26-bit test badges */
+#define TEST_CARDS              40    /*!< Number of 26-bit test badges */
+
+
+/******************************** Global variables **************************************/
+
+/**
+ * @brief The credentials of testCredentials.txt besides the 26-bit badges
+ */
+static const uint32_t testCredentials[] = { 0, 7654321, 0x00C0FFEEUL, 0xFFFFFFFEUL };
+
+/**
+ * @brief Hashes of tools/credentials.py: credential, seed, hash
+ */
+static const uint32_t testHashes[][3] = {
+    { 0,            0,            0x00000000UL },
+    { 1,            0,            0x514E28B7UL },
+    { 0x00C0FFEEUL, 0x2265B1F5UL, 0x958B00A3UL },
+    { 0xFFFFFFFEUL, 0x9E3779B1UL, 0x171EE435UL },
+    { 123456789,    0xDEADBEEFUL, 0x6AD6CF46UL }
+};
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Returns a 26-bit badge as credential.
+ */
+static uint32_t test_badge( uint8_t facility, uint16_t card )
+{
+    return ( (uint32_t) facility << 16 ) | card;
+}
+
+
+void test_hashMatchesTheGenerator( void )
+{
+    for ( const auto& hash : testHashes )
+    {
+        TEST_ASSERT_EQUAL_HEX32( hash[2], credStore_hash( hash[0], hash[1] ) );
+    }
+}
+
+
+void test_tableFindsEveryCredential( void )
+{
+    for ( uint16_t card = TEST_FIRST_CARD; card < TEST_FIRST_CARD + TEST_CARDS; card++ )
+    {
+        TEST_ASSERT_TRUE( credStore_contains( &testTable, test_badge( TEST_FACILITY, card ) ) );
+    }
+
+    for ( const uint32_t credential : testCredentials )
+    {
+        TEST_ASSERT_TRUE( credStore_contains( &testTable, credential ) );
+    }
+}
+
+
+void test_tableRejectsOtherCredentials( void )
+{
+    uint32_t accepted = 0;
+
+    /* The neighbouring cards and the same cards of the other facilities */
+    for ( uint32_t card = 0; card < 0x10000UL; card++ )
+    {
+        if ( ( card < TEST_FIRST_CARD ) || ( card >= TEST_FIRST_CARD + TEST_CARDS ) )
+        {
+            accepted += credStore_contains( &testTable, test_badge( TEST_FACILITY, (uint16_t) card ) ) ? 1 : 0;
+        }
+    }
+
+    for ( uint16_t facility = 0; facility <= 0xFF; facility++ )
+    {
+        for ( uint16_t card = TEST_FIRST_CARD; ( facility != TEST_FACILITY ) && ( card < TEST_FIRST_CARD + TEST_CARDS ); card++ )
+        {
+            accepted += credStore_contains( &testTable, test_badge( (uint8_t) facility, card ) ) ? 1 : 0;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32( 0, accepted );
+
+    /* The key of an unused slot is never a credential */
+    TEST_ASSERT_FALSE( credStore_contains( &testTable, CRED_STORE_EMPTY ) );
+    TEST_ASSERT_FALSE( credStore_contains( &testTable, 0xFFFFFFFDUL ) );
+    TEST_ASSERT_FALSE( credStore_contains( &testTable, 1 ) );
+}
+
+
+void test_emptyTableRejectsEverything( void )
+{
+    static const uint16_t displace[] PROGMEM = { 0 };
+    static const uint16_t keyLow[] PROGMEM   = { 0xFFFF };
+    static const uint16_t keyHigh[] PROGMEM  = { 0xFFFF };
+    const cred_table_t    table              = { 0x2265B1F5UL, 0x91B7584AUL, 1, 1, 0, displace, keyLow, keyHigh };
+
+    for ( uint32_t credential = 0; credential < 0x100000UL; credential += 7 )
+    {
+        TEST_ASSERT_FALSE( credStore_contains( &table, credential ) );
+    }
+    TEST_ASSERT_FALSE( credStore_contains( &table, CRED_STORE_EMPTY ) );
+}
+
+
+void test_firmwareTableFindsItsKeys( void )
+{
+    const cred_table_t* const pTable = credStore_getTable();
+    uint16_t                  used   = 0;
+
+    TEST_ASSERT_TRUE( pTable->count <= CRED_STORE_MAX_CREDENTIALS );
+    TEST_ASSERT_TRUE( pTable->count <= pTable->slots );
+    TEST_ASSERT_TRUE( pTable->buckets > 0 );
+
+    for ( uint16_t slot = 0; slot < pTable->slots; slot++ )
+    {
+        const uint32_t key =    pgm_read_word( &pTable->pKeyLow[slot] )
+                             | ( (uint32_t) pgm_read_word( &pTable->pKeyHigh[slot] ) << 16 );
+
+        if ( key != CRED_STORE_EMPTY )
+        {
+            TEST_ASSERT_TRUE( credStore_contains( pTable, key ) );
+            used++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT16( pTable->count, used );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_hashMatchesTheGenerator );
+    RUN_TEST( test_tableFindsEveryCredential );
+    RUN_TEST( test_tableRejectsOtherCredentials );
+    RUN_TEST( test_emptyTableRejectsEverything );
+    RUN_TEST( test_firmwareTableFindsItsKeys );
+    return UNITY_END();
+}
@@ -0,0 +1,341 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the controller bus with several controllers on the host
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "hostShim.h"
+#include "ctrlBus.h"
+#include "stateMan.h"
+#include "sysClock.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_NODES              3    /*!< Controllers on the bus, at the addresses 1..TEST_NODES */
+#define TEST_SETTLE             2000 /*!< Time for the inputs to settle and the neighbours to be seen @unit ms */
+#define TEST_PRESS              200  /*!< Time a button is held @unit ms */
+#define TEST_UNLOCK_TIMEOUT     1    /*!< Unlock timeout of the doors @unit s */
+#define TEST_TRAFFIC            120000UL /*!< Random traffic of the violation test @unit ms */
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief A controller of the test corridor
+ */
+typedef struct
+{
+    door_control_t doorControl; /*!< The door control instance */
+    ctrl_bus_t     bus;         /*!< Its controller bus */
+    HardwareSerial serial;      /*!< The serial interface of its transceiver */
+    bool           muted;       /*!< The frames of the controller are lost, it appears offline */
+    uint8_t        dropSteps;   /*!< The frames of the controller are lost in the next steps */
+} test_node_t;
+
+/******************************** Global variables **************************************/
+
+static test_node_t testNodes[TEST_NODES]; /*!< The controllers by address - 1 */
+static uint32_t    testViolations;        /*!< Steps in which two controllers had a door unlocked */
+static uint32_t    testRandom;            /*!< State of the random generator of the traffic */
+
+
+/******************************** Function definition ************************************/
+
+/**
+ * @brief Returns the unlocked doors of a controller.
+ */
+static uint8_t test_getUnlockedDoors( const test_node_t* pNode )
+{
+    uint8_t doors = 0;
+
+    for ( uint8_t i = 0; i < DOOR_TYPE_SIZE; i++ )
+    {
+        if ( ioMan_getLockState( &pNode->doorControl.io, (door_type_t) i ) == LOCK_STATE_UNLOCKED )
+        {
+            doors |= ( 1 << i );
+        }
+    }
+
+    return doors;
+}
+
+
+/**
+ * @brief Runs all controllers like their main loops, one step per millisecond.
+ *
+ * The bytes a controller writes reach the receivers of all others in the next step, like
+ * on the shared RS-485 line. Every step counts an interlock violation if more than one
+ * controller has a door unlocked.
+ */
+static void test_run( uint32_t span )
+{
+    for ( uint32_t time = 0; time < span; time++ )
+    {
+        hostShim_advanceMillis( 1 );
+        sysClock_update();
+
+        uint8_t unlocked = 0;
+
+        for ( test_node_t& node : testNodes )
+        {
+            ctrlBus_process( &node.bus );
+            stateMan_process( &node.doorControl, sysClock_millis() );
+            unlocked += ( test_getUnlockedDoors( &node ) != 0 ) ? 1 : 0;
+        }
+
+        testViolations += ( unlocked > 1 ) ? 1 : 0;
+
+        for ( test_node_t& sender : testNodes )
+        {
+            const bool lost = sender.muted || ( sender.dropSteps > 0 );
+
+            for ( test_node_t& receiver : testNodes )
+            {
+                if ( !lost && ( &receiver != &sender ) )
+                {
+                    receiver.serial.input += sender.serial.output;
+                }
+            }
+
+            sender.serial.output.clear();
+            sender.dropSteps -= ( sender.dropSteps > 0 ) ? 1 : 0;
+        }
+    }
+}
+
+
+/**
+ * @brief Presses and releases the button of a door.
+ */
+static void test_press( test_node_t* pNode, door_type_t door )
+{
+    const io_t button = ( door == DOOR_TYPE_DOOR_1 ) ? IO_BUTTON_1 : IO_BUTTON_2;
+
+    ioMan_setRawInput( &pNode->doorControl.io, button, HIGH );
+    test_run( TEST_PRESS );
+    ioMan_setRawInput( &pNode->doorControl.io, button, LOW );
+}
+
+
+/**
+ * @brief Returns a pseudo random number below the given limit.
+ */
+static uint32_t test_random( uint32_t limit )
+{
+    testRandom = testRandom * 1664525UL + 1013904223UL;
+    return ( testRandom >> 8 ) % limit;
+}
+
+
+void setUp( void )
+{
+    hostShim_reset();
+    sysClock_update();
+    testViolations = 0;
+
+    for ( uint8_t i = 0; i < TEST_NODES; i++ )
+    {
+        test_node_t* const pNode = &testNodes[i];
+
+        pNode->serial.input.clear();
+        pNode->serial.output.clear();
+        pNode->muted     = false;
+        pNode->dropSteps = 0;
+
+        stateMan_init( &pNode->doorControl, millis() );
+        stateMan_setDoorTimer( &pNode->doorControl, DOOR_TIMER_TYPE_UNLOCK, TEST_UNLOCK_TIMEOUT );
+        ioMan_setInputOverride( &pNode->doorControl.io, true );
+        for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+        {
+            ioMan_setRawInput( &pNode->doorControl.io, (io_t) input, LOW );
+        }
+
+        memset( &pNode->bus.stats, 0, sizeof( pNode->bus.stats ) );
+        ctrlBus_setup( &pNode->bus, &pNode->doorControl, &pNode->serial, 0 );
+        ctrlBus_configure( &pNode->bus, i + 1, ( 1 << TEST_NODES ) - 1 );
+    }
+
+    test_run( TEST_SETTLE );
+
+    for ( const test_node_t& node : testNodes )
+    {
+        TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &node.doorControl ) );
+    }
+}
+
+void tearDown( void )
+{
+}
+
+
+void test_neighboursSeeEachOther( void )
+{
+    for ( uint8_t i = 0; i < TEST_NODES; i++ )
+    {
+        for ( uint8_t address = 1; address <= TEST_NODES; address++ )
+        {
+            TEST_ASSERT_EQUAL( address != ( i + 1 ), ctrlBus_getNode( &testNodes[i].bus, address )->online );
+        }
+
+        TEST_ASSERT_EQUAL_UINT16( 0, ctrlBus_getStats( &testNodes[i].bus )->crcErrors );
+    }
+}
+
+
+void test_grantUnlocksTheDoor( void )
+{
+    test_press( &testNodes[0], DOOR_TYPE_DOOR_1 );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT16( 1, ctrlBus_getStats( &testNodes[0].bus )->grants );
+    TEST_ASSERT_EQUAL_UINT16( 0, ctrlBus_getStats( &testNodes[0].bus )->retransmits );
+    TEST_ASSERT_EQUAL_UINT8( 1, testNodes[1].bus.leaseHolder );
+    TEST_ASSERT_EQUAL_UINT8( 1, testNodes[2].bus.leaseHolder );
+
+    /* The neighbours keep their doors locked while the grant is held */
+    test_press( &testNodes[1], DOOR_TYPE_DOOR_2 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &testNodes[1].doorControl ) );
+
+    /* The grant ends once the door is locked again */
+    test_run( TEST_UNLOCK_TIMEOUT * 1000UL + CTRL_BUS_HEARTBEAT );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 0, testNodes[1].bus.leaseHolder );
+    TEST_ASSERT_EQUAL_UINT8( 0, testNodes[2].bus.leaseHolder );
+
+    test_press( &testNodes[1], DOOR_TYPE_DOOR_2 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_2_UNLOCKED, stateMan_getState( &testNodes[1].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, testViolations );
+}
+
+
+void test_unlockedNeighbourDenies( void )
+{
+    /* Controller 2 unlocks its door without asking the bus */
+    testNodes[1].doorControl.unlockGate = NULL;
+    stateMan_postEvent( &testNodes[1].doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( CTRL_BUS_HEARTBEAT );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &testNodes[1].doorControl ) );
+
+    test_press( &testNodes[0], DOOR_TYPE_DOOR_1 );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL( LOCK_STATE_LOCKED, ioMan_getLockState( &testNodes[0].doorControl.io, DOOR_TYPE_DOOR_1 ) );
+    TEST_ASSERT_TRUE( ctrlBus_getStats( &testNodes[0].bus )->denials > 0 );
+    TEST_ASSERT_EQUAL_UINT16( 0, ctrlBus_getStats( &testNodes[0].bus )->grants );
+
+    /* Controller 3 granted before controller 2 denied and was released */
+    TEST_ASSERT_EQUAL_UINT8( 0, testNodes[2].bus.leaseHolder );
+}
+
+
+void test_lowerAddressWins( void )
+{
+    /* Controllers 1 and 2 ask each other in the same step */
+    ioMan_setRawInput( &testNodes[0].doorControl.io, IO_BUTTON_1, HIGH );
+    ioMan_setRawInput( &testNodes[1].doorControl.io, IO_BUTTON_1, HIGH );
+    test_run( TEST_PRESS );
+    ioMan_setRawInput( &testNodes[0].doorControl.io, IO_BUTTON_1, LOW );
+    ioMan_setRawInput( &testNodes[1].doorControl.io, IO_BUTTON_1, LOW );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &testNodes[1].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT16( 1, ctrlBus_getStats( &testNodes[0].bus )->grants );
+    TEST_ASSERT_EQUAL_UINT16( 0, ctrlBus_getStats( &testNodes[1].bus )->grants );
+    TEST_ASSERT_TRUE( ctrlBus_getStats( &testNodes[1].bus )->denials > 0 );
+    TEST_ASSERT_EQUAL_UINT32( 0, testViolations );
+}
+
+
+void test_lostRequestIsRetransmitted( void )
+{
+    /* The first request of controller 1 is lost */
+    ioMan_setRawInput( &testNodes[0].doorControl.io, IO_BUTTON_1, HIGH );
+    while ( testNodes[0].bus.grant == CTRL_BUS_GRANT_IDLE )
+    {
+        test_run( 1 );
+        testNodes[0].dropSteps = 1;
+    }
+    test_run( TEST_PRESS );
+    ioMan_setRawInput( &testNodes[0].doorControl.io, IO_BUTTON_1, LOW );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT16( 1, ctrlBus_getStats( &testNodes[0].bus )->retransmits );
+    TEST_ASSERT_EQUAL_UINT16( 1, ctrlBus_getStats( &testNodes[0].bus )->grants );
+    TEST_ASSERT_EQUAL_UINT16( 0, ctrlBus_getStats( &testNodes[0].bus )->denials );
+
+    /* The grant took at least the retry timeout */
+    TEST_ASSERT_TRUE( ctrlBus_getStats( &testNodes[0].bus )->lastLatency >= CTRL_BUS_RETRY_TIMEOUT * 1000UL );
+}
+
+
+void test_offlineHolderLosesTheGrant( void )
+{
+    test_press( &testNodes[0], DOOR_TYPE_DOOR_1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &testNodes[0].doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, testNodes[1].bus.leaseHolder );
+
+    /* Controller 1 goes offline while it holds the grant. Its last frame is at most a heartbeat old */
+    testNodes[0].muted = true;
+    test_run( CTRL_BUS_NODE_TIMEOUT - CTRL_BUS_HEARTBEAT - TEST_NODES );
+    TEST_ASSERT_EQUAL_UINT8( 1, testNodes[1].bus.leaseHolder );
+
+    test_run( 2 * CTRL_BUS_HEARTBEAT );
+    TEST_ASSERT_FALSE( ctrlBus_getNode( &testNodes[1].bus, 1 )->online );
+    TEST_ASSERT_EQUAL_UINT8( 0, testNodes[1].bus.leaseHolder );
+    TEST_ASSERT_EQUAL_UINT8( 0, testNodes[2].bus.leaseHolder );
+
+    /* An offline neighbour doesn't answer, which denies the grant */
+    test_press( &testNodes[1], DOOR_TYPE_DOOR_1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &testNodes[1].doorControl ) );
+    TEST_ASSERT_TRUE( ctrlBus_getStats( &testNodes[1].bus )->retransmits >= CTRL_BUS_RETRIES );
+    TEST_ASSERT_TRUE( ctrlBus_getStats( &testNodes[1].bus )->denials > 0 );
+}
+
+
+void test_randomTrafficHasNoViolation( void )
+{
+    uint32_t unlocks = 0;
+
+    testRandom = 1;
+
+    for ( uint32_t time = 0; time < TEST_TRAFFIC; time += TEST_PRESS + 50 )
+    {
+        /* Every controller presses a button now and then, some frames are lost */
+        for ( test_node_t& node : testNodes )
+        {
+            ioMan_setRawInput( &node.doorControl.io, IO_BUTTON_1, ( test_random( 8 ) == 0 ) ? HIGH : LOW );
+            ioMan_setRawInput( &node.doorControl.io, IO_BUTTON_2, ( test_random( 16 ) == 0 ) ? HIGH : LOW );
+            node.dropSteps = ( test_random( 32 ) == 0 ) ? 1 : 0;
+        }
+
+        test_run( TEST_PRESS + 50 );
+    }
+
+    for ( const test_node_t& node : testNodes )
+    {
+        unlocks += ctrlBus_getStats( &node.bus )->grants;
+        TEST_ASSERT_EQUAL_UINT32( 0, stateMan_getInterlockViolations( &node.doorControl ) );
+    }
+
+    TEST_ASSERT_TRUE( unlocks > 20 );
+    TEST_ASSERT_EQUAL_UINT32( 0, testViolations );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_neighboursSeeEachOther );
+    RUN_TEST( test_grantUnlocksTheDoor );
+    RUN_TEST( test_unlockedNeighbourDenies );
+    RUN_TEST( test_lowerAddressWins );
+    RUN_TEST( test_lostRequestIsRetransmitted );
+    RUN_TEST( test_offlineHolderLosesTheGrant );
+    RUN_TEST( test_randomTrafficHasNoViolation );
+    return UNITY_END();
+}
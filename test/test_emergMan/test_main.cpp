@@ -0,0 +1,168 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the emergency release on the host
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "hostShim.h"
+#include "emergMan.h"
+#include "stateMan.h"
+#include "appSettings.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_SETTLE             500 /*!< Time until the inputs have settled and the doors are idle @unit ms */
+#define TEST_STEPS              200 /*!< Steps run while the emergency input is active */
+#define TEST_RELEASED           LOW  /*!< Level of a released magnet, the magnets are active low */
+#define TEST_LOCKED             HIGH /*!< Level of a locked magnet */
+
+
+/******************************** Global variables **************************************/
+
+static door_control_t doorControl; /*!< The door control instance driving the shim pins */
+
+
+/******************************** Function definition ************************************/
+
+/**
+ * @brief Runs one step of the main loop: emergency input, state machine and output flush.
+ */
+static void test_step( void )
+{
+    hostShim_advanceMillis( 1 );
+    emergMan_process();
+    stateMan_process( &doorControl, millis() );
+    ioMan_flushOutputs( &doorControl.io );
+}
+
+
+/**
+ * @brief Asserts the level of both magnet pins.
+ */
+static void test_assertMagnets( uint8_t level )
+{
+    TEST_ASSERT_EQUAL_UINT8( level, hostShim_getPin( DOOR_1_MAGNET ) );
+    TEST_ASSERT_EQUAL_UINT8( level, hostShim_getPin( DOOR_2_MAGNET ) );
+}
+
+
+void setUp( void )
+{
+    hostShim_reset();
+
+    stateMan_setup( &doorControl );
+    ioMan_setInputOverride( &doorControl.io, true );
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setRawInput( &doorControl.io, (io_t) input, LOW );
+    }
+
+    hostShim_setPin( EMERGENCY_PIN, LOW );
+    emergMan_setup( &doorControl );
+    emergMan_setEnabled( false );
+
+    for ( uint16_t step = 0; step < TEST_SETTLE; step++ )
+    {
+        test_step();
+    }
+}
+
+void tearDown( void )
+{
+    /* The release is latched in the module, the next test starts without it */
+    hostShim_setPin( EMERGENCY_PIN, LOW );
+    emergMan_reset();
+    emergMan_process();
+}
+
+
+void test_enableWithActiveInputReleasesBeforeDispatch( void )
+{
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    test_assertMagnets( TEST_LOCKED );
+
+    hostShim_setPin( EMERGENCY_PIN, HIGH );
+    emergMan_setEnabled( true );
+
+    /* Written by the release itself, no event was dispatched and no output flushed */
+    test_assertMagnets( TEST_RELEASED );
+    TEST_ASSERT_TRUE( emergMan_isLatched() );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+
+    test_step();
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_EMERGENCY, stateMan_getState( &doorControl ) );
+    test_assertMagnets( TEST_RELEASED );
+}
+
+
+void test_magnetsStayReleasedThroughFlushes( void )
+{
+    const uint32_t releases = emergMan_getStats()->releases;
+
+    hostShim_setPin( EMERGENCY_PIN, HIGH );
+    emergMan_setEnabled( true );
+
+    for ( uint16_t step = 0; step < TEST_STEPS; step++ )
+    {
+        /* Unlock requests and door switches must not lock a magnet again */
+        ioMan_setRawInput( &doorControl.io, IO_BUTTON_1, ( step & 0x10 ) ? HIGH : LOW );
+        ioMan_setRawInput( &doorControl.io, IO_SWITCH_2, ( step & 0x20 ) ? HIGH : LOW );
+        if ( ( step % 50 ) == 0 )
+        {
+            stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+            stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_2_CLOSE, DOOR_CONTROL_SOURCE_SWITCH );
+        }
+
+        test_step();
+        test_assertMagnets( TEST_RELEASED );
+    }
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_EMERGENCY, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT32( releases + 1, emergMan_getStats()->releases );
+}
+
+
+void test_resetRefusedWhileInputActive( void )
+{
+    hostShim_setPin( EMERGENCY_PIN, HIGH );
+    emergMan_setEnabled( true );
+    test_step();
+
+    TEST_ASSERT_FALSE( emergMan_reset() );
+    TEST_ASSERT_TRUE( emergMan_isLatched() );
+
+    for ( uint8_t step = 0; step < 10; step++ )
+    {
+        test_step();
+        test_assertMagnets( TEST_RELEASED );
+    }
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_EMERGENCY, stateMan_getState( &doorControl ) );
+
+    /* The input went inactive, the reset is accepted and the doors are locked again */
+    hostShim_setPin( EMERGENCY_PIN, LOW );
+    TEST_ASSERT_TRUE( emergMan_reset() );
+    TEST_ASSERT_FALSE( emergMan_isLatched() );
+
+    for ( uint16_t step = 0; step < TEST_SETTLE; step++ )
+    {
+        test_step();
+    }
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    test_assertMagnets( TEST_LOCKED );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_enableWithActiveInputReleasesBeforeDispatch );
+    RUN_TEST( test_magnetsStayReleasedThroughFlushes );
+    RUN_TEST( test_resetRefusedWhileInputActive );
+    return UNITY_END();
+}
@@ -0,0 +1,602 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the event queue, the deferred events and the dispatch budget
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "hostShim.h"
+#include "hsm.h"
+#include "stateMan.h"
+#include "appSettings.h"
+#include "latMon.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_LOG_SIZE           32 /*!< Most handler calls recorded by the test states */
+
+#define TEST_EVENT_SWITCH       1  /*!< Switches state A to state B */
+#define TEST_EVENT_RETURN       2  /*!< Switches state B back to state A */
+#define TEST_EVENT_UNHANDLED    9  /*!< Isn't handled by state A */
+#define TEST_EVENT_DEFERRED_1   5  /*!< Deferred by state A */
+#define TEST_EVENT_DEFERRED_2   6  /*!< Deferred by state A */
+#define TEST_EVENT_SELF         3  /*!< State B pushes TEST_EVENT_PREEMPT in front of it and is triggered to self */
+#define TEST_EVENT_PREEMPT      4  /*!< Pushed by state B in a higher priority class */
+
+#define TEST_SETTLE             2000 /*!< Time for the inputs to settle @unit ms */
+#define TEST_QUEUE_LIMIT        32   /*!< Longest event queue of the saturated load, the leak limit of test_interlockFuzz */
+#define TEST_LOAD_STEPS         10   /*!< Steps run under the saturated load before the safety event @unit ms */
+
+/******************************** Global variables **************************************/
+
+static uint32_t testLog[TEST_LOG_SIZE]; /*!< The events of the handler calls, in call order */
+static uint8_t  testLogSize;            /*!< Number of recorded handler calls */
+static uint32_t testEventLog[TEST_LOG_SIZE]; /*!< The events passed to the event logger, in call order */
+static uint8_t  testEventLogSize;            /*!< Number of recorded event logger calls */
+static bool     testSelfTriggered;           /*!< State B was triggered to self by TEST_EVENT_SELF */
+static uint8_t  testBudget;             /*!< Handler calls the budget still grants */
+static uint8_t  testBudgetAsked;        /*!< Number of budget requests */
+
+static state_machine_result_t test_handlerA( state_machine_t* const pStateMachine, const uint32_t event );
+static state_machine_result_t test_handlerB( state_machine_t* const pStateMachine, const uint32_t event );
+
+/*!< State A defers two events, state B defers none */
+static const state_t testStates[] = {
+    { test_handlerA, NULL, NULL, ( 1UL << TEST_EVENT_DEFERRED_1 ) | ( 1UL << TEST_EVENT_DEFERRED_2 ), 0 },
+    { test_handlerB, NULL, NULL, 0, 1 }
+};
+
+static door_control_t doorControl;                                      /*!< The door control instance under test */
+static bool           testWindowOpen[DOOR_TYPE_SIZE] = { true, true }; /*!< The access window of every door is open */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    testLogSize       = 0;
+    testEventLogSize  = 0;
+    testSelfTriggered = false;
+    testBudget      = UINT8_MAX;
+    testBudgetAsked = 0;
+}
+
+void tearDown( void )
+{
+}
+
+
+static state_machine_result_t test_handlerA( state_machine_t* const pStateMachine, const uint32_t event )
+{
+    testLog[testLogSize++] = event;
+
+    if ( event == TEST_EVENT_SWITCH )
+    {
+        return switch_state( pStateMachine, &testStates[1] );
+    }
+
+    return ( event == TEST_EVENT_UNHANDLED ) ? EVENT_UN_HANDLED : EVENT_HANDLED;
+}
+
+
+static state_machine_result_t test_handlerB( state_machine_t* const pStateMachine, const uint32_t event )
+{
+    testLog[testLogSize++] = 100 + event;
+
+    if ( event == TEST_EVENT_RETURN )
+    {
+        return switch_state( pStateMachine, &testStates[0] );
+    }
+
+    if ( ( event == TEST_EVENT_SELF ) && !testSelfTriggered )
+    {
+        testSelfTriggered = true;
+        pushEventPriority( &pStateMachine->event, TEST_EVENT_PREEMPT, 1 );
+        return TRIGGERED_TO_SELF;
+    }
+
+    return EVENT_HANDLED;
+}
+
+
+static void test_eventLogger( state_machine_t* const pStateMachine, uint32_t state, const event_t* const pEvent )
+{
+    testEventLog[testEventLogSize++] = 100 * state + pEvent->id;
+}
+
+
+static void test_resultLogger( state_machine_t* const pStateMachine, uint32_t state, state_machine_result_t result )
+{
+}
+
+
+static bool test_budget( state_machine_t* const pStateMachine, const event_t* const pEvent )
+{
+    testBudgetAsked++;
+
+    if ( testBudget == 0 )
+    {
+        return false;
+    }
+
+    testBudget--;
+    return true;
+}
+
+
+/**
+ * @brief The access window of the door control instance, controlled by the test.
+ */
+static bool test_accessWindow( door_control_t* const pDoorControl, door_type_t door )
+{
+    return testWindowOpen[door];
+}
+
+
+/**
+ * @brief Dispatches all queued events of a state machine.
+ *
+ * @param pStateMachine The state machine.
+ * @param budget The budget of the dispatch, NULL to dispatch all events.
+ */
+static void test_dispatch( state_machine_t* const pStateMachine, state_machine_budget budget )
+{
+    state_machine_t* const stateMachines[] = { pStateMachine };
+
+    dispatch_event( stateMachines, 1, test_eventLogger, test_resultLogger, budget );
+}
+
+
+/**
+ * @brief Returns the number of events of a queue.
+ */
+static uint8_t test_countEvents( const event_t* pEvent )
+{
+    uint8_t count = 0;
+
+    for ( ; pEvent != NULL; pEvent = pEvent->next )
+    {
+        count++;
+    }
+
+    return count;
+}
+
+
+static void test_priority_dispatches_higher_classes_first( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[1] );
+
+    pushEventPriority( &machine.event, 10, 0 );
+    pushEventPriority( &machine.event, 20, 2 );
+    pushEventPriority( &machine.event, 11, 0 );
+    pushEventPriority( &machine.event, 30, 1 );
+    pushEventPriority( &machine.event, 21, 2 );
+
+    test_dispatch( &machine, NULL );
+
+    const uint32_t expected[] = { 120, 121, 130, 110, 111 };
+    TEST_ASSERT_EQUAL_UINT8( 5, testLogSize );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( expected, testLog, 5 );
+    TEST_ASSERT_NULL( machine.event );
+}
+
+
+static void test_budget_carries_the_remaining_events_in_order( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[1] );
+
+    for ( uint32_t event = 10; event < 15; event++ )
+    {
+        pushEvent( &machine.event, event );
+    }
+
+    testBudget = 2;
+    test_dispatch( &machine, test_budget );
+
+    TEST_ASSERT_EQUAL_UINT8( 2, testLogSize );
+    TEST_ASSERT_EQUAL_UINT8( 3, test_countEvents( machine.event ) );
+    TEST_ASSERT_EQUAL_UINT32( 12, machine.event->id );
+
+    /* An event of a higher class posted meanwhile overtakes the carried events */
+    pushEventPriority( &machine.event, 20, 1 );
+    testBudget = UINT8_MAX;
+    test_dispatch( &machine, test_budget );
+
+    const uint32_t expected[] = { 110, 111, 120, 112, 113, 114 };
+    TEST_ASSERT_EQUAL_UINT8( 6, testLogSize );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( expected, testLog, 6 );
+}
+
+
+static void test_logger_gets_the_dispatched_event( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[1] );
+
+    pushEvent( &machine.event, TEST_EVENT_SELF );
+    pushEvent( &machine.event, 10 );
+    test_dispatch( &machine, NULL );
+
+    /* The event triggered to self is dispatched again before the one pushed in front of it */
+    const uint32_t expected[] = { 103, 103, 104, 110 };
+    TEST_ASSERT_EQUAL_UINT8( 4, testLogSize );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( expected, testLog, 4 );
+    TEST_ASSERT_EQUAL_UINT8( 4, testEventLogSize );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( testLog, testEventLog, 4 );
+    TEST_ASSERT_NULL( machine.event );
+}
+
+
+static void test_deferral_does_not_charge_the_budget( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[0] );
+
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_1 );
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_2 );
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_1 );
+    pushEvent( &machine.event, 3 );
+
+    testBudget = 1;
+    test_dispatch( &machine, test_budget );
+
+    /* Only the handler call of event 3 was asked and charged */
+    TEST_ASSERT_EQUAL_UINT8( 1, testBudgetAsked );
+    TEST_ASSERT_EQUAL_UINT8( 1, testLogSize );
+    TEST_ASSERT_EQUAL_UINT32( 3, testLog[0] );
+    TEST_ASSERT_NULL( machine.event );
+    TEST_ASSERT_EQUAL_UINT8( 3, machine.deferredCount );
+
+    clear_events( &machine );
+}
+
+
+static void test_deferred_events_are_recalled_by_a_state_change( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[0] );
+
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_1 );
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_2 );
+    pushEvent( &machine.event, TEST_EVENT_UNHANDLED );
+    test_dispatch( &machine, NULL );
+
+    TEST_ASSERT_EQUAL_UINT8( 2, machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT32( 1, machine.dropped );
+
+    /* The deferred events are dispatched in their order, ahead of the events of their class posted later */
+    pushEvent( &machine.event, TEST_EVENT_SWITCH );
+    pushEvent( &machine.event, 7 );
+    pushEventPriority( &machine.event, 8, 1 );
+    test_dispatch( &machine, NULL );
+
+    const uint32_t expected[] = { TEST_EVENT_UNHANDLED, 8, TEST_EVENT_SWITCH, 100 + TEST_EVENT_DEFERRED_1, 100 + TEST_EVENT_DEFERRED_2, 107 };
+    TEST_ASSERT_EQUAL_UINT8( 6, testLogSize );
+    TEST_ASSERT_EQUAL_UINT32_ARRAY( expected, testLog, 6 );
+    TEST_ASSERT_EQUAL_UINT8( 0, machine.deferredCount );
+    TEST_ASSERT_NULL( machine.deferred );
+}
+
+
+static void test_deferred_queue_drops_beyond_its_capacity( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[0] );
+
+    for ( uint8_t i = 0; i < HSM_DEFER_CAPACITY + 3; i++ )
+    {
+        pushEvent( &machine.event, TEST_EVENT_DEFERRED_1 );
+    }
+
+    test_dispatch( &machine, NULL );
+
+    TEST_ASSERT_EQUAL_UINT8( HSM_DEFER_CAPACITY, machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT8( HSM_DEFER_CAPACITY, test_countEvents( machine.deferred ) );
+    TEST_ASSERT_EQUAL_UINT32( 3, machine.dropped );
+
+    clear_events( &machine );
+    TEST_ASSERT_NULL( machine.deferred );
+    TEST_ASSERT_EQUAL_UINT8( 0, machine.deferredCount );
+}
+
+
+static void test_expiry_uses_the_stamp_flag( void )
+{
+    state_machine_t machine = {};
+    switch_state( &machine, &testStates[0] );
+
+    /* Posted at time 0, the value the clock returns at its wraparound */
+    event_t* const pStamped = pushEventPriority( &machine.event, TEST_EVENT_DEFERRED_1, 0 );
+    pStamped->posted        = 0;
+    pStamped->stamped       = true;
+
+    pushEvent( &machine.event, TEST_EVENT_DEFERRED_2 );
+    test_dispatch( &machine, NULL );
+    TEST_ASSERT_EQUAL_UINT8( 2, machine.deferredCount );
+
+    TEST_ASSERT_EQUAL_UINT32( 0, expire_deferred( &machine, 100, 100 ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, expire_deferred( &machine, 101, 100 ) );
+
+    /* The unstamped event never expires */
+    TEST_ASSERT_EQUAL_UINT32( 0, expire_deferred( &machine, 0x80000000UL, 100 ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT32( TEST_EVENT_DEFERRED_2, machine.deferred->id );
+    TEST_ASSERT_EQUAL_UINT32( 1, machine.expired );
+
+    clear_events( &machine );
+}
+
+
+/**
+ * @brief Advances the time and processes the door control instance every millisecond.
+ *
+ * @param span The time to advance @unit ms
+ */
+static void test_run( uint32_t span )
+{
+    for ( uint32_t time = 0; time < span; time++ )
+    {
+        hostShim_advanceMillis( 1 );
+        stateMan_process( &doorControl, millis() );
+    }
+}
+
+
+/**
+ * @brief Restarts the door control instance with closed doors and waits until it is idle.
+ */
+static void test_start( void )
+{
+    stateMan_init( &doorControl, millis() );
+    ioMan_setInputOverride( &doorControl.io, true );
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setRawInput( &doorControl.io, (io_t) input, LOW );
+    }
+    test_run( TEST_SETTLE );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+}
+
+
+static void test_unlock_request_waits_for_the_other_door( void )
+{
+    test_start();
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( 1 );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, doorControl.machine.deferredCount );
+    TEST_ASSERT_EQUAL( LOCK_STATE_LOCKED, ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_2 ) );
+
+    /* Opening door 1 recalls the request, door 1 open defers it again */
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, HIGH );
+    test_run( 1000 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_OPEN, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, doorControl.machine.deferredCount );
+
+    /* Door 2 unlocks once door 1 is closed */
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, LOW );
+    test_run( 1000 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_2_UNLOCKED, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 0, doorControl.machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT32( 0, stateMan_getExpiredEvents( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT32( 0, stateMan_getInterlockViolations( &doorControl ) );
+}
+
+
+static void test_recalled_unlock_request_asks_the_gate_again( void )
+{
+    test_start();
+    doorControl.accessWindow = test_accessWindow;
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( 1 );
+    TEST_ASSERT_EQUAL_UINT8( 1, doorControl.machine.deferredCount );
+
+    /* The access window of door 2 closes while its request waits */
+    testWindowOpen[DOOR_TYPE_DOOR_2] = false;
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, HIGH );
+    test_run( 1000 );
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, LOW );
+    test_run( 1000 );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT8( 0, doorControl.machine.deferredCount );
+    TEST_ASSERT_EQUAL( LOCK_STATE_LOCKED, ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_2 ) );
+
+    doorControl.accessWindow         = NULL;
+    testWindowOpen[DOOR_TYPE_DOOR_2] = true;
+}
+
+
+static void test_unlock_request_expires_after_the_deferral_age( void )
+{
+    test_start();
+    stateMan_setDeferMaxAge( &doorControl, 1 );
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( 1 );
+    TEST_ASSERT_EQUAL_UINT8( 1, doorControl.machine.deferredCount );
+
+    test_run( 990 );
+    TEST_ASSERT_EQUAL_UINT8( 1, doorControl.machine.deferredCount );
+    test_run( 20 );
+    TEST_ASSERT_EQUAL_UINT8( 0, doorControl.machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT32( 1, stateMan_getExpiredEvents( &doorControl ) );
+
+    /* Door 1 locks at its unlock timeout and the stale request of door 2 is gone */
+    test_run( appSettings_getSettings()->doorUnlockTimeout * 1000UL );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL( LOCK_STATE_LOCKED, ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_2 ) );
+}
+
+
+static void test_switch_event_is_not_posted_twice( void )
+{
+    clear_events( &doorControl.machine );
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
+    TEST_ASSERT_EQUAL_UINT8( 1, test_countEvents( doorControl.machine.event ) );
+
+    /* A request of the same event is queued again */
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_OPEN, DOOR_CONTROL_SOURCE_REQUEST );
+    TEST_ASSERT_EQUAL_UINT8( 2, test_countEvents( doorControl.machine.event ) );
+
+    clear_events( &doorControl.machine );
+}
+
+
+static void test_switch_event_is_not_posted_while_deferred( void )
+{
+    clear_events( &doorControl.machine );
+
+    /* Park the event as the dispatch would */
+    pushEvent( &doorControl.machine.deferred, DOOR_CONTROL_EVENT_DOOR_2_CLOSE );
+    doorControl.machine.deferredCount = 1;
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_CLOSE, DOOR_CONTROL_SOURCE_SWITCH );
+    TEST_ASSERT_NULL( doorControl.machine.event );
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
+    TEST_ASSERT_EQUAL_UINT8( 1, test_countEvents( doorControl.machine.event ) );
+
+    clear_events( &doorControl.machine );
+}
+
+
+static void test_time_budget_grants_one_event_per_step( void )
+{
+    test_start();
+
+    /* A time budget shorter than a tick of micros() runs out before the first handler */
+    stateMan_setDispatchBudget( &doorControl, 0, 1 );
+    hostShim_setMicrosStep( 4 );
+
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK_TIMEOUT, DOOR_CONTROL_SOURCE_TIMER );
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL_UINT16( 1, stateMan_getDispatchBudget( &doorControl )->dispatched );
+    TEST_ASSERT_TRUE( stateMan_getDispatchBudget( &doorControl )->exhausted );
+
+    /* The carried event is dispatched in the next step */
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+
+    hostShim_setMicrosStep( 0 );
+    stateMan_setDispatchBudget( &doorControl, DISPATCH_MAX_EVENTS, DISPATCH_MAX_TIME );
+}
+
+
+/**
+ * @brief Fills the event queue with routine events up to the queue limit.
+ *
+ * The closes of the single doors are posted as requests, the switch events of the same
+ * state would be dropped while one is queued. Both doors closed would end the fault.
+ */
+static void test_saturate( void )
+{
+    static const door_control_event_t load[] = { DOOR_CONTROL_EVENT_DOOR_1_CLOSE, DOOR_CONTROL_EVENT_DOOR_2_CLOSE };
+
+    for ( uint8_t i = test_countEvents( doorControl.machine.event ); i < TEST_QUEUE_LIMIT - 1; i++ )
+    {
+        stateMan_postEvent( &doorControl, load[i % ( sizeof( load ) / sizeof( load[0] ) )], DOOR_CONTROL_SOURCE_REQUEST );
+    }
+}
+
+
+static void test_safety_event_preempts_a_saturated_queue( void )
+{
+    lat_mon_summary_t summary;
+    uint32_t          routine = 0;
+
+    test_start();
+    stateMan_setDispatchBudget( &doorControl, DISPATCH_MAX_EVENTS, 0 );
+
+    /* The load arrives faster than the budget dispatches it */
+    for ( uint8_t step = 0; step < TEST_LOAD_STEPS; step++ )
+    {
+        test_saturate();
+        test_run( 1 );
+        TEST_ASSERT_EQUAL_UINT16( DISPATCH_MAX_EVENTS, stateMan_getDispatchBudget( &doorControl )->dispatched );
+        TEST_ASSERT_TRUE( stateMan_getDispatchBudget( &doorControl )->exhausted );
+    }
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+
+    test_saturate();
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_2_OPEN, DOOR_CONTROL_SOURCE_SWITCH );
+    TEST_ASSERT_EQUAL_UINT8( TEST_QUEUE_LIMIT, test_countEvents( doorControl.machine.event ) );
+    TEST_ASSERT_EQUAL_UINT32( DOOR_CONTROL_EVENT_DOOR_1_2_OPEN, doorControl.machine.event->id );
+
+    /* Dispatched first in the next step, it waited one step and not for the backlog */
+    latMon_clear();
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_FAULT, stateMan_getState( &doorControl ) );
+
+    TEST_ASSERT_TRUE( latMon_getSummary( DOOR_CONTROL_EVENT_DOOR_1_2_OPEN, &summary ) );
+    TEST_ASSERT_EQUAL_UINT32( 1, summary.count );
+    TEST_ASSERT_EQUAL_UINT32( 1000, summary.max );
+    TEST_ASSERT_EQUAL_UINT8( DOOR_CONTROL_SOURCE_SWITCH, summary.maxSource );
+
+    /* The routine events of the same step waited longer */
+    for ( uint8_t event = 0; event < DOOR_CONTROL_EVENT_SIZE; event++ )
+    {
+        if ( ( event != DOOR_CONTROL_EVENT_DOOR_1_2_OPEN ) && latMon_getSummary( (door_control_event_t) event, &summary ) )
+        {
+            routine += summary.count;
+            TEST_ASSERT_TRUE( summary.max > 1000 );
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32( DISPATCH_MAX_EVENTS - 1, routine );
+
+    clear_events( &doorControl.machine );
+    latMon_clear();
+    stateMan_setDispatchBudget( &doorControl, DISPATCH_MAX_EVENTS, DISPATCH_MAX_TIME );
+}
+
+
+static void test_event_priority_classes( void )
+{
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_PRIORITY_EMERGENCY, stateMan_getEventPriority( DOOR_CONTROL_EVENT_EMERGENCY ) );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_PRIORITY_SAFETY, stateMan_getEventPriority( DOOR_CONTROL_EVENT_DOOR_1_2_OPEN ) );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_PRIORITY_ROUTINE, stateMan_getEventPriority( DOOR_CONTROL_EVENT_DOOR_1_UNLOCK ) );
+}
+
+
+int main( int argc, char** argv )
+{
+    hostShim_reset();
+    stateMan_init( &doorControl, millis() );
+
+    UNITY_BEGIN();
+    RUN_TEST( test_priority_dispatches_higher_classes_first );
+    RUN_TEST( test_budget_carries_the_remaining_events_in_order );
+    RUN_TEST( test_logger_gets_the_dispatched_event );
+    RUN_TEST( test_deferral_does_not_charge_the_budget );
+    RUN_TEST( test_deferred_events_are_recalled_by_a_state_change );
+    RUN_TEST( test_deferred_queue_drops_beyond_its_capacity );
+    RUN_TEST( test_expiry_uses_the_stamp_flag );
+    RUN_TEST( test_switch_event_is_not_posted_twice );
+    RUN_TEST( test_switch_event_is_not_posted_while_deferred );
+    RUN_TEST( test_time_budget_grants_one_event_per_step );
+    RUN_TEST( test_event_priority_classes );
+    RUN_TEST( test_unlock_request_waits_for_the_other_door );
+    RUN_TEST( test_recalled_unlock_request_asks_the_gate_again );
+    RUN_TEST( test_unlock_request_expires_after_the_deferral_age );
+    RUN_TEST( test_safety_event_preempts_a_saturated_queue );
+    return UNITY_END();
+}
@@ -0,0 +1,496 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Equivalence tests of the template state machine engine and the state machine of hsm.c
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "hostShim.h"
+#include "hsm.h"
+#include "hsmEngine.h"
+
+/*
+ * The same state machine is built twice, once from the tables of hsm.c and once from the
+ * types of hsmEngine.h. Both run the same event sequences and write every handler, entry
+ * and exit call and every logger call to a trace of their own. The traces, the states
+ * and the dropped events must be equal after every dispatch.
+ *
+ * Only the features both engines share are covered: a flat state machine without
+ * deferred events and without a dispatch budget.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define TEST_STATE_SIZE         3      /*!< Number of states of the test machine */
+#define TEST_EVENT_RANGE        10     /*!< Events of the random sequences are below this id */
+#define TEST_SEQUENCE_LENGTH    2000   /*!< Events of a random sequence */
+#define TEST_PUSH_LIMIT         500    /*!< Most events pushed by the actions of a run */
+
+#define TEST_EVENT_PUSH_LOW     20     /*!< Pushed by a handler in the lowest class */
+#define TEST_EVENT_PUSH_HIGH    21     /*!< Pushed by a handler in a higher class */
+#define TEST_EVENT_PUSH_ENTRY   22     /*!< Pushed by the entry action of the last state */
+#define TEST_EVENT_PUSH_SELF    23     /*!< Pushed in the highest class before TRIGGERED_TO_SELF */
+
+
+/************************************ ENUMERATION *************************************/
+
+/**
+ * @brief Enumeration of the reactions of the test states to an event
+ */
+typedef enum
+{
+    TEST_ACTION_HANDLE,      /*!< Handle the event */
+    TEST_ACTION_SWITCH_NEXT, /*!< Switch to the next state */
+    TEST_ACTION_SWITCH_LAST, /*!< Switch to the last state */
+    TEST_ACTION_PUSH,        /*!< Push two events of different classes, then handle the event */
+    TEST_ACTION_UNHANDLED,   /*!< Don't handle the event */
+    TEST_ACTION_RETRIGGER    /*!< Push an event of the highest class and return TRIGGERED_TO_SELF */
+} test_action_t;
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The trace of one engine
+ */
+typedef struct
+{
+    std::string text;        /*!< Every call in call order */
+    uint16_t    pushes;      /*!< Events pushed by the actions */
+    bool        retriggered; /*!< The last handler call returned TRIGGERED_TO_SELF */
+} test_trace_t;
+
+
+/******************************** Global variables **************************************/
+
+static test_trace_t traceC;   /*!< The trace of the state machine of hsm.c */
+static test_trace_t traceTpl; /*!< The trace of the template engine */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    traceC   = test_trace_t();
+    traceTpl = test_trace_t();
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Appends a call to a trace.
+ */
+static void test_log( test_trace_t& trace, const char* pKind, uint32_t state, uint32_t value )
+{
+    char text[24];
+
+    snprintf( text, sizeof( text ), "%s%u:%u ", pKind, (unsigned) state, (unsigned) value );
+    trace.text += text;
+}
+
+
+/**
+ * @brief Decides the reaction of a state to an event, the same for both engines.
+ *
+ * @param trace The trace of the engine.
+ * @param state The index of the current state.
+ * @param event The event.
+ * @return test_action_t The reaction.
+ */
+static test_action_t test_decide( test_trace_t& trace, uint8_t state, uint32_t event )
+{
+    test_log( trace, "h", state, event );
+
+    if ( trace.retriggered )
+    {
+        trace.retriggered = false;
+        return TEST_ACTION_HANDLE;
+    }
+
+    switch ( event )
+    {
+    case 1:
+        return TEST_ACTION_SWITCH_NEXT;
+    case 2:
+        return ( trace.pushes < TEST_PUSH_LIMIT ) ? TEST_ACTION_PUSH : TEST_ACTION_HANDLE;
+    case 3:
+        return ( state != 1 ) ? TEST_ACTION_UNHANDLED : TEST_ACTION_HANDLE;
+    case 4:
+        return ( state == 0 ) ? TEST_ACTION_SWITCH_LAST : TEST_ACTION_HANDLE;
+    case 5:
+        if ( trace.pushes < TEST_PUSH_LIMIT )
+        {
+            trace.retriggered = true;
+            return TEST_ACTION_RETRIGGER;
+        }
+        return TEST_ACTION_HANDLE;
+    case 6:
+        return ( state == 2 ) ? TEST_ACTION_SWITCH_NEXT : TEST_ACTION_UNHANDLED;
+    default:
+        return TEST_ACTION_HANDLE;
+    }
+}
+
+
+/*
+ * The state machine of hsm.c
+ */
+
+extern const state_t testStatesC[TEST_STATE_SIZE];
+
+template <uint8_t State>
+static state_machine_result_t test_handlerC( state_machine_t* const pMachine, const uint32_t event )
+{
+    switch ( test_decide( traceC, State, event ) )
+    {
+    case TEST_ACTION_SWITCH_NEXT:
+        return switch_state( pMachine, &testStatesC[( State + 1 ) % TEST_STATE_SIZE] );
+    case TEST_ACTION_SWITCH_LAST:
+        return switch_state( pMachine, &testStatesC[TEST_STATE_SIZE - 1] );
+    case TEST_ACTION_PUSH:
+        traceC.pushes += 2;
+        pushEvent( &pMachine->event, TEST_EVENT_PUSH_LOW );
+        pushEventPriority( &pMachine->event, TEST_EVENT_PUSH_HIGH, 1 );
+        return EVENT_HANDLED;
+    case TEST_ACTION_UNHANDLED:
+        return EVENT_UN_HANDLED;
+    case TEST_ACTION_RETRIGGER:
+        traceC.pushes++;
+        pushEventPriority( &pMachine->event, TEST_EVENT_PUSH_SELF, 2 );
+        return TRIGGERED_TO_SELF;
+    default:
+        return EVENT_HANDLED;
+    }
+}
+
+template <uint8_t State>
+static state_machine_result_t test_entryC( state_machine_t* const pMachine, const uint32_t event )
+{
+    test_log( traceC, "en", State, event );
+
+    if ( ( State == TEST_STATE_SIZE - 1 ) && ( traceC.pushes < TEST_PUSH_LIMIT ) )
+    {
+        traceC.pushes++;
+        pushEventPriority( &pMachine->event, TEST_EVENT_PUSH_ENTRY, 1 );
+    }
+
+    return EVENT_HANDLED;
+}
+
+template <uint8_t State>
+static state_machine_result_t test_exitC( state_machine_t* const pMachine, const uint32_t event )
+{
+    test_log( traceC, "ex", State, event );
+    return EVENT_HANDLED;
+}
+
+/*!< The second state has no entry action, the first one no exit action */
+const state_t testStatesC[TEST_STATE_SIZE] = {
+    { test_handlerC<0>, test_entryC<0>, NULL,          0, 0 },
+    { test_handlerC<1>, NULL,           test_exitC<1>, 0, 1 },
+    { test_handlerC<2>, test_entryC<2>, test_exitC<2>, 0, 2 }
+};
+
+static void test_eventLoggerC( state_machine_t* const pMachine, uint32_t state, const event_t* const pEvent )
+{
+    test_log( traceC, "[", state, pEvent->id );
+}
+
+static void test_resultLoggerC( state_machine_t* const pMachine, uint32_t state, state_machine_result_t result )
+{
+    test_log( traceC, "<", state, result );
+}
+
+
+/*
+ * The same state machine on the template engine
+ */
+
+class TestMachine;
+
+template <uint8_t State>
+static state_machine_result_t test_handlerTpl( TestMachine& machine, uint32_t event );
+
+template <uint8_t State>
+static state_machine_result_t test_entryTpl( TestMachine& machine, uint32_t event );
+
+template <uint8_t State>
+static state_machine_result_t test_exitTpl( TestMachine& machine, uint32_t event );
+
+struct TestState0 : HsmState
+{
+    static state_machine_result_t handler( TestMachine& machine, uint32_t event ) { return test_handlerTpl<0>( machine, event ); }
+    static state_machine_result_t entry( TestMachine& machine, uint32_t event ) { return test_entryTpl<0>( machine, event ); }
+};
+
+struct TestState1 : HsmState
+{
+    static state_machine_result_t handler( TestMachine& machine, uint32_t event ) { return test_handlerTpl<1>( machine, event ); }
+    static state_machine_result_t exit( TestMachine& machine, uint32_t event ) { return test_exitTpl<1>( machine, event ); }
+};
+
+struct TestState2 : HsmState
+{
+    static state_machine_result_t handler( TestMachine& machine, uint32_t event ) { return test_handlerTpl<2>( machine, event ); }
+    static state_machine_result_t entry( TestMachine& machine, uint32_t event ) { return test_entryTpl<2>( machine, event ); }
+    static state_machine_result_t exit( TestMachine& machine, uint32_t event ) { return test_exitTpl<2>( machine, event ); }
+};
+
+class TestMachine : public HsmEngine<TestMachine, TestState0, TestState1, TestState2>
+{
+public:
+    void logEvent( uint8_t stateIndex, uint32_t event )
+    {
+        test_log( traceTpl, "[", stateIndex, event );
+    }
+
+    void logResult( uint8_t stateIndex, state_machine_result_t result )
+    {
+        test_log( traceTpl, "<", stateIndex, result );
+    }
+
+    /**
+     * @brief Switches to the state after the given one, the type of the state is only known at runtime.
+     */
+    state_machine_result_t switchNext( uint8_t stateIndex )
+    {
+        switch ( ( stateIndex + 1 ) % TEST_STATE_SIZE )
+        {
+        case 0:
+            return switchState<TestState0>();
+        case 1:
+            return switchState<TestState1>();
+        default:
+            return switchState<TestState2>();
+        }
+    }
+};
+
+template <uint8_t State>
+static state_machine_result_t test_handlerTpl( TestMachine& machine, uint32_t event )
+{
+    switch ( test_decide( traceTpl, State, event ) )
+    {
+    case TEST_ACTION_SWITCH_NEXT:
+        return machine.switchNext( State );
+    case TEST_ACTION_SWITCH_LAST:
+        return machine.switchState<TestState2>();
+    case TEST_ACTION_PUSH:
+        traceTpl.pushes += 2;
+        machine.pushEvent( TEST_EVENT_PUSH_LOW );
+        machine.pushEventPriority( TEST_EVENT_PUSH_HIGH, 1 );
+        return EVENT_HANDLED;
+    case TEST_ACTION_UNHANDLED:
+        return EVENT_UN_HANDLED;
+    case TEST_ACTION_RETRIGGER:
+        traceTpl.pushes++;
+        machine.pushEventPriority( TEST_EVENT_PUSH_SELF, 2 );
+        return TRIGGERED_TO_SELF;
+    default:
+        return EVENT_HANDLED;
+    }
+}
+
+template <uint8_t State>
+static state_machine_result_t test_entryTpl( TestMachine& machine, uint32_t event )
+{
+    test_log( traceTpl, "en", State, event );
+
+    if ( ( State == TEST_STATE_SIZE - 1 ) && ( traceTpl.pushes < TEST_PUSH_LIMIT ) )
+    {
+        traceTpl.pushes++;
+        machine.pushEventPriority( TEST_EVENT_PUSH_ENTRY, 1 );
+    }
+
+    return EVENT_HANDLED;
+}
+
+template <uint8_t State>
+static state_machine_result_t test_exitTpl( TestMachine& machine, uint32_t event )
+{
+    test_log( traceTpl, "ex", State, event );
+    return EVENT_HANDLED;
+}
+
+
+/**
+ * @brief Both engines under test
+ */
+typedef struct
+{
+    state_machine_t machineC;   /*!< The state machine of hsm.c */
+    TestMachine     machineTpl; /*!< The state machine of the template engine */
+} test_engines_t;
+
+
+/**
+ * @brief Pushes an event to both engines.
+ */
+static void test_push( test_engines_t& engines, uint32_t event, uint8_t priority )
+{
+    pushEventPriority( &engines.machineC.event, event, priority );
+    engines.machineTpl.pushEventPriority( event, priority );
+}
+
+
+/**
+ * @brief Dispatches the queued events of both engines and compares the outcome.
+ */
+static void test_dispatchAndCompare( test_engines_t& engines )
+{
+    state_machine_t* const machines[] = { &engines.machineC };
+
+    const state_machine_result_t resultC   = dispatch_event( machines, 1, test_eventLoggerC, test_resultLoggerC, NULL );
+    const state_machine_result_t resultTpl = engines.machineTpl.dispatchEvent();
+
+    TEST_ASSERT_EQUAL_STRING( traceC.text.c_str(), traceTpl.text.c_str() );
+    TEST_ASSERT_EQUAL( resultC, resultTpl );
+    TEST_ASSERT_EQUAL_UINT32( engines.machineC.State->Id, engines.machineTpl.getState() );
+    TEST_ASSERT_EQUAL_UINT32( engines.machineC.dropped, engines.machineTpl.getDroppedEvents() );
+    TEST_ASSERT_NULL( engines.machineC.event );
+}
+
+
+/**
+ * @brief Starts both engines in the first state.
+ */
+static void test_start( test_engines_t& engines )
+{
+    engines.machineC = state_machine_t();
+
+    switch_state( &engines.machineC, &testStatesC[0] );
+    engines.machineTpl.switchState<TestState0>();
+
+    TEST_ASSERT_EQUAL_STRING( traceC.text.c_str(), traceTpl.text.c_str() );
+}
+
+
+/**
+ * @brief Runs a random event sequence through both engines.
+ *
+ * @param seed The seed of the sequence.
+ */
+static void test_runSequence( uint32_t seed )
+{
+    test_engines_t engines;
+    uint32_t       random = seed;
+
+    test_start( engines );
+
+    for ( uint16_t i = 0; i < TEST_SEQUENCE_LENGTH; i++ )
+    {
+        /* Numerical Recipes LCG, the same sequence on every host */
+        random = random * 1664525UL + 1013904223UL;
+
+        test_push( engines, ( random >> 8 ) % TEST_EVENT_RANGE, ( random >> 20 ) % 3 );
+
+        /* Dispatch after 1 to 4 events, so the queue holds several classes */
+        if ( ( ( random >> 28 ) & 0x03 ) == 0 )
+        {
+            test_dispatchAndCompare( engines );
+        }
+    }
+
+    test_dispatchAndCompare( engines );
+    TEST_ASSERT_TRUE( traceC.pushes > 0 );
+}
+
+
+void test_switchesRunTheSameActions( void )
+{
+    test_engines_t engines;
+
+    test_start( engines );
+
+    const uint32_t events[] = { 1, 1, 1, 4, 1, 6, 0 };
+
+    for ( uint8_t i = 0; i < sizeof( events ) / sizeof( events[0] ); i++ )
+    {
+        test_push( engines, events[i], 0 );
+        test_dispatchAndCompare( engines );
+    }
+}
+
+
+void test_unhandledEventsAreDropped( void )
+{
+    test_engines_t engines;
+
+    test_start( engines );
+
+    test_push( engines, 3, 0 );
+    test_push( engines, 6, 0 );
+    test_push( engines, 0, 0 );
+    test_dispatchAndCompare( engines );
+
+    TEST_ASSERT_EQUAL_UINT32( 2, engines.machineC.dropped );
+}
+
+
+void test_pushedEventsKeepTheClassOrder( void )
+{
+    test_engines_t engines;
+
+    test_start( engines );
+
+    test_push( engines, 0, 0 );
+    test_push( engines, 2, 0 );
+    test_push( engines, 7, 1 );
+    test_push( engines, 8, 0 );
+    test_dispatchAndCompare( engines );
+}
+
+
+void test_retriggerDispatchesTheSameEvent( void )
+{
+    test_engines_t engines;
+
+    test_start( engines );
+
+    /* The handler pushes an event of the highest class in front of the event and returns
+     * TRIGGERED_TO_SELF, both engines must dispatch the event again, not the pushed one.
+     */
+    test_push( engines, 5, 0 );
+    test_push( engines, 0, 0 );
+    test_dispatchAndCompare( engines );
+
+    TEST_ASSERT_TRUE( traceC.text.find( "h0:5 <0:2 [0:5 h0:5 " ) != std::string::npos );
+}
+
+
+void test_randomSequences( void )
+{
+    const uint32_t seeds[] = { 1, 0x2545F491UL, 0xDEADBEEFUL, 20240913UL };
+
+    for ( uint8_t i = 0; i < sizeof( seeds ) / sizeof( seeds[0] ); i++ )
+    {
+        setUp();
+        test_runSequence( seeds[i] );
+    }
+}
+
+
+int main( int argc, char** argv )
+{
+    hostShim_reset();
+
+    UNITY_BEGIN();
+    RUN_TEST( test_switchesRunTheSameActions );
+    RUN_TEST( test_unhandledEventsAreDropped );
+    RUN_TEST( test_pushedEventsKeepTheClassOrder );
+    RUN_TEST( test_retriggerDispatchesTheSameEvent );
+    RUN_TEST( test_randomSequences );
+    return UNITY_END();
+}
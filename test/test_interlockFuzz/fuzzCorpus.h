@@ -0,0 +1,148 @@
+/**
+ * \file    fuzzCorpus.h
+ * \brief   Seed corpus and regression cases of the interlock fuzzer
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#ifndef FUZZ_CORPUS_H
+#define FUZZ_CORPUS_H
+
+#include <stdint.h>
+
+#include "ioMan.h"
+#include "stateMan.h"
+
+/*
+ * The traces use the records of tools/replay.py: "I <time> <input> <level>" sets an input
+ * at a time in ms, "E <time>" ends the trace. The inputs are 0 and 1 for the buttons and
+ * 2 and 3 for the door switches, level 1 presses a button or opens a door. The settings
+ * are the ones of the dbc, timer and budget commands, so a case can be replayed on a
+ * controller as well.
+ *
+ * A minimised failing trace printed by the fuzzer is added to the regression cases
+ * together with the state the controller must end in once the fault is fixed.
+ */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief The settings of a fuzz case
+ */
+typedef struct
+{
+    uint16_t debounceDelay[IO_INPUT_SIZE]; /*!< The debounce delay of the inputs @unit ms */
+    uint8_t  unlockTimeout;                /*!< The door unlock timeout @unit s */
+    uint8_t  openTimeout;                  /*!< The door open timeout @unit min */
+    uint8_t  maxEvents;                    /*!< The most events dispatched per step ( 0 = unlimited ) */
+    uint16_t deferMaxAge;                  /*!< The age after which a deferred event is dropped ( 0 = never ) @unit s */
+} fuzz_settings_t;
+
+/**
+ * @brief A fuzz case of the seed corpus or of the regression cases
+ */
+typedef struct
+{
+    const char*          pName;     /*!< What the case covers */
+    fuzz_settings_t      settings;  /*!< The settings of the controller */
+    const char*          pTrace;    /*!< The input trace */
+    door_control_state_t endState;  /*!< The state at the end of the trace */
+} fuzz_case_t;
+
+
+/******************************** Global variables **************************************/
+
+#define FUZZ_DEFAULT_SETTINGS   { { 100, 100, 300, 300 }, 5, 10, 8, 10 } /*!< The default settings of the firmware */
+
+/**
+ * @brief The seed corpus, mutated by the fuzzer
+ */
+static const fuzz_case_t fuzzCorpus[] = {
+    {
+        "door 1 cycle",
+        FUZZ_DEFAULT_SETTINGS,
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 1000 0 1\nI 1200 0 0\nI 2000 2 1\nI 4000 2 0\n"
+        "E 5000\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "door 2 cycle with bouncing contacts",
+        { { 20, 20, 50, 50 }, 3, 1, 8, 10 },
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 1000 1 1\nI 1002 1 0\nI 1004 1 1\nI 1150 1 0\n"
+        "I 1500 3 1\nI 1503 3 0\nI 1506 3 1\nI 3000 3 0\nI 3004 3 1\nI 3008 3 0\n"
+        "E 4000\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "both buttons pressed together",
+        FUZZ_DEFAULT_SETTINGS,
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 1000 0 1\nI 1000 1 1\nI 1500 0 0\nI 1500 1 0\n"
+        "E 2500\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "door 2 forced open while door 1 is open",
+        FUZZ_DEFAULT_SETTINGS,
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 1000 0 1\nI 1200 0 0\nI 1600 2 1\nI 2500 3 1\nI 3000 1 1\nI 3200 1 0\n"
+        "I 4000 3 0\nI 4200 2 0\n"
+        "E 5000\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "door 1 left open until the open timeout",
+        { { 100, 100, 300, 300 }, 5, 1, 8, 10 },
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 1000 0 1\nI 1200 0 0\nI 2000 2 1\nI 65000 1 1\nI 65200 1 0\n"
+        "E 66000\n",
+        DOOR_CONTROL_STATE_FAULT
+    },
+    {
+        "button burst with a budget of one event",
+        { { 10, 10, 10, 10 }, 1, 1, 1, 1 },
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 500 0 1\nI 520 0 0\nI 540 1 1\nI 560 1 0\nI 580 0 1\nI 600 0 0\n"
+        "I 620 2 1\nI 640 2 0\nI 660 1 1\nI 680 3 1\nI 700 3 0\nI 720 1 0\n"
+        "E 4000\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "door switch unstable at startup, the fault clears once it settles closed",
+        FUZZ_DEFAULT_SETTINGS,
+        "I 0 0 0\nI 0 1 0\nI 0 2 1\nI 0 3 0\n"
+        "I 100 2 0\nI 200 2 1\nI 300 2 0\nI 400 2 1\nI 500 2 0\nI 600 2 1\nI 700 2 0\n"
+        "E 4000\n",
+        DOOR_CONTROL_STATE_IDLE
+    }
+};
+
+/**
+ * @brief The regression cases, traces at the edges of the door timers and minimised traces the fuzzer found
+ */
+static const fuzz_case_t fuzzRegressions[] = {
+    {
+        "door 1 opened and closed while unlocked by a button held over the unlock timeout",
+        { { 10, 10, 10, 10 }, 1, 1, 8, 10 },
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 100 0 1\nI 500 2 1\nI 600 2 0\nI 2500 0 0\n"
+        "E 3500\n",
+        DOOR_CONTROL_STATE_IDLE
+    },
+    {
+        "door 1 opened at its unlock timeout while the button of door 2 is pressed",
+        { { 10, 10, 10, 10 }, 1, 1, 1, 10 },
+        "I 0 0 0\nI 0 1 0\nI 0 2 0\nI 0 3 0\n"
+        "I 100 0 1\nI 150 0 0\nI 1095 1 1\nI 1100 2 1\nI 1500 1 0\nI 2000 2 0\n"
+        "E 3000\n",
+        DOOR_CONTROL_STATE_IDLE
+    }
+};
+
+#endif  // FUZZ_CORPUS_H
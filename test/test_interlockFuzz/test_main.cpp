@@ -0,0 +1,611 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Randomized safety fuzzer of the door interlock and the event queue
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <sys/wait.h>
+#include <unistd.h>
+#define FUZZ_FORK               1 /*!< The workers are processes of their own */
+#else
+#define FUZZ_FORK               0 /*!< The workers run one after the other */
+#endif
+
+#include "hostShim.h"
+#include "hsm.h"
+#include "stateMan.h"
+#include "fuzzCorpus.h"
+
+/* The min and max macros of the Arduino core hide the ones of the standard library */
+#undef min
+#undef max
+
+/*
+ * The fuzzer runs the door control on the host, one millisecond per processing step, and
+ * checks after every step:
+ * - the doors are never unlocked both, except in the emergency state
+ * - the interlock check of the firmware never found a violation
+ * - the event queue is sorted by priority class and doesn't grow without bound
+ * - the deferred events match their count and stay within their capacity
+ *
+ * Every trace is either generated like tools/fuzz.py does or a mutation of a case of the
+ * seed corpus, with random debounce, timer and budget settings. The traces are spread
+ * over worker processes, one per core, so the workers share no firmware state and the
+ * throughput scales with the cores. A failing trace is minimised and printed with the
+ * commands and records to replay it on a controller with tools/replay.py.
+ *
+ * The environment variables FUZZ_TRACES, FUZZ_JOBS and FUZZ_SEED set the number of traces,
+ * the number of workers and the seed of the run.
+ */
+
+
+/*************************************** Defines ****************************************/
+
+#define FUZZ_TRACES             64     /*!< Default number of generated traces of a run */
+#define FUZZ_SEED               1      /*!< Default seed of a run */
+#define FUZZ_EDGES              30     /*!< Input changes of a generated trace */
+#define FUZZ_MAX_GAP            2000   /*!< Longest time between two input changes @unit ms */
+#define FUZZ_MAX_BOUNCE         3      /*!< Most bounces of an input change */
+#define FUZZ_MAX_MUTATIONS      4      /*!< Most mutations of a corpus case */
+#define FUZZ_TAIL               1000   /*!< Time after the last record of a generated trace @unit ms */
+#define FUZZ_QUEUE_LIMIT        32     /*!< Longest event queue that isn't a leak */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief A record of a trace
+ */
+typedef struct
+{
+    uint32_t time;  /*!< The time of the record @unit ms */
+    uint8_t  input; /*!< The input */
+    uint8_t  level; /*!< The pin level */
+} fuzz_record_t;
+
+/**
+ * @brief A trace with its settings
+ */
+typedef struct
+{
+    fuzz_settings_t            settings; /*!< The settings of the controller */
+    std::vector<fuzz_record_t> records;  /*!< The records, sorted by time */
+    uint32_t                   end;      /*!< The end of the trace @unit ms */
+} fuzz_trace_t;
+
+/**
+ * @brief The outcome of a trace
+ */
+typedef struct
+{
+    bool                 passed;   /*!< All invariants held */
+    uint32_t             time;     /*!< The time of the first broken invariant @unit ms */
+    const char*          pReason;  /*!< The first broken invariant */
+    door_control_state_t endState; /*!< The state at the end of the trace */
+} fuzz_result_t;
+
+
+/******************************** Global variables **************************************/
+
+static door_control_t doorControl; /*!< The door control instance under test */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Parses the records of a trace.
+ *
+ * @param pText The records, one per line.
+ * @param pTrace The trace, its settings are kept.
+ */
+static void fuzz_parse( const char* pText, fuzz_trace_t* const pTrace )
+{
+    pTrace->records.clear();
+    pTrace->end = 0;
+
+    while ( *pText != '\0' )
+    {
+        unsigned time  = 0;
+        unsigned input = 0;
+        unsigned level = 0;
+
+        if ( sscanf( pText, "I %u %u %u", &time, &input, &level ) == 3 )
+        {
+            pTrace->records.push_back( { time, (uint8_t) input, (uint8_t) level } );
+        }
+        else if ( sscanf( pText, "E %u", &time ) == 1 )
+        {
+            pTrace->end = time;
+        }
+
+        pText = strchr( pText, '\n' );
+        if ( pText == NULL )
+        {
+            break;
+        }
+        pText++;
+    }
+}
+
+
+/**
+ * @brief Prints a trace with the commands to replay it on a controller.
+ *
+ * @param pTrace The trace.
+ */
+static void fuzz_print( const fuzz_trace_t* const pTrace )
+{
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        printf( "dbc -i %u -t %u\n", input, pTrace->settings.debounceDelay[input] );
+    }
+    printf( "timer -u %u -o %u\n", pTrace->settings.unlockTimeout, pTrace->settings.openTimeout );
+    printf( "budget -e %u -d %u\n", pTrace->settings.maxEvents, pTrace->settings.deferMaxAge );
+
+    for ( const fuzz_record_t& record : pTrace->records )
+    {
+        printf( "I %u %u %u\n", (unsigned) record.time, record.input, record.level );
+    }
+    printf( "E %u\n", (unsigned) pTrace->end );
+}
+
+
+/**
+ * @brief Checks the invariants after a processing step.
+ *
+ * @return The broken invariant, NULL if all invariants hold.
+ */
+static const char* fuzz_check( void )
+{
+    const bool bothUnlocked =    ( ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_1 ) == LOCK_STATE_UNLOCKED )
+                              && ( ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_2 ) == LOCK_STATE_UNLOCKED );
+
+    if ( bothUnlocked && ( stateMan_getState( &doorControl ) != DOOR_CONTROL_STATE_EMERGENCY ) )
+    {
+        return "both doors unlocked";
+    }
+
+    if ( stateMan_getInterlockViolations( &doorControl ) != 0 )
+    {
+        return "interlock violation";
+    }
+
+    uint8_t queued = 0;
+
+    for ( const event_t* pEvent = doorControl.machine.event; pEvent != NULL; pEvent = pEvent->next )
+    {
+        if ( ( pEvent->next != NULL ) && ( pEvent->next->priority > pEvent->priority ) )
+        {
+            return "event queue out of priority order";
+        }
+
+        if ( ++queued > FUZZ_QUEUE_LIMIT )
+        {
+            return "event queue grows without bound";
+        }
+    }
+
+    uint8_t deferred = 0;
+
+    for ( const event_t* pEvent = doorControl.machine.deferred; pEvent != NULL; pEvent = pEvent->next )
+    {
+        deferred++;
+    }
+
+    if ( ( deferred != doorControl.machine.deferredCount ) || ( deferred > HSM_DEFER_CAPACITY ) )
+    {
+        return "deferred events out of count";
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Runs a trace on a new door control instance.
+ *
+ * @param pTrace The trace.
+ * @return fuzz_result_t The outcome.
+ */
+static fuzz_result_t fuzz_run( const fuzz_trace_t* const pTrace )
+{
+    fuzz_result_t result = { true, 0, NULL, DOOR_CONTROL_STATE_INIT };
+    size_t        next   = 0;
+
+    hostShim_reset();
+    stateMan_init( &doorControl, millis() );
+    ioMan_setInputOverride( &doorControl.io, true );
+
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setDebounceDelay( &doorControl.io, (io_t) input, pTrace->settings.debounceDelay[input] );
+    }
+    stateMan_setDoorTimer( &doorControl, DOOR_TIMER_TYPE_UNLOCK, pTrace->settings.unlockTimeout );
+    stateMan_setDoorTimer( &doorControl, DOOR_TIMER_TYPE_OPEN, pTrace->settings.openTimeout );
+    stateMan_setDispatchBudget( &doorControl, pTrace->settings.maxEvents, 0 );
+    stateMan_setDeferMaxAge( &doorControl, pTrace->settings.deferMaxAge );
+
+    for ( uint32_t time = 0; time <= pTrace->end; time++ )
+    {
+        while ( ( next < pTrace->records.size() ) && ( pTrace->records[next].time <= time ) )
+        {
+            ioMan_setRawInput( &doorControl.io, (io_t) pTrace->records[next].input, pTrace->records[next].level );
+            next++;
+        }
+
+        hostShim_setMillis( time );
+        stateMan_process( &doorControl, time );
+
+        const char* pReason = fuzz_check();
+
+        if ( pReason != NULL )
+        {
+            result = { false, time, pReason, stateMan_getState( &doorControl ) };
+            break;
+        }
+    }
+
+    result.endState = stateMan_getState( &doorControl );
+    clear_events( &doorControl.machine );
+
+    return result;
+}
+
+
+/**
+ * @brief Draws random settings.
+ */
+static void fuzz_randomSettings( std::mt19937& rng, fuzz_settings_t* const pSettings )
+{
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        pSettings->debounceDelay[input] = std::uniform_int_distribution<uint16_t>( 10, 300 )( rng );
+    }
+    pSettings->unlockTimeout = std::uniform_int_distribution<uint8_t>( 1, 10 )( rng );
+    pSettings->openTimeout   = std::uniform_int_distribution<uint8_t>( 1, 3 )( rng );
+    pSettings->maxEvents     = std::uniform_int_distribution<uint8_t>( 0, 4 )( rng );
+    pSettings->deferMaxAge   = std::uniform_int_distribution<uint16_t>( 0, 20 )( rng );
+}
+
+
+/**
+ * @brief Appends an input change with contact bounce, like tools/fuzz.py.
+ *
+ * @return The time after the change @unit ms
+ */
+static uint32_t fuzz_appendEdge( std::mt19937& rng, std::vector<fuzz_record_t>& records, uint32_t time, uint8_t input, uint8_t level )
+{
+    const uint8_t bounces = std::uniform_int_distribution<uint8_t>( 0, FUZZ_MAX_BOUNCE )( rng );
+
+    for ( uint8_t i = 0; i < bounces; i++ )
+    {
+        records.push_back( { time, input, level } );
+        time += std::uniform_int_distribution<uint32_t>( 1, 5 )( rng );
+        records.push_back( { time, input, (uint8_t) !level } );
+        time += std::uniform_int_distribution<uint32_t>( 1, 5 )( rng );
+    }
+
+    records.push_back( { time, input, level } );
+
+    return time;
+}
+
+
+/**
+ * @brief Generates a trace with random settings, like tools/fuzz.py.
+ */
+static void fuzz_generate( std::mt19937& rng, fuzz_trace_t* const pTrace )
+{
+    uint8_t  levels[IO_INPUT_SIZE] = {};
+    uint32_t time                  = 0;
+
+    fuzz_randomSettings( rng, &pTrace->settings );
+    pTrace->records.clear();
+
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        pTrace->records.push_back( { 0, input, LOW } );
+    }
+
+    for ( uint8_t edge = 0; edge < FUZZ_EDGES; edge++ )
+    {
+        const uint8_t input = std::uniform_int_distribution<uint8_t>( 0, IO_INPUT_SIZE - 1 )( rng );
+
+        time          += std::uniform_int_distribution<uint32_t>( 1, FUZZ_MAX_GAP )( rng );
+        levels[input]  = !levels[input];
+        time           = fuzz_appendEdge( rng, pTrace->records, time, input, levels[input] );
+    }
+
+    pTrace->end = time + FUZZ_TAIL;
+}
+
+
+/**
+ * @brief Mutates a case of the seed corpus.
+ *
+ * An input change is added, removed or moved, or the settings are drawn again.
+ */
+static void fuzz_mutate( std::mt19937& rng, fuzz_trace_t* const pTrace )
+{
+    const fuzz_case_t& seed = fuzzCorpus[std::uniform_int_distribution<size_t>( 0, sizeof( fuzzCorpus ) / sizeof( fuzzCorpus[0] ) - 1 )( rng )];
+
+    pTrace->settings = seed.settings;
+    fuzz_parse( seed.pTrace, pTrace );
+
+    const uint8_t mutations = std::uniform_int_distribution<uint8_t>( 1, FUZZ_MAX_MUTATIONS )( rng );
+
+    for ( uint8_t i = 0; i < mutations; i++ )
+    {
+        std::vector<fuzz_record_t>& records = pTrace->records;
+        const size_t                index   = std::uniform_int_distribution<size_t>( 0, records.size() - 1 )( rng );
+
+        switch ( std::uniform_int_distribution<uint8_t>( 0, 3 )( rng ) )
+        {
+        case 0:
+            fuzz_appendEdge( rng, records, std::uniform_int_distribution<uint32_t>( 1, pTrace->end )( rng ),
+                             std::uniform_int_distribution<uint8_t>( 0, IO_INPUT_SIZE - 1 )( rng ),
+                             std::uniform_int_distribution<uint8_t>( LOW, HIGH )( rng ) );
+            break;
+        case 1:
+            /* The initial levels are kept */
+            if ( records[index].time != 0 )
+            {
+                records.erase( records.begin() + index );
+            }
+            break;
+        case 2:
+            if ( records[index].time != 0 )
+            {
+                records[index].time = std::max<int32_t>( 1, (int32_t) records[index].time + std::uniform_int_distribution<int32_t>( -500, 500 )( rng ) );
+            }
+            break;
+        default:
+            fuzz_randomSettings( rng, &pTrace->settings );
+            break;
+        }
+    }
+
+    std::stable_sort( pTrace->records.begin(), pTrace->records.end(),
+                      []( const fuzz_record_t& a, const fuzz_record_t& b ) { return a.time < b.time; } );
+
+    pTrace->end = std::max( pTrace->end, pTrace->records.back().time + FUZZ_TAIL );
+}
+
+
+/**
+ * @brief Minimises a failing trace with delta debugging, like tools/fuzz.py.
+ *
+ * The initial input levels are always kept, all later records are candidates for removal.
+ *
+ * @param pTrace The failing trace, the minimised trace on return.
+ */
+static void fuzz_minimize( fuzz_trace_t* const pTrace )
+{
+    std::vector<fuzz_record_t> initial;
+    std::vector<fuzz_record_t> edges;
+    size_t                     chunks = 2;
+
+    for ( const fuzz_record_t& record : pTrace->records )
+    {
+        ( ( record.time == 0 ) ? initial : edges ).push_back( record );
+    }
+
+    while ( edges.size() >= 2 )
+    {
+        const size_t size    = std::max<size_t>( 1, edges.size() / chunks );
+        bool         reduced = false;
+
+        for ( size_t start = 0; start < edges.size(); start += size )
+        {
+            fuzz_trace_t candidate = *pTrace;
+
+            candidate.records = initial;
+            candidate.records.insert( candidate.records.end(), edges.begin(), edges.begin() + start );
+            candidate.records.insert( candidate.records.end(), edges.begin() + std::min( start + size, edges.size() ), edges.end() );
+
+            if ( !fuzz_run( &candidate ).passed )
+            {
+                edges.erase( edges.begin() + start, edges.begin() + std::min( start + size, edges.size() ) );
+                chunks  = std::max<size_t>( chunks - 1, 2 );
+                reduced = true;
+                break;
+            }
+        }
+
+        if ( !reduced )
+        {
+            if ( size == 1 )
+            {
+                break;
+            }
+            chunks = std::min( chunks * 2, edges.size() );
+        }
+    }
+
+    pTrace->records = initial;
+    pTrace->records.insert( pTrace->records.end(), edges.begin(), edges.end() );
+}
+
+
+/**
+ * @brief Runs the traces of a worker.
+ *
+ * @param seed The seed of the run.
+ * @param job The index of the worker.
+ * @param jobs The number of workers.
+ * @param traces The number of traces of the run.
+ * @return true if all traces passed.
+ */
+static bool fuzz_worker( uint32_t seed, uint32_t job, uint32_t jobs, uint32_t traces )
+{
+    fuzz_trace_t trace;
+
+    for ( uint32_t index = job; index < traces; index += jobs )
+    {
+        std::mt19937 rng( seed + index );
+
+        if ( index & 1 )
+        {
+            fuzz_mutate( rng, &trace );
+        }
+        else
+        {
+            fuzz_generate( rng, &trace );
+        }
+
+        const fuzz_result_t result = fuzz_run( &trace );
+
+        if ( !result.passed )
+        {
+            fuzz_minimize( &trace );
+            const fuzz_result_t minimal = fuzz_run( &trace );
+
+            printf( "Trace %u of seed %u: %s at %u ms, minimised to %u records:\n", (unsigned) index, (unsigned) seed,
+                    minimal.pReason, (unsigned) minimal.time, (unsigned) trace.records.size() );
+            fuzz_print( &trace );
+            fflush( stdout );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Returns a number from the environment.
+ */
+static uint32_t fuzz_getEnv( const char* pName, uint32_t fallback )
+{
+    const char* pValue = getenv( pName );
+
+    return ( pValue != NULL ) ? (uint32_t) strtoul( pValue, NULL, 0 ) : fallback;
+}
+
+
+/**
+ * @brief Runs a case of the seed corpus or a regression case and checks its end state.
+ */
+static void fuzz_runCase( const fuzz_case_t& fuzzCase )
+{
+    fuzz_trace_t trace;
+
+    trace.settings = fuzzCase.settings;
+    fuzz_parse( fuzzCase.pTrace, &trace );
+
+    const fuzz_result_t result = fuzz_run( &trace );
+
+    TEST_ASSERT_TRUE_MESSAGE( result.passed, fuzzCase.pName );
+    TEST_ASSERT_EQUAL_MESSAGE( fuzzCase.endState, result.endState, fuzzCase.pName );
+}
+
+
+void test_corpus( void )
+{
+    for ( const fuzz_case_t& fuzzCase : fuzzCorpus )
+    {
+        fuzz_runCase( fuzzCase );
+    }
+}
+
+
+void test_regressions( void )
+{
+    for ( const fuzz_case_t& fuzzCase : fuzzRegressions )
+    {
+        fuzz_runCase( fuzzCase );
+    }
+}
+
+
+void test_brokenInvariantIsFound( void )
+{
+    fuzz_trace_t trace;
+
+    trace.settings = fuzzCorpus[0].settings;
+    fuzz_parse( fuzzCorpus[0].pTrace, &trace );
+
+    /* The fuzzer must notice a violation, so unlock both doors behind the state machine */
+    hostShim_reset();
+    stateMan_init( &doorControl, millis() );
+    ioMan_setDoorState( &doorControl.io, DOOR_TYPE_DOOR_1, LOCK_STATE_UNLOCKED );
+    ioMan_setDoorState( &doorControl.io, DOOR_TYPE_DOOR_2, LOCK_STATE_UNLOCKED );
+    TEST_ASSERT_EQUAL_STRING( "both doors unlocked", fuzz_check() );
+    clear_events( &doorControl.machine );
+
+    TEST_ASSERT_TRUE( fuzz_run( &trace ).passed );
+}
+
+
+void test_fuzz( void )
+{
+    const uint32_t seed   = fuzz_getEnv( "FUZZ_SEED", FUZZ_SEED );
+    const uint32_t traces = fuzz_getEnv( "FUZZ_TRACES", FUZZ_TRACES );
+    uint32_t       jobs   = fuzz_getEnv( "FUZZ_JOBS", std::max( 1U, std::thread::hardware_concurrency() ) );
+    uint32_t       failed = 0;
+
+    jobs = std::max<uint32_t>( 1, std::min( jobs, traces ) );
+
+#if FUZZ_FORK
+    fflush( stdout );
+
+    for ( uint32_t job = 0; job < jobs; job++ )
+    {
+        if ( fork() == 0 )
+        {
+            _exit( fuzz_worker( seed, job, jobs, traces ) ? 0 : 1 );
+        }
+    }
+
+    for ( uint32_t job = 0; job < jobs; job++ )
+    {
+        int status = 0;
+
+        if ( ( wait( &status ) < 0 ) || !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) )
+        {
+            failed++;
+        }
+    }
+#else
+    for ( uint32_t job = 0; job < jobs; job++ )
+    {
+        failed += fuzz_worker( seed, job, jobs, traces ) ? 0 : 1;
+    }
+#endif
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE( 0, failed, "Interlock fuzzer found a failing trace, see the output" );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_corpus );
+    RUN_TEST( test_regressions );
+    RUN_TEST( test_brokenInvariantIsFound );
+    RUN_TEST( test_fuzz );
+    return UNITY_END();
+}
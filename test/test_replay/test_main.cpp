@@ -0,0 +1,350 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the trace replay on the host
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "hostShim.h"
+#include "replay.h"
+#include "stateMan.h"
+#include "appSettings.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_SETTLE             2000 /*!< Trace time at which the replayed inputs have settled @unit ms */
+#define TEST_LINE_SIZE          32   /*!< Size of a trace record */
+#define TEST_TRAFFIC            86400000UL /*!< Recorded traffic, one day @unit ms */
+#define TEST_MIN_SPEEDUP        1000 /*!< Least ratio of the replayed traffic to the time the replay takes */
+
+/******************************** Global variables **************************************/
+
+static door_control_t doorControl; /*!< The recorded door control instance, its inputs start a replay */
+static uint32_t       testRandom;  /*!< State of the random generator of the recorded traffic */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    hostShim_reset();
+
+    stateMan_init( &doorControl, millis() );
+    ioMan_setInputOverride( &doorControl.io, true );
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setRawInput( &doorControl.io, (io_t) input, LOW );
+    }
+
+    replay_setup( &doorControl );
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Feeds a trace record to the replay.
+ */
+static void test_record( const char* format, unsigned long time, unsigned int input = 0, unsigned int level = 0 )
+{
+    char line[TEST_LINE_SIZE];
+
+    snprintf( line, sizeof( line ), format, time, input, level );
+    replay_processLine( line );
+}
+
+
+/**
+ * @brief Starts a replay with closed doors and replays it until the inputs have settled.
+ *
+ * @return door_control_t* The replayed instance.
+ */
+static door_control_t* test_startReplay( void )
+{
+    replay_start( 0 );
+
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        test_record( "I %lu %u %u", 0, input, LOW );
+    }
+    test_record( "I %lu %u %u", TEST_SETTLE, 0, LOW );
+
+    door_control_t* const pInstance = replay_getInstance();
+    TEST_ASSERT_NOT_NULL( pInstance );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( pInstance ) );
+
+    return pInstance;
+}
+
+
+/**
+ * @brief Checks whether an S-record of the replay shows the given door unlocked.
+ */
+static bool test_wasUnlocked( door_type_t door )
+{
+    const std::string& output = Serial.output;
+
+    for ( size_t start = 0; start < output.size(); start = output.find( '\n', start ) + 1 )
+    {
+        unsigned long time;
+        unsigned int  state;
+        unsigned int  locks;
+
+        if (    ( sscanf( output.c_str() + start, "S %lu %u %u", &time, &state, &locks ) == 3 )
+             && ( locks & ( 1U << door ) ) )
+        {
+            return true;
+        }
+
+        if ( output.find( '\n', start ) == std::string::npos )
+        {
+            break;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Returns the (state, unlocked doors) pairs of the S-records of a trace, without repetitions.
+ */
+static std::vector<std::pair<unsigned int, unsigned int>> test_getStates( const std::string& trace )
+{
+    std::vector<std::pair<unsigned int, unsigned int>> states;
+    size_t                                             start = 0;
+
+    while ( start < trace.size() )
+    {
+        unsigned long time;
+        unsigned int  state;
+        unsigned int  locks;
+
+        if (    ( sscanf( trace.c_str() + start, "S %lu %u %u", &time, &state, &locks ) == 3 )
+             && ( states.empty() || ( states.back() != std::make_pair( state, locks ) ) ) )
+        {
+            states.push_back( std::make_pair( state, locks ) );
+        }
+
+        const size_t end = trace.find( '\n', start );
+        start            = ( end == std::string::npos ) ? trace.size() : end + 1;
+    }
+
+    return states;
+}
+
+
+/**
+ * @brief Returns a pseudo random number below the given limit.
+ */
+static uint32_t test_random( uint32_t limit )
+{
+    testRandom = testRandom * 1664525UL + 1013904223UL;
+    return ( testRandom >> 8 ) % limit;
+}
+
+
+/**
+ * @brief Runs the recorded instance like the main loop, one processing step per millisecond.
+ */
+static void test_run( uint32_t span )
+{
+    for ( uint32_t time = 0; time < span; time++ )
+    {
+        hostShim_advanceMillis( 1 );
+        stateMan_process( &doorControl, millis() );
+        replay_process();
+    }
+}
+
+
+/**
+ * @brief Sets an input of the recorded instance and runs it for the given time.
+ */
+static void test_input( io_t input, uint8_t level, uint32_t span )
+{
+    ioMan_setRawInput( &doorControl.io, input, level );
+    test_run( span );
+}
+
+
+/**
+ * @brief Records one passage through the airlock or one of its mishaps.
+ */
+static void test_recordPassage( void )
+{
+    const door_type_t door        = (door_type_t) test_random( DOOR_TYPE_SIZE );
+    const io_t        button      = ( door == DOOR_TYPE_DOOR_1 ) ? IO_BUTTON_1 : IO_BUTTON_2;
+    const io_t        doorSwitch  = ( door == DOOR_TYPE_DOOR_1 ) ? IO_SWITCH_1 : IO_SWITCH_2;
+    const io_t        otherSwitch = ( door == DOOR_TYPE_DOOR_1 ) ? IO_SWITCH_2 : IO_SWITCH_1;
+
+    test_input( button, HIGH, 100 + test_random( 400 ) );
+    test_input( button, LOW, 500 + test_random( 1500 ) );
+
+    switch ( test_random( 8 ) )
+    {
+    case 0:
+        /* Nobody passes, the door locks at its unlock timeout */
+        test_run( appSettings_getSettings()->doorUnlockTimeout * 1000UL );
+        break;
+
+    case 1:
+        /* The other door is forced open meanwhile */
+        test_input( otherSwitch, HIGH, 1000 + test_random( 2000 ) );
+        test_input( otherSwitch, LOW, 2000 );
+        break;
+
+    case 2:
+        /* The switch bounces when the door closes */
+        test_input( doorSwitch, HIGH, 2000 + test_random( 3000 ) );
+        for ( uint8_t bounce = 0; bounce < 4; bounce++ )
+        {
+            test_input( doorSwitch, LOW, 1 + test_random( 5 ) );
+            test_input( doorSwitch, HIGH, 1 + test_random( 5 ) );
+        }
+        test_input( doorSwitch, LOW, 2000 );
+        break;
+
+    default:
+        test_input( doorSwitch, HIGH, 2000 + test_random( 5000 ) );
+        test_input( doorSwitch, LOW, 2000 );
+        break;
+    }
+}
+
+
+void test_recorded_day_replays_the_same_states( void )
+{
+    testRandom = 1;
+    test_run( TEST_SETTLE );
+    Serial.output.clear();
+
+    /* A day of traffic, a passage every 5 minutes on average. The idle time between the
+     * passages is run in one step, as nothing can change once the inputs are settled and
+     * no timeout is pending.
+     */
+    replay_startRecording();
+    while ( millis() < TEST_TRAFFIC )
+    {
+        uint32_t deadline;
+
+        test_recordPassage();
+        while ( !ioMan_isSettled( &doorControl.io ) || stateMan_getNextTimerDeadline( &doorControl, &deadline ) )
+        {
+            test_run( 1 );
+        }
+
+        hostShim_advanceMillis( test_random( 600000UL ) );
+        test_run( 1 );
+    }
+    replay_stopRecording();
+
+    const std::string recording = Serial.output;
+    const uint32_t    traffic   = millis() - TEST_SETTLE;
+
+    /* Feed the I-records like tools/replay.py does */
+    Serial.output.clear();
+    replay_start( 0 );
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t     line  = 0;
+
+    while ( line < recording.size() )
+    {
+        const size_t end = recording.find( '\n', line );
+
+        if ( recording[line] == 'I' )
+        {
+            replay_processLine( recording.substr( line, end - line - ( ( recording[end - 1] == '\r' ) ? 1 : 0 ) ).c_str() );
+        }
+        line = end + 1;
+    }
+    test_record( "E %lu", traffic );
+
+    const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    printf( "Replayed %.1f h of traffic in %.3f s, %.0f times real time\n", traffic / 3600000.0, seconds, traffic / 1000.0 / seconds );
+
+    const auto expected = test_getStates( recording );
+    const auto actual   = test_getStates( Serial.output );
+
+    TEST_ASSERT_TRUE( expected.size() > 100 );
+    TEST_ASSERT_EQUAL_UINT32( expected.size(), actual.size() );
+    for ( size_t i = 0; i < expected.size(); i++ )
+    {
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE( expected[i].first, actual[i].first, "state" );
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE( expected[i].second, actual[i].second, "unlocked doors" );
+    }
+
+    TEST_ASSERT_TRUE( traffic / 1000.0 / seconds >= TEST_MIN_SPEEDUP );
+}
+
+
+void test_deferred_unlock_expires_on_the_virtual_clock( void )
+{
+    door_control_t* const pInstance = test_startReplay();
+
+    /* The request of door 2 waits for door 1. The hardware clock doesn't move during the replay */
+    stateMan_setDeferMaxAge( pInstance, 1 );
+    stateMan_postEvent( pInstance, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( pInstance, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_record( "I %lu %u %u", TEST_SETTLE + 1, 0, LOW );
+
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( pInstance ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, pInstance->machine.deferredCount );
+
+    /* Posted at the settle time, the age exceeds 1 s one millisecond after 1 s */
+    test_record( "I %lu %u %u", TEST_SETTLE + 1000, 0, LOW );
+    TEST_ASSERT_EQUAL_UINT8( 1, pInstance->machine.deferredCount );
+
+    test_record( "I %lu %u %u", TEST_SETTLE + 1001, 0, LOW );
+    TEST_ASSERT_EQUAL_UINT8( 0, pInstance->machine.deferredCount );
+    TEST_ASSERT_EQUAL_UINT32( 1, stateMan_getExpiredEvents( pInstance ) );
+
+    /* Door 1 locks at its unlock timeout and door 2 isn't unlocked by the dropped request */
+    test_record( "E %lu", TEST_SETTLE + 60000UL );
+    TEST_ASSERT_NULL( replay_getInstance() );
+    TEST_ASSERT_TRUE( test_wasUnlocked( DOOR_TYPE_DOOR_1 ) );
+    TEST_ASSERT_FALSE( test_wasUnlocked( DOOR_TYPE_DOOR_2 ) );
+}
+
+
+void test_deferred_unlock_expires_between_records( void )
+{
+    door_control_t* const pInstance = test_startReplay();
+
+    stateMan_setDeferMaxAge( pInstance, 5 );
+    stateMan_postEvent( pInstance, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    stateMan_postEvent( pInstance, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_record( "I %lu %u %u", TEST_SETTLE + 1, 0, LOW );
+    TEST_ASSERT_EQUAL_UINT8( 1, pInstance->machine.deferredCount );
+
+    /* The virtual clock stops at the expiry, even without a record or a timeout at that time */
+    TEST_ASSERT_EQUAL_UINT32( 0, stateMan_getExpiredEvents( pInstance ) );
+    uint32_t deadline;
+    TEST_ASSERT_TRUE( stateMan_getNextTimerDeadline( pInstance, &deadline ) );
+    TEST_ASSERT_EQUAL_UINT32( REPLAY_TIME_OFFSET + TEST_SETTLE + 5001, deadline );
+
+    test_record( "E %lu", TEST_SETTLE + 5001 );
+    TEST_ASSERT_EQUAL_UINT32( 1, stateMan_getExpiredEvents( pInstance ) );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_recorded_day_replays_the_same_states );
+    RUN_TEST( test_deferred_unlock_expires_on_the_virtual_clock );
+    RUN_TEST( test_deferred_unlock_expires_between_records );
+    return UNITY_END();
+}
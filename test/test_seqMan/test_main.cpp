@@ -0,0 +1,350 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the protothreads and the event driven sequences
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "hostShim.h"
+#include "pt.h"
+#include "seqMan.h"
+#include "stateMan.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_SIGNAL_A           0x01  /*!< A signal the test sequence waits for */
+#define TEST_SIGNAL_B           0x02  /*!< A signal the test sequence waits for with a timeout */
+#define TEST_SIGNAL_OTHER       0x80  /*!< A signal the test sequence never waits for */
+#define TEST_TIMEOUT            500   /*!< The timeout of the test sequence @unit ms */
+#define TEST_SETTLE             2000  /*!< Time for the inputs to settle @unit ms */
+
+
+/************************************* STRUCTURE **************************************/
+
+/**
+ * @brief A protothread with the values it keeps across its waits
+ */
+typedef struct
+{
+    pt_t    pt;          /*!< The protothread */
+    bool    condition;   /*!< The condition the protothread waits for */
+    uint8_t evaluations; /*!< How often the condition was evaluated */
+    uint8_t steps;       /*!< The steps the protothread completed */
+} test_pt_t;
+
+
+/******************************** Global variables **************************************/
+
+static door_control_t doorControl; /*!< The door control instance under test */
+static uint8_t        resumes;     /*!< How often the test sequence ran */
+static uint8_t        timeouts;    /*!< How often a wait of the test sequence timed out */
+static uint8_t        lastSignal;  /*!< The signal of the last resume of the test sequence */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+    resumes    = 0;
+    timeouts   = 0;
+    lastSignal = 0;
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Evaluates the condition of the test protothread and counts the evaluations.
+ */
+static bool test_evaluate( test_pt_t* const pTest )
+{
+    pTest->evaluations++;
+    return pTest->condition;
+}
+
+
+/**
+ * @brief The test protothread: waits for its condition, yields once and ends.
+ */
+static pt_result_t test_protothread( test_pt_t* const pTest )
+{
+    PT_BEGIN( &pTest->pt );
+
+    pTest->steps++;
+    PT_WAIT_UNTIL( &pTest->pt, test_evaluate( pTest ) );
+    pTest->steps++;
+    PT_YIELD( &pTest->pt );
+    pTest->steps++;
+
+    PT_END( &pTest->pt );
+}
+
+
+/**
+ * @brief The test sequence: waits for signal A, then for signal B with a timeout, forever.
+ */
+static pt_result_t test_sequence( seq_t* const pSeq )
+{
+    resumes++;
+    lastSignal = pSeq->signal;
+
+    PT_BEGIN( &pSeq->pt );
+
+    for ( ;; )
+    {
+        SEQ_AWAIT( pSeq, TEST_SIGNAL_A );
+        SEQ_AWAIT_TIMEOUT( pSeq, TEST_SIGNAL_B, TEST_TIMEOUT );
+        if ( SEQ_TIMED_OUT( pSeq ) )
+        {
+            timeouts++;
+        }
+    }
+
+    PT_END( &pSeq->pt );
+}
+
+
+void test_protothreadWaitsAndYields( void )
+{
+    test_pt_t test = {};
+
+    PT_INIT( &test.pt );
+
+    TEST_ASSERT_EQUAL( PT_WAITING, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL( PT_WAITING, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL_UINT8( 1, test.steps );
+    TEST_ASSERT_EQUAL_UINT8( 2, test.evaluations );
+
+    test.condition = true;
+    TEST_ASSERT_EQUAL( PT_YIELDED, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL_UINT8( 2, test.steps );
+    TEST_ASSERT_EQUAL_UINT8( 3, test.evaluations );
+
+    /* The condition isn't evaluated again behind the wait */
+    TEST_ASSERT_EQUAL( PT_ENDED, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL_UINT8( 3, test.steps );
+    TEST_ASSERT_EQUAL_UINT8( 3, test.evaluations );
+    TEST_ASSERT_EQUAL_UINT16( 0, test.pt.lc );
+}
+
+
+void test_protothreadStartsOver( void )
+{
+    test_pt_t test = {};
+
+    PT_INIT( &test.pt );
+    test_protothread( &test );
+    test.condition = true;
+    test_protothread( &test );
+
+    /* PT_INIT() abandons the yield, the body runs from its beginning again */
+    PT_INIT( &test.pt );
+    TEST_ASSERT_EQUAL( PT_YIELDED, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL_UINT8( 4, test.steps );
+
+    /* After the end, the next call starts over as well */
+    TEST_ASSERT_EQUAL( PT_ENDED, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL( PT_YIELDED, test_protothread( &test ) );
+    TEST_ASSERT_EQUAL_UINT8( 7, test.steps );
+}
+
+
+void test_sequenceRunsUntilItsFirstWait( void )
+{
+    seq_t    seq;
+    uint32_t deadline = 0;
+
+    seqMan_start( &seq, test_sequence, NULL, 3, 100 );
+
+    TEST_ASSERT_EQUAL_UINT8( 1, resumes );
+    TEST_ASSERT_EQUAL_UINT8( 3, seq.id );
+    TEST_ASSERT_EQUAL_UINT8( TEST_SIGNAL_A, seq.awaitSignals );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &seq, &deadline ) );
+
+    /* Without a deadline, processing doesn't resume the sequence */
+    seqMan_process( &seq, 100000 );
+    TEST_ASSERT_EQUAL_UINT8( 1, resumes );
+}
+
+
+void test_sequenceDropsSignalsItDoesNotAwait( void )
+{
+    seq_t seq;
+
+    seqMan_start( &seq, test_sequence, NULL, 0, 0 );
+
+    seqMan_post( &seq, TEST_SIGNAL_OTHER, 10 );
+    seqMan_post( &seq, TEST_SIGNAL_B, 20 );
+    TEST_ASSERT_EQUAL_UINT8( 1, resumes );
+
+    seqMan_post( &seq, TEST_SIGNAL_A, 30 );
+    TEST_ASSERT_EQUAL_UINT8( 2, resumes );
+    TEST_ASSERT_EQUAL_UINT8( TEST_SIGNAL_A, lastSignal );
+    TEST_ASSERT_EQUAL_UINT8( TEST_SIGNAL_B, seq.awaitSignals );
+
+    /* Signal A was consumed by the first wait */
+    seqMan_post( &seq, TEST_SIGNAL_A, 40 );
+    TEST_ASSERT_EQUAL_UINT8( 2, resumes );
+}
+
+
+void test_signalEndsTheWaitBeforeTheDeadline( void )
+{
+    seq_t    seq;
+    uint32_t deadline = 0;
+
+    seqMan_start( &seq, test_sequence, NULL, 0, 0 );
+    seqMan_post( &seq, TEST_SIGNAL_A, 1000 );
+
+    TEST_ASSERT_TRUE( seqMan_getDeadline( &seq, &deadline ) );
+    TEST_ASSERT_EQUAL_UINT32( 1000 + TEST_TIMEOUT, deadline );
+
+    seqMan_post( &seq, TEST_SIGNAL_B, 1000 + TEST_TIMEOUT - 1 );
+    TEST_ASSERT_EQUAL_UINT8( TEST_SIGNAL_B, lastSignal );
+    TEST_ASSERT_FALSE( SEQ_TIMED_OUT( &seq ) );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &seq, &deadline ) );
+
+    /* The cancelled deadline doesn't resume the sequence */
+    seqMan_process( &seq, 1000 + TEST_TIMEOUT );
+    TEST_ASSERT_EQUAL_UINT8( 3, resumes );
+    TEST_ASSERT_EQUAL_UINT8( 0, timeouts );
+}
+
+
+void test_deadlineEndsTheWait( void )
+{
+    seq_t seq;
+
+    seqMan_start( &seq, test_sequence, NULL, 0, 0 );
+    seqMan_post( &seq, TEST_SIGNAL_A, 1000 );
+
+    seqMan_process( &seq, 1000 + TEST_TIMEOUT - 1 );
+    TEST_ASSERT_EQUAL_UINT8( 2, resumes );
+
+    seqMan_process( &seq, 1000 + TEST_TIMEOUT );
+    TEST_ASSERT_EQUAL_UINT8( 3, resumes );
+    TEST_ASSERT_EQUAL_UINT8( 1, timeouts );
+    TEST_ASSERT_EQUAL_UINT8( TEST_SIGNAL_A, seq.awaitSignals );
+
+    /* Signal B is dropped once the wait timed out */
+    seqMan_post( &seq, TEST_SIGNAL_B, 1000 + TEST_TIMEOUT + 1 );
+    TEST_ASSERT_EQUAL_UINT8( 3, resumes );
+}
+
+
+void test_deadlineAcrossTheWraparound( void )
+{
+    seq_t          seq;
+    const uint32_t start    = 0xFFFFFFFFUL - TEST_TIMEOUT / 2;
+    uint32_t       deadline = 0;
+
+    seqMan_start( &seq, test_sequence, NULL, 0, start - 10 );
+    seqMan_post( &seq, TEST_SIGNAL_A, start );
+    TEST_ASSERT_TRUE( seqMan_getDeadline( &seq, &deadline ) );
+    TEST_ASSERT_TRUE( deadline < start );
+
+    /* The deadline lies behind the wraparound, but is still ahead */
+    seqMan_process( &seq, 0xFFFFFFFFUL );
+    seqMan_process( &seq, 0 );
+    seqMan_process( &seq, deadline - 1 );
+    TEST_ASSERT_EQUAL_UINT8( 0, timeouts );
+
+    seqMan_process( &seq, deadline );
+    TEST_ASSERT_EQUAL_UINT8( 1, timeouts );
+}
+
+
+/**
+ * @brief Advances the time and processes the door control instance every millisecond.
+ *
+ * @param span The time to advance @unit ms
+ */
+static void test_run( uint32_t span )
+{
+    for ( uint32_t time = 0; time < span; time++ )
+    {
+        hostShim_advanceMillis( 1 );
+        stateMan_process( &doorControl, millis() );
+    }
+}
+
+
+void test_doorSequenceFollowsTheDoor( void )
+{
+    uint32_t deadline = 0;
+
+    stateMan_init( &doorControl, millis() );
+    ioMan_setInputOverride( &doorControl.io, true );
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setRawInput( &doorControl.io, (io_t) input, LOW );
+    }
+    test_run( TEST_SETTLE );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &doorControl.doorSequence[DOOR_TYPE_DOOR_1], &deadline ) );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &doorControl.initSequence, &deadline ) );
+
+    /* Unlocking starts the unlock timeout of door 1 only */
+    stateMan_setDoorTimer( &doorControl, DOOR_TIMER_TYPE_UNLOCK, 2 );
+    stateMan_setDoorTimer( &doorControl, DOOR_TIMER_TYPE_OPEN, 1 );
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_1_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_TRUE( seqMan_getDeadline( &doorControl.doorSequence[DOOR_TYPE_DOOR_1], &deadline ) );
+    TEST_ASSERT_EQUAL_UINT32( millis() + 2000, deadline );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &doorControl.doorSequence[DOOR_TYPE_DOOR_2], &deadline ) );
+
+    /* Opening the door replaces the unlock timeout by the open timeout */
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, HIGH );
+    test_run( 1000 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_OPEN, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_TRUE( seqMan_getDeadline( &doorControl.doorSequence[DOOR_TYPE_DOOR_1], &deadline ) );
+    TEST_ASSERT_EQUAL_UINT32( doorControl.doorSequence[DOOR_TYPE_DOOR_1].waitStart + 60000UL, deadline );
+
+    /* Closing the door ends the wait, the sequence waits for the next unlock */
+    ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, LOW );
+    test_run( 1000 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_FALSE( seqMan_getDeadline( &doorControl.doorSequence[DOOR_TYPE_DOOR_1], &deadline ) );
+    TEST_ASSERT_EQUAL_UINT8( DOOR_SIGNAL_UNLOCKED, doorControl.doorSequence[DOOR_TYPE_DOOR_1].awaitSignals );
+}
+
+
+void test_doorSequenceUnlockTimeout( void )
+{
+    stateMan_postEvent( &doorControl, DOOR_CONTROL_EVENT_DOOR_2_UNLOCK, DOOR_CONTROL_SOURCE_REQUEST );
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_2_UNLOCKED, stateMan_getState( &doorControl ) );
+
+    test_run( 1999 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_2_UNLOCKED, stateMan_getState( &doorControl ) );
+
+    /* The timeout event is dispatched in the processing step of the deadline */
+    test_run( 1 );
+    TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+    TEST_ASSERT_EQUAL( LOCK_STATE_LOCKED, ioMan_getLockState( &doorControl.io, DOOR_TYPE_DOOR_2 ) );
+    TEST_ASSERT_EQUAL_UINT8( DOOR_SIGNAL_UNLOCKED, doorControl.doorSequence[DOOR_TYPE_DOOR_2].awaitSignals );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_protothreadWaitsAndYields );
+    RUN_TEST( test_protothreadStartsOver );
+    RUN_TEST( test_sequenceRunsUntilItsFirstWait );
+    RUN_TEST( test_sequenceDropsSignalsItDoesNotAwait );
+    RUN_TEST( test_signalEndsTheWaitBeforeTheDeadline );
+    RUN_TEST( test_deadlineEndsTheWait );
+    RUN_TEST( test_deadlineAcrossTheWraparound );
+    RUN_TEST( test_doorSequenceFollowsTheDoor );
+    RUN_TEST( test_doorSequenceUnlockTimeout );
+    return UNITY_END();
+}
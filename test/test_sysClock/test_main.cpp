@@ -0,0 +1,209 @@
+/**
+ * \file    test_main.cpp
+ * \brief   Unit tests of the system clock and its wraparound
+
+ * \author  Mathias Buder
+ * \date    2024-09-13
+
+ *  Copyright (c) 2024 Mathias Buder
+ */
+
+#include <unity.h>
+
+#include "hostShim.h"
+#include "sysClock.h"
+#include "stateMan.h"
+#include "appSettings.h"
+
+/*************************************** Defines ****************************************/
+
+#define TEST_WRAP               4294967296ULL              /*!< The wraparound of the 32-bit clock @unit ms */
+#define TEST_HOUR               3600000UL                  /*!< One hour @unit ms */
+#define TEST_DAY                ( 24 * TEST_HOUR )         /*!< One day @unit ms */
+#define TEST_SOAK_DAYS          60                         /*!< Simulated days of the soak test */
+#define TEST_SOAK_IDLE          ( 4 * TEST_HOUR )          /*!< Idle time between two door cycles @unit ms */
+#define TEST_SETTLE             2000                       /*!< Time for the inputs to settle @unit ms */
+#define TEST_PRESS              200                        /*!< Duration of a button press @unit ms */
+
+/******************************** Global variables **************************************/
+
+static door_control_t doorControl; /*!< The door control instance under test */
+static uint64_t       hostTime;    /*!< The hardware clock without wraparound @unit ms */
+
+
+/******************************** Function definition ************************************/
+
+void setUp( void )
+{
+}
+
+void tearDown( void )
+{
+}
+
+
+/**
+ * @brief Advances the hardware clock and processes the door control instance.
+ *
+ * @param span The time to advance @unit ms
+ * @param step The time between two main loop iterations @unit ms
+ */
+static void test_run( uint64_t span, uint32_t step )
+{
+    for ( uint64_t time = 0; time < span; time += step )
+    {
+        hostTime += step;
+        hostShim_setMillis( (uint32_t) hostTime );
+        sysClock_update();
+        stateMan_process( &doorControl, sysClock_millis() );
+    }
+}
+
+
+/**
+ * @brief Runs the main loop until the door control instance reaches a state.
+ *
+ * @param state The expected state.
+ * @param limit The longest wait @unit ms
+ * @return The time until the state was reached, limit if it wasn't @unit ms
+ */
+static uint32_t test_waitForState( door_control_state_t state, uint32_t limit )
+{
+    uint32_t time = 0;
+
+    while ( ( stateMan_getState( &doorControl ) != state ) && ( time < limit ) )
+    {
+        test_run( 1, 1 );
+        time++;
+    }
+
+    return time;
+}
+
+
+/**
+ * @brief Starts the door control instance with closed doors at a hardware clock.
+ *
+ * @param start The hardware clock @unit ms
+ */
+static void test_start( uint64_t start )
+{
+    hostTime = start;
+    hostShim_setMillis( (uint32_t) hostTime );
+    sysClock_update();
+
+    stateMan_init( &doorControl, sysClock_millis() );
+    ioMan_setInputOverride( &doorControl.io, true );
+    for ( uint8_t input = 0; input < IO_INPUT_SIZE; input++ )
+    {
+        ioMan_setRawInput( &doorControl.io, (io_t) input, LOW );
+    }
+    test_run( TEST_SETTLE, 1 );
+}
+
+
+void test_isExpired_acrossWrap( void )
+{
+    TEST_ASSERT_FALSE( sysClock_isExpired( 0xFFFFFF00UL, 0x00000100UL ) );
+    TEST_ASSERT_TRUE( sysClock_isExpired( 0x00000100UL, 0x00000100UL ) );
+    TEST_ASSERT_TRUE( sysClock_isExpired( 0x00000200UL, 0xFFFFFF00UL ) );
+}
+
+
+void test_isEarlier_acrossWrap( void )
+{
+    TEST_ASSERT_TRUE( sysClock_isEarlier( 0xFFFFFF00UL, 0x00000100UL ) );
+    TEST_ASSERT_FALSE( sysClock_isEarlier( 0x00000100UL, 0x00000100UL ) );
+    TEST_ASSERT_FALSE( sysClock_isEarlier( 0x00000100UL, 0xFFFFFF00UL ) );
+}
+
+
+void test_uptime_countsWraps( void )
+{
+    hostShim_setMillis( 0xFFFFF000UL );
+    sysClock_update();
+    const uint64_t before = sysClock_getUptime();
+
+    hostShim_setMillis( 0x00001000UL );
+    sysClock_update();
+
+    TEST_ASSERT_EQUAL_UINT32( 0x00001000UL, sysClock_millis() );
+    TEST_ASSERT_TRUE( ( sysClock_getUptime() - before ) == 0x2000 );
+}
+
+
+/**
+ * @brief Cycles door 1 for 60 simulated days, starting 5 hours before the wraparound.
+ *
+ * Every cycle unlocks door 1 and either lets the unlock timeout lock it again, opens and
+ * closes it or keeps it open until the open timeout. Every timeout must fire on time, also
+ * the ones that span the wraparound.
+ */
+void test_soak_doorTimeoutsAcrossWrap( void )
+{
+    appSettings_getSettings()->doorOpenTimeout = 1;
+    test_start( TEST_WRAP - 5 * TEST_HOUR );
+
+    const uint32_t unlockTimeout = appSettings_getSettings()->doorUnlockTimeout * 1000UL;
+    const uint32_t openTimeout   = appSettings_getSettings()->doorOpenTimeout * 60000UL;
+    const uint64_t start         = hostTime;
+    uint16_t       cycles        = 0;
+
+    while ( ( hostTime - start ) < ( (uint64_t) TEST_SOAK_DAYS * TEST_DAY ) )
+    {
+        TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_IDLE, stateMan_getState( &doorControl ) );
+
+        ioMan_setRawInput( &doorControl.io, IO_BUTTON_1, HIGH );
+        test_run( TEST_PRESS, 1 );
+        ioMan_setRawInput( &doorControl.io, IO_BUTTON_1, LOW );
+        TEST_ASSERT_EQUAL( DOOR_CONTROL_STATE_DOOR_1_UNLOCKED, stateMan_getState( &doorControl ) );
+
+        switch ( cycles % 3 )
+        {
+            case 0:
+            {
+                /* The unlock timeout started with the debounced button press */
+                const uint32_t time = test_waitForState( DOOR_CONTROL_STATE_IDLE, unlockTimeout );
+                TEST_ASSERT_UINT32_WITHIN( 150, unlockTimeout - TEST_PRESS, time );
+                break;
+            }
+
+            case 1:
+                ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, HIGH );
+                test_run( 1000, 1 );
+                ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, LOW );
+                TEST_ASSERT_LESS_THAN_UINT32( TEST_SETTLE, test_waitForState( DOOR_CONTROL_STATE_IDLE, TEST_SETTLE ) );
+                break;
+
+            default:
+            {
+                ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, HIGH );
+                test_run( TEST_PRESS, 1 );
+                const uint32_t time = test_waitForState( DOOR_CONTROL_STATE_FAULT, openTimeout + 1000 ) + TEST_PRESS;
+                TEST_ASSERT_UINT32_WITHIN( 400, openTimeout, time );
+
+                ioMan_setRawInput( &doorControl.io, IO_SWITCH_1, LOW );
+                stateMan_reset( &doorControl, sysClock_millis() );
+                test_run( TEST_SETTLE, 1 );
+                break;
+            }
+        }
+
+        cycles++;
+        test_run( TEST_SOAK_IDLE, 1000 );
+    }
+
+    TEST_ASSERT_TRUE( hostTime > TEST_WRAP );
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32( TEST_SOAK_DAYS * 24 / 4, cycles );
+}
+
+
+int main( int argc, char** argv )
+{
+    UNITY_BEGIN();
+    RUN_TEST( test_isExpired_acrossWrap );
+    RUN_TEST( test_isEarlier_acrossWrap );
+    RUN_TEST( test_uptime_countsWraps );
+    RUN_TEST( test_soak_doorTimeoutsAcrossWrap );
+    return UNITY_END();
+}
@@ -0,0 +1,244 @@
+"""
+Captures and compares the benchmark reports of the door control firmware.
+
+Run the benchmarks with the bench command of the controller and capture the
+JSON report:
+
+    python tools/bench.py run --port COM3 --output current.json
+
+The benchmark firmware (pio run -e mega_bench) prints the same report at boot and
+answers the same bench command. The unit test test_bench stores the report of the
+host in the file named by BENCH_REPORT:
+
+    BENCH_REPORT=current.json pio test -e native -f test_bench
+
+Compare the report against a baseline of the same target. The exit code is 1 if
+the median cycles of a benchmark grew by more than the threshold:
+
+    python tools/bench.py compare baseline.json current.json --threshold 10
+
+Compare the flash size of the two state machine engines of a benchmark build, the
+engine of hsm.c and the template engine of hsmEngine.h, with the same two states:
+
+    python tools/bench.py size .pio/build/mega_bench/firmware.elf
+
+See src/bench.cpp for the benchmarks and the report format.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+import time
+
+import serial
+
+REPORT_PREFIX = '{"bench":'
+
+# Functions of the hsm.c engine and of its benchmark state machine. The queue functions
+# pushEvent and pushEventPriority are used by both engines and aren't counted.
+HSM_SYMBOLS = {
+    "dispatch_event",
+    "switch_state",
+    "bench_stateHandler",
+    "bench_stateEntryExitHandler",
+    "bench_eventLogger",
+    "bench_resultLogger",
+    "bench_runPushDispatch",
+    "bench_runSwitchState",
+    "bench_setupStateMachine",
+    "benchStates",
+}
+
+# The template engine is inlined into the benchmark functions, what isn't inlined is
+# instantiated with the names of the benchmark state machine.
+TPL_PREFIXES = ("bench_runTpl", "bench_setupTpl", "BenchTpl", "HsmEngine<BenchTpl", "HsmStateVisitor<BenchTpl")
+
+
+def readReport(port, baud, timeout):
+    """
+    Runs the benchmarks and waits for the benchmark report.
+
+    Opening the serial port resets the controller. The bench command is sent once the
+    controller has booted. Log output before the report is skipped.
+
+    Args:
+        port (str): The serial port of the controller.
+        baud (int): The baud rate of the serial interface.
+        timeout (float): The maximum time to wait for the report (s).
+
+    Returns:
+        dict: The benchmark report, or None on timeout.
+    """
+    connection = serial.Serial(port, baud, timeout=1)
+    deadline = time.time() + timeout
+    try:
+        # A benchmark build prints its report while booting
+        time.sleep(2)
+        connection.write(b"bench -j 1\n")
+        while time.time() < deadline:
+            line = connection.readline().decode("ascii", errors="replace").strip()
+            if line.startswith(REPORT_PREFIX):
+                return json.loads(line)
+    finally:
+        connection.close()
+    return None
+
+
+def loadReport(fileName):
+    """
+    Loads a benchmark report.
+
+    Args:
+        fileName (str): The report file.
+
+    Returns:
+        dict: The benchmark cases of the report by name.
+    """
+    with open(fileName) as reportFile:
+        report = json.load(reportFile)
+    return {case["name"]: case for case in report["cases"]}
+
+
+def run(args):
+    """
+    Captures a benchmark report and prints or stores it.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if a report was received, 1 otherwise.
+    """
+    report = readReport(args.port, args.baud, args.timeout)
+    if report is None:
+        print("No benchmark report received")
+        return 1
+
+    print(f"{report['target']} {report['version']} at {report['clock_mhz']} MHz")
+    for case in report["cases"]:
+        print(f"{case['name']:<20} {case['median_cycles']:>10} cycles {case['median_ns']:>10} ns")
+
+    if args.output:
+        with open(args.output, "w") as reportFile:
+            json.dump(report, reportFile, indent=2)
+    return 0
+
+
+def compare(args):
+    """
+    Compares the median cycles of two benchmark reports.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if no benchmark regressed by more than the threshold, 1 otherwise.
+    """
+    baseline = loadReport(args.baseline)
+    current = loadReport(args.current)
+    regressions = 0
+
+    print(f"{'benchmark':<20} {'baseline':>10} {'current':>10} {'change':>8}")
+    for name, case in current.items():
+        if name not in baseline:
+            print(f"{name:<20} {'-':>10} {case['median_cycles']:>10} {'new':>8}")
+            continue
+        before = baseline[name]["median_cycles"]
+        after = case["median_cycles"]
+        change = (after - before) * 100.0 / before if before else 0.0
+        marker = ""
+        if change > args.threshold:
+            marker = " REGRESSION"
+            regressions += 1
+        print(f"{name:<20} {before:>10} {after:>10} {change:>7.1f}%{marker}")
+
+    for name in baseline:
+        if name not in current:
+            print(f"{name:<20} missing in {args.current}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) slower by more than {args.threshold}%")
+        return 1
+    return 0
+
+
+def readSymbolSizes(elf, nm):
+    """
+    Reads the sizes of all functions and variables of a firmware.
+
+    Args:
+        elf (str): The firmware file.
+        nm (str): The nm tool of the toolchain of the firmware.
+
+    Returns:
+        dict: The size of every symbol by its demangled name (bytes).
+    """
+    output = subprocess.run([nm, "--size-sort", "--demangle", "--print-size", elf],
+                            check=True, capture_output=True, text=True).stdout
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split(maxsplit=3)
+        if len(fields) == 4:
+            # Static functions keep their parameters in the demangled name
+            name = fields[3].split("(")[0]
+            sizes[name] = sizes.get(name, 0) + int(fields[1], 16)
+    return sizes
+
+
+def size(args):
+    """
+    Prints the flash size of both state machine engines of a benchmark build.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if both engines were found, 1 otherwise.
+    """
+    sizes = readSymbolSizes(args.elf, args.nm)
+    engines = {
+        "hsm": {name: length for name, length in sizes.items() if name in HSM_SYMBOLS},
+        "tpl": {name: length for name, length in sizes.items() if name.startswith(TPL_PREFIXES)},
+    }
+
+    for engine, symbols in engines.items():
+        print(f"{engine}: {sum(symbols.values())} bytes")
+        for name, length in sorted(symbols.items(), key=lambda symbol: -symbol[1]):
+            print(f"  {name:<64} {length:>6}")
+
+    if not engines["hsm"] or not engines["tpl"]:
+        print("Both engines are only contained in the benchmark builds")
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Capture and compare door control benchmark reports")
+    subparsers = parser.add_subparsers(dest="mode", required=True)
+
+    runParser = subparsers.add_parser("run", help="Run the benchmarks and capture the report")
+    runParser.add_argument("--port", required=True, help="The serial port of the controller")
+    runParser.add_argument("--baud", type=int, default=115200, help="The baud rate of the serial interface")
+    runParser.add_argument("--timeout", type=float, default=30, help="The maximum time to wait for the report (s)")
+    runParser.add_argument("--output", help="The file to store the report in")
+
+    compareParser = subparsers.add_parser("compare", help="Compare a report against a baseline")
+    compareParser.add_argument("baseline", help="The baseline report")
+    compareParser.add_argument("current", help="The report to check")
+    compareParser.add_argument("--threshold", type=float, default=10, help="The allowed increase of the median cycles (%%)")
+
+    sizeParser = subparsers.add_parser("size", help="Compare the flash size of the state machine engines")
+    sizeParser.add_argument("elf", help="The firmware of a benchmark build")
+    sizeParser.add_argument("--nm", default="avr-nm", help="The nm tool of the toolchain of the firmware")
+    args = parser.parse_args()
+
+    if args.mode == "run":
+        return run(args)
+    if args.mode == "size":
+        return size(args)
+    return compare(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
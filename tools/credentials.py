@@ -0,0 +1,367 @@
+"""
+Generates the credential tables of the door control firmware.
+
+The badge readers only unlock a door for credentials of the credential list. The list
+is a text file with one credential per line, as decimal or hexadecimal number, or as
+facility:card of a 26-bit badge. Everything after a # is a comment:
+
+    # Facility 12
+    12:3456
+    0x00C0FFEE
+    7654321
+
+The build generates the table from the list set as custom_credentials in platformio.ini.
+To check a list and the size of its table without building:
+
+    python tools/credentials.py build credentials.txt --output credTable.h
+
+The table is a minimal perfect hash table, see src/credStore.cpp. The hash and the
+reduction below must match the firmware.
+"""
+
+import argparse
+import math
+import os
+import random
+import sys
+
+MASK = 0xFFFFFFFF
+EMPTY = 0xFFFFFFFF
+GOLDEN = 0x9E3779B1
+MAX_CREDENTIALS = 10000
+MAX_DISPLACE = 0xFFFF
+BENCH_SIZES = [(100, "100"), (1000, "1k"), (10000, "10k")]
+
+
+def hashId(credential, seed):
+    """
+    Hashes a credential with the finalizer of MurmurHash3, as credStore_hash().
+
+    Args:
+        credential (int): The credential.
+        seed (int): The seed.
+
+    Returns:
+        int: The 32-bit hash.
+    """
+    value = (credential ^ seed) & MASK
+    value ^= value >> 16
+    value = (value * 0x85EBCA6B) & MASK
+    value ^= value >> 13
+    value = (value * 0xC2B2AE35) & MASK
+    value ^= value >> 16
+    return value
+
+
+def reduce(value, count):
+    """
+    Maps a hash to 0..count - 1, as credStore_reduce().
+
+    Args:
+        value (int): The 32-bit hash.
+        count (int): The number of values.
+
+    Returns:
+        int: The value.
+    """
+    return ((value >> 16) * count) >> 16
+
+
+def slotSeed(table, displace):
+    """
+    Returns the seed of the slot hash for a displacement.
+
+    Args:
+        table (dict): The credential table.
+        displace (int): The displacement of the bucket.
+
+    Returns:
+        int: The seed.
+    """
+    return (table["slotSeed"] + displace * GOLDEN) & MASK
+
+
+def parseCredential(text):
+    """
+    Parses a credential of the credential list.
+
+    Args:
+        text (str): The credential, decimal, hexadecimal or facility:card.
+
+    Returns:
+        int: The credential.
+    """
+    if ":" in text:
+        facility, card = (int(part, 0) for part in text.split(":"))
+        if not (0 <= facility <= 0xFF and 0 <= card <= 0xFFFF):
+            raise ValueError(f"{text}: facility or card out of range")
+        return (facility << 16) | card
+    credential = int(text, 0)
+    if not 0 <= credential < EMPTY:
+        raise ValueError(f"{text}: out of range")
+    return credential
+
+
+def loadCredentials(fileName):
+    """
+    Loads a credential list.
+
+    Args:
+        fileName (str): The credential list.
+
+    Returns:
+        list: The sorted credentials without duplicates.
+    """
+    credentials = set()
+    with open(fileName) as listFile:
+        for number, line in enumerate(listFile, 1):
+            text = line.split("#", 1)[0].strip()
+            if not text:
+                continue
+            try:
+                credentials.add(parseCredential(text))
+            except ValueError as error:
+                raise ValueError(f"{fileName}:{number}: {error}") from None
+    return sorted(credentials)
+
+
+def buildTable(credentials, loadFactor=0.98, bucketSize=4, seed=1):
+    """
+    Builds the minimal perfect hash table of a credential list.
+
+    The buckets are placed from the largest to the smallest. The displacement of a
+    bucket is the first one that moves all its credentials to distinct free slots. If a
+    bucket finds no displacement, the table is built again with other seeds.
+
+    Args:
+        credentials (list): The credentials.
+        loadFactor (float): The share of used slots.
+        bucketSize (float): The mean number of credentials per bucket.
+        seed (int): Seed of the random hash seeds.
+
+    Returns:
+        dict: The credential table.
+    """
+    if len(credentials) > MAX_CREDENTIALS:
+        raise ValueError(f"{len(credentials)} credentials, at most {MAX_CREDENTIALS} fit")
+
+    rng = random.Random(seed)
+    count = max(len(credentials), 1)
+    table = {
+        "slots": max(math.ceil(count / loadFactor), 1),
+        "buckets": max(math.ceil(count / bucketSize), 1),
+        "count": len(credentials),
+    }
+
+    for _ in range(100):
+        table["bucketSeed"] = rng.getrandbits(32)
+        table["slotSeed"] = rng.getrandbits(32)
+        if placeBuckets(table, credentials):
+            return table
+
+    raise RuntimeError("No displacement found, lower the load factor")
+
+
+def placeBuckets(table, credentials):
+    """
+    Finds the displacement of every bucket and fills the slots.
+
+    Args:
+        table (dict): The credential table with its seeds.
+        credentials (list): The credentials.
+
+    Returns:
+        bool: True if every bucket found a displacement.
+    """
+    buckets = [[] for _ in range(table["buckets"])]
+    for credential in credentials:
+        buckets[reduce(hashId(credential, table["bucketSeed"]), table["buckets"])].append(credential)
+
+    table["keys"] = [EMPTY] * table["slots"]
+    table["displace"] = [0] * table["buckets"]
+    for index in sorted(range(table["buckets"]), key=lambda index: -len(buckets[index])):
+        members = buckets[index]
+        for candidate in range(MAX_DISPLACE + 1):
+            seedOfSlot = slotSeed(table, candidate)
+            slots = {reduce(hashId(credential, seedOfSlot), table["slots"]) for credential in members}
+            if len(slots) == len(members) and all(table["keys"][slot] == EMPTY for slot in slots):
+                break
+        else:
+            return False
+        table["displace"][index] = candidate
+        for credential in members:
+            table["keys"][reduce(hashId(credential, seedOfSlot), table["slots"])] = credential
+    return True
+
+
+def contains(table, credential):
+    """
+    Looks up a credential, as credStore_contains().
+
+    Args:
+        table (dict): The credential table.
+        credential (int): The credential.
+
+    Returns:
+        bool: True if the credential is in the table.
+    """
+    if credential == EMPTY:
+        return False
+    bucket = reduce(hashId(credential, table["bucketSeed"]), table["buckets"])
+    slot = reduce(hashId(credential, slotSeed(table, table["displace"][bucket])), table["slots"])
+    return table["keys"][slot] == credential
+
+
+def formatArray(name, values):
+    """
+    Formats a 16-bit array in flash.
+
+    Args:
+        name (str): The name of the array.
+        values (list): The values.
+
+    Returns:
+        str: The C definition.
+    """
+    lines = []
+    for start in range(0, len(values), 12):
+        lines.append("    " + ", ".join(f"0x{value:04X}" for value in values[start:start + 12]))
+    return f"static const uint16_t {name}[] PROGMEM = {{\n" + ",\n".join(lines) + "\n};\n"
+
+
+def formatTable(table, name):
+    """
+    Formats a credential table as C definitions.
+
+    Args:
+        table (dict): The credential table.
+        name (str): The name of the cred_table_t.
+
+    Returns:
+        str: The C definitions.
+    """
+    return (
+        formatArray(f"{name}Displace", table["displace"])
+        + formatArray(f"{name}KeyLow", [key & 0xFFFF for key in table["keys"]])
+        + formatArray(f"{name}KeyHigh", [key >> 16 for key in table["keys"]])
+        + f"static const cred_table_t {name} = {{ 0x{table['bucketSeed']:08X}UL, 0x{table['slotSeed']:08X}UL, "
+        + f"{table['buckets']}, {table['slots']}, {table['count']}, {name}Displace, {name}KeyLow, {name}KeyHigh }};\n"
+    )
+
+
+def tableSize(table):
+    """
+    Returns the flash size of a credential table.
+
+    Args:
+        table (dict): The credential table.
+
+    Returns:
+        int: The size of the arrays (bytes).
+    """
+    return 2 * table["buckets"] + 4 * table["slots"]
+
+
+def benchCredential(index):
+    """
+    Returns a credential of the benchmark tables, as bench_getCredential().
+
+    The lower 24 bits of a multiple of an odd number are distinct for the first 2^24
+    indices.
+
+    Args:
+        index (int): The index of the credential.
+
+    Returns:
+        int: The credential.
+    """
+    return (index * GOLDEN) & 0xFFFFFF
+
+
+def writeHeader(fileName, source, body):
+    """
+    Writes a generated header, unless it is unchanged.
+
+    Args:
+        fileName (str): The header file.
+        source (str): Where the tables come from.
+        body (str): The C definitions.
+    """
+    text = f"/* Generated by tools/credentials.py from {source}, do not edit */\n\n{body}"
+    if os.path.exists(fileName):
+        with open(fileName) as headerFile:
+            if headerFile.read() == text:
+                return
+    os.makedirs(os.path.dirname(os.path.abspath(fileName)), exist_ok=True)
+    with open(fileName, "w") as headerFile:
+        headerFile.write(text)
+
+
+def generate(credentialFile, outputDir, bench):
+    """
+    Generates the headers of the firmware build.
+
+    Args:
+        credentialFile (str): The credential list, None for an empty table.
+        outputDir (str): The directory of the generated headers.
+        bench (bool): Also generate the benchmark tables.
+    """
+    credentials = loadCredentials(credentialFile) if credentialFile else []
+    table = buildTable(credentials)
+    writeHeader(os.path.join(outputDir, "credTable.h"), credentialFile or "an empty list", formatTable(table, "credTable"))
+    print(f"Credentials: {table['count']} in {tableSize(table)} bytes")
+
+    if bench:
+        body = ""
+        for size, suffix in BENCH_SIZES:
+            body += formatTable(buildTable([benchCredential(index) for index in range(size)]), f"credBench{suffix}")
+        writeHeader(os.path.join(outputDir, "credBenchTable.h"), "the benchmark credentials", body)
+
+
+def build(args):
+    """
+    Builds the table of a credential list, checks it and writes the header.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if every credential is found in the table, 1 otherwise.
+    """
+    credentials = loadCredentials(args.credentials)
+    table = buildTable(credentials, args.load_factor, args.bucket_size)
+    missing = [credential for credential in credentials if not contains(table, credential)]
+
+    print(f"{table['count']} credentials, {table['buckets']} buckets, {table['slots']} slots, {tableSize(table)} bytes")
+    if missing:
+        print(f"{len(missing)} credential(s) not found, e.g. {missing[0]}")
+        return 1
+
+    if args.output:
+        writeHeader(args.output, args.credentials, formatTable(table, args.name))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the credential tables of the door control firmware")
+    subparsers = parser.add_subparsers(dest="mode", required=True)
+
+    buildParser = subparsers.add_parser("build", help="Build and check the table of a credential list")
+    buildParser.add_argument("credentials", help="The credential list")
+    buildParser.add_argument("--output", help="The header to write the table to")
+    buildParser.add_argument("--name", default="credTable", help="The name of the table in the header")
+    buildParser.add_argument("--load-factor", type=float, default=0.98, help="The share of used slots")
+    buildParser.add_argument("--bucket-size", type=float, default=4, help="The mean number of credentials per bucket")
+
+    benchParser = subparsers.add_parser("bench", help="Generate the benchmark tables")
+    benchParser.add_argument("--output", required=True, help="The directory to write the headers to")
+    args = parser.parse_args()
+
+    if args.mode == "build":
+        return build(args)
+    generate(None, args.output, True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
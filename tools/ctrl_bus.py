@@ -0,0 +1,454 @@
+"""
+Monitors and simulates the controller bus of chained door controllers.
+
+Decode the frames on a real bus, e.g. through a USB RS-485 adapter:
+
+    python tools/ctrl_bus.py monitor --port /dev/ttyUSB0
+
+Simulate a corridor of controllers. Every simulated controller talks through a
+pseudo-terminal of its own, a hub forwards the bytes like the shared RS-485 line.
+The hub forwards without delay and doesn't simulate collisions on the line.
+The report shows the grant latency and counts interlock violations, the exit code
+is 1 if two neighbours had a door unlocked at the same time:
+
+    python tools/ctrl_bus.py sim --nodes 6 --duration 30 --rate 2
+
+The simulated controllers follow the protocol of src/ctrlBus.cpp. See there for
+the frame format and the grant rules.
+"""
+
+import argparse
+import os
+import pty
+import random
+import select
+import statistics
+import sys
+import time
+import tty
+
+SOF = 0x7E
+BROADCAST = 0xFF
+HEADER_SIZE = 6
+MAX_PAYLOAD = 4
+MAX_ADDRESS = 8
+
+FRAME_STATE = 1
+FRAME_REQUEST = 2
+FRAME_GRANT = 3
+FRAME_DENY = 4
+FRAME_RELEASE = 5
+FRAME_NAMES = {FRAME_STATE: "STATE", FRAME_REQUEST: "REQUEST", FRAME_GRANT: "GRANT", FRAME_DENY: "DENY", FRAME_RELEASE: "RELEASE"}
+
+# door_control_state_t
+STATE_IDLE = 1
+STATE_DOOR_1_UNLOCKED = 3
+STATE_DOOR_1_OPEN = 4
+STATE_NAMES = ["INIT", "IDLE", "FAULT", "DOOR_1_UNLOCKED", "DOOR_1_OPEN", "DOOR_2_UNLOCKED", "DOOR_2_OPEN", "EMERGENCY"]
+
+# Timing of src/ctrlBus.h (s)
+HEARTBEAT = 0.250
+NODE_TIMEOUT = 1.0
+RETRY_TIMEOUT = 0.020
+RETRIES = 3
+RETRY_BACKOFF = 0.050
+GRANT_HOLD = 0.500
+BYTE_TIMEOUT = 0.005
+
+
+def calculateCrc(data):
+    """
+    Calculates the CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) of a frame.
+
+    Args:
+        data (bytes): The frame from the destination to the end of the payload.
+
+    Returns:
+        int: The CRC.
+    """
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encodeFrame(destination, source, frameType, sequence, payload=b""):
+    """
+    Builds a frame.
+
+    Args:
+        destination (int): The destination address, BROADCAST for all controllers.
+        source (int): The source address.
+        frameType (int): The frame type.
+        sequence (int): The sequence number.
+        payload (bytes): The payload, at most MAX_PAYLOAD bytes.
+
+    Returns:
+        bytes: The frame including the start byte and the CRC.
+    """
+    body = bytes([destination, source, frameType, sequence & 0xFF, len(payload)]) + bytes(payload)
+    crc = calculateCrc(body)
+    return bytes([SOF]) + body + bytes([crc >> 8, crc & 0xFF])
+
+
+class FrameDecoder:
+    """
+    Assembles received bytes to frames, like the receiver of src/ctrlBus.cpp.
+    """
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.lastByte = 0.0
+        self.errors = 0
+
+    def feed(self, data, now):
+        """
+        Adds received bytes.
+
+        Args:
+            data (bytes): The received bytes.
+            now (float): The time of reception (s).
+
+        Returns:
+            list: The complete frames as (destination, source, type, sequence, payload).
+        """
+        frames = []
+        for byte in data:
+            if self.buffer and (now - self.lastByte) > BYTE_TIMEOUT:
+                self.errors += 1
+                self.buffer.clear()
+            self.lastByte = now
+
+            if not self.buffer and byte != SOF:
+                continue
+            self.buffer.append(byte)
+            if len(self.buffer) < HEADER_SIZE:
+                continue
+
+            length = self.buffer[HEADER_SIZE - 1]
+            if length > MAX_PAYLOAD:
+                self.errors += 1
+                self.buffer.clear()
+            elif len(self.buffer) == HEADER_SIZE + length + 2:
+                body = bytes(self.buffer[1:HEADER_SIZE + length])
+                crc = (self.buffer[-2] << 8) | self.buffer[-1]
+                if calculateCrc(body) == crc:
+                    frames.append((body[0], body[1], body[2], body[3], body[5:]))
+                else:
+                    self.errors += 1
+                self.buffer.clear()
+        return frames
+
+
+class SimulatedController:
+    """
+    A door controller with one door that follows the grant rules of src/ctrlBus.cpp.
+
+    The door button is pressed at random times. Once all neighbours granted, the door
+    is unlocked, opened for a while and closed again.
+    """
+
+    def __init__(self, address, neighbours, fd, rate, rng):
+        self.address = address
+        self.neighbours = neighbours
+        self.fd = fd
+        self.rate = rate
+        self.rng = rng
+        self.decoder = FrameDecoder()
+        self.state = STATE_IDLE
+        self.doorUntil = 0.0
+        self.nextPress = 0.0
+        self.lastPublish = -HEARTBEAT
+        self.publishedState = None
+        self.sequence = 0
+        # Own grant request
+        self.grant = "idle"
+        self.target = 0
+        self.granted = []
+        self.attempts = 0
+        self.sentAt = 0.0
+        self.grantTime = 0.0
+        self.requestStart = 0.0
+        # Grant given to a neighbour
+        self.leaseHolder = 0
+        self.leaseUsed = False
+        self.leaseSince = 0.0
+        self.lastSeen = {}
+        self.latencies = []
+        self.failures = 0
+
+    def send(self, destination, frameType, sequence, payload=b""):
+        os.write(self.fd, encodeFrame(destination, self.address, frameType, sequence, payload))
+
+    def process(self, now):
+        """
+        Runs one main loop iteration of the controller.
+
+        Args:
+            now (float): The current time (s).
+        """
+        try:
+            data = os.read(self.fd, 256)
+        except BlockingIOError:
+            data = b""
+        for frame in self.decoder.feed(data, now):
+            self.receive(frame, now)
+
+        self.processLease(now)
+        self.processGrant(now)
+        self.processDoor(now)
+
+        if self.state != self.publishedState or (now - self.lastPublish) >= HEARTBEAT + self.address / 1000:
+            self.publishedState = self.state
+            self.lastPublish = now
+            unlocked = 1 if self.state != STATE_IDLE else 0
+            self.send(BROADCAST, FRAME_STATE, 0, bytes([self.state, unlocked]))
+
+    def receive(self, frame, now):
+        destination, source, frameType, sequence, payload = frame
+        if destination not in (self.address, BROADCAST) or source not in self.neighbours:
+            return
+        self.lastSeen[source] = now
+
+        if frameType == FRAME_STATE and self.leaseHolder == source:
+            if payload[0] != STATE_IDLE or payload[1] != 0:
+                self.leaseUsed = True
+            elif self.leaseUsed:
+                self.leaseHolder = 0
+        elif frameType == FRAME_REQUEST:
+            self.answerRequest(source, sequence, now)
+        elif frameType in (FRAME_GRANT, FRAME_DENY):
+            if self.grant == "requesting" and source == self.target and sequence == self.sequence:
+                if frameType == FRAME_GRANT:
+                    self.granted.append(source)
+                    self.requestNext(now)
+                else:
+                    self.endGrant("denied", now)
+        elif frameType == FRAME_RELEASE and self.leaseHolder == source:
+            self.leaseHolder = 0
+
+    def answerRequest(self, source, sequence, now):
+        grant = False
+        if self.leaseHolder == source:
+            grant = True
+        elif self.leaseHolder == 0 and self.state == STATE_IDLE:
+            if self.grant in ("idle", "denied"):
+                grant = True
+            elif self.grant == "requesting" and source < self.address:
+                self.endGrant("denied", now)
+                grant = True
+
+        if grant and self.leaseHolder != source:
+            self.leaseHolder = source
+            self.leaseUsed = False
+            self.leaseSince = now
+        self.send(source, FRAME_GRANT if grant else FRAME_DENY, sequence)
+
+    def processLease(self, now):
+        if self.leaseHolder == 0:
+            return
+        offline = (now - self.lastSeen.get(self.leaseHolder, 0.0)) > NODE_TIMEOUT
+        unused = not self.leaseUsed and (now - self.leaseSince) > GRANT_HOLD + 2 * HEARTBEAT
+        if offline or unused:
+            self.leaseHolder = 0
+
+    def processGrant(self, now):
+        if self.grant == "requesting" and (now - self.sentAt) > RETRY_TIMEOUT:
+            if self.attempts < RETRIES:
+                self.attempts += 1
+                self.sendRequest(now)
+            else:
+                self.endGrant("denied", now)
+        elif self.grant == "granted" and self.state == STATE_IDLE and (now - self.grantTime) > GRANT_HOLD:
+            self.endGrant("idle", now)
+        elif self.grant == "denied" and (now - self.grantTime) > RETRY_BACKOFF:
+            self.grant = "idle"
+
+    def processDoor(self, now):
+        if self.state == STATE_IDLE:
+            if self.grant == "granted":
+                self.state = STATE_DOOR_1_UNLOCKED
+                self.doorUntil = now + self.rng.uniform(0.1, 0.3)
+            elif now >= self.nextPress and self.grant == "idle" and self.leaseHolder == 0:
+                # The button is held until the grant succeeds or fails
+                self.grant = "requesting"
+                self.target = 0
+                self.granted = []
+                self.sequence = (self.sequence + 1) & 0xFF
+                self.requestStart = now
+                self.requestNext(now)
+        elif now >= self.doorUntil:
+            if self.state == STATE_DOOR_1_UNLOCKED:
+                self.state = STATE_DOOR_1_OPEN
+                self.doorUntil = now + self.rng.uniform(0.2, 0.6)
+            else:
+                self.state = STATE_IDLE
+                self.endGrant("idle", now)
+                self.nextPress = now + self.rng.expovariate(self.rate)
+
+    def requestNext(self, now):
+        for address in sorted(self.neighbours):
+            if address > self.target:
+                self.target = address
+                self.attempts = 0
+                self.sendRequest(now)
+                return
+        self.grant = "granted"
+        self.grantTime = now
+        self.latencies.append(now - self.requestStart)
+
+    def sendRequest(self, now):
+        self.sentAt = now
+        self.send(self.target, FRAME_REQUEST, self.sequence, bytes([0]))
+
+    def endGrant(self, nextGrant, now):
+        for address in self.granted:
+            self.send(address, FRAME_RELEASE, self.sequence)
+        if nextGrant == "denied":
+            self.failures += 1
+            self.nextPress = now + RETRY_BACKOFF
+        self.granted = []
+        self.grant = nextGrant
+        self.grantTime = now
+
+
+def openBus(count):
+    """
+    Creates the pseudo-terminals of the simulated bus.
+
+    Args:
+        count (int): The number of controllers.
+
+    Returns:
+        list: The (hub, controller) file descriptor pair of every controller.
+    """
+    pairs = []
+    for _ in range(count):
+        hub, controller = pty.openpty()
+        tty.setraw(hub)
+        tty.setraw(controller)
+        os.set_blocking(controller, False)
+        pairs.append((hub, controller))
+    return pairs
+
+
+def sim(args):
+    """
+    Simulates a corridor of controllers, each interlocked with its direct neighbours.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if no interlock violation occurred, 1 otherwise.
+    """
+    rng = random.Random(args.seed)
+    pairs = openBus(args.nodes)
+    controllers = []
+    for index, (_, fd) in enumerate(pairs):
+        address = index + 1
+        neighbours = {a for a in (address - 1, address + 1) if 1 <= a <= args.nodes}
+        controllers.append(SimulatedController(address, neighbours, fd, args.rate, rng))
+
+    hubFds = [hub for hub, _ in pairs]
+    decoders = {fd: FrameDecoder() for fd in hubFds}
+    published = {}
+    violations = 0
+    frames = 0
+
+    end = time.monotonic() + args.duration
+    while time.monotonic() < end:
+        now = time.monotonic()
+        for controller in controllers:
+            controller.process(now)
+
+        # The hub forwards every byte to all other controllers, like the shared line
+        ready, _, _ = select.select(hubFds, [], [], 0.001)
+        for fd in ready:
+            data = os.read(fd, 1024)
+            for other in hubFds:
+                if other != fd:
+                    os.write(other, data)
+
+            for destination, source, frameType, sequence, payload in decoders[fd].feed(data, now):
+                frames += 1
+                if frameType != FRAME_STATE:
+                    continue
+                published[source] = payload[0] != STATE_IDLE
+                for neighbour in (source - 1, source + 1):
+                    if published[source] and published.get(neighbour, False):
+                        violations += 1
+                        print(f"Violation: controllers {source} and {neighbour} unlocked at the same time")
+
+    latencies = sorted(l for controller in controllers for l in controller.latencies)
+    failures = sum(controller.failures for controller in controllers)
+    print(f"{args.nodes} controllers, {args.duration} s, {frames} frames")
+    print(f"{len(latencies)} grants, {failures} failed (denied or no answer)")
+    if latencies:
+        p99 = latencies[min(len(latencies) - 1, int(len(latencies) * 0.99))]
+        print(f"Grant latency: median {statistics.median(latencies) * 1000:.2f} ms, "
+              f"p99 {p99 * 1000:.2f} ms, max {latencies[-1] * 1000:.2f} ms")
+    print(f"{violations} interlock violation(s)")
+    return 1 if violations else 0
+
+
+def monitor(args):
+    """
+    Prints the frames on a real bus.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 when interrupted.
+    """
+    import serial
+
+    connection = serial.Serial(args.port, args.baud, timeout=0.01)
+    decoder = FrameDecoder()
+    start = time.monotonic()
+    try:
+        while True:
+            data = connection.read(256)
+            now = time.monotonic()
+            for destination, source, frameType, sequence, payload in decoder.feed(data, now):
+                target = "all" if destination == BROADCAST else str(destination)
+                text = f"{(now - start) * 1000:10.1f} ms {source} -> {target} {FRAME_NAMES.get(frameType, frameType)} #{sequence}"
+                if frameType == FRAME_STATE and len(payload) >= 2:
+                    state = STATE_NAMES[payload[0]] if payload[0] < len(STATE_NAMES) else payload[0]
+                    text += f" {state} unlocked 0x{payload[1]:x}"
+                print(text)
+    except KeyboardInterrupt:
+        print(f"{decoder.errors} discarded frame(s)")
+    finally:
+        connection.close()
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Monitor and simulate the controller bus")
+    subparsers = parser.add_subparsers(dest="mode", required=True)
+
+    monitorParser = subparsers.add_parser("monitor", help="Print the frames on a real bus")
+    monitorParser.add_argument("--port", required=True, help="The serial port of the RS-485 adapter")
+    monitorParser.add_argument("--baud", type=int, default=115200, help="The baud rate of the bus")
+
+    simParser = subparsers.add_parser("sim", help="Simulate a corridor of controllers over pseudo-terminals")
+    simParser.add_argument("--nodes", type=int, default=4, help=f"The number of controllers (2..{MAX_ADDRESS})")
+    simParser.add_argument("--duration", type=float, default=20, help="The simulated time (s)")
+    simParser.add_argument("--rate", type=float, default=1, help="Button presses per controller and second")
+    simParser.add_argument("--seed", type=int, default=1, help="Seed of the random button presses")
+    args = parser.parse_args()
+
+    if args.mode == "monitor":
+        return monitor(args)
+    if not 2 <= args.nodes <= MAX_ADDRESS:
+        parser.error(f"--nodes must be within 2..{MAX_ADDRESS}")
+    return sim(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
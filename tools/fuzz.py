@@ -0,0 +1,230 @@
+"""
+Randomized safety fuzzer for the door interlock.
+
+Generates random button/switch edge sequences with contact bounce, replays them
+on one or more controllers ( see tools/replay.py ) and checks that the controller
+never reports an interlock violation ( V-record ), i.e. both magnets released
+while a door is open. Each serial port is driven by its own worker thread, so
+throughput scales with the number of connected boards. A failing sequence is
+minimised automatically and written to a trace file for tools/replay.py.
+
+    python tools/fuzz.py --port COM3 --port COM4 --iterations 1000
+
+The unit test test/test_interlockFuzz runs the same fuzzer on the host against the
+firmware sources, without a controller.
+"""
+
+import argparse
+import random
+import sys
+import threading
+
+import replay
+
+INPUT_BUTTON_1 = 0
+INPUT_BUTTON_2 = 1
+INPUT_SWITCH_1 = 2
+INPUT_SWITCH_2 = 3
+
+# Pin levels of the inputs in their rest position ( buttons released, doors closed )
+REST_LEVEL = {INPUT_BUTTON_1: 0, INPUT_BUTTON_2: 0, INPUT_SWITCH_1: 0, INPUT_SWITCH_2: 0}
+
+
+def generateTrace(rng, edges, maxGap, maxBounce):
+    """
+    Generates a random input trace.
+
+    Args:
+        rng (random.Random): The random number generator.
+        edges (int): The number of input changes.
+        maxGap (int): The maximum time between two input changes (ms).
+        maxBounce (int): The maximum number of bounces per input change.
+
+    Returns:
+        list: The trace as list of (time, input, level) tuples.
+    """
+    levels = dict(REST_LEVEL)
+    trace = [(0, io, level) for io, level in levels.items()]
+    currentTime = 0
+
+    for _ in range(edges):
+        currentTime += rng.randint(1, maxGap)
+        io = rng.choice(list(levels))
+        level = 1 - levels[io]
+
+        # Contact bounce: a few short toggles before the level settles
+        for _ in range(rng.randint(0, maxBounce)):
+            trace.append((currentTime, io, level))
+            currentTime += rng.randint(1, 5)
+            trace.append((currentTime, io, 1 - level))
+            currentTime += rng.randint(1, 5)
+
+        trace.append((currentTime, io, level))
+        levels[io] = level
+
+    return trace
+
+
+def runTrace(connection, trace, tick):
+    """
+    Replays a trace and collects the reported interlock violations.
+
+    Args:
+        connection (serial.Serial): The serial port of the controller.
+        trace (list): The trace as list of (time, input, level) tuples.
+        tick (int): The virtual time step while inputs are debouncing (ms).
+
+    Returns:
+        list: The received V-records, or None if the replay failed.
+    """
+    violations = []
+    endTime = (trace[-1][0] if trace else 0) + 1000
+
+    connection.write(f"replay -t {tick}\n".encode())
+    if replay.readRecord(connection, "R") != "R start":
+        return None
+
+    records = [f"I {t} {io} {level}" for t, io, level in trace] + [f"E {endTime}"]
+    for record in records:
+        connection.write((record + "\n").encode())
+        while True:
+            line = replay.readRecord(connection, "VAR")
+            if line is None:
+                return None
+            if line.startswith("V "):
+                violations.append(line)
+            elif line.startswith("A ") or line.startswith("R done"):
+                break
+
+    return violations
+
+
+def minimize(connection, trace, tick):
+    """
+    Minimises a failing trace using delta debugging.
+
+    The initial input levels are always kept, all later edges are candidates for removal.
+
+    Args:
+        connection (serial.Serial): The serial port of the controller.
+        trace (list): The failing trace.
+        tick (int): The virtual time step while inputs are debouncing (ms).
+
+    Returns:
+        list: A trace that still fails but from which no single chunk can be removed.
+    """
+    initial = [record for record in trace if record[0] == 0]
+    edges = [record for record in trace if record[0] != 0]
+    chunks = 2
+
+    while len(edges) >= 2:
+        size = max(1, len(edges) // chunks)
+        reduced = False
+
+        for start in range(0, len(edges), size):
+            candidate = edges[:start] + edges[start + size:]
+            if runTrace(connection, initial + candidate, tick):
+                edges = candidate
+                chunks = max(chunks - 1, 2)
+                reduced = True
+                break
+
+        if not reduced:
+            if size == 1:
+                break
+            chunks = min(chunks * 2, len(edges))
+
+    return initial + edges
+
+
+def configure(connection, rng):
+    """
+    Applies random debounce and timer settings.
+
+    Note that every setting is persisted to the EEPROM of the controller.
+
+    Args:
+        connection (serial.Serial): The serial port of the controller.
+        rng (random.Random): The random number generator.
+    """
+    for io in REST_LEVEL:
+        connection.write(f"dbc -i {io} -t {rng.randint(10, 300)}\n".encode())
+    connection.write(f"timer -u {rng.randint(1, 10)} -o {rng.randint(1, 3)}\n".encode())
+
+
+def worker(port, args, seed, results, lock):
+    """
+    Fuzzes a single controller.
+
+    Args:
+        port (str): The serial port of the controller.
+        args (argparse.Namespace): The command line arguments.
+        seed (int): The seed of the random number generator.
+        results (list): The list to append failing traces to.
+        lock (threading.Lock): Protects the results and the console output.
+    """
+    rng = random.Random(seed)
+    connection = replay.openPort(port, args.baud)
+
+    for iteration in range(args.iterations):
+        if args.settings:
+            configure(connection, rng)
+
+        trace = generateTrace(rng, args.edges, args.max_gap, args.max_bounce)
+        violations = runTrace(connection, trace, args.tick)
+
+        if violations is None:
+            with lock:
+                print(f"{port}: replay failed in iteration {iteration}")
+            return
+
+        if violations:
+            minimal = minimize(connection, trace, args.tick)
+            with lock:
+                print(f"{port}: interlock violation in iteration {iteration}: {violations[0]}")
+                results.append(minimal)
+            return
+
+    with lock:
+        print(f"{port}: {args.iterations} traces without violation")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Randomized safety fuzzer for the door interlock")
+    parser.add_argument("--port", action="append", required=True, help="Serial port of a controller, may be repeated")
+    parser.add_argument("--baud", type=int, default=115200, help="The baud rate of the serial interface")
+    parser.add_argument("--iterations", type=int, default=100, help="Number of traces per controller")
+    parser.add_argument("--edges", type=int, default=50, help="Number of input changes per trace")
+    parser.add_argument("--max-gap", type=int, default=10000, help="Maximum time between input changes (ms)")
+    parser.add_argument("--max-bounce", type=int, default=3, help="Maximum number of bounces per input change")
+    parser.add_argument("--tick", type=int, default=1, help="The virtual time step while inputs are debouncing (ms)")
+    parser.add_argument("--settings", action="store_true", help="Randomize debounce and timer settings ( written to EEPROM )")
+    parser.add_argument("--seed", type=int, default=None, help="The seed of the random number generator")
+    parser.add_argument("--output", default="failing_trace.txt", help="File for the minimised failing trace")
+    args = parser.parse_args()
+
+    seed = args.seed if args.seed is not None else random.randrange(1 << 32)
+    print(f"Seed: {seed}")
+
+    results = []
+    lock = threading.Lock()
+    threads = [threading.Thread(target=worker, args=(port, args, seed + index, results, lock)) for index, port in enumerate(args.port)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    if results:
+        minimal = min(results, key=len)
+        with open(args.output, "w") as traceFile:
+            for t, io, level in minimal:
+                traceFile.write(f"I {t} {io} {level}\n")
+            traceFile.write(f"E {minimal[-1][0] + 1000}\n")
+        print(f"Minimised failing trace with {len(minimal)} records written to {args.output}")
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,3 +1,6 @@
+import os
+
+import credentials
 import func
 
 Import("env")
@@ -8,6 +11,16 @@ def genSoftwareVersion():
     print ("Git-Version: " + buildVersion)
     return (buildFlag)
 
+def genCredentialTables():
+    generatedDir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    credentialFile = env.GetProjectOption("custom_credentials", "")
+    if credentialFile:
+        credentialFile = os.path.join(env.subst("$PROJECT_DIR"), credentialFile)
+    bench = "BENCH_FIRMWARE" in str(env.GetProjectOption("build_flags", ""))
+    credentials.generate(credentialFile or None, generatedDir, bench)
+    return (generatedDir)
+
 env.Append(
-    BUILD_FLAGS=[genSoftwareVersion()]
-)
\ No newline at end of file
+    BUILD_FLAGS=[genSoftwareVersion()],
+    CPPPATH=[genCredentialTables()]
+)
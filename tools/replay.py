@@ -0,0 +1,201 @@
+"""
+Records and replays door control traces over the serial interface.
+
+Record a trace from a running controller (stop with Ctrl+C):
+
+    python tools/replay.py record --port COM3 trace.txt
+
+Replay a trace with the virtual clock and diff the resulting state sequence
+against the S-records of the recording:
+
+    python tools/replay.py play --port COM3 trace.txt
+
+See src/replay.cpp for the trace format.
+"""
+
+import argparse
+import re
+import sys
+import time
+
+import serial
+
+RECORD_PATTERN = re.compile(r"^([ISE]) (\d+)(?: (\d+) (\d+))?$")
+
+
+def openPort(port, baud):
+    """
+    Opens the serial port and waits for the controller to finish booting.
+
+    Args:
+        port (str): The serial port of the controller.
+        baud (int): The baud rate of the serial interface.
+
+    Returns:
+        serial.Serial: The opened serial port.
+    """
+    connection = serial.Serial(port, baud, timeout=5)
+    time.sleep(2)
+    connection.reset_input_buffer()
+    return connection
+
+
+def readRecord(connection, prefixes):
+    """
+    Reads lines until a trace record with one of the given prefixes is received.
+
+    Log output interleaved with the trace records is skipped.
+
+    Args:
+        connection (serial.Serial): The serial port of the controller.
+        prefixes (str): The accepted record prefixes.
+
+    Returns:
+        str: The received record, or None on timeout.
+    """
+    while True:
+        line = connection.readline()
+        if not line:
+            return None
+        line = line.decode("ascii", errors="replace").strip()
+        if line[:1] in prefixes and line[1:2] == " ":
+            return line
+
+
+def loadTrace(fileName):
+    """
+    Loads a trace file and splits it into input and state records.
+
+    Args:
+        fileName (str): The trace file.
+
+    Returns:
+        tuple: The list of I-records and the list of (state, locks) tuples of the S-records.
+    """
+    inputs = []
+    states = []
+    endTime = 0
+    with open(fileName) as traceFile:
+        for line in traceFile:
+            match = RECORD_PATTERN.match(line.strip())
+            if not match:
+                continue
+            kind, recordTime = match.group(1), int(match.group(2))
+            endTime = max(endTime, recordTime)
+            if kind == "I":
+                inputs.append(line.strip())
+            elif kind == "S":
+                states.append((int(match.group(3)), int(match.group(4))))
+    return inputs, states, endTime
+
+
+def record(args):
+    """
+    Enables the trace recording and writes all trace records to a file.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+    """
+    connection = openPort(args.port, args.baud)
+    connection.write(b"trace 1\n")
+    print(f"Recording to {args.trace}, press Ctrl+C to stop")
+
+    lastTime = 0
+    with open(args.trace, "w") as traceFile:
+        try:
+            while True:
+                line = readRecord(connection, "IS")
+                if line:
+                    traceFile.write(line + "\n")
+                    traceFile.flush()
+                    lastTime = max(lastTime, int(line.split()[1]))
+        except KeyboardInterrupt:
+            pass
+        finally:
+            connection.write(b"trace 0\n")
+            # Close the trace one second after the last record
+            traceFile.write(f"E {lastTime + 1000}\n")
+
+
+def play(args):
+    """
+    Replays a trace and diffs the reported state sequence against the recording.
+
+    Args:
+        args (argparse.Namespace): The command line arguments.
+
+    Returns:
+        int: 0 if the state sequences match, 1 otherwise.
+    """
+    inputs, expected, endTime = loadTrace(args.trace)
+    connection = openPort(args.port, args.baud)
+    actual = []
+    violations = 0
+
+    connection.write(f"replay -t {args.tick}\n".encode())
+    if readRecord(connection, "R") != "R start":
+        print("Controller did not start the replay")
+        return 1
+
+    startTime = time.time()
+    for record in inputs + [f"E {endTime}"]:
+        connection.write((record + "\n").encode())
+        while True:
+            line = readRecord(connection, "SARV")
+            if line is None:
+                print(f"Timeout while replaying: {record}")
+                return 1
+            if line.startswith("V "):
+                print(f"Interlock violation: {line}")
+                violations += 1
+            elif line.startswith("S "):
+                fields = line.split()
+                actual.append((int(fields[2]), int(fields[3])))
+            elif line.startswith("A ") or line.startswith("R done"):
+                if line.startswith("R done"):
+                    print(f"Replayed {line.split()[2]} records in {line.split()[3]} steps")
+                break
+    duration = time.time() - startTime
+
+    print(f"Replayed {endTime / 1000.0:.1f} s of traffic in {duration:.2f} s")
+
+    # Consecutive duplicates can occur at the start of a recording
+    def compress(sequence):
+        return [entry for index, entry in enumerate(sequence) if index == 0 or sequence[index - 1] != entry]
+
+    if violations:
+        return 1
+
+    # Traces of the fuzzers have no S-records, only the violations count
+    if not expected:
+        return 0
+
+    expected, actual = compress(expected), compress(actual)
+    for index in range(max(len(expected), len(actual))):
+        want = expected[index] if index < len(expected) else None
+        got = actual[index] if index < len(actual) else None
+        if want != got:
+            print(f"Mismatch at state change {index}: expected (state, unlocked) {want}, got {got}")
+            return 1
+
+    print(f"{len(actual)} state changes match")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record and replay door control traces")
+    parser.add_argument("mode", choices=["record", "play"])
+    parser.add_argument("trace", help="The trace file")
+    parser.add_argument("--port", required=True, help="The serial port of the controller")
+    parser.add_argument("--baud", type=int, default=115200, help="The baud rate of the serial interface")
+    parser.add_argument("--tick", type=int, default=1, help="The virtual time step while inputs are debouncing (ms)")
+    args = parser.parse_args()
+
+    if args.mode == "record":
+        record(args)
+        return 0
+    return play(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())